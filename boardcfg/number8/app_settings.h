@@ -67,6 +67,29 @@ extern "C" {
  */
 #define COARSE_TIMER_ID 2
 
+/**
+ * @}
+ *
+ * @name USB Transport
+ * Settings for the @ref usb_transport.
+ * @{
+ */
+
+/**
+ * @brief The number of messages that can be queued for sending to the host.
+ *
+ * Each queued message requires a 576 byte buffer.
+ */
+#define USB_TRANSPORT_TX_QUEUE_SIZE 4
+
+/**
+ * @brief The maximum size of a transfer to the host.
+ *
+ * Queued messages are coalesced into a single transfer up to this size. This
+ * must be at least USB_READ_BUFFER_SIZE.
+ */
+#define USB_TRANSPORT_MAX_TRANSFER_SIZE 1024
+
 /**
  * @}
  *
@@ -111,6 +134,54 @@ extern "C" {
  */
 #define TRANSCEIVER_RX_ENABLE_PORT_BIT PORTS_BIT_POS_10
 
+/**
+ * @brief The number of operations that can be queued in the transceiver.
+ *
+ * Each queued operation requires a frame sized (513 byte) buffer.
+ */
+#define TRANSCEIVER_QUEUE_DEPTH 4
+
+/**
+ * @brief Use DMA to transmit frames.
+ *
+ * If true, after the first slot the UART is fed by a DMA channel rather than
+ * the UART TX interrupt.
+ */
+#define TRANSCEIVER_TX_DMA false
+
+/**
+ * @brief The DMA channel to use for transmit, if TRANSCEIVER_TX_DMA is true.
+ */
+#define TRANSCEIVER_TX_DMA_CHANNEL 0
+
+/**
+ * @brief Use DMA to receive frames.
+ *
+ * If true, received slots are written directly into the frame buffer by a
+ * DMA channel, rather than being read by the UART RX interrupt.
+ */
+#define TRANSCEIVER_RX_DMA false
+
+/**
+ * @brief The DMA channel to use for receive, if TRANSCEIVER_RX_DMA is true.
+ */
+#define TRANSCEIVER_RX_DMA_CHANNEL 1
+
+/**
+ * @}
+ *
+ * @name RDM Discovery
+ * Settings for the @ref rdm_discovery.
+ * @{
+ */
+
+/**
+ * @brief The maximum number of devices in the discovery device table.
+ *
+ * Each entry uses 8 bytes of RAM.
+ */
+#define RDM_DISCOVERY_TABLE_SIZE 256
+
 /**
  * @}
  *
@@ -32,7 +32,13 @@
   USBTransport_SendResponse(token, command, rc, iov, iov_count);
 
 #define PIPELINE_TRANSPORT_RX(data, size) \
-  StreamDecoder_Process(data, size);
+  StreamDecoder_ProcessMessage(data, size)
+
+#define PIPELINE_TRANSPORT_DMX_RX(data, size) \
+  DMXStream_Process(data, size);
+
+#define PIPELINE_TRANSPORT_SOF(frame_number) \
+  Transceiver_SOF(frame_number);
 
 #define PIPELINE_HANDLE_MESSAGE(message) \
   MessageHandler_HandleMessage(message);
@@ -46,6 +52,9 @@
 #define PIPELINE_TRANSCEIVER_RX_EVENT(event) \
   Responder_Receive(event);
 
+#define PIPELINE_TRANSCEIVER_RDM_FAST_PATH(frame, size, response) \
+  Responder_HandleFastPath(frame, size, response)
+
 #define PIPELINE_RDMRESPONDER_SEND(include_break, iov, iov_len) \
   Transceiver_QueueRDMResponse(include_break, iov, iov_len);
 
@@ -1,13 +1,17 @@
 noinst_LTLIBRARIES += firmware/src/libcoarsetimer.la \
                       firmware/src/libdimmermodel.la \
+                      firmware/src/libdmxstream.la \
                       firmware/src/libflags.la \
+                      firmware/src/liblatencytrace.la \
                       firmware/src/libledmodel.la \
                       firmware/src/libmessagehandler.la \
                       firmware/src/libmovinglightmodel.la \
                       firmware/src/libnetworkmodel.la \
                       firmware/src/libproxymodel.la \
                       firmware/src/librandom.la \
+                      firmware/src/librdmbatch.la \
                       firmware/src/librdmbuffer.la \
+                      firmware/src/librdmdiscovery.la \
                       firmware/src/librdmhandler.la \
                       firmware/src/librdmresponder.la \
                       firmware/src/librdmutil.la \
@@ -26,9 +30,15 @@ firmware_src_libcoarsetimer_la_CFLAGS = $(BUILD_FLAGS)
 firmware_src_libdimmermodel_la_SOURCES = firmware/src/dimmer_model.c
 firmware_src_libdimmermodel_la_CFLAGS = $(BUILD_FLAGS)
 
+firmware_src_libdmxstream_la_SOURCES = firmware/src/dmx_stream.c
+firmware_src_libdmxstream_la_CFLAGS = $(BUILD_FLAGS)
+
 firmware_src_libflags_la_SOURCES = firmware/src/flags.c
 firmware_src_libflags_la_CFLAGS = $(BUILD_FLAGS)
 
+firmware_src_liblatencytrace_la_SOURCES = firmware/src/latency_trace.c
+firmware_src_liblatencytrace_la_CFLAGS = $(BUILD_FLAGS)
+
 firmware_src_libledmodel_la_SOURCES = firmware/src/led_model.c
 firmware_src_libledmodel_la_CFLAGS = $(BUILD_FLAGS)
 
@@ -47,9 +57,15 @@ firmware_src_libmovinglightmodel_la_CFLAGS = $(BUILD_FLAGS)
 firmware_src_librandom_la_SOURCES = firmware/src/random.c
 firmware_src_librandom_la_CFLAGS = $(BUILD_FLAGS)
 
+firmware_src_librdmbatch_la_SOURCES = firmware/src/rdm_batch.c
+firmware_src_librdmbatch_la_CFLAGS = $(BUILD_FLAGS)
+
 firmware_src_librdmbuffer_la_SOURCES = firmware/src/rdm_buffer.c
 firmware_src_librdmbuffer_la_CFLAGS = $(BUILD_FLAGS)
 
+firmware_src_librdmdiscovery_la_SOURCES = firmware/src/rdm_discovery.c
+firmware_src_librdmdiscovery_la_CFLAGS = $(BUILD_FLAGS)
+
 firmware_src_librdmhandler_la_SOURCES = firmware/src/rdm_handler.c
 firmware_src_librdmhandler_la_CFLAGS = $(BUILD_FLAGS)
 
@@ -19,16 +19,22 @@
 
 #include "app.h"
 
+#include <string.h>
+
 #include "sys/attribs.h"
 
 #include "coarse_timer.h"
 #include "dimmer_model.h"
+#include "flags.h"
+#include "latency_trace.h"
 #include "led_model.h"
 #include "message_handler.h"
 #include "moving_light.h"
 #include "network_model.h"
 #include "proxy_model.h"
 #include "rdm.h"
+#include "rdm_batch.h"
+#include "rdm_discovery.h"
 #include "rdm_handler.h"
 #include "rdm_responder.h"
 #include "receiver_counters.h"
@@ -41,9 +47,9 @@
 #include "temperature.h"
 #include "transceiver.h"
 #include "uid_store.h"
+#include "usb_console.h"
 #include "usb_descriptors.h"
 #include "usb_transport.h"
-#include "uid_store.h"
 
 #include "app_settings.h"
 
@@ -70,7 +76,7 @@ void APP_Initialize(void) {
   CoarseTimer_Initialize(&timer_settings);
 
   // Initialize the Logging system, bottom up
-  USBTransport_Initialize(NULL);
+  USBTransport_Initialize(NULL, NULL);
   USBConsole_Initialize();
   SysLog_Initialize(NULL);
 
@@ -94,6 +100,16 @@ void APP_Initialize(void) {
     .timer_vector = AS_TIMER_INTERRUPT_VECTOR(TRANSCEIVER_TIMER),
     .timer_source = AS_TIMER_INTERRUPT_SOURCE(TRANSCEIVER_TIMER),
     .input_capture_timer = AS_IC_TMR_ID(TRANSCEIVER_TIMER),
+    .tx_dma = TRANSCEIVER_TX_DMA,
+    .tx_dma_channel = AS_DMA_CHANNEL(TRANSCEIVER_TX_DMA_CHANNEL),
+    .tx_dma_vector = AS_DMA_INTERRUPT_VECTOR(TRANSCEIVER_TX_DMA_CHANNEL),
+    .tx_dma_source = AS_DMA_INTERRUPT_SOURCE(TRANSCEIVER_TX_DMA_CHANNEL),
+    .tx_dma_trigger = AS_USART_DMA_TX_TRIGGER(TRANSCEIVER_UART),
+    .rx_dma = TRANSCEIVER_RX_DMA,
+    .rx_dma_channel = AS_DMA_CHANNEL(TRANSCEIVER_RX_DMA_CHANNEL),
+    .rx_dma_vector = AS_DMA_INTERRUPT_VECTOR(TRANSCEIVER_RX_DMA_CHANNEL),
+    .rx_dma_source = AS_DMA_INTERRUPT_SOURCE(TRANSCEIVER_RX_DMA_CHANNEL),
+    .rx_dma_trigger = AS_USART_DMA_RX_TRIGGER(TRANSCEIVER_UART),
   };
   Transceiver_Initialize(&transceiver_settings, NULL, NULL);
 
@@ -137,8 +153,11 @@ void APP_Initialize(void) {
   // Initialize the Host message layers.
   MessageHandler_Initialize(NULL);
   StreamDecoder_Initialize(NULL);
+  RDMDiscovery_Initialize(NULL);
+  RDMBatch_Initialize(NULL);
+  LatencyTrace_Initialize();
 
-  Flags_Initialize();
+  Flags_Initialize(NULL);
 
   // SPI DMX Output
   SPIRGBConfiguration spi_config;
@@ -155,6 +174,8 @@ void APP_Initialize(void) {
 void APP_Tasks(void) {
   USBTransport_Tasks();
   Transceiver_Tasks();
+  RDMDiscovery_Tasks();
+  RDMBatch_Tasks();
   USBConsole_Tasks();
 
   if (Transceiver_GetMode() == T_MODE_RESPONDER) {
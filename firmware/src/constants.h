@@ -110,6 +110,24 @@ typedef enum {
    */
   COMMAND_RUN_SELF_TEST = 0x03,
 
+  /**
+   * @brief Enable or disable the latency trace trailer.
+   * @sa @ref message-commands-setlatencytrace.
+   */
+  COMMAND_SET_LATENCY_TRACE = 0x04,
+
+  /**
+   * @brief Check if the latency trace trailer is enabled.
+   * @sa @ref message-commands-getlatencytrace.
+   */
+  COMMAND_GET_LATENCY_TRACE = 0x05,
+
+  /**
+   * @brief Get the USB transport TX queue statistics.
+   * @sa @ref message-commands-gettransportstats.
+   */
+  COMMAND_GET_TRANSPORT_STATS = 0x06,
+
   // User Configuration
   /**
    * @brief Set the break time of the transceiver.
@@ -135,6 +153,30 @@ typedef enum {
    */
   COMMAND_GET_MARK_TIME = 0x13,
 
+  /**
+   * @brief Set the DMX refresh interval.
+   * See @ref message-commands-setdmxrefresh
+   */
+  COMMAND_SET_DMX_REFRESH_INTERVAL = 0x14,
+
+  /**
+   * @brief Fetch the current DMX refresh interval.
+   * See @ref message-commands-getdmxrefresh
+   */
+  COMMAND_GET_DMX_REFRESH_INTERVAL = 0x15,
+
+  /**
+   * @brief Align DMX frames to USB Start-of-Frame packets.
+   * See @ref message-commands-setdmxsync
+   */
+  COMMAND_SET_DMX_SYNC = 0x16,
+
+  /**
+   * @brief Fetch the current DMX sync settings.
+   * See @ref message-commands-getdmxsync
+   */
+  COMMAND_GET_DMX_SYNC = 0x17,
+
   // Advanced Configuration
   /**
    * @brief Set the RDM Broadcast timeout.
@@ -196,9 +238,27 @@ typedef enum {
    */
   COMMAND_GET_RDM_RESPONDER_JITTER = 0x29,
 
+  /**
+   * @brief Set the background RDM discovery interval.
+   * See @ref message-commands-setdiscoveryinterval.
+   */
+  COMMAND_SET_RDM_DISCOVERY_INTERVAL = 0x2a,
+
+  /**
+   * @brief Get the background RDM discovery interval.
+   * See @ref message-commands-getdiscoveryinterval.
+   */
+  COMMAND_GET_RDM_DISCOVERY_INTERVAL = 0x2b,
+
   // DMX
   TX_DMX = 0x30,  //!< Transmit a DMX frame. See @ref message-commands-txdmx.
 
+  /**
+   * @brief Update slots in the DMX frame being refreshed.
+   * See @ref message-commands-patchdmx.
+   */
+  COMMAND_PATCH_DMX = 0x31,
+
   // RDM
   /**
    * @brief Send an RDM Discovery Unique Branch and wait for a response.
@@ -218,6 +278,37 @@ typedef enum {
    */
   COMMAND_RDM_BROADCAST_REQUEST = 0x42,
 
+  /**
+   * @brief Run full RDM discovery on the device.
+   * See @ref message-commands-rdmdiscovery.
+   */
+  COMMAND_RDM_DISCOVERY = 0x43,
+
+  /**
+   * @brief Get the UIDs in the device table.
+   * See @ref message-commands-rdmgetdevices.
+   */
+  COMMAND_RDM_GET_DEVICES = 0x44,
+
+  /**
+   * @brief Sent by the device when the device table changes.
+   * See @ref message-commands-rdmdeviceschanged.
+   */
+  COMMAND_RDM_DEVICES_CHANGED = 0x45,
+
+  /**
+   * @brief Send a batch of RDM Get / Set commands.
+   * See @ref message-commands-rdmbatch.
+   */
+  COMMAND_RDM_BATCH_REQUEST = 0x46,
+
+  // Sniffer
+  /**
+   * @brief A batch of frames captured in sniffer mode.
+   * See @ref message-commands-snifferframes.
+   */
+  COMMAND_SNIFFER_FRAMES = 0x50,
+
   // Experimental / testing
   COMMAND_ECHO = 0xf0,  //!< Echo the data back. See @ref message-commands-echo
   GET_FLAGS = 0xf2,  //!< Get the flags state
@@ -247,7 +338,17 @@ typedef enum {
   RC_INVALID_MODE = 8,  //!< The command is invalid in the current mode.
 
   RC_TEST_FAILED = 9,  //!< The self test failed
-  RC_CANCELLED = 10  //!< The request was preempted or cancelled
+  RC_CANCELLED = 10,  //!< The request was preempted or cancelled
+  RC_MORE_DATA = 11,  //!< More responses to this request will follow.
+  /**
+   * @brief A newer DMX frame replaced this one before it was sent.
+   */
+  RC_SUPERSEDED = 12,
+  /**
+   * @brief The command requires DMX refresh to be enabled.
+   */
+  RC_REFRESH_DISABLED = 13,
+  RC_BUSY = 14  //!< The operation is already running.
 } ReturnCode;
 
 /**
@@ -308,6 +409,22 @@ typedef enum {
  */
 #define DEFAULT_RDM_RESPONDER_DELAY 1760u
 
+/**
+ * @brief The default DMX refresh interval.
+ * @sa Transceiver_SetDMXRefreshInterval.
+ *
+ * Measured in 10ths of a millisecond. 0 disables the continuous DMX output.
+ */
+#define DEFAULT_DMX_REFRESH_INTERVAL 0u
+
+/**
+ * @brief The default background RDM discovery interval.
+ * @sa RDMDiscovery_SetInterval.
+ *
+ * Measured in 10ths of a millisecond. 0 disables background discovery.
+ */
+#define DEFAULT_RDM_DISCOVERY_INTERVAL 0u
+
 #endif  // FIRMWARE_SRC_CONSTANTS_H_
 
 /**
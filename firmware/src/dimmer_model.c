@@ -246,6 +246,7 @@ bool ResetToBlockAddress(uint16_t start_address) {
   for (i = 0u; i < NUMBER_OF_SUB_DEVICES; i++) {
     RDMResponder *responder = &g_subdevices[i].responder;
     responder->dmx_start_address = start_address;
+    RDMResponder_InvalidateCache(responder);
     const PersonalityDefinition *personality =
         &responder->def->personalities[responder->current_personality - 1u];
     start_address += personality->slot_count;
@@ -1063,6 +1064,7 @@ void DimmerModel_Initialize() {
     RDMResponder_InitResponder();
     g_responder->is_subdevice = true;
     g_responder->sub_device_count = NUMBER_OF_SUB_DEVICES;
+    RDMResponder_InvalidateCache(g_responder);
   }
 
   // restore
@@ -1072,6 +1074,7 @@ void DimmerModel_Initialize() {
     for (i = 0u; i < NUMBER_OF_SUB_DEVICES; i++) {
       RDMResponder *responder = &g_subdevices[i].responder;
       responder->dmx_start_address = INITIAL_START_ADDRESSS;
+      RDMResponder_InvalidateCache(responder);
     }
   }
 
@@ -1083,6 +1086,7 @@ static void DimmerModel_Activate() {
   g_responder->def = &ROOT_RESPONDER_DEFINITION;
   RDMResponder_InitResponder();
   g_responder->sub_device_count = NUMBER_OF_SUB_DEVICES;
+  RDMResponder_InvalidateCache(g_responder);
   g_root_device.status_message_timer = CoarseTimer_GetTime();
 }
 
@@ -1255,16 +1259,6 @@ static const PIDDescriptor ROOT_PID_DESCRIPTORS[] = {
     RDMResponder_SetDeviceLabel},
   {PID_SOFTWARE_VERSION_LABEL, RDMResponder_GetSoftwareVersionLabel, 0u,
     (PIDCommandHandler) NULL},
-  {PID_IDENTIFY_DEVICE, RDMResponder_GetIdentifyDevice, 0u,
-    RDMResponder_SetIdentifyDevice},
-  {PID_PERFORM_SELFTEST, DimmerModel_GetSelfTest, 0u,
-    DimmerModel_PerformSelfTest},
-  {PID_SELF_TEST_DESCRIPTION, DimmerModel_GetSelfTestDescription, 1u,
-    (PIDCommandHandler) NULL},
-  {PID_CAPTURE_PRESET, (PIDCommandHandler) NULL, 0,
-    DimmerModel_CapturePreset},
-  {PID_PRESET_PLAYBACK, DimmerModel_GetPresetPlayback, 0,
-    DimmerModel_SetPresetPlayback},
   {PID_DMX_BLOCK_ADDRESS, DimmerModel_GetDMXBlockAddress, 0u,
     DimmerModel_SetDMXBlockAddress},
   {PID_DMX_FAIL_MODE, DimmerModel_GetDMXFailMode, 0u,
@@ -1275,6 +1269,16 @@ static const PIDDescriptor ROOT_PID_DESCRIPTORS[] = {
   {PID_LOCK_STATE, DimmerModel_GetLockState, 0u, DimmerModel_SetLockState},
   {PID_LOCK_STATE_DESCRIPTION, DimmerModel_GetLockStateDescription, 1u,
     (PIDCommandHandler) NULL},
+  {PID_IDENTIFY_DEVICE, RDMResponder_GetIdentifyDevice, 0u,
+    RDMResponder_SetIdentifyDevice},
+  {PID_PERFORM_SELFTEST, DimmerModel_GetSelfTest, 0u,
+    DimmerModel_PerformSelfTest},
+  {PID_SELF_TEST_DESCRIPTION, DimmerModel_GetSelfTestDescription, 1u,
+    (PIDCommandHandler) NULL},
+  {PID_CAPTURE_PRESET, (PIDCommandHandler) NULL, 0,
+    DimmerModel_CapturePreset},
+  {PID_PRESET_PLAYBACK, DimmerModel_GetPresetPlayback, 0,
+    DimmerModel_SetPresetPlayback},
   {PID_PRESET_INFO, DimmerModel_GetPresetInfo, 0u,
     (PIDCommandHandler) NULL},
   {PID_PRESET_STATUS, DimmerModel_GetPresetStatus, 2u,
@@ -1326,15 +1330,10 @@ static const PIDDescriptor SUBDEVICE_PID_DESCRIPTORS[] = {
     (PIDCommandHandler) NULL},
   {PID_MANUFACTURER_LABEL, RDMResponder_GetManufacturerLabel, 0u,
     (PIDCommandHandler) NULL},
-  {PID_DMX_START_ADDRESS, RDMResponder_GetDMXStartAddress, 0u,
-    RDMResponder_SetDMXStartAddress},
   {PID_SOFTWARE_VERSION_LABEL, RDMResponder_GetSoftwareVersionLabel, 0u,
     (PIDCommandHandler) NULL},
-  {PID_IDENTIFY_DEVICE, RDMResponder_GetIdentifyDevice, 0u,
-    RDMResponder_SetIdentifyDevice},
-  {PID_BURN_IN, DimmerModel_GetBurnIn, 0u, DimmerModel_SetBurnIn},
-  {PID_IDENTIFY_MODE, DimmerModel_GetIdentifyMode, 0u,
-    DimmerModel_SetIdentifyMode},
+  {PID_DMX_START_ADDRESS, RDMResponder_GetDMXStartAddress, 0u,
+    RDMResponder_SetDMXStartAddress},
   {PID_DIMMER_INFO, DimmerModel_GetDimmerInfo, 0u,
     (PIDCommandHandler) NULL},
   {PID_MINIMUM_LEVEL, DimmerModel_GetMinimumLevel, 0u,
@@ -1353,6 +1352,11 @@ static const PIDDescriptor SUBDEVICE_PID_DESCRIPTORS[] = {
   {PID_MODULATION_FREQUENCY_DESCRIPTION,
     DimmerModel_GetModulationFrequencyDescription, 1u,
     (PIDCommandHandler) NULL},
+  {PID_BURN_IN, DimmerModel_GetBurnIn, 0u, DimmerModel_SetBurnIn},
+  {PID_IDENTIFY_DEVICE, RDMResponder_GetIdentifyDevice, 0u,
+    RDMResponder_SetIdentifyDevice},
+  {PID_IDENTIFY_MODE, DimmerModel_GetIdentifyMode, 0u,
+    DimmerModel_SetIdentifyMode},
 };
 
 static const ProductDetailIds SUBDEVICE_PRODUCT_DETAIL_ID_LIST = {
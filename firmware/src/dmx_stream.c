@@ -0,0 +1,40 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ * dmx_stream.c
+ * Copyright (C) 2015 Simon Newton
+ */
+
+#include "dmx_stream.h"
+
+#include "constants.h"
+#include "dmx_spec.h"
+#include "transceiver.h"
+
+void DMXStream_Process(const uint8_t *data, unsigned int size) {
+  if (size == 0u || size > DMX_FRAME_SIZE + 1u ||
+      data[0] == RDM_START_CODE ||
+      Transceiver_GetMode() != T_MODE_CONTROLLER) {
+    return;
+  }
+
+  // No event is generated when the frame has been sent.
+  if (data[0] == NULL_START_CODE) {
+    Transceiver_QueueDMX(TRANSCEIVER_NO_NOTIFICATION, data + 1, size - 1u);
+  } else {
+    Transceiver_QueueASC(TRANSCEIVER_NO_NOTIFICATION, data[0], data + 1,
+                         size - 1u);
+  }
+}
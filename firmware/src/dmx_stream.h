@@ -0,0 +1,70 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ * dmx_stream.h
+ * Copyright (C) 2015 Simon Newton
+ */
+
+/**
+ * @defgroup dmx_stream DMX Stream
+ * @brief Send DMX frames received on the dedicated DMX endpoint.
+ *
+ * The USB device has a second vendor interface, with a single bulk OUT
+ * endpoint, which only carries DMX frames. Each transfer is a single frame,
+ * the start code followed by up to 512 slots. There is no other framing, and
+ * no response is sent.
+ *
+ * The frames are queued with the transceiver directly, without going through
+ * the stream decoder or the message handler, so a slow RDM operation or a burst
+ * of configuration messages on the main endpoint doesn't delay the next DMX
+ * frame.
+ *
+ * Frames are dropped if the transceiver isn't in controller mode, or if the
+ * transceiver queue is full. Since the host sends frames continuously, the next
+ * frame will replace a dropped one.
+ *
+ * @addtogroup dmx_stream
+ * @{
+ * @file dmx_stream.h
+ * @brief Send DMX frames received on the dedicated DMX endpoint.
+ */
+
+#ifndef FIRMWARE_SRC_DMX_STREAM_H_
+#define FIRMWARE_SRC_DMX_STREAM_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Handle a frame from the DMX endpoint.
+ * @param data The frame, starting with the start code.
+ * @param size The size of the frame, including the start code.
+ *
+ * RDM frames are not accepted on the DMX endpoint.
+ */
+void DMXStream_Process(const uint8_t *data, unsigned int size);
+
+#ifdef __cplusplus
+}
+#endif
+
+/**
+ * @}
+ */
+
+#endif  // FIRMWARE_SRC_DMX_STREAM_H_
@@ -0,0 +1,130 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ * latency_trace.c
+ * Copyright (C) 2015 Simon Newton
+ */
+
+#include "latency_trace.h"
+
+#include <string.h>
+
+/*
+ * @brief The number of tokens tracked.
+ *
+ * This should cover the messages queued with the transceiver, plus the
+ * responses waiting to be written.
+ */
+enum { TRACE_SLOTS = 8u };
+
+typedef struct {
+  bool in_use;
+  uint8_t token;
+  uint8_t recorded;  //!< A bitmask of the recorded stages.
+  CoarseTimer_Value times[LATENCY_TRACE_STAGE_COUNT];
+} TraceSlot;
+
+typedef struct {
+  bool enabled;
+  uint8_t next_slot;  //!< The slot to use for the next token.
+  TraceSlot slots[TRACE_SLOTS];
+} LatencyTraceData;
+
+static LatencyTraceData g_trace;
+
+/*
+ * @brief Find the most recent slot for a token.
+ */
+static TraceSlot* FindSlot(uint8_t token) {
+  unsigned int i = 0u;
+  for (; i < TRACE_SLOTS; i++) {
+    TraceSlot *slot = &g_trace.slots[
+        (g_trace.next_slot + TRACE_SLOTS - 1u - i) % TRACE_SLOTS];
+    if (slot->in_use && slot->token == token) {
+      return slot;
+    }
+  }
+  return NULL;
+}
+
+// Public Functions
+// ----------------------------------------------------------------------------
+void LatencyTrace_Initialize() {
+  memset(&g_trace, 0, sizeof(g_trace));
+}
+
+void LatencyTrace_SetEnabled(bool enabled) {
+  if (enabled && !g_trace.enabled) {
+    memset(g_trace.slots, 0, sizeof(g_trace.slots));
+  }
+  g_trace.enabled = enabled;
+}
+
+bool LatencyTrace_IsEnabled() {
+  return g_trace.enabled;
+}
+
+void LatencyTrace_Start(uint8_t token) {
+  if (!g_trace.enabled) {
+    return;
+  }
+
+  TraceSlot *slot = &g_trace.slots[g_trace.next_slot];
+  g_trace.next_slot = (g_trace.next_slot + 1u) % TRACE_SLOTS;
+  slot->in_use = true;
+  slot->token = token;
+  slot->recorded = 1u << LATENCY_TRACE_DECODED;
+  memset(slot->times, 0, sizeof(slot->times));
+  slot->times[LATENCY_TRACE_DECODED] = CoarseTimer_GetTime();
+}
+
+void LatencyTrace_Record(uint8_t token, LatencyTraceStage stage) {
+  if (g_trace.enabled) {
+    LatencyTrace_RecordTime(token, stage, CoarseTimer_GetTime());
+  }
+}
+
+void LatencyTrace_RecordTime(uint8_t token, LatencyTraceStage stage,
+                             CoarseTimer_Value time) {
+  if (!g_trace.enabled) {
+    return;
+  }
+
+  TraceSlot *slot = FindSlot(token);
+  if (slot) {
+    slot->recorded |= 1u << stage;
+    slot->times[stage] = time;
+  }
+}
+
+void LatencyTrace_WriteTrailer(uint8_t token, uint8_t *trailer) {
+  memset(trailer, 0, LATENCY_TRACE_TRAILER_SIZE);
+  const TraceSlot *slot = FindSlot(token);
+  if (!slot) {
+    return;
+  }
+
+  trailer[0] = slot->recorded;
+  uint8_t *ptr = &trailer[1];
+  unsigned int i = 0u;
+  for (; i < LATENCY_TRACE_STAGE_COUNT; i++) {
+    // Little endian, like the rest of the message.
+    CoarseTimer_Value time = slot->times[i];
+    *ptr++ = time & 0xff;
+    *ptr++ = (time >> 8) & 0xff;
+    *ptr++ = (time >> 16) & 0xff;
+    *ptr++ = time >> 24;
+  }
+}
@@ -0,0 +1,120 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ * latency_trace.h
+ * Copyright (C) 2015 Simon Newton
+ */
+
+/**
+ * @defgroup latency_trace Latency Trace
+ * @brief Record when each stage of handling a message occurred.
+ *
+ * When tracing is enabled, each response carries a trailer with the device
+ * timestamps for the request with the same token. The host can use the
+ * timestamps to work out where the time was spent: in the decoder, waiting in
+ * the transceiver queue, on the wire or waiting for the USB write.
+ *
+ * The timestamps are CoarseTimer values, with a resolution of 100us. A small
+ * number of recent tokens are tracked, if a token is reused the timestamps are
+ * overwritten.
+ *
+ * See @ref message-format-trace for the trailer format.
+ *
+ * @addtogroup latency_trace
+ * @{
+ * @file latency_trace.h
+ * @brief Record when each stage of handling a message occurred.
+ */
+
+#ifndef FIRMWARE_SRC_LATENCY_TRACE_H_
+#define FIRMWARE_SRC_LATENCY_TRACE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "coarse_timer.h"
+#include "latency_trace_format.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Initialize the latency trace module.
+ *
+ * Tracing is disabled.
+ */
+void LatencyTrace_Initialize();
+
+/**
+ * @brief Enable or disable tracing.
+ * @param enabled true to add the trailer to responses.
+ */
+void LatencyTrace_SetEnabled(bool enabled);
+
+/**
+ * @brief Check if tracing is enabled.
+ * @returns true if responses should include the trailer.
+ */
+bool LatencyTrace_IsEnabled();
+
+/**
+ * @brief Start tracking a token, recording the LATENCY_TRACE_DECODED stage.
+ * @param token The token of the message that was decoded.
+ *
+ * Any timestamps from a previous message with the same token are cleared.
+ */
+void LatencyTrace_Start(uint8_t token);
+
+/**
+ * @brief Record the current time for a stage.
+ * @param token The token of the message.
+ * @param stage The stage that occurred.
+ *
+ * This has no effect if the token isn't being tracked.
+ */
+void LatencyTrace_Record(uint8_t token, LatencyTraceStage stage);
+
+/**
+ * @brief Record the time for a stage.
+ * @param token The token of the message.
+ * @param stage The stage that occurred.
+ * @param time When the stage occurred.
+ *
+ * This has no effect if the token isn't being tracked.
+ */
+void LatencyTrace_RecordTime(uint8_t token, LatencyTraceStage stage,
+                             CoarseTimer_Value time);
+
+/**
+ * @brief Write the trailer for a token.
+ * @param token The token of the message.
+ * @param trailer The buffer to write to, at least LATENCY_TRACE_TRAILER_SIZE
+ *   bytes.
+ *
+ * The timestamps are written in little endian format. If the token isn't
+ * being tracked, the bitmask will be 0.
+ */
+void LatencyTrace_WriteTrailer(uint8_t token, uint8_t *trailer);
+
+#ifdef __cplusplus
+}
+#endif
+
+/**
+ * @}
+ */
+
+#endif  // FIRMWARE_SRC_LATENCY_TRACE_H_
@@ -0,0 +1,68 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ * latency_trace_format.h
+ * Copyright (C) 2015 Simon Newton
+ */
+
+/**
+ * @addtogroup latency_trace
+ * @{
+ * @file latency_trace_format.h
+ * @brief The format of the latency trace trailer.
+ *
+ * This has no dependencies on the rest of the firmware, so the host tools can
+ * use it to parse the trailer.
+ */
+
+#ifndef FIRMWARE_SRC_LATENCY_TRACE_FORMAT_H_
+#define FIRMWARE_SRC_LATENCY_TRACE_FORMAT_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief The stages of handling a message.
+ */
+typedef enum {
+  LATENCY_TRACE_DECODED = 0,  //!< The message was decoded.
+  LATENCY_TRACE_QUEUED = 1,  //!< The operation was queued with the transceiver.
+  LATENCY_TRACE_BREAK = 2,  //!< The break for the operation started.
+  LATENCY_TRACE_COMPLETE = 3,  //!< The transceiver operation completed.
+  LATENCY_TRACE_WRITE = 4,  //!< The USB write for the response was issued.
+  LATENCY_TRACE_STAGE_COUNT = 5  //!< The number of stages.
+} LatencyTraceStage;
+
+/**
+ * @brief The size of the trailer, a bitmask of the recorded stages followed
+ *   by a 32-bit little endian timestamp for each stage.
+ */
+enum {
+  LATENCY_TRACE_TRAILER_SIZE =
+      1u + LATENCY_TRACE_STAGE_COUNT * sizeof(uint32_t)
+};
+
+#ifdef __cplusplus
+}
+#endif
+
+/**
+ * @}
+ */
+
+#endif  // FIRMWARE_SRC_LATENCY_TRACE_FORMAT_H_
@@ -26,12 +26,17 @@
 #include "app.h"
 #include "app_pipeline.h"
 #include "constants.h"
+#include "dmx_spec.h"
 #include "flags.h"
+#include "latency_trace.h"
 #include "peripheral/eth/plib_eth.h"
+#include "rdm_batch.h"
+#include "rdm_discovery.h"
 #include "rdm_frame.h"
 #include "rdm_handler.h"
 #include "syslog.h"
 #include "transceiver.h"
+#include "usb_transport.h"
 
 #include "app_settings.h"
 
@@ -111,6 +116,59 @@ static void RunSelfTest(uint8_t token, unsigned int length) {
   }
 }
 
+static void SetLatencyTrace(uint8_t token, const uint8_t* payload,
+                            unsigned int length) {
+  if (length != sizeof(uint8_t) || payload[0] > 1u) {
+    SendMessage(token, COMMAND_SET_LATENCY_TRACE, RC_BAD_PARAM, NULL, 0u);
+    return;
+  }
+  LatencyTrace_SetEnabled(payload[0]);
+  SendMessage(token, COMMAND_SET_LATENCY_TRACE, RC_OK, NULL, 0u);
+}
+
+static void ReturnLatencyTrace(uint8_t token, unsigned int length) {
+  if (length) {
+    SendMessage(token, COMMAND_GET_LATENCY_TRACE, RC_BAD_PARAM, NULL, 0u);
+    return;
+  }
+
+  uint8_t enabled = LatencyTrace_IsEnabled();
+  IOVec iovec;
+  iovec.base = &enabled;
+  iovec.length = sizeof(enabled);
+  SendMessage(token, COMMAND_GET_LATENCY_TRACE, RC_OK, &iovec, 1u);
+}
+
+static void ReturnTransportStats(uint8_t token, unsigned int length) {
+  if (length) {
+    SendMessage(token, COMMAND_GET_TRANSPORT_STATS, RC_BAD_PARAM, NULL, 0u);
+    return;
+  }
+
+  typedef struct {
+    uint32_t dropped;
+    uint32_t tx_errors;
+    uint32_t coalesced;
+    uint8_t queue_depth;
+    uint8_t queue_high_water;
+  } __attribute__((packed)) TransportStatsResponse;
+
+  USBTransportStats stats;
+  USBTransport_GetStats(&stats);
+
+  TransportStatsResponse response;
+  response.dropped = stats.dropped;
+  response.tx_errors = stats.tx_errors;
+  response.coalesced = stats.coalesced;
+  response.queue_depth = stats.queue_depth;
+  response.queue_high_water = stats.queue_high_water;
+
+  IOVec iovec;
+  iovec.base = &response;
+  iovec.length = sizeof(response);
+  SendMessage(token, COMMAND_GET_TRANSPORT_STATS, RC_OK, &iovec, 1u);
+}
+
 static void SetBreakTime(uint8_t token,
                          const uint8_t* payload,
                          unsigned int length) {
@@ -167,6 +225,65 @@ static void ReturnMarkTime(uint8_t token, unsigned int length) {
   SendMessage(token, COMMAND_GET_MARK_TIME, RC_OK, &iovec, 1u);
 }
 
+static void SetDMXRefreshInterval(uint8_t token,
+                                  const uint8_t* payload,
+                                  unsigned int length) {
+  uint16_t interval;
+  if (length != sizeof(interval)) {
+    SendMessage(token, COMMAND_SET_DMX_REFRESH_INTERVAL, RC_BAD_PARAM, NULL,
+                0u);
+    return;
+  }
+
+  interval = JoinUInt16(payload[1], payload[0]);
+  bool ok = Transceiver_SetDMXRefreshInterval(interval);
+  SendMessage(token, COMMAND_SET_DMX_REFRESH_INTERVAL,
+              ok ? RC_OK : RC_BAD_PARAM, NULL, 0u);
+}
+
+static void ReturnDMXRefreshInterval(uint8_t token, unsigned int length) {
+  if (length) {
+    SendMessage(token, COMMAND_GET_DMX_REFRESH_INTERVAL, RC_BAD_PARAM, NULL,
+                0u);
+    return;
+  }
+
+  uint16_t interval = Transceiver_GetDMXRefreshInterval();
+  IOVec iovec;
+  iovec.base = (uint8_t*) &interval;
+  iovec.length = sizeof(interval);
+  SendMessage(token, COMMAND_GET_DMX_REFRESH_INTERVAL, RC_OK, &iovec, 1u);
+}
+
+static void SetDMXSync(uint8_t token, const uint8_t* payload,
+                       unsigned int length) {
+  if (length != 2u * sizeof(uint16_t)) {
+    SendMessage(token, COMMAND_SET_DMX_SYNC, RC_BAD_PARAM, NULL, 0u);
+    return;
+  }
+
+  uint16_t period = JoinUInt16(payload[1], payload[0]);
+  uint16_t anchor = JoinUInt16(payload[3], payload[2]);
+  bool ok = Transceiver_SetDMXSync(period, anchor);
+  SendMessage(token, COMMAND_SET_DMX_SYNC, ok ? RC_OK : RC_BAD_PARAM, NULL,
+              0u);
+}
+
+static void ReturnDMXSync(uint8_t token, unsigned int length) {
+  if (length) {
+    SendMessage(token, COMMAND_GET_DMX_SYNC, RC_BAD_PARAM, NULL, 0u);
+    return;
+  }
+
+  uint16_t sync[2];
+  sync[0] = Transceiver_GetDMXSyncPeriod();
+  sync[1] = Transceiver_GetDMXSyncAnchor();
+  IOVec iovec;
+  iovec.base = (uint8_t*) sync;
+  iovec.length = sizeof(sync);
+  SendMessage(token, COMMAND_GET_DMX_SYNC, RC_OK, &iovec, 1u);
+}
+
 static void SetRDMBroadcastTimeout(uint8_t token,
                                    const uint8_t* payload,
                                    unsigned int length) {
@@ -314,6 +431,47 @@ static void ReturnRDMResponderJitter(uint8_t token, unsigned int length) {
   SendMessage(token, COMMAND_GET_RDM_RESPONDER_JITTER, RC_OK, &iovec, 1u);
 }
 
+static void SetRDMDiscoveryInterval(uint8_t token,
+                                    const uint8_t* payload,
+                                    unsigned int length) {
+  uint16_t interval;
+  if (length != sizeof(interval)) {
+    SendMessage(token, COMMAND_SET_RDM_DISCOVERY_INTERVAL, RC_BAD_PARAM, NULL,
+                0u);
+    return;
+  }
+
+  interval = JoinUInt16(payload[1], payload[0]);
+  bool ok = RDMDiscovery_SetInterval(interval);
+  SendMessage(token, COMMAND_SET_RDM_DISCOVERY_INTERVAL,
+              ok ? RC_OK : RC_BAD_PARAM, NULL, 0u);
+}
+
+static void ReturnRDMDiscoveryInterval(uint8_t token, unsigned int length) {
+  if (length) {
+    SendMessage(token, COMMAND_GET_RDM_DISCOVERY_INTERVAL, RC_BAD_PARAM,
+                NULL, 0u);
+    return;
+  }
+  uint16_t interval = RDMDiscovery_GetInterval();
+  IOVec iovec;
+  iovec.base = (uint8_t*) &interval;
+  iovec.length = sizeof(interval);
+  SendMessage(token, COMMAND_GET_RDM_DISCOVERY_INTERVAL, RC_OK, &iovec, 1u);
+}
+
+static void ReturnRDMDevices(uint8_t token, const uint8_t* payload,
+                             unsigned int length) {
+  uint16_t offset = 0u;
+  if (length == sizeof(offset)) {
+    offset = JoinUInt16(payload[1], payload[0]);
+  } else if (length) {
+    SendMessage(token, COMMAND_RDM_GET_DEVICES, RC_BAD_PARAM, NULL, 0u);
+    return;
+  }
+  RDMDiscovery_SendDevices(token, offset);
+}
+
 static bool CheckForTXMode(const Message *message) {
   if (Transceiver_GetMode() == T_MODE_CONTROLLER) {
     return true;
@@ -322,6 +480,76 @@ static bool CheckForTXMode(const Message *message) {
   return false;
 }
 
+/*
+ * @brief Apply the slot ranges in a patch DMX message.
+ *
+ * Each range is a 16 bit offset, a 16 bit length and then the slot data. All
+ * ranges are checked before any are applied, so a bad message leaves the
+ * frame untouched.
+ */
+static void PatchDMX(const Message *message) {
+  static const unsigned int RANGE_HEADER_SIZE = 4u;
+
+  if (message->length == 0u) {
+    SendMessage(message->token, message->command, RC_BAD_PARAM, NULL, 0u);
+    return;
+  }
+
+  unsigned int i = 0u;
+  while (i != message->length) {
+    if (message->length - i < RANGE_HEADER_SIZE) {
+      SendMessage(message->token, message->command, RC_BAD_PARAM, NULL, 0u);
+      return;
+    }
+    uint16_t offset = JoinUInt16(message->payload[i + 1],
+                                 message->payload[i]);
+    uint16_t length = JoinUInt16(message->payload[i + 3],
+                                 message->payload[i + 2]);
+    i += RANGE_HEADER_SIZE;
+    if (message->length - i < length ||
+        (uint32_t) offset + length > DMX_FRAME_SIZE) {
+      SendMessage(message->token, message->command, RC_BAD_PARAM, NULL, 0u);
+      return;
+    }
+    i += length;
+  }
+
+  if (Transceiver_GetDMXRefreshInterval() == 0u) {
+    // Without refresh there's no resident frame to patch.
+    SendMessage(message->token, message->command, RC_REFRESH_DISABLED, NULL,
+                0u);
+    return;
+  }
+
+  i = 0u;
+  while (i != message->length) {
+    uint16_t offset = JoinUInt16(message->payload[i + 1],
+                                 message->payload[i]);
+    uint16_t length = JoinUInt16(message->payload[i + 3],
+                                 message->payload[i + 2]);
+    i += RANGE_HEADER_SIZE;
+    if (!Transceiver_PatchDMX(offset, message->payload + i, length)) {
+      // The frame is being sent, and there's no room to queue a copy.
+      SendMessage(message->token, message->command, RC_BUFFER_FULL, NULL,
+                  0u);
+      return;
+    }
+    i += length;
+  }
+  SendMessage(message->token, message->command, RC_OK, NULL, 0u);
+}
+
+/*
+ * @brief Handle the result of queueing an operation with the transceiver.
+ */
+static void OperationQueued(const Message *message, bool ok) {
+  if (ok) {
+    LatencyTrace_Record(message->token, LATENCY_TRACE_QUEUED);
+  } else {
+    SendMessage(message->token, message->command, RC_BUFFER_FULL, NULL, 0u);
+  }
+}
+
 // Public Functions
 // ----------------------------------------------------------------------------
 void MessageHandler_Initialize(TransportTXFunction tx_cb) {
@@ -331,15 +559,22 @@ void MessageHandler_Initialize(TransportTXFunction tx_cb) {
 }
 
 void MessageHandler_HandleMessage(const Message *message) {
+  LatencyTrace_Start(message->token);
+
   switch (message->command) {
     case COMMAND_ECHO:
       Echo(message);
       break;
     case TX_DMX:
-      if (CheckForTXMode(message) &&
-          !Transceiver_QueueDMX(message->token, message->payload,
-                                message->length)) {
-        SendMessage(message->token, message->command, RC_BUFFER_FULL, NULL, 0u);
+      if (CheckForTXMode(message)) {
+        OperationQueued(message,
+                        Transceiver_QueueDMX(message->token, message->payload,
+                                             message->length));
+      }
+      break;
+    case COMMAND_PATCH_DMX:
+      if (CheckForTXMode(message)) {
+        PatchDMX(message);
       }
       break;
     case GET_FLAGS:
@@ -358,18 +593,29 @@ void MessageHandler_HandleMessage(const Message *message) {
     case COMMAND_RUN_SELF_TEST:
       RunSelfTest(message->token, message->length);
       break;
+    case COMMAND_SET_LATENCY_TRACE:
+      SetLatencyTrace(message->token, message->payload, message->length);
+      break;
+    case COMMAND_GET_LATENCY_TRACE:
+      ReturnLatencyTrace(message->token, message->length);
+      break;
+    case COMMAND_GET_TRANSPORT_STATS:
+      ReturnTransportStats(message->token, message->length);
+      break;
     case COMMAND_RDM_DUB_REQUEST:
-      if (CheckForTXMode(message) &&
-          !Transceiver_QueueRDMDUB(message->token, message->payload,
-                                   message->length)) {
-        SendMessage(message->token, message->command, RC_BUFFER_FULL, NULL, 0u);
+      if (CheckForTXMode(message)) {
+        OperationQueued(message,
+                        Transceiver_QueueRDMDUB(message->token,
+                                                message->payload,
+                                                message->length));
       }
       break;
     case COMMAND_RDM_REQUEST:
-      if (CheckForTXMode(message) &&
-          !Transceiver_QueueRDMRequest(message->token, message->payload,
-                                       message->length, false)) {
-        SendMessage(message->token, message->command, RC_BUFFER_FULL, NULL, 0u);
+      if (CheckForTXMode(message)) {
+        OperationQueued(message,
+                        Transceiver_QueueRDMRequest(message->token,
+                                                    message->payload,
+                                                    message->length, false));
       }
       break;
     case COMMAND_SET_BREAK_TIME:
@@ -384,6 +630,18 @@ void MessageHandler_HandleMessage(const Message *message) {
     case COMMAND_GET_MARK_TIME:
       ReturnMarkTime(message->token, message->length);
       break;
+    case COMMAND_SET_DMX_REFRESH_INTERVAL:
+      SetDMXRefreshInterval(message->token, message->payload, message->length);
+      break;
+    case COMMAND_GET_DMX_REFRESH_INTERVAL:
+      ReturnDMXRefreshInterval(message->token, message->length);
+      break;
+    case COMMAND_SET_DMX_SYNC:
+      SetDMXSync(message->token, message->payload, message->length);
+      break;
+    case COMMAND_GET_DMX_SYNC:
+      ReturnDMXSync(message->token, message->length);
+      break;
     case COMMAND_SET_RDM_BROADCAST_TIMEOUT:
       SetRDMBroadcastTimeout(message->token, message->payload, message->length);
       break;
@@ -414,12 +672,38 @@ void MessageHandler_HandleMessage(const Message *message) {
     case COMMAND_GET_RDM_RESPONDER_JITTER:
       ReturnRDMResponderJitter(message->token, message->length);
       break;
+    case COMMAND_SET_RDM_DISCOVERY_INTERVAL:
+      SetRDMDiscoveryInterval(message->token, message->payload,
+                              message->length);
+      break;
+    case COMMAND_GET_RDM_DISCOVERY_INTERVAL:
+      ReturnRDMDiscoveryInterval(message->token, message->length);
+      break;
 
     case COMMAND_RDM_BROADCAST_REQUEST:
-      if (CheckForTXMode(message) &&
-          !Transceiver_QueueRDMRequest(message->token, message->payload,
-                                       message->length, true)) {
-        SendMessage(message->token, message->command, RC_BUFFER_FULL, NULL, 0u);
+      if (CheckForTXMode(message)) {
+        OperationQueued(message,
+                        Transceiver_QueueRDMRequest(message->token,
+                                                    message->payload,
+                                                    message->length, true));
+      }
+      break;
+    case COMMAND_RDM_DISCOVERY:
+      if (CheckForTXMode(message) && !RDMDiscovery_Start(message->token)) {
+        // Discovery is already running.
+        SendMessage(message->token, message->command, RC_BUSY, NULL, 0u);
+      }
+      break;
+    case COMMAND_RDM_GET_DEVICES:
+      ReturnRDMDevices(message->token, message->payload, message->length);
+      break;
+    case COMMAND_RDM_BATCH_REQUEST:
+      if (CheckForTXMode(message)) {
+        ReturnCode rc = RDMBatch_Start(message->token, message->payload,
+                                       message->length);
+        if (rc != RC_OK) {
+          SendMessage(message->token, message->command, rc, NULL, 0u);
+        }
       }
       break;
 
@@ -430,8 +714,20 @@ void MessageHandler_HandleMessage(const Message *message) {
 }
 
 void MessageHandler_TransceiverEvent(const TransceiverEvent *event) {
+  if (event->token >= RDM_BATCH_TOKEN) {
+    RDMBatch_TransceiverEvent(event);
+    return;
+  }
+
+  if (event->token >= RDM_DISCOVERY_TOKEN) {
+    RDMDiscovery_TransceiverEvent(event);
+    return;
+  }
+
   uint8_t vector_size = 0u;
   IOVec iovec[2];
+  bool sent_frame = true;
+  bool traced = true;
 
   Command command;
   ReturnCode rc;
@@ -453,10 +749,17 @@ void MessageHandler_TransceiverEvent(const TransceiverEvent *event) {
       break;
     case T_RESULT_CANCELLED:
       rc = RC_CANCELLED;
+      // The operation was flushed from the queue before it was sent.
+      sent_frame = false;
       break;
     case T_RESULT_SELF_TEST_FAILED:
       rc = RC_TEST_FAILED;
       break;
+    case T_RESULT_SUPERSEDED:
+      rc = RC_SUPERSEDED;
+      // The frame never made it to the line.
+      sent_frame = false;
+      break;
     default:
       rc = RC_UNKNOWN;
   }
@@ -482,15 +785,31 @@ void MessageHandler_TransceiverEvent(const TransceiverEvent *event) {
       break;
     case T_OP_SELF_TEST:
       command = COMMAND_RUN_SELF_TEST;
+      sent_frame = false;
       break;
     case T_OP_MODE_CHANGE:
       command = COMMAND_SET_MODE;
+      sent_frame = false;
+      break;
+    case T_OP_SNIFFER:
+      command = COMMAND_SNIFFER_FRAMES;
+      sent_frame = false;
+      // Sniffer events always use token 0, they don't belong to a request.
+      traced = false;
       break;
     default:
       SysLog_Print(SYSLOG_INFO, "Unknown Transceiver op %d", event->op);
       return;
   }
 
+  if (sent_frame && LatencyTrace_IsEnabled()) {
+    LatencyTrace_RecordTime(event->token, LATENCY_TRACE_BREAK,
+                            Transceiver_GetFrameStartTime());
+  }
+  if (traced) {
+    LatencyTrace_Record(event->token, LATENCY_TRACE_COMPLETE);
+  }
+
   if (event->data && event->length > 0) {
     iovec[vector_size].base = event->data;
     iovec[vector_size].length = event->length;
@@ -656,8 +656,6 @@ static const PIDDescriptor PID_DESCRIPTORS[] = {
     RDMResponder_SetDeviceLabel},
   {PID_SOFTWARE_VERSION_LABEL, RDMResponder_GetSoftwareVersionLabel, 0u,
     (PIDCommandHandler) NULL},
-  {PID_IDENTIFY_DEVICE, RDMResponder_GetIdentifyDevice, 0u,
-    RDMResponder_SetIdentifyDevice},
   {PID_LIST_INTERFACES, NetworkModel_GetListInterfaces, 0u,
     (PIDCommandHandler) NULL},
   {PID_INTERFACE_LABEL, NetworkModel_GetInterfaceLabel, 4u,
@@ -684,6 +682,8 @@ static const PIDDescriptor PID_DESCRIPTORS[] = {
   {PID_DNS_HOSTNAME, NetworkModel_GetHostname, 0u, NetworkModel_SetHostname},
   {PID_DNS_DOMAIN_NAME, NetworkModel_GetDomainName, 0u,
     NetworkModel_SetDomainName},
+  {PID_IDENTIFY_DEVICE, RDMResponder_GetIdentifyDevice, 0u,
+    RDMResponder_SetIdentifyDevice},
 };
 
 static const ProductDetailIds PRODUCT_DETAIL_ID_LIST = {
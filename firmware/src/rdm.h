@@ -74,6 +74,11 @@ static const uint8_t RDM_CHECKSUM_LENGTH = 2u;
  */
 static const uint8_t MESSAGE_LENGTH_OFFSET = 2u;
 
+/**
+ * @brief The location of the command class in a frame.
+ */
+static const uint8_t RDM_COMMAND_CLASS_OFFSET = 20u;
+
 /**
  * @brief The location of the parameter data length in a frame.
  */
@@ -0,0 +1,266 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ * rdm_batch.c
+ * Copyright (C) 2015 Simon Newton
+ */
+
+#include "rdm_batch.h"
+
+#include <string.h>
+
+#include "app_pipeline.h"
+#include "rdm.h"
+#include "rdm_frame.h"
+#include "rdm_util.h"
+#include "syslog.h"
+#include "utils.h"
+
+/*
+ * @brief The maximum number of requests in a batch.
+ *
+ * The smallest request is a header and checksum, without the start code.
+ */
+enum { MAX_BATCH_REQUESTS = PAYLOAD_SIZE / (sizeof(RDMHeader) + 1) };
+
+/*
+ * @brief The number of requests queued with the transceiver at once.
+ *
+ * With two requests queued, the next one is ready to go as soon as the
+ * current one completes.
+ */
+enum { BATCH_WINDOW = 2 };
+
+/*
+ * @brief The size of the record header in the response.
+ *
+ * The return code, the response length and the three timing values.
+ */
+enum { RECORD_HEADER_SIZE = 1 + 2 + 6 };
+
+typedef struct {
+  bool active;  //!< True if a batch is in progress.
+  bool cancelled;  //!< True if the batch was cancelled.
+  uint8_t host_token;
+  uint8_t request_count;
+  uint8_t next_request;  //!< The index of the next request to queue.
+  uint8_t in_flight;  //!< The number of requests queued with the transceiver.
+  uint16_t offsets[MAX_BATCH_REQUESTS];  //!< The offset of each request.
+  uint8_t requests[PAYLOAD_SIZE];
+  unsigned int response_size;
+  uint8_t response[PAYLOAD_SIZE];
+} BatchData;
+
+static BatchData g_batch;
+
+#ifndef PIPELINE_TRANSPORT_TX
+static TransportTXFunction g_batch_tx_cb;
+#endif
+
+/*
+ * @brief The size of a request, excluding the start code.
+ */
+static inline unsigned int RequestSize(const uint8_t *request) {
+  // The message length excludes the checksum but includes the start code.
+  return request[MESSAGE_LENGTH_OFFSET - 1u] + RDM_CHECKSUM_LENGTH - 1u;
+}
+
+/*
+ * @brief Send the responses collected so far to the host.
+ */
+static void SendResponses(ReturnCode rc) {
+  IOVec iovec;
+  iovec.base = g_batch.response;
+  iovec.length = g_batch.response_size;
+
+#ifdef PIPELINE_TRANSPORT_TX
+  PIPELINE_TRANSPORT_TX(g_batch.host_token, COMMAND_RDM_BATCH_REQUEST, rc,
+                        &iovec, 1u);
+#else
+  if (g_batch_tx_cb) {
+    g_batch_tx_cb(g_batch.host_token, COMMAND_RDM_BATCH_REQUEST, rc, &iovec,
+                  1u);
+  }
+#endif
+  g_batch.response_size = 0u;
+}
+
+static void Complete() {
+  SendResponses(g_batch.cancelled ? RC_CANCELLED : RC_OK);
+  g_batch.active = false;
+}
+
+static ReturnCode ResultToReturnCode(const TransceiverEvent *event) {
+  bool is_broadcast = event->op == T_OP_RDM_BROADCAST;
+  switch (event->result) {
+    case T_RESULT_TX_ERROR:
+      return RC_TX_ERROR;
+    case T_RESULT_RX_DATA:
+      return is_broadcast ? RC_RDM_BCAST_RESPONSE : RC_OK;
+    case T_RESULT_RX_TIMEOUT:
+      return is_broadcast ? RC_OK : RC_RDM_TIMEOUT;
+    case T_RESULT_RX_INVALID:
+      return RC_RDM_INVALID_RESPONSE;
+    case T_RESULT_CANCELLED:
+      return RC_CANCELLED;
+    default:
+      return RC_UNKNOWN;
+  }
+}
+
+/*
+ * @brief Add the result of a request to the response buffer.
+ *
+ * If the record doesn't fit, the buffered records are sent first.
+ */
+static void AddRecord(const TransceiverEvent *event) {
+  unsigned int length = event->data ? event->length : 0u;
+  if (g_batch.response_size + RECORD_HEADER_SIZE + length > PAYLOAD_SIZE) {
+    SendResponses(RC_MORE_DATA);
+  }
+
+  uint16_t break_start = 0u;
+  uint16_t mark_start = 0u;
+  uint16_t mark_end = 0u;
+  if (event->op == T_OP_RDM_WITH_RESPONSE && event->timing) {
+    break_start = event->timing->get_set_response.break_start;
+    mark_start = event->timing->get_set_response.mark_start;
+    mark_end = event->timing->get_set_response.mark_end;
+  }
+
+  uint8_t *record = &g_batch.response[g_batch.response_size];
+  record[0] = ResultToReturnCode(event);
+  record[1] = ShortLSB(length);
+  record[2] = ShortMSB(length);
+  record[3] = ShortLSB(break_start);
+  record[4] = ShortMSB(break_start);
+  record[5] = ShortLSB(mark_start);
+  record[6] = ShortMSB(mark_start);
+  record[7] = ShortLSB(mark_end);
+  record[8] = ShortMSB(mark_end);
+  if (length) {
+    memcpy(&record[RECORD_HEADER_SIZE], event->data, length);
+  }
+  g_batch.response_size += RECORD_HEADER_SIZE + length;
+}
+
+// Public Functions
+// ----------------------------------------------------------------------------
+void RDMBatch_Initialize(TransportTXFunction tx_cb) {
+  memset(&g_batch, 0, sizeof(g_batch));
+#ifndef PIPELINE_TRANSPORT_TX
+  g_batch_tx_cb = tx_cb;
+#endif
+}
+
+ReturnCode RDMBatch_Start(uint8_t token, const uint8_t *data,
+                          unsigned int size) {
+  if (g_batch.active) {
+    return RC_BUSY;
+  }
+
+  if (size == 0u || size > PAYLOAD_SIZE) {
+    return RC_BAD_PARAM;
+  }
+
+  // Check each request is complete before we accept the batch.
+  unsigned int count = 0u;
+  unsigned int offset = 0u;
+  while (offset < size) {
+    unsigned int remaining = size - offset;
+    if (count == MAX_BATCH_REQUESTS || remaining < MESSAGE_LENGTH_OFFSET) {
+      return RC_BAD_PARAM;
+    }
+
+    const uint8_t *request = &data[offset];
+    if (request[MESSAGE_LENGTH_OFFSET - 1u] < sizeof(RDMHeader) ||
+        RequestSize(request) > remaining) {
+      return RC_BAD_PARAM;
+    }
+    // DUBs and other command classes need different handling, so they can't
+    // be batched.
+    uint8_t command_class = request[RDM_COMMAND_CLASS_OFFSET - 1u];
+    if (command_class != GET_COMMAND && command_class != SET_COMMAND) {
+      return RC_BAD_PARAM;
+    }
+    g_batch.offsets[count++] = offset;
+    offset += RequestSize(request);
+  }
+
+  memcpy(g_batch.requests, data, size);
+  g_batch.active = true;
+  g_batch.cancelled = false;
+  g_batch.host_token = token;
+  g_batch.request_count = count;
+  g_batch.next_request = 0u;
+  g_batch.in_flight = 0u;
+  g_batch.response_size = 0u;
+  return RC_OK;
+}
+
+void RDMBatch_TransceiverEvent(const TransceiverEvent *event) {
+  int16_t index = event->token - RDM_BATCH_TOKEN;
+  if (!g_batch.active || g_batch.in_flight == 0u || index < 0 ||
+      index >= g_batch.next_request) {
+    return;
+  }
+
+  g_batch.in_flight--;
+  if (event->result == T_RESULT_CANCELLED) {
+    // The mode changed or the transceiver was reset, don't send any more
+    // requests.
+    g_batch.cancelled = true;
+  } else {
+    AddRecord(event);
+  }
+
+  if (g_batch.in_flight == 0u &&
+      (g_batch.cancelled || g_batch.next_request == g_batch.request_count)) {
+    Complete();
+  }
+}
+
+void RDMBatch_Tasks() {
+  if (!g_batch.active) {
+    return;
+  }
+
+  if (Transceiver_GetMode() != T_MODE_CONTROLLER) {
+    g_batch.cancelled = true;
+  }
+
+  if (g_batch.cancelled) {
+    if (g_batch.in_flight == 0u) {
+      Complete();
+    }
+    return;
+  }
+
+  while (g_batch.in_flight < BATCH_WINDOW &&
+         g_batch.next_request < g_batch.request_count) {
+    const uint8_t *request =
+        &g_batch.requests[g_batch.offsets[g_batch.next_request]];
+    // The destination UID follows the sub start code and message length.
+    bool is_broadcast = !RDMUtil_IsUnicast(&request[MESSAGE_LENGTH_OFFSET]);
+    if (!Transceiver_QueueRDMRequest(RDM_BATCH_TOKEN + g_batch.next_request,
+                                     request, RequestSize(request),
+                                     is_broadcast)) {
+      // The transceiver queue is full, try again next time.
+      return;
+    }
+    g_batch.next_request++;
+    g_batch.in_flight++;
+  }
+}
@@ -0,0 +1,108 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ * rdm_batch.h
+ * Copyright (C) 2015 Simon Newton
+ */
+
+/**
+ * @defgroup rdm_batch RDM Batch
+ * @brief Send a batch of RDM requests with a single host message.
+ *
+ * The host sends a single message containing several RDM Get / Set requests.
+ * The requests are queued with the transceiver in order, keeping the next
+ * request queued while the current one is in progress, so the requests go out
+ * back to back without a round trip to the host between them.
+ *
+ * The responses, along with the timing information, are packed into as few
+ * messages as possible. See @ref message-commands-rdmbatch.
+ *
+ * The requests are queued using tokens from RDM_BATCH_TOKEN upwards. The
+ * completion events are passed to RDMBatch_TransceiverEvent() by the message
+ * handler.
+ *
+ * @addtogroup rdm_batch
+ * @{
+ * @file rdm_batch.h
+ * @brief Send a batch of RDM requests with a single host message.
+ */
+
+#ifndef FIRMWARE_SRC_RDM_BATCH_H_
+#define FIRMWARE_SRC_RDM_BATCH_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "constants.h"
+#include "transceiver.h"
+#include "transport.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Transceiver tokens at or above this value belong to a batch.
+ */
+enum { RDM_BATCH_TOKEN = 0x200 };
+
+/**
+ * @brief Initialize the RDM Batch module.
+ * @param tx_cb The callback to use for sending messages.
+ *
+ * If PIPELINE_TRANSPORT_TX is defined in app_pipeline.h, the macro
+ * will override the tx_cb argument.
+ */
+void RDMBatch_Initialize(TransportTXFunction tx_cb);
+
+/**
+ * @brief Start a batch of RDM requests.
+ * @param token The token of the host message. All responses are sent with
+ *   this token.
+ * @param data The RDM requests, each excluding the start code.
+ * @param size The size of the request data.
+ * @returns
+ *   - RC_OK if the batch was started, the responses will follow.
+ *   - RC_BAD_PARAM if the requests were malformed or a request wasn't a GET
+ *     or SET.
+ *   - RC_BUSY if a batch is already in progress.
+ */
+ReturnCode RDMBatch_Start(uint8_t token, const uint8_t *data,
+                          unsigned int size);
+
+/**
+ * @brief Handle the completion of a batched request.
+ * @param event The transceiver event, the token will be at least
+ *   RDM_BATCH_TOKEN.
+ */
+void RDMBatch_TransceiverEvent(const TransceiverEvent *event);
+
+/**
+ * @brief Perform the periodic batch tasks.
+ *
+ * This queues the next requests with the transceiver. It should be called
+ * from the main event loop.
+ */
+void RDMBatch_Tasks();
+
+#ifdef __cplusplus
+}
+#endif
+
+/**
+ * @}
+ */
+
+#endif  // FIRMWARE_SRC_RDM_BATCH_H_
@@ -38,6 +38,8 @@ static uint8_t RDM_BUFFER[RDM_MAX_FRAME_SIZE];
 
 uint8_t *g_rdm_buffer = RDM_BUFFER;
 
+const uint8_t *g_rdm_response = RDM_BUFFER;
+
 #ifdef __cplusplus
 }
 #endif
@@ -40,6 +40,16 @@ extern "C" {
  */
 extern uint8_t *g_rdm_buffer;
 
+/**
+ * @brief The RDM response to send.
+ *
+ * This normally points to g_rdm_buffer. Handlers that reply with a frame that
+ * was built in advance point it at that frame instead, rather than copying
+ * the frame into g_rdm_buffer. RDMHandler_HandleRequest() resets it before
+ * each request is handled.
+ */
+extern const uint8_t *g_rdm_response;
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,732 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ * rdm_discovery.c
+ * Copyright (C) 2015 Simon Newton
+ */
+
+#include "rdm_discovery.h"
+
+#include <string.h>
+
+#include "app_pipeline.h"
+#include "coarse_timer.h"
+#include "constants.h"
+#include "rdm.h"
+#include "rdm_frame.h"
+#include "rdm_handler.h"
+#include "rdm_util.h"
+#include "syslog.h"
+#include "utils.h"
+
+#include "app_settings.h"
+
+/*
+ * @brief The highest UID a responder can have, FFFF:FFFFFFFE.
+ */
+static const uint64_t MAX_RESPONDER_UID = 0xfffffffffffeull;
+
+/*
+ * @brief The maximum depth of the branch stack.
+ *
+ * Each split halves the branch, and the lower half is searched before the
+ * upper half, so there is at most one pending branch per bit of the UID.
+ */
+enum { BRANCH_STACK_SIZE = 49 };
+
+/*
+ * @brief The number of UIDs that fit in a single response.
+ */
+enum { UIDS_PER_RESPONSE = PAYLOAD_SIZE / UID_LENGTH };
+
+/*
+ * @brief The number of UIDs that fit in a get devices response.
+ *
+ * The response starts with the 16 bit device count.
+ */
+enum { DEVICES_PER_RESPONSE = (PAYLOAD_SIZE - 2) / UID_LENGTH };
+
+/*
+ * @brief The number of times we try to mute a responder.
+ */
+static const uint8_t MAX_MUTE_ATTEMPTS = 3u;
+
+/*
+ * @brief The number of times a branch can fail before we give up on it.
+ *
+ * A branch fails if a single UID collides, or the responder can't be muted.
+ */
+static const uint8_t MAX_BRANCH_FAILURES = 3u;
+
+/*
+ * @brief The smallest non-0 background discovery interval, 10ms.
+ */
+static const uint16_t MIN_BACKGROUND_INTERVAL = 100u;
+
+/*
+ * @brief The size of a device change record, the change type and the UID.
+ */
+enum { DEVICE_CHANGE_SIZE = 1 + UID_LENGTH };
+
+/*
+ * @brief The size of the largest discovery request, including the start code.
+ */
+enum {
+  DISCOVERY_REQUEST_SIZE = sizeof(RDMHeader) + 2 * UID_LENGTH + 2
+};
+
+/*
+ * @brief The size of the encoded UID & checksum in a DUB response.
+ */
+enum { DUB_EUID_SIZE = 2 * UID_LENGTH + 4 };
+
+/*
+ * @brief The maximum number of preamble bytes in a DUB response.
+ */
+static const uint8_t DUB_MAX_PREAMBLE = 7u;
+
+static const uint8_t DUB_PREAMBLE_BYTE = 0xfeu;
+static const uint8_t DUB_SEPARATOR_BYTE = 0xaau;
+
+/*
+ * @brief The discovery states.
+ */
+typedef enum {
+  DISCOVERY_IDLE,  //!< Discovery isn't running.
+  DISCOVERY_UNMUTE,  //!< Un-muting all responders.
+  DISCOVERY_DUB,  //!< Sending a DUB for the branch on the top of the stack.
+  DISCOVERY_MUTE,  //!< Muting a responder.
+  DISCOVERY_VERIFY,  //!< Checking a device in the table is still present.
+} DiscoveryState;
+
+/*
+ * @brief A range of UIDs still to be searched.
+ */
+typedef struct {
+  uint64_t lower;
+  uint64_t upper;
+  uint8_t failures;
+} Branch;
+
+typedef struct {
+  DiscoveryState state;
+  bool in_flight;  //!< True if a request is queued with the transceiver.
+  bool full;  //!< True if this is a full discovery requested by the host.
+  bool discard;  //!< Ignore the result of the in-flight request.
+  bool needs_unmute;  //!< The next background sweep starts with an un-mute.
+  uint16_t interval;  //!< The background discovery interval.
+  CoarseTimer_Value last_request;
+  uint8_t host_token;
+  uint8_t transaction_number;
+  int16_t next_token;
+  uint8_t mute_attempts;
+  uint64_t mute_uid;  //!< The UID being muted.
+  unsigned int stack_size;
+  Branch stack[BRANCH_STACK_SIZE];
+  unsigned int uid_count;  //!< The number of UIDs waiting to be sent.
+  uint8_t uids[UIDS_PER_RESPONSE * UID_LENGTH];
+  uint8_t request[DISCOVERY_REQUEST_SIZE];
+  unsigned int verify_index;  //!< The next device to verify.
+  unsigned int table_size;
+  uint64_t table[RDM_DISCOVERY_TABLE_SIZE];  //!< Sorted by UID.
+} DiscoveryData;
+
+static DiscoveryData g_discovery;
+
+#ifndef PIPELINE_TRANSPORT_TX
+static TransportTXFunction g_discovery_tx_cb;
+#endif
+
+static inline uint64_t UIDToUInt64(const uint8_t *uid) {
+  uint64_t value = 0u;
+  unsigned int i = 0u;
+  for (; i < UID_LENGTH; i++) {
+    value = (value << 8) + uid[i];
+  }
+  return value;
+}
+
+static inline void UInt64ToUID(uint64_t value, uint8_t *uid) {
+  unsigned int i = UID_LENGTH;
+  while (i != 0u) {
+    i--;
+    uid[i] = value & 0xff;
+    value >>= 8;
+  }
+}
+
+static inline void Send(uint8_t token, Command command, ReturnCode rc,
+                        const IOVec *iov, unsigned int iov_count) {
+#ifdef PIPELINE_TRANSPORT_TX
+  PIPELINE_TRANSPORT_TX(token, command, rc, iov, iov_count);
+#else
+  if (g_discovery_tx_cb) {
+    g_discovery_tx_cb(token, command, rc, iov, iov_count);
+  }
+#endif
+}
+
+/*
+ * @brief Find a UID in the device table.
+ * @param uid The UID to find.
+ * @param[out] index The index of the UID, or where it should be inserted.
+ * @returns true if the UID is in the table.
+ */
+static bool TableFind(uint64_t uid, unsigned int *index) {
+  unsigned int lower = 0u;
+  unsigned int upper = g_discovery.table_size;
+  while (lower < upper) {
+    unsigned int mid = lower + (upper - lower) / 2u;
+    if (g_discovery.table[mid] < uid) {
+      lower = mid + 1u;
+    } else {
+      upper = mid;
+    }
+  }
+  *index = lower;
+  return lower < g_discovery.table_size && g_discovery.table[lower] == uid;
+}
+
+/*
+ * @brief Add a UID to the device table.
+ * @returns false if the UID was already present, true otherwise.
+ *
+ * If the table is full the UID isn't stored, but it's still treated as new.
+ */
+static bool TableInsert(uint64_t uid) {
+  unsigned int index;
+  if (TableFind(uid, &index)) {
+    return false;
+  }
+
+  if (g_discovery.table_size == RDM_DISCOVERY_TABLE_SIZE) {
+    SysLog_Print(SYSLOG_INFO, "Discovery: device table full");
+    return true;
+  }
+
+  memmove(&g_discovery.table[index + 1u], &g_discovery.table[index],
+          (g_discovery.table_size - index) * sizeof(uint64_t));
+  g_discovery.table[index] = uid;
+  g_discovery.table_size++;
+  return true;
+}
+
+static void TableRemove(unsigned int index) {
+  g_discovery.table_size--;
+  memmove(&g_discovery.table[index], &g_discovery.table[index + 1u],
+          (g_discovery.table_size - index) * sizeof(uint64_t));
+}
+
+/*
+ * @brief Tell the host a device was added or removed.
+ */
+static void SendChange(RDMDeviceChange change, uint64_t uid) {
+  uint8_t record[DEVICE_CHANGE_SIZE];
+  record[0] = change;
+  UInt64ToUID(uid, &record[1]);
+
+  IOVec iovec;
+  iovec.base = record;
+  iovec.length = DEVICE_CHANGE_SIZE;
+  Send(0u, COMMAND_RDM_DEVICES_CHANGED, RC_OK, &iovec, 1u);
+}
+
+/*
+ * @brief Send the UIDs found so far to the host.
+ * @param rc The return code for the response.
+ */
+static void SendUIDs(ReturnCode rc) {
+  IOVec iovec;
+  iovec.base = g_discovery.uids;
+  iovec.length = g_discovery.uid_count * UID_LENGTH;
+  Send(g_discovery.host_token, COMMAND_RDM_DISCOVERY, rc, &iovec, 1u);
+  g_discovery.uid_count = 0u;
+}
+
+/*
+ * @brief Record a UID which was found and muted.
+ *
+ * For a full discovery, the UIDs are sent to the host once the buffer is
+ * full. For background discovery, only devices not already in the table are
+ * reported.
+ */
+static void AddUID(uint64_t uid) {
+  bool is_new = TableInsert(uid);
+  if (!g_discovery.full) {
+    if (is_new) {
+      SendChange(RDM_DEVICE_ADDED, uid);
+    }
+    return;
+  }
+
+  UInt64ToUID(uid, &g_discovery.uids[g_discovery.uid_count * UID_LENGTH]);
+  g_discovery.uid_count++;
+  if (g_discovery.uid_count == UIDS_PER_RESPONSE) {
+    SendUIDs(RC_MORE_DATA);
+  }
+}
+
+/*
+ * @brief End the current discovery run.
+ *
+ * For a full discovery, the last UIDs are sent to the host.
+ */
+static void Complete(ReturnCode rc) {
+  if (g_discovery.full) {
+    SendUIDs(rc);
+  }
+  if (rc != RC_OK) {
+    // Some responders may have been left un-muted.
+    g_discovery.needs_unmute = true;
+  }
+  g_discovery.state = DISCOVERY_IDLE;
+  g_discovery.full = false;
+  g_discovery.stack_size = 0u;
+}
+
+static void PushBranch(uint64_t lower, uint64_t upper) {
+  Branch *branch = &g_discovery.stack[g_discovery.stack_size];
+  branch->lower = lower;
+  branch->upper = upper;
+  branch->failures = 0u;
+  g_discovery.stack_size++;
+}
+
+/*
+ * @brief Split the branch on the top of the stack.
+ *
+ * The lower half ends up on the top of the stack, so it's searched first.
+ */
+static void SplitBranch() {
+  g_discovery.stack_size--;
+  Branch *branch = &g_discovery.stack[g_discovery.stack_size];
+  uint64_t lower = branch->lower;
+  uint64_t upper = branch->upper;
+  uint64_t mid = lower + (upper - lower) / 2u;
+  PushBranch(mid + 1u, upper);
+  PushBranch(lower, mid);
+}
+
+/*
+ * @brief Note a failure of the branch on the top of the stack.
+ *
+ * The branch is dropped once it fails too many times.
+ */
+static void BranchFailed() {
+  Branch *branch = &g_discovery.stack[g_discovery.stack_size - 1u];
+  branch->failures++;
+  if (branch->failures >= MAX_BRANCH_FAILURES) {
+    SysLog_Print(SYSLOG_INFO, "Discovery: dropping branch");
+    g_discovery.stack_size--;
+  }
+}
+
+/*
+ * @brief Start a background sweep, if one is due.
+ * @returns true if a sweep was started.
+ *
+ * A sweep checks one device from the table is still present, and then sends a
+ * DUB for the entire UID space. Since known devices are muted, only new
+ * devices respond.
+ */
+static bool StartSweep() {
+  if (g_discovery.interval == 0u ||
+      !CoarseTimer_HasElapsed(g_discovery.last_request,
+                              g_discovery.interval)) {
+    return false;
+  }
+
+  g_discovery.stack_size = 0u;
+  PushBranch(0u, MAX_RESPONDER_UID);
+  g_discovery.mute_attempts = 0u;
+  if (g_discovery.needs_unmute) {
+    g_discovery.state = DISCOVERY_UNMUTE;
+  } else if (g_discovery.table_size) {
+    if (g_discovery.verify_index >= g_discovery.table_size) {
+      g_discovery.verify_index = 0u;
+    }
+    g_discovery.state = DISCOVERY_VERIFY;
+  } else {
+    g_discovery.state = DISCOVERY_DUB;
+  }
+  return true;
+}
+
+/*
+ * @brief Decode a DUB response.
+ * @param data The raw response.
+ * @param length The size of the response.
+ * @param[out] uid The decoded UID.
+ * @returns true if the response was valid, false if it was corrupt, which
+ *   usually indicates a collision.
+ */
+static bool DecodeDUBResponse(const uint8_t *data, unsigned int length,
+                              uint64_t *uid) {
+  unsigned int offset = 0u;
+  while (offset < length && offset < DUB_MAX_PREAMBLE &&
+         data[offset] == DUB_PREAMBLE_BYTE) {
+    offset++;
+  }
+
+  if (offset == length || data[offset] != DUB_SEPARATOR_BYTE) {
+    return false;
+  }
+  offset++;
+
+  if (length - offset < DUB_EUID_SIZE) {
+    return false;
+  }
+
+  const uint8_t *euid = &data[offset];
+  uint8_t decoded[UID_LENGTH];
+  uint16_t checksum = 0u;
+  unsigned int i = 0u;
+  for (; i < UID_LENGTH; i++) {
+    // Each byte is sent twice, once OR'ed with 0xaa and once with 0x55.
+    if ((euid[2 * i] & 0xaa) != 0xaa || (euid[2 * i + 1] & 0x55) != 0x55) {
+      return false;
+    }
+    decoded[i] = euid[2 * i] & euid[2 * i + 1];
+    checksum += euid[2 * i] + euid[2 * i + 1];
+  }
+
+  const uint8_t *ecs = &euid[2 * UID_LENGTH];
+  if ((ecs[0] & ecs[1]) != ShortMSB(checksum) ||
+      (ecs[2] & ecs[3]) != ShortLSB(checksum)) {
+    return false;
+  }
+  *uid = UIDToUInt64(decoded);
+  return true;
+}
+
+/*
+ * @brief Build a discovery request in g_discovery.request.
+ * @param dest The destination UID.
+ * @param pid The discovery PID.
+ * @param param_data_length The size of the param data, which should already
+ *   be in place.
+ * @returns The size of the frame, including the start code.
+ */
+static unsigned int BuildRequest(uint64_t dest, uint16_t pid,
+                                 uint8_t param_data_length) {
+  RDMHeader *header = (RDMHeader*) g_discovery.request;
+  header->start_code = RDM_START_CODE;
+  header->sub_start_code = SUB_START_CODE;
+  header->message_length = sizeof(RDMHeader) + param_data_length;
+  UInt64ToUID(dest, header->dest_uid);
+  RDMHandler_GetUID(header->src_uid);
+  header->transaction_number = g_discovery.transaction_number;
+  header->port_id = 1u;
+  header->message_count = 0u;
+  header->sub_device = htons(SUBDEVICE_ROOT);
+  header->command_class = DISCOVERY_COMMAND;
+  header->param_id = htons(pid);
+  header->param_data_length = param_data_length;
+  return RDMUtil_AppendChecksum(g_discovery.request);
+}
+
+/*
+ * @brief Queue the next request with the transceiver.
+ * @returns true if the request was queued.
+ */
+static bool QueueRequest() {
+  static const uint64_t BROADCAST_UID = 0xffffffffffffull;
+  unsigned int size;
+  bool ok = false;
+
+  switch (g_discovery.state) {
+    case DISCOVERY_IDLE:
+      return false;
+    case DISCOVERY_UNMUTE:
+      size = BuildRequest(BROADCAST_UID, PID_DISC_UN_MUTE, 0u);
+      ok = Transceiver_QueueRDMRequest(g_discovery.next_token,
+                                       g_discovery.request + 1, size - 1u,
+                                       true);
+      break;
+    case DISCOVERY_DUB:
+      UInt64ToUID(g_discovery.stack[g_discovery.stack_size - 1u].lower,
+                  &g_discovery.request[RDM_PARAM_DATA_OFFSET]);
+      UInt64ToUID(g_discovery.stack[g_discovery.stack_size - 1u].upper,
+                  &g_discovery.request[RDM_PARAM_DATA_OFFSET + UID_LENGTH]);
+      size = BuildRequest(BROADCAST_UID, PID_DISC_UNIQUE_BRANCH,
+                          2 * UID_LENGTH);
+      ok = Transceiver_QueueRDMDUB(g_discovery.next_token,
+                                   g_discovery.request + 1, size - 1u);
+      break;
+    case DISCOVERY_MUTE:
+      size = BuildRequest(g_discovery.mute_uid, PID_DISC_MUTE, 0u);
+      ok = Transceiver_QueueRDMRequest(g_discovery.next_token,
+                                       g_discovery.request + 1, size - 1u,
+                                       false);
+      break;
+    case DISCOVERY_VERIFY:
+      size = BuildRequest(g_discovery.table[g_discovery.verify_index],
+                          PID_DISC_MUTE, 0u);
+      ok = Transceiver_QueueRDMRequest(g_discovery.next_token,
+                                       g_discovery.request + 1, size - 1u,
+                                       false);
+      break;
+  }
+  return ok;
+}
+
+/*
+ * @brief Check if an event holds a mute response from a responder.
+ * @param event The transceiver event.
+ * @param uid The UID of the responder the mute was sent to.
+ * @returns true if the response is valid and came from the responder.
+ */
+static bool IsMuteResponse(const TransceiverEvent *event, uint64_t uid) {
+  if (event->result != T_RESULT_RX_DATA ||
+      event->length < sizeof(RDMHeader) ||
+      !RDMUtil_VerifyChecksum(event->data, event->length)) {
+    return false;
+  }
+  const RDMHeader *header = (const RDMHeader*) event->data;
+  return header->command_class == DISCOVERY_COMMAND_RESPONSE &&
+         ntohs(header->param_id) == PID_DISC_MUTE &&
+         UIDToUInt64(header->src_uid) == uid;
+}
+
+static void HandleDUBResponse(const TransceiverEvent *event) {
+  Branch *branch = &g_discovery.stack[g_discovery.stack_size - 1u];
+  uint64_t uid;
+
+  if (event->result == T_RESULT_RX_TIMEOUT) {
+    // No responders in this branch.
+    g_discovery.stack_size--;
+  } else if (event->result == T_RESULT_RX_DATA &&
+             DecodeDUBResponse(event->data, event->length, &uid) &&
+             uid >= branch->lower && uid <= branch->upper) {
+    g_discovery.mute_uid = uid;
+    g_discovery.mute_attempts = 0u;
+    g_discovery.state = DISCOVERY_MUTE;
+  } else if (branch->lower == branch->upper) {
+    // A single UID can't collide with itself.
+    BranchFailed();
+  } else {
+    SplitBranch();
+  }
+}
+
+static void HandleMuteResponse(const TransceiverEvent *event) {
+  if (IsMuteResponse(event, g_discovery.mute_uid)) {
+    AddUID(g_discovery.mute_uid);
+    g_discovery.state = DISCOVERY_DUB;
+    return;
+  }
+
+  g_discovery.mute_attempts++;
+  if (g_discovery.mute_attempts < MAX_MUTE_ATTEMPTS) {
+    return;
+  }
+
+  SysLog_Print(SYSLOG_INFO, "Discovery: failed to mute responder");
+  g_discovery.state = DISCOVERY_DUB;
+  Branch *branch = &g_discovery.stack[g_discovery.stack_size - 1u];
+  if (branch->lower == branch->upper) {
+    BranchFailed();
+  } else {
+    // Colliding responses can occasionally decode to a valid UID that
+    // doesn't exist, so treat this as a collision.
+    SplitBranch();
+  }
+}
+
+static void HandleVerifyResponse(const TransceiverEvent *event) {
+  if (IsMuteResponse(event, g_discovery.table[g_discovery.verify_index])) {
+    g_discovery.verify_index++;
+    g_discovery.state = DISCOVERY_DUB;
+    return;
+  }
+
+  g_discovery.mute_attempts++;
+  if (g_discovery.mute_attempts < MAX_MUTE_ATTEMPTS) {
+    return;
+  }
+
+  uint64_t uid = g_discovery.table[g_discovery.verify_index];
+  TableRemove(g_discovery.verify_index);
+  SendChange(RDM_DEVICE_REMOVED, uid);
+  g_discovery.state = DISCOVERY_DUB;
+}
+
+// Public Functions
+// ----------------------------------------------------------------------------
+void RDMDiscovery_Initialize(TransportTXFunction tx_cb) {
+  memset(&g_discovery, 0, sizeof(g_discovery));
+  g_discovery.state = DISCOVERY_IDLE;
+  g_discovery.needs_unmute = true;
+  g_discovery.interval = DEFAULT_RDM_DISCOVERY_INTERVAL;
+  g_discovery.last_request = CoarseTimer_GetTime();
+  g_discovery.next_token = RDM_DISCOVERY_TOKEN;
+#ifndef PIPELINE_TRANSPORT_TX
+  g_discovery_tx_cb = tx_cb;
+#endif
+}
+
+bool RDMDiscovery_Start(uint8_t token) {
+  if (g_discovery.full) {
+    return false;
+  }
+
+  // A full discovery preempts a background sweep.
+  g_discovery.discard = g_discovery.in_flight;
+  g_discovery.full = true;
+  g_discovery.host_token = token;
+  g_discovery.uid_count = 0u;
+  g_discovery.table_size = 0u;
+  g_discovery.stack_size = 0u;
+  PushBranch(0u, MAX_RESPONDER_UID);
+  g_discovery.state = DISCOVERY_UNMUTE;
+  return true;
+}
+
+bool RDMDiscovery_IsRunning() {
+  return g_discovery.full;
+}
+
+bool RDMDiscovery_SetInterval(uint16_t interval) {
+  if (interval != 0u && interval < MIN_BACKGROUND_INTERVAL) {
+    return false;
+  }
+
+  g_discovery.interval = interval;
+  if (interval == 0u && !g_discovery.full &&
+      g_discovery.state != DISCOVERY_IDLE) {
+    g_discovery.discard = g_discovery.in_flight;
+    Complete(RC_CANCELLED);
+  }
+  return true;
+}
+
+uint16_t RDMDiscovery_GetInterval() {
+  return g_discovery.interval;
+}
+
+void RDMDiscovery_SendDevices(uint8_t token, uint16_t offset) {
+  if (g_discovery.full) {
+    // The table is being rebuilt, and the UID buffer holds the UIDs still to
+    // be sent to the host.
+    Send(token, COMMAND_RDM_GET_DEVICES, RC_BUSY, NULL, 0u);
+    return;
+  }
+
+  uint8_t count[sizeof(uint16_t)];
+  IOVec iov[2];
+  unsigned int iov_count = 1u;
+
+  count[0] = ShortLSB(g_discovery.table_size);
+  count[1] = ShortMSB(g_discovery.table_size);
+  iov[0].base = count;
+  iov[0].length = sizeof(count);
+
+  unsigned int end = offset;
+  end += DEVICES_PER_RESPONSE;
+  if (end > g_discovery.table_size) {
+    end = g_discovery.table_size;
+  }
+
+  uint8_t *uids = g_discovery.uids;
+  unsigned int i = offset;
+  for (; i < end; i++) {
+    UInt64ToUID(g_discovery.table[i], uids);
+    uids += UID_LENGTH;
+  }
+  iov[1].base = g_discovery.uids;
+  iov[1].length = uids - g_discovery.uids;
+  if (iov[1].length) {
+    iov_count++;
+  }
+  Send(token, COMMAND_RDM_GET_DEVICES, RC_OK, iov, iov_count);
+}
+
+void RDMDiscovery_TransceiverEvent(const TransceiverEvent *event) {
+  if (!g_discovery.in_flight || event->token != g_discovery.next_token) {
+    return;
+  }
+
+  g_discovery.in_flight = false;
+  g_discovery.transaction_number++;
+  g_discovery.next_token++;
+  if (g_discovery.next_token == RDM_DISCOVERY_TOKEN_LIMIT) {
+    g_discovery.next_token = RDM_DISCOVERY_TOKEN;
+  }
+
+  if (g_discovery.discard) {
+    // The request belonged to a background sweep which was stopped.
+    g_discovery.discard = false;
+    g_discovery.needs_unmute = true;
+    return;
+  }
+
+  if (event->result == T_RESULT_CANCELLED) {
+    Complete(RC_CANCELLED);
+    return;
+  } else if (event->result == T_RESULT_TX_ERROR) {
+    Complete(RC_TX_ERROR);
+    return;
+  }
+
+  switch (g_discovery.state) {
+    case DISCOVERY_IDLE:
+      return;
+    case DISCOVERY_UNMUTE:
+      g_discovery.needs_unmute = false;
+      g_discovery.state = DISCOVERY_DUB;
+      break;
+    case DISCOVERY_DUB:
+      HandleDUBResponse(event);
+      break;
+    case DISCOVERY_MUTE:
+      HandleMuteResponse(event);
+      break;
+    case DISCOVERY_VERIFY:
+      HandleVerifyResponse(event);
+      break;
+  }
+
+  if (g_discovery.state == DISCOVERY_DUB && g_discovery.stack_size == 0u) {
+    Complete(RC_OK);
+  }
+}
+
+void RDMDiscovery_Tasks() {
+  if (g_discovery.in_flight) {
+    return;
+  }
+
+  if (Transceiver_GetMode() != T_MODE_CONTROLLER) {
+    if (g_discovery.state != DISCOVERY_IDLE) {
+      Complete(RC_CANCELLED);
+    }
+    return;
+  }
+
+  if (g_discovery.state == DISCOVERY_IDLE) {
+    if (!StartSweep()) {
+      return;
+    }
+  } else if (!g_discovery.full &&
+             !CoarseTimer_HasElapsed(g_discovery.last_request,
+                                     g_discovery.interval)) {
+    // Background requests are spaced out so DMX frames can be sent between
+    // them.
+    return;
+  }
+
+  g_discovery.in_flight = QueueRequest();
+  g_discovery.last_request = CoarseTimer_GetTime();
+}
@@ -0,0 +1,157 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ * rdm_discovery.h
+ * Copyright (C) 2015 Simon Newton
+ */
+
+/**
+ * @defgroup rdm_discovery RDM Discovery
+ * @brief Run the E1.20 discovery algorithm on the device.
+ *
+ * Rather than the host sending each DUB, mute and un-mute, the device runs the
+ * binary search itself. All responders are un-muted, then the UID space is
+ * searched depth first. A branch which doesn't respond is dropped, a branch
+ * with a valid DUB response has the responder muted and is searched again, and
+ * a branch with a collision is split in two.
+ *
+ * The discovery requests are queued with the transceiver using tokens from
+ * RDM_DISCOVERY_TOKEN to RDM_DISCOVERY_TOKEN_LIMIT, which can never clash with
+ * the 8 bit host tokens. The completion events are passed to
+ * RDMDiscovery_TransceiverEvent() by the message handler.
+ *
+ * UIDs are sent to the host as they are found, see
+ * @ref message-commands-rdmdiscovery.
+ *
+ * @par Background Discovery
+ *
+ * The UIDs found are kept in a table, sorted by UID. If a background interval
+ * is set, the device also runs incremental discovery on its own. Each sweep
+ * tries to mute one device from the table, to check it's still present, and
+ * then sends DUBs until any new, un-muted devices are found. Only the changes
+ * to the table are sent to the host, see
+ * @ref message-commands-rdmdeviceschanged.
+ *
+ * Queued requests take priority over DMX frames in the transceiver, so
+ * background requests are spaced at least the background interval apart.
+ * This ensures DMX frames are still sent between the requests.
+ *
+ * @addtogroup rdm_discovery
+ * @{
+ * @file rdm_discovery.h
+ * @brief Run the E1.20 discovery algorithm on the device.
+ */
+
+#ifndef FIRMWARE_SRC_RDM_DISCOVERY_H_
+#define FIRMWARE_SRC_RDM_DISCOVERY_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "transceiver.h"
+#include "transport.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief The range of transceiver tokens used by discovery.
+ */
+enum {
+  RDM_DISCOVERY_TOKEN = 0x100,  //!< The first discovery token.
+  RDM_DISCOVERY_TOKEN_LIMIT = 0x200  //!< One past the last discovery token.
+};
+
+/**
+ * @brief The type of change to the device table.
+ */
+typedef enum {
+  RDM_DEVICE_REMOVED = 0,  //!< The device no longer responds.
+  RDM_DEVICE_ADDED = 1,  //!< A new device was found.
+} RDMDeviceChange;
+
+/**
+ * @brief Initialize the RDM Discovery module.
+ * @param tx_cb The callback to use for sending messages.
+ *
+ * If PIPELINE_TRANSPORT_TX is defined in app_pipeline.h, the macro
+ * will override the tx_cb argument.
+ */
+void RDMDiscovery_Initialize(TransportTXFunction tx_cb);
+
+/**
+ * @brief Start a full discovery.
+ * @param token The token of the host message which started discovery. All
+ *   responses are sent with this token.
+ * @returns true if discovery was started, false if it is already running.
+ */
+bool RDMDiscovery_Start(uint8_t token);
+
+/**
+ * @brief Check if discovery is running.
+ * @returns true if a full discovery is in progress.
+ */
+bool RDMDiscovery_IsRunning();
+
+/**
+ * @brief Set the interval between background discovery requests.
+ * @param interval The interval in 10ths of a millisecond, or 0 to disable
+ *   background discovery. The minimum non-0 interval is 10ms.
+ * @returns true if the interval was set, false if it was out of range.
+ */
+bool RDMDiscovery_SetInterval(uint16_t interval);
+
+/**
+ * @brief Get the interval between background discovery requests.
+ * @returns The interval in 10ths of a millisecond, 0 means disabled.
+ */
+uint16_t RDMDiscovery_GetInterval();
+
+/**
+ * @brief Send the contents of the device table to the host.
+ * @param token The token to use for the response.
+ * @param offset The index of the first UID to send.
+ *
+ * If a full discovery is running, RC_BUSY is sent instead.
+ *
+ * See @ref message-commands-rdmgetdevices.
+ */
+void RDMDiscovery_SendDevices(uint8_t token, uint16_t offset);
+
+/**
+ * @brief Handle the completion of a discovery request.
+ * @param event The transceiver event, the token will be at least
+ *   RDM_DISCOVERY_TOKEN.
+ */
+void RDMDiscovery_TransceiverEvent(const TransceiverEvent *event);
+
+/**
+ * @brief Perform the periodic discovery tasks.
+ *
+ * This queues the next discovery request with the transceiver. It should be
+ * called from the main event loop.
+ */
+void RDMDiscovery_Tasks();
+
+#ifdef __cplusplus
+}
+#endif
+
+/**
+ * @}
+ */
+
+#endif  // FIRMWARE_SRC_RDM_DISCOVERY_H_
@@ -22,27 +22,145 @@
 #include <string.h>
 
 #include "app_pipeline.h"
+#include "coarse_timer.h"
 #include "constants.h"
 #include "iovec.h"
 #include "macros.h"
 #include "rdm_buffer.h"
 #include "rdm_frame.h"
+#include "rdm_responder.h"
 #include "rdm_util.h"
 #include "syslog.h"
 #include "utils.h"
 
 enum { MAX_RDM_MODELS = 6 };
 
+/*
+ * @brief The number of responses kept for retransmission.
+ */
+enum { RETRANSMIT_CACHE_SIZE = 4 };
+
+/*
+ * @brief How long a response can be replayed for, in 10ths of a millisecond.
+ *
+ * Retries arrive within a few ms, this stops a transaction number that has
+ * wrapped around matching an old response.
+ */
+static const uint32_t RETRANSMIT_TIMEOUT = 10000u;
+
 static ModelEntry g_models[MAX_RDM_MODELS];
 
+/*
+ * @brief A response, and the request it was for.
+ *
+ * The sub_device and param_id are in network byte order, as they are in the
+ * RDMHeader.
+ */
+typedef struct {
+  uint8_t src_uid[UID_LENGTH];
+  uint8_t dest_uid[UID_LENGTH];
+  uint16_t sub_device;
+  uint16_t param_id;
+  uint8_t transaction_number;
+  uint8_t command_class;
+  uint8_t param_data_length;
+  uint16_t response_size;  // 0 if the entry is unused.
+  CoarseTimer_Value time;
+  // A reused transaction number with different param data mustn't match.
+  uint8_t param_data[MAX_PARAM_DATA_SIZE];
+  uint8_t response[RDM_MAX_FRAME_SIZE];
+} RetransmitEntry;
+
 typedef struct {
   uint16_t default_model;
   ModelEntry *active_model;
+  // True while a model is being activated or deactivated. The models rewrite
+  // the root responder then, so the fast path mustn't read it from the ISR.
+  volatile bool changing_model;
   RDMHandlerSendCallback send_callback;
+  unsigned int next_retransmit_entry;
+  RetransmitEntry retransmit_cache[RETRANSMIT_CACHE_SIZE];
 } RDMHandlerState;
 
 static RDMHandlerState g_rdm_handler;
 
+static void ClearRetransmitCache() {
+  unsigned int i = 0u;
+  for (; i < RETRANSMIT_CACHE_SIZE; i++) {
+    g_rdm_handler.retransmit_cache[i].response_size = 0u;
+  }
+  g_rdm_handler.next_retransmit_entry = 0u;
+}
+
+/*
+ * @brief Check if a request is a retry of one we've already responded to.
+ * @returns The cached response, or NULL if there wasn't one.
+ */
+static const RetransmitEntry *FindRetransmit(const RDMHeader *header,
+                                             const uint8_t *param_data) {
+  unsigned int i = 0u;
+  for (; i < RETRANSMIT_CACHE_SIZE; i++) {
+    const RetransmitEntry *entry = &g_rdm_handler.retransmit_cache[i];
+    if (entry->response_size &&
+        entry->transaction_number == header->transaction_number &&
+        entry->command_class == header->command_class &&
+        entry->param_id == header->param_id &&
+        entry->sub_device == header->sub_device &&
+        entry->param_data_length == header->param_data_length &&
+        (header->param_data_length == 0u ||
+         memcmp(entry->param_data, param_data,
+                header->param_data_length) == 0) &&
+        RDMUtil_UIDCompare(entry->src_uid, header->src_uid) == 0 &&
+        RDMUtil_UIDCompare(entry->dest_uid, header->dest_uid) == 0 &&
+        !CoarseTimer_HasElapsed(entry->time, RETRANSMIT_TIMEOUT)) {
+      return entry;
+    }
+  }
+  return NULL;
+}
+
+/*
+ * @brief Save a response so it can be replayed if the request is retried.
+ *
+ * Each responder, identified by UID and sub device, gets at most one entry.
+ */
+static void SaveRetransmit(const RDMHeader *header, const uint8_t *param_data,
+                           const uint8_t *response,
+                           unsigned int response_size) {
+  RetransmitEntry *entry = NULL;
+  unsigned int i = 0u;
+  for (; i < RETRANSMIT_CACHE_SIZE; i++) {
+    RetransmitEntry *candidate = &g_rdm_handler.retransmit_cache[i];
+    if (candidate->response_size &&
+        candidate->sub_device == header->sub_device &&
+        RDMUtil_UIDCompare(candidate->dest_uid, header->dest_uid) == 0) {
+      entry = candidate;
+      break;
+    }
+  }
+
+  if (entry == NULL) {
+    // Replace the oldest entry.
+    i = g_rdm_handler.next_retransmit_entry;
+    entry = &g_rdm_handler.retransmit_cache[i];
+    g_rdm_handler.next_retransmit_entry = (i + 1u) % RETRANSMIT_CACHE_SIZE;
+  }
+
+  memcpy(entry->src_uid, header->src_uid, UID_LENGTH);
+  memcpy(entry->dest_uid, header->dest_uid, UID_LENGTH);
+  entry->sub_device = header->sub_device;
+  entry->param_id = header->param_id;
+  entry->transaction_number = header->transaction_number;
+  entry->command_class = header->command_class;
+  entry->param_data_length = header->param_data_length;
+  if (header->param_data_length) {
+    memcpy(entry->param_data, param_data, header->param_data_length);
+  }
+  entry->time = CoarseTimer_GetTime();
+  memcpy(entry->response, response, response_size);
+  entry->response_size = response_size;
+}
+
 static int GetSetModelId(const RDMHeader *header,
                          const uint8_t *param_data) {
   uint8_t our_uid[UID_LENGTH];
@@ -138,7 +256,9 @@ static int GetModelList(const RDMHeader *header) {
 void RDMHandler_Initialize(const RDMHandlerSettings *settings) {
   g_rdm_handler.default_model = settings->default_model;
   g_rdm_handler.active_model = NULL;
+  g_rdm_handler.changing_model = false;
   g_rdm_handler.send_callback = settings->send_callback;
+  ClearRetransmitCache();
 
   unsigned int i = 0u;
   for (; i < MAX_RDM_MODELS; i++) {
@@ -161,8 +281,10 @@ bool RDMHandler_AddModel(const ModelEntry *entry) {
       g_models[i].request_fn = entry->request_fn;
       g_models[i].tasks_fn = entry->tasks_fn;
       if (entry->model_id == g_rdm_handler.default_model) {
+        g_rdm_handler.changing_model = true;
         g_rdm_handler.active_model = &g_models[i];
         g_rdm_handler.active_model->activate_fn();
+        g_rdm_handler.changing_model = false;
       }
       return true;
     }
@@ -177,10 +299,13 @@ bool RDMHandler_SetActiveModel(uint16_t model_id) {
   }
 
   if (model_id == NULL_MODEL_ID) {
+    g_rdm_handler.changing_model = true;
     if (g_rdm_handler.active_model) {
       g_rdm_handler.active_model->deactivate_fn();
     }
     g_rdm_handler.active_model = NULL;
+    g_rdm_handler.changing_model = false;
+    ClearRetransmitCache();
     return true;
   }
 
@@ -188,11 +313,14 @@ bool RDMHandler_SetActiveModel(uint16_t model_id) {
   for (; i < MAX_RDM_MODELS; i++) {
     if (g_models[i].model_id != NULL_MODEL_ID &&
         g_models[i].model_id == model_id) {
+      g_rdm_handler.changing_model = true;
       if (g_rdm_handler.active_model) {
         g_rdm_handler.active_model->deactivate_fn();
       }
       g_rdm_handler.active_model = &g_models[i];
       g_rdm_handler.active_model->activate_fn();
+      g_rdm_handler.changing_model = false;
+      ClearRetransmitCache();
       return true;
     }
   }
@@ -209,8 +337,23 @@ void RDMHandler_HandleRequest(const RDMHeader *header,
   // We need to intercept calls to the SET_MODEL_ID pid, and use them to change
   // the active model.
   int response_size = RDM_RESPONDER_NO_RESPONSE;
+  g_rdm_response = g_rdm_buffer;
+
+  // Discovery responses depend on the mute state, so they are never replayed.
+  bool cacheable = header->command_class != DISCOVERY_COMMAND &&
+                   RDMUtil_IsUnicast(header->dest_uid) &&
+                   header->param_data_length <= MAX_PARAM_DATA_SIZE;
+  const RetransmitEntry *retransmit = NULL;
+  if (cacheable) {
+    retransmit = FindRetransmit(header, param_data);
+  }
 
-  if (ntohs(header->param_id) == PID_DEVICE_MODEL) {
+  if (retransmit) {
+    // The controller is retrying, send the same response without running the
+    // handler again.
+    g_rdm_response = retransmit->response;
+    response_size = retransmit->response_size;
+  } else if (ntohs(header->param_id) == PID_DEVICE_MODEL) {
     response_size = GetSetModelId(header, param_data);
   } else if (ntohs(header->param_id) == PID_DEVICE_MODEL_LIST) {
     response_size = GetModelList(header);
@@ -222,9 +365,14 @@ void RDMHandler_HandleRequest(const RDMHeader *header,
     response_size = g_rdm_handler.active_model->request_fn(header, param_data);
   }
 
+  if (cacheable && !retransmit && response_size > 0 &&
+      response_size <= RDM_MAX_FRAME_SIZE) {
+    SaveRetransmit(header, param_data, g_rdm_response, response_size);
+  }
+
   if (response_size) {
     IOVec iov;
-    iov.base = g_rdm_buffer;
+    iov.base = g_rdm_response;
     iov.length = abs(response_size);
 
 #ifdef PIPELINE_RDMRESPONDER_SEND
@@ -235,6 +383,19 @@ void RDMHandler_HandleRequest(const RDMHeader *header,
   }
 }
 
+int RDMHandler_HandleFastPath(const RDMHeader *header,
+                              const uint8_t *param_data,
+                              const uint8_t **response) {
+  // The ISR can't interrupt itself, so if changing_model is clear here the
+  // main loop can't start rewriting the root responder until this returns.
+  // While it's set, the request is left for the main loop, which handles it
+  // once the new model is active.
+  if (!g_rdm_handler.active_model || g_rdm_handler.changing_model) {
+    return RDM_RESPONDER_NO_RESPONSE;
+  }
+  return RDMResponder_HandleFastPath(header, param_data, response);
+}
+
 void RDMHandler_GetUID(uint8_t *uid) {
   if (g_rdm_handler.active_model) {
     g_rdm_handler.active_model->ioctl_fn(IOCTL_GET_UID, uid, UID_LENGTH);
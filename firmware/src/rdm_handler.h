@@ -30,6 +30,15 @@
  * PID_DEVICE_MODEL_LIST aren't included in SUPPORTED_PARAMETERS so they are
  * 'hidden' PIDs.
  *
+ * Controllers retry a request, using the same transaction number, if the
+ * response was lost. The last response sent by each responder is kept for a
+ * short time, and replayed if the same request arrives again, so the handler
+ * isn't run twice. Discovery commands are never replayed.
+ *
+ * DISC_UNIQUE_BRANCH, DISC_MUTE and DISC_UN_MUTE for the root responder can
+ * be answered from the RX ISR with RDMHandler_HandleFastPath(), so the
+ * response timing doesn't depend on the main loop.
+ *
  * @addtogroup rdm_handler
  * @{
  * @file rdm_handler.h
@@ -114,6 +123,27 @@ uint16_t RDMHandler_ActiveModel();
 void RDMHandler_HandleRequest(const RDMHeader *header,
                               const uint8_t *param_data);
 
+/**
+ * @brief Handle a RDM Request from the RX ISR, if it can be answered there.
+ * @pre The same as RDMHandler_HandleRequest().
+ * @param header The RDM command header.
+ * @param param_data the parameter data
+ * @param[out] response Set to the response frame, if there is one.
+ * @returns The size of the response frame, negative if no break should be
+ *   sent, or 0 if there isn't a response.
+ *
+ * Only discovery commands for the root responder are handled, all models
+ * answer those the same way. The request is still passed to
+ * RDMHandler_HandleRequest() from the main loop afterwards.
+ *
+ * No response is returned while a model is being activated or deactivated,
+ * since the model may be rewriting the root responder's UID and DUB response.
+ * The main loop answers those requests instead.
+ */
+int RDMHandler_HandleFastPath(const RDMHeader *header,
+                              const uint8_t *param_data,
+                              const uint8_t **response);
+
 /**
  * @brief Get the UID of the responder.
  * @param[out] uid A pointer to copy the UID to; should be at least UID_LENGTH.
@@ -56,10 +56,28 @@ if (!RDMUtil_IsUnicast(header->dest_uid)) {\
   return RDM_RESPONDER_NO_RESPONSE; \
 }
 
+/*
+ * @brief The bits for RDMResponder.cache_flags.
+ */
+enum {
+  CACHE_DEVICE_INFO = 0x01,
+  CACHE_SUPPORTED_PARAMETERS = 0x02
+};
+
+// A DISC_MUTE / DISC_UN_MUTE response, with the control field.
+enum { MUTE_RESPONSE_LENGTH = sizeof(RDMHeader) + sizeof(uint16_t) + 2 };
+
 static RDMResponder root_responder;
 
 RDMResponder *g_responder = &root_responder;
 
+/*
+ * @brief The mute responses built from the USART ISR.
+ *
+ * This is separate from g_rdm_buffer, since the main loop may be using it.
+ */
+static uint8_t g_fast_path_response[MUTE_RESPONSE_LENGTH];
+
 /*
  * @brief The responder state.
  */
@@ -140,10 +158,32 @@ static uint8_t *BuildSensorValueResponse(uint8_t *ptr, uint8_t index,
   return ptr;
 }
 
-static inline uint16_t GetControlField() {
-  return (g_responder->sub_device_count ? MUTE_SUBDEVICE_FLAG : 0) |
-         (g_responder->is_managed_proxy ? MUTE_MANAGED_PROXY_FLAG : 0) |
-         (g_responder->is_proxied_device ? MUTE_PROXY_FLAG : 0);
+static inline uint16_t GetControlField(const RDMResponder *responder) {
+  return (responder->sub_device_count ? MUTE_SUBDEVICE_FLAG : 0) |
+         (responder->is_managed_proxy ? MUTE_MANAGED_PROXY_FLAG : 0) |
+         (responder->is_proxied_device ? MUTE_PROXY_FLAG : 0);
+}
+
+/*
+ * @brief Build the encoded DUB response for the current responder's UID.
+ */
+static void BuildDUBResponse() {
+  uint8_t *response = g_responder->dub_response;
+  memset(response, FE_CONSTANT, 7);
+  response[7] = AA_CONSTANT;
+
+  uint16_t checksum = 0u;
+  unsigned int i = 0u;
+  for (; i < UID_LENGTH; i++) {
+    response[8 + 2 * i] = g_responder->uid[i] | AA_CONSTANT;
+    response[9 + 2 * i] = g_responder->uid[i] | FIVE5_CONSTANT;
+    checksum += response[8 + 2 * i] + response[9 + 2 * i];
+  }
+
+  response[20] = ShortMSB(checksum) | AA_CONSTANT;
+  response[21] = ShortMSB(checksum) | FIVE5_CONSTANT;
+  response[22] = ShortLSB(checksum) | AA_CONSTANT;
+  response[23] = ShortLSB(checksum) | FIVE5_CONSTANT;
 }
 
 // Public Functions
@@ -199,6 +239,10 @@ void RDMResponder_RestoreResponder() {
   g_responder = &root_responder;
 }
 
+void RDMResponder_InvalidateCache(RDMResponder *responder) {
+  responder->cache_flags = 0u;
+}
+
 void RDMResponder_InitResponder() {
   // This resets the non-mutable state of the responder and then calls
   // RDMResponder_ResetToFactoryDefaults() to reset the mutable state.
@@ -206,6 +250,7 @@ void RDMResponder_InitResponder() {
   g_responder->is_subdevice = false;
   g_responder->is_managed_proxy = false;
   g_responder->is_proxied_device = false;
+  BuildDUBResponse();
 
   RDMResponder_ResetToFactoryDefaults();
 }
@@ -218,6 +263,7 @@ void RDMResponder_ResetToFactoryDefaults() {
 
   g_responder->is_muted = false;
   g_responder->identify_on = false;
+  RDMResponder_InvalidateCache(g_responder);
 
   if (g_responder->def) {
     RDMUtil_StringCopy(g_responder->device_label, RDM_DEFAULT_STRING_SIZE,
@@ -246,33 +292,9 @@ int RDMResponder_HandleDUBRequest(const uint8_t *param_data,
     return RDM_RESPONDER_NO_RESPONSE;
   }
 
-  uint8_t *response = (uint8_t*) g_rdm_buffer;
-  memset(response, FE_CONSTANT, 7);
-  response[7] = AA_CONSTANT;
-  response[8] = g_responder->uid[0] | AA_CONSTANT;
-  response[9] = g_responder->uid[0] | FIVE5_CONSTANT;
-  response[10] = g_responder->uid[1] | AA_CONSTANT;
-  response[11] = g_responder->uid[1] | FIVE5_CONSTANT;
-
-  response[12] = g_responder->uid[2] | AA_CONSTANT;
-  response[13] = g_responder->uid[2] | FIVE5_CONSTANT;
-  response[14] = g_responder->uid[3] | AA_CONSTANT;
-  response[15] = g_responder->uid[3] | FIVE5_CONSTANT;
-  response[16] = g_responder->uid[4] | AA_CONSTANT;
-  response[17] = g_responder->uid[4] | FIVE5_CONSTANT;
-  response[18] = g_responder->uid[5] | AA_CONSTANT;
-  response[19] = g_responder->uid[5] | FIVE5_CONSTANT;
-
-  uint16_t checksum = 0u;
-  unsigned int i;
-  for (i = 8u; i < 20u; i++) {
-    checksum += response[i];
-  }
-
-  response[20] = ShortMSB(checksum) | AA_CONSTANT;
-  response[21] = ShortMSB(checksum) | FIVE5_CONSTANT;
-  response[22] = ShortLSB(checksum) | AA_CONSTANT;
-  response[23] = ShortLSB(checksum) | FIVE5_CONSTANT;
+  // The response is built when the responder is initialized, so there's no
+  // need to copy it into g_rdm_buffer.
+  g_rdm_response = g_responder->dub_response;
   return -DUB_RESPONSE_LENGTH;
 }
 
@@ -296,6 +318,55 @@ void RDMResponder_BuildHeader(const RDMHeader *incoming_header,
   outgoing_header->param_data_length = message_length - sizeof(RDMHeader);
 }
 
+/*
+ * @brief Write the response header and checksum.
+ * @param frame The response frame, the param data must already be in place.
+ * @param responder The responder sending the response.
+ * @param header The header of the request.
+ * @param response_type The response type to use.
+ * @param command_class The command class of the response.
+ * @param message_length The length of the response, excluding the checksum.
+ * @returns The size of the response frame.
+ */
+static int WriteHeaderAndChecksum(uint8_t *frame,
+                                  const RDMResponder *responder,
+                                  const RDMHeader *header,
+                                  RDMResponseType response_type,
+                                  uint8_t command_class,
+                                  unsigned int message_length) {
+  uint8_t *ptr = frame;
+  *ptr++ = RDM_START_CODE;
+  *ptr++ = SUB_START_CODE;
+  *ptr++ = message_length;
+  memcpy(ptr, header->src_uid, UID_LENGTH);
+  ptr += UID_LENGTH;
+  memcpy(ptr, header->dest_uid, UID_LENGTH);
+  ptr += UID_LENGTH;
+  *ptr++ = header->transaction_number;
+  *ptr++ = response_type;
+  *ptr++ = responder->queued_message_count;
+  ptr = PushUInt16(ptr, ntohs(header->sub_device));
+  *ptr++ = command_class;
+  ptr = PushUInt16(ptr, ntohs(header->param_id));
+  *ptr++ = message_length - sizeof(RDMHeader);
+  return RDMUtil_AppendChecksum(frame);
+}
+
+/*
+ * @brief Build a DISC_MUTE / DISC_UN_MUTE response.
+ * @param frame The buffer to use, at least MUTE_RESPONSE_LENGTH bytes.
+ * @param responder The responder that was muted or un-muted.
+ * @param header The header of the request.
+ * @returns The size of the response frame.
+ */
+static int BuildMuteResponse(uint8_t *frame, const RDMResponder *responder,
+                             const RDMHeader *header) {
+  uint8_t *ptr = frame + sizeof(RDMHeader);
+  ptr = PushUInt16(ptr, GetControlField(responder));
+  return WriteHeaderAndChecksum(frame, responder, header, ACK,
+                                DISCOVERY_COMMAND_RESPONSE, ptr - frame);
+}
+
 int RDMResponder_AddHeaderAndChecksum(const RDMHeader *header,
                                       RDMResponseType response_type,
                                       unsigned int message_length) {
@@ -314,22 +385,9 @@ int RDMResponder_AddHeaderAndChecksum(const RDMHeader *header,
       return RDM_RESPONDER_NO_RESPONSE;
   }
 
-  uint8_t *ptr = g_rdm_buffer;
-  *ptr++ = RDM_START_CODE;
-  *ptr++ = SUB_START_CODE;
-  *ptr++ = message_length;
-  memcpy(ptr, header->src_uid, UID_LENGTH);
-  ptr += UID_LENGTH;
-  memcpy(ptr, header->dest_uid, UID_LENGTH);
-  ptr += UID_LENGTH;
-  *ptr++ = header->transaction_number;
-  *ptr++ = response_type;
-  *ptr++ = g_responder->queued_message_count;
-  ptr = PushUInt16(ptr, ntohs(header->sub_device));
-  *ptr++ = response_command_class;
-  ptr = PushUInt16(ptr, ntohs(header->param_id));
-  *ptr++ = message_length - sizeof(RDMHeader);
-  return RDMUtil_AppendChecksum(g_rdm_buffer);
+  return WriteHeaderAndChecksum(g_rdm_buffer, g_responder, header,
+                                response_type, response_command_class,
+                                message_length);
 }
 
 int RDMResponder_BuildSetAck(const RDMHeader *header) {
@@ -373,40 +431,55 @@ int RDMResponder_BuildParamDescription(
   return RDMResponder_AddHeaderAndChecksum(header, ACK, ptr - g_rdm_buffer);
 }
 
+/*
+ * @brief Find the descriptor for a PID.
+ * @returns The descriptor, or NULL if the PID isn't supported.
+ *
+ * The descriptor tables are sorted by PID, see ResponderDefinition.
+ */
+static const PIDDescriptor *FindDescriptor(
+    const ResponderDefinition *definition, uint16_t pid) {
+  unsigned int lower = 0u;
+  unsigned int upper = definition->descriptor_count;
+  while (lower < upper) {
+    unsigned int middle = lower + (upper - lower) / 2u;
+    const PIDDescriptor *descriptor = &definition->descriptors[middle];
+    if (descriptor->pid == pid) {
+      return descriptor;
+    } else if (descriptor->pid < pid) {
+      lower = middle + 1u;
+    } else {
+      upper = middle;
+    }
+  }
+  return NULL;
+}
+
 int RDMResponder_DispatchPID(const RDMHeader *header,
                              const uint8_t *param_data) {
-  const ResponderDefinition *definition = g_responder->def;
-  uint16_t pid = ntohs(header->param_id);
-  unsigned int i = 0u;
-  // TODO(simon): convert to binary search if the list gets long.
-  // We'll need to add a check to ensure it's sorted though.
-  for (; i < definition->descriptor_count; i++) {
-    if (pid == definition->descriptors[i].pid) {
-      if (header->command_class == GET_COMMAND) {
-        if (RDMUtil_IsUnicast(header->dest_uid)) {\
-          if (definition->descriptors[i].get_handler) {
-            if (header->param_data_length ==
-                definition->descriptors[i].get_param_size) {
-              return definition->descriptors[i].get_handler(header, param_data);
-            } else {
-              return RDMResponder_BuildNack(header, NR_FORMAT_ERROR);
-            }
-          } else {
-            return RDMResponder_BuildNack(header, NR_UNSUPPORTED_COMMAND_CLASS);
-          }
-        } else {
-          return RDM_RESPONDER_NO_RESPONSE;
-        }
-      } else {
-        if (definition->descriptors[i].set_handler) {
-          return definition->descriptors[i].set_handler(header, param_data);
-        } else {
-          return RDMResponder_BuildNack(header, NR_UNSUPPORTED_COMMAND_CLASS);
-        }
-      }
+  const PIDDescriptor *descriptor = FindDescriptor(
+      g_responder->def, ntohs(header->param_id));
+  if (!descriptor) {
+    return RDMResponder_BuildNack(header, NR_UNKNOWN_PID);
+  }
+
+  if (header->command_class == GET_COMMAND) {
+    if (!RDMUtil_IsUnicast(header->dest_uid)) {
+      return RDM_RESPONDER_NO_RESPONSE;
+    }
+    if (!descriptor->get_handler) {
+      return RDMResponder_BuildNack(header, NR_UNSUPPORTED_COMMAND_CLASS);
+    }
+    if (header->param_data_length != descriptor->get_param_size) {
+      return RDMResponder_BuildNack(header, NR_FORMAT_ERROR);
+    }
+    return descriptor->get_handler(header, param_data);
+  } else {
+    if (!descriptor->set_handler) {
+      return RDMResponder_BuildNack(header, NR_UNSUPPORTED_COMMAND_CLASS);
     }
+    return descriptor->set_handler(header, param_data);
   }
-  return RDMResponder_BuildNack(header, NR_UNKNOWN_PID);
 }
 
 int RDMResponder_Ioctl(ModelIoctl command, uint8_t *data, unsigned int length) {
@@ -515,13 +588,9 @@ int RDMResponder_SetMute(const RDMHeader *header) {
                       g_internal_state.mute_bit);
 
   ReturnUnlessUnicast(header);
-
-  uint8_t *ptr = g_rdm_buffer + sizeof(RDMHeader);
-  ptr = PushUInt16(ptr, GetControlField());
-  return RDMResponder_AddHeaderAndChecksum(header, ACK, ptr - g_rdm_buffer);
+  return BuildMuteResponse(g_rdm_buffer, g_responder, header);
 }
 
-// TODO(simon): combine with RDMResponder_SetMute above.
 int RDMResponder_SetUnMute(const RDMHeader *header) {
   if (header->param_data_length) {
     return RDM_RESPONDER_NO_RESPONSE;
@@ -532,19 +601,23 @@ int RDMResponder_SetUnMute(const RDMHeader *header) {
   g_internal_state.mute_timer = CoarseTimer_GetTime();
 
   ReturnUnlessUnicast(header);
-
-  uint8_t *ptr = g_rdm_buffer + sizeof(RDMHeader);
-  ptr = PushUInt16(ptr, GetControlField());
-  return RDMResponder_AddHeaderAndChecksum(header, ACK, ptr - g_rdm_buffer);
+  return BuildMuteResponse(g_rdm_buffer, g_responder, header);
 }
 
 int RDMResponder_GetSupportedParameters(const RDMHeader *header,
                                         UNUSED const uint8_t *param_data) {
+  uint8_t *ptr = g_rdm_buffer + sizeof(RDMHeader);
+  if (g_responder->cache_flags & CACHE_SUPPORTED_PARAMETERS) {
+    const unsigned int size = g_responder->supported_parameters_size;
+    memcpy(ptr, g_responder->supported_parameters, size);
+    return RDMResponder_AddHeaderAndChecksum(header, ACK,
+                                             sizeof(RDMHeader) + size);
+  }
+
   const ResponderDefinition *definition = g_responder->def;
 
   // TODO(simon): handle ack-overflow here
   unsigned int i = 0u;
-  uint8_t *ptr = g_rdm_buffer + sizeof(RDMHeader);
   for (; i < definition->descriptor_count; i++) {
     switch (definition->descriptors[i].pid) {
       case PID_DISC_UNIQUE_BRANCH:
@@ -565,6 +638,13 @@ int RDMResponder_GetSupportedParameters(const RDMHeader *header,
     }
   }
 
+  unsigned int size = ptr - g_rdm_buffer - sizeof(RDMHeader);
+  if (size <= SUPPORTED_PARAMETERS_CACHE_SIZE) {
+    memcpy(g_responder->supported_parameters,
+           g_rdm_buffer + sizeof(RDMHeader), size);
+    g_responder->supported_parameters_size = size;
+    g_responder->cache_flags |= CACHE_SUPPORTED_PARAMETERS;
+  }
   return RDMResponder_AddHeaderAndChecksum(header, ACK, ptr - g_rdm_buffer);
 }
 
@@ -590,26 +670,32 @@ int RDMResponder_SetCommsStatus(const RDMHeader *header,
 
 int RDMResponder_GetDeviceInfo(const RDMHeader *header,
                                UNUSED const uint8_t *param_data) {
-  const PersonalityDefinition *personality = CurrentPersonality();
-
-  uint8_t *ptr = g_rdm_buffer + sizeof(RDMHeader);
-  ptr = PushUInt16(ptr, RDM_VERSION);
-  ptr = PushUInt16(ptr, g_responder->def->model_id);
-  ptr = PushUInt16(ptr, g_responder->def->product_category);
-  ptr = PushUInt32(ptr, g_responder->def->software_version);
-  ptr = PushUInt16(ptr, personality ? personality->dmx_footprint : 0u);
-  *ptr++ = g_responder->current_personality;
-
-  if (g_responder->def->personalities) {
-    *ptr++ = g_responder->def->personality_count;
-  } else {
-    *ptr++ = 1u;
+  if (!(g_responder->cache_flags & CACHE_DEVICE_INFO)) {
+    const PersonalityDefinition *personality = CurrentPersonality();
+
+    uint8_t *ptr = g_responder->device_info;
+    ptr = PushUInt16(ptr, RDM_VERSION);
+    ptr = PushUInt16(ptr, g_responder->def->model_id);
+    ptr = PushUInt16(ptr, g_responder->def->product_category);
+    ptr = PushUInt32(ptr, g_responder->def->software_version);
+    ptr = PushUInt16(ptr, personality ? personality->dmx_footprint : 0u);
+    *ptr++ = g_responder->current_personality;
+
+    if (g_responder->def->personalities) {
+      *ptr++ = g_responder->def->personality_count;
+    } else {
+      *ptr++ = 1u;
+    }
+    ptr = PushUInt16(ptr, g_responder->dmx_start_address);
+    ptr = PushUInt16(ptr, g_responder->sub_device_count);
+    *ptr++ = g_responder->def->sensor_count;
+    g_responder->cache_flags |= CACHE_DEVICE_INFO;
   }
-  ptr = PushUInt16(ptr, g_responder->dmx_start_address);
-  ptr = PushUInt16(ptr, g_responder->sub_device_count);
-  *ptr++ = g_responder->def->sensor_count;
 
-  return RDMResponder_AddHeaderAndChecksum(header, ACK, ptr - g_rdm_buffer);
+  memcpy(g_rdm_buffer + sizeof(RDMHeader), g_responder->device_info,
+         DEVICE_INFO_SIZE);
+  return RDMResponder_AddHeaderAndChecksum(
+      header, ACK, sizeof(RDMHeader) + DEVICE_INFO_SIZE);
 }
 
 int RDMResponder_GetProductDetailIds(const RDMHeader *header,
@@ -704,6 +790,7 @@ int RDMResponder_SetDMXPersonality(const RDMHeader *header,
     g_responder->using_factory_defaults = false;
   }
   g_responder->current_personality = new_personality;
+  RDMResponder_InvalidateCache(g_responder);
   return RDMResponder_BuildSetAck(header);
 }
 
@@ -751,6 +838,7 @@ int RDMResponder_SetDMXStartAddress(const RDMHeader *header,
     g_responder->using_factory_defaults = false;
   }
   g_responder->dmx_start_address = address;
+  RDMResponder_InvalidateCache(g_responder);
   return RDMResponder_BuildSetAck(header);
 }
 
@@ -963,3 +1051,42 @@ int RDMResponder_HandleDiscovery(const RDMHeader *header,
   }
   return RDM_RESPONDER_NO_RESPONSE;
 }
+
+int RDMResponder_HandleFastPath(const RDMHeader *header,
+                                const uint8_t *param_data,
+                                const uint8_t **response) {
+  // This runs from the USART ISR. The main loop may have switched g_responder
+  // to a child or sub-device, so only the root responder is used.
+  RDMResponder *responder = &root_responder;
+  if (header->command_class != DISCOVERY_COMMAND ||
+      ntohs(header->sub_device) != SUBDEVICE_ROOT ||
+      !RDMUtil_RequiresAction(responder->uid, header->dest_uid)) {
+    return RDM_RESPONDER_NO_RESPONSE;
+  }
+
+  switch (ntohs(header->param_id)) {
+    case PID_DISC_UNIQUE_BRANCH:
+      if (responder->is_muted ||
+          header->param_data_length != 2 * UID_LENGTH ||
+          RDMUtil_UIDCompare(param_data, responder->uid) > 0 ||
+          RDMUtil_UIDCompare(responder->uid, param_data + UID_LENGTH) > 0) {
+        return RDM_RESPONDER_NO_RESPONSE;
+      }
+      *response = responder->dub_response;
+      return -DUB_RESPONSE_LENGTH;
+    case PID_DISC_MUTE:
+    case PID_DISC_UN_MUTE:
+      if (header->param_data_length) {
+        return RDM_RESPONDER_NO_RESPONSE;
+      }
+      // Update the mute state now, so the next DUB is answered correctly. The
+      // main loop still handles the request, which updates the mute LED.
+      responder->is_muted = ntohs(header->param_id) == PID_DISC_MUTE;
+      ReturnUnlessUnicast(header);
+      *response = g_fast_path_response;
+      return BuildMuteResponse(g_fast_path_response, responder, header);
+    default:
+      {}
+  }
+  return RDM_RESPONDER_NO_RESPONSE;
+}
@@ -232,6 +232,9 @@ typedef struct {
 typedef struct {
   /**
    * @brief The descriptor table.
+   *
+   * The table must be sorted by PID, with no duplicates, since
+   * RDMResponder_DispatchPID() uses a binary search.
    */
   const PIDDescriptor *descriptors;
 
@@ -279,6 +282,19 @@ typedef struct {
   uint8_t sensor_count;  //!< The number of sensors
 } ResponderDefinition;
 
+/**
+ * @brief The size of the DEVICE_INFO parameter data.
+ */
+enum { DEVICE_INFO_SIZE = 19 };
+
+/**
+ * @brief The space for the cached SUPPORTED_PARAMETERS parameter data.
+ *
+ * If a responder supports more PIDs than fit, the list is built for each
+ * request.
+ */
+enum { SUPPORTED_PARAMETERS_CACHE_SIZE = 80 };
+
 /**
  * @brief A core implementation of a responder.
  *
@@ -311,6 +327,27 @@ typedef struct {
   bool is_subdevice;  // true if this is a subdevice.
   bool is_managed_proxy;  // true if this is a managed proxy.
   bool is_proxied_device;  // true if this is a proxied device.
+
+  /**
+   * @brief The valid entries in the response cache.
+   *
+   * See RDMResponder_InvalidateCache().
+   */
+  uint8_t cache_flags;
+  uint8_t device_info[DEVICE_INFO_SIZE];  //!< Cached DEVICE_INFO data.
+  /**
+   * @brief Cached SUPPORTED_PARAMETERS data.
+   */
+  uint8_t supported_parameters[SUPPORTED_PARAMETERS_CACHE_SIZE];
+  uint8_t supported_parameters_size;  //!< The size of supported_parameters
+
+  /**
+   * @brief The encoded DUB response for this responder's UID.
+   *
+   * This is built by RDMResponder_InitResponder(), so code that changes the
+   * uid must call that afterwards.
+   */
+  uint8_t dub_response[DUB_RESPONSE_LENGTH];
 } RDMResponder;
 
 /**
@@ -358,6 +395,17 @@ void RDMResponder_SwitchResponder(RDMResponder *responder);
  */
 void RDMResponder_RestoreResponder();
 
+/**
+ * @brief Discard the cached GET responses for a responder.
+ * @param responder The responder to invalidate.
+ *
+ * The DEVICE_INFO and SUPPORTED_PARAMETERS parameter data is cached. Code
+ * that changes the definition, DMX start address, personality, sub device
+ * count or is_subdevice flag of a responder directly must call this. The
+ * SET handlers and RDMResponder_InitResponder() take care of it themselves.
+ */
+void RDMResponder_InvalidateCache(RDMResponder *responder);
+
 /**
  * @brief Initialize the current responder with default values.
  */
@@ -380,6 +428,9 @@ void RDMResponder_GetUID(uint8_t *uid);
  * @param param_data_length The size of the param_data.
  * @returns The size of the RDM response frame, this will be negative to
  *   indicate no break should be sent.
+ *
+ * The response isn't copied to g_rdm_buffer, g_rdm_response is pointed at
+ * the responder's prebuilt dub_response instead.
  */
 int RDMResponder_HandleDUBRequest(const uint8_t *param_data,
                                   unsigned int param_data_length);
@@ -412,6 +463,23 @@ int RDMResponder_AddHeaderAndChecksum(const RDMHeader *incoming_header,
 int RDMResponder_HandleDiscovery(const RDMHeader *incoming_header,
                                  const uint8_t *param_data);
 
+/**
+ * @brief Handle a discovery command for the root responder from the RX ISR.
+ * @param incoming_header The header of the incoming frame.
+ * @param param_data The received parameter data.
+ * @param[out] response Set to the response frame, if there is one.
+ * @returns The size of the RDM response frame. A negative value means no break
+ *   should be sent.
+ *
+ * This answers DISC_UNIQUE_BRANCH with the prebuilt DUB response, and sets the
+ * mute state of the root responder for DISC_MUTE & DISC_UN_MUTE. It doesn't
+ * use g_responder or g_rdm_buffer, so it's safe to call from an ISR. Requests
+ * it doesn't answer, such as those for child devices, are left for the model.
+ */
+int RDMResponder_HandleFastPath(const RDMHeader *incoming_header,
+                                const uint8_t *param_data,
+                                const uint8_t **response);
+
 /**
  * @brief Build an RDM Set ACK with no param data.
  * @param incoming_header The header of the incoming frame.
@@ -454,7 +522,7 @@ int RDMResponder_BuildParamDescription(const RDMHeader *incoming_header,
  * @param param_data The received parameter data.
  * @returns The size of the RDM response frame.
  *
- * This checks the ResponderDefinition for a matching PID handler of the
+ * This searches the ResponderDefinition for a matching PID handler of the
  * correct command class. If one isn't found, it'll NACK with
  * NR_UNSUPPORTED_COMMAND_CLASS or NR_UNKNOWN_PID.
  */
@@ -118,8 +118,8 @@ static inline void PossiblyIncrementLengthMismatchCounter(
 void Responder_Initialize() {}
 
 void Responder_Receive(const TransceiverEvent *event) {
-  // While this function is running, UART interrupts are disabled.
-  // Try to keep things short.
+  // This runs from Transceiver_Tasks(). The UART interrupts remain enabled, so
+  // later slots may arrive while it's running.
   if (event->op != T_OP_RX) {
     return;
   }
@@ -245,3 +245,20 @@ void Responder_Receive(const TransceiverEvent *event) {
     }
   }
 }
+
+int Responder_HandleFastPath(const uint8_t *frame, unsigned int size,
+                             const uint8_t **response) {
+  // This runs from the USART ISR, so it can't touch the decoder state.
+  const RDMHeader *header = (const RDMHeader*) frame;
+  if (!RDMUtil_VerifyChecksum(frame, size) ||
+      header->start_code != RDM_START_CODE ||
+      header->sub_start_code != RDM_SUB_START_CODE ||
+      header->param_data_length !=
+          header->message_length - sizeof(RDMHeader)) {
+    return 0;
+  }
+  return RDMHandler_HandleFastPath(
+      header,
+      header->param_data_length ? frame + RDM_PARAM_DATA_OFFSET : NULL,
+      response);
+}
@@ -50,6 +50,21 @@ void Responder_Initialize();
  */
 void Responder_Receive(const TransceiverEvent *event);
 
+/**
+ * @brief Answer a RDM request from the transceiver's RX ISR.
+ * @param frame The RDM request, including the start code & checksum.
+ * @param size The size of the request.
+ * @param[out] response Set to the response frame, if there is one.
+ * @returns The size of the response, negative if no break should be sent, or
+ *   0 if the request should be left to Responder_Receive().
+ *
+ * This is a TransceiverRDMFastPath. The request is checked in the same way as
+ * Responder_Receive() does, but the counters aren't updated, since
+ * Responder_Receive() still sees the request.
+ */
+int Responder_HandleFastPath(const uint8_t *frame, unsigned int size,
+                             const uint8_t **response);
+
 #ifdef __cplusplus
 }
 #endif
@@ -24,6 +24,7 @@
 
 #include "app_pipeline.h"
 #include "constants.h"
+#include "utils.h"
 
 // Microchip defines this macro in stdlib.h but it's non standard.
 // We define it here so that the unit tests work.
@@ -31,6 +32,13 @@
 #define min(a, b) (((a) < (b)) ? (a) : (b))
 #endif
 
+/*
+ * @brief The size of the message header.
+ *
+ * The start of message identifier, token, command and length.
+ */
+enum { MESSAGE_HEADER_SIZE = 6 };
+
 // The state indicates the next byte we expect
 
 typedef enum {
@@ -53,52 +61,105 @@ typedef struct {
   unsigned int fragment_offset;
   uint8_t fragmented_buffer[PAYLOAD_SIZE];
   uint8_t fragmented_frame : 1;  // true if we've received a fragmented frame
+  uint8_t message_handled : 1;  // true if the handler has been run.
 } StreamDecoderData;
 
 StreamDecoderData g_stream_data;
 
-// Public Functions
-// ----------------------------------------------------------------------------
-void StreamDecoder_Initialize(MessageHandler handler) {
-  g_stream_data.state = START_OF_MESSAGE;
-#ifndef PIPELINE_HANDLE_MESSAGE
-  g_stream_data.handler = handler;
+static inline void HandleMessage() {
+  g_stream_data.message_handled = true;
+#ifdef PIPELINE_HANDLE_MESSAGE
+  PIPELINE_HANDLE_MESSAGE(&g_stream_data.message);
+#else
+  g_stream_data.handler(&g_stream_data.message);
 #endif
-  g_stream_data.message.token = 0u;
-  g_stream_data.message.length = 0u;
-  g_stream_data.message.command = 0u;
-  g_stream_data.message.payload = NULL;
-  g_stream_data.fragment_offset = 0u;
-  g_stream_data.fragmented_frame = false;
 }
 
-bool StreamDecoder_GetFragmentedFrameFlag() {
-  return g_stream_data.fragmented_frame;
-}
+/*
+ * @brief Decode the messages which are entirely contained within the data.
+ * @param data The first byte to decode.
+ * @param end One past the last byte of data.
+ * @param single_message Return once a message has been handled.
+ * @returns A pointer to the start of a message which isn't complete, the byte
+ *   after the handled message if single_message is true, or end if all the
+ *   data was consumed.
+ *
+ * This is the fast path. Each message is checked against the end of the data
+ * once, and the payload is passed to the handler without being copied.
+ */
+static const uint8_t *DecodeCompleteMessages(const uint8_t *data,
+                                             const uint8_t *end,
+                                             bool single_message) {
+  while (data < end) {
+    if (*data != START_OF_MESSAGE_ID) {
+      data = memchr(data, START_OF_MESSAGE_ID, end - data);
+      if (data == NULL) {
+        return end;
+      }
+    }
 
-void StreamDecoder_ClearFragmentedFrameFlag() {
-  g_stream_data.fragmented_frame = false;
+    unsigned int remaining = end - data;
+    if (remaining < MESSAGE_HEADER_SIZE) {
+      return data;
+    }
+    uint16_t length = JoinShort(data[5], data[4]);
+    if (remaining < MESSAGE_HEADER_SIZE + length + 1u) {
+      return data;
+    }
+
+    if (data[MESSAGE_HEADER_SIZE + length] == END_OF_MESSAGE_ID) {
+      g_stream_data.message.token = data[1];
+      g_stream_data.message.command = JoinShort(data[3], data[2]);
+      g_stream_data.message.length = length;
+      g_stream_data.message.payload =
+          length ? data + MESSAGE_HEADER_SIZE : NULL;
+      HandleMessage();
+    }
+    // A message without an EOM is skipped, just like the slow path.
+    data += MESSAGE_HEADER_SIZE + length + 1u;
+    if (single_message && g_stream_data.message_handled) {
+      return data;
+    }
+  }
+  return end;
 }
 
-void StreamDecoder_Process(const uint8_t* data, unsigned int size) {
+/*
+ * @brief Decode data from the input stream.
+ * @param data A pointer to the incoming data.
+ * @param size The size of the data.
+ * @param single_message Stop once a message has been handled.
+ * @returns The number of bytes consumed.
+ */
+static unsigned int Decode(const uint8_t* data, unsigned int size,
+                           bool single_message) {
 #ifndef PIPELINE_HANDLE_MESSAGE
   if (!g_stream_data.handler) {
-    return;
+    return size;
   }
 #endif
 
+  const uint8_t *start = data;
   const uint8_t *end = data + size;
   uint32_t payload_size;
 
+  g_stream_data.message_handled = false;
   while (data < end) {
+    if (single_message && g_stream_data.message_handled) {
+      break;
+    }
+
     switch (g_stream_data.state) {
       case START_OF_MESSAGE:
-        for (; data < end; data++) {
-          if (*data == START_OF_MESSAGE_ID) {
-            g_stream_data.state = TOKEN;
-            break;
-          }
+        // Whole messages are decoded in place, we only drop into the state
+        // machine if a message spans more than one call.
+        data = DecodeCompleteMessages(data, end, single_message);
+        if (data == end ||
+            (single_message && g_stream_data.message_handled)) {
+          // Don't step past the end of the data, or the handled message.
+          continue;
         }
+        g_stream_data.state = TOKEN;
         break;
       case TOKEN:
         g_stream_data.message.token = *data;
@@ -154,15 +215,44 @@ void StreamDecoder_Process(const uint8_t* data, unsigned int size) {
         break;
       case END_OF_MESSAGE:
         if (*data == END_OF_MESSAGE_ID) {
-#ifdef PIPELINE_HANDLE_MESSAGE
-          PIPELINE_HANDLE_MESSAGE(&g_stream_data.message);
-#else
-          g_stream_data.handler(&g_stream_data.message);
-#endif
+          HandleMessage();
         }
         g_stream_data.fragment_offset = 0u;
         g_stream_data.state = START_OF_MESSAGE;
     }
     data++;
   }
+  return data - start;
+}
+
+// Public Functions
+// ----------------------------------------------------------------------------
+void StreamDecoder_Initialize(MessageHandler handler) {
+  g_stream_data.state = START_OF_MESSAGE;
+#ifndef PIPELINE_HANDLE_MESSAGE
+  g_stream_data.handler = handler;
+#endif
+  g_stream_data.message.token = 0u;
+  g_stream_data.message.length = 0u;
+  g_stream_data.message.command = 0u;
+  g_stream_data.message.payload = NULL;
+  g_stream_data.fragment_offset = 0u;
+  g_stream_data.fragmented_frame = false;
+}
+
+bool StreamDecoder_GetFragmentedFrameFlag() {
+  return g_stream_data.fragmented_frame;
+}
+
+void StreamDecoder_ClearFragmentedFrameFlag() {
+  g_stream_data.fragmented_frame = false;
+}
+
+void StreamDecoder_Process(const uint8_t* data, unsigned int size) {
+  Decode(data, size, false);
+}
+
+unsigned int StreamDecoder_ProcessMessage(const uint8_t* data,
+                                          unsigned int size) {
+  return Decode(data, size, true);
 }
@@ -82,11 +82,25 @@ void StreamDecoder_ClearFragmentedFrameFlag();
  * @param data A pointer to the incoming data.
  * @param size The size of the incommig data buffer.
  *
- * Since this may result in a response being sent, this should only be called
- * if there is space available in the Host TX buffer.
+ * Every message in the data is decoded, and each may result in a response
+ * being sent. If the Host TX buffer may not have space for all the responses,
+ * use StreamDecoder_ProcessMessage() instead.
  */
 void StreamDecoder_Process(const uint8_t* data, unsigned int size);
 
+/**
+ * @brief Decode data from an input stream, stopping after the first message.
+ * @param data A pointer to the incoming data.
+ * @param size The size of the incoming data buffer.
+ * @returns The number of bytes consumed. If this is less than size, call
+ *   again with the remaining data.
+ *
+ * Each message may result in a response being sent, so this allows the caller
+ * to check there is space in the Host TX buffer before decoding the next one.
+ */
+unsigned int StreamDecoder_ProcessMessage(const uint8_t* data,
+                                          unsigned int size);
+
 #ifdef __cplusplus
 }
 #endif
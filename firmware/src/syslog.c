@@ -21,6 +21,7 @@
 
 #include <stdarg.h>
 #include <stdint.h>
+#include <stdio.h>
 #include <string.h>
 
 #include "app_pipeline.h"
@@ -59,12 +60,10 @@ void SysLog_Print(SysLogLevel level, const char* format, ...) {
     return;
   }
 
-  size_t padding = 0;
   va_list args;
 
   va_start(args, format);
-  size_t len = vsnprintf(g_syslog.printf_buffer, SYSLOG_PRINT_BUFFER_SIZE,
-                         format, args);
+  vsnprintf(g_syslog.printf_buffer, SYSLOG_PRINT_BUFFER_SIZE, format, args);
   va_end(args);
   SysLog_Write(g_syslog.printf_buffer);
 }
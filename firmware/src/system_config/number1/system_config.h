@@ -148,6 +148,9 @@ SUBSTITUTE GOODS, TECHNOLOGY, SERVICES, OR ANY CLAIMS BY THIRD PARTIES
 /* EP0 size in bytes */
 #define USB_DEVICE_EP0_BUFFER_SIZE      64
 
+/* Generate SOF events, used to align the DMX output */
+#define USB_DEVICE_SOF_EVENT_ENABLE
+
 
 
 
@@ -175,7 +178,7 @@ SUBSTITUTE GOODS, TECHNOLOGY, SERVICES, OR ANY CLAIMS BY THIRD PARTIES
 #define USB_DEVICE_CDC_QUEUE_DEPTH_COMBINED 3
 
 /* Endpoint Transfer Queue Size combined for Read and write */
-#define USB_DEVICE_ENDPOINT_QUEUE_DEPTH_COMBINED    2
+#define USB_DEVICE_ENDPOINT_QUEUE_DEPTH_COMBINED    4
 
 
 
@@ -23,6 +23,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include "sys/attribs.h"
+#include "sys/kmem.h"
 #include "system/int/sys_int.h"
 #include "system/clk/sys_clk.h"
 
@@ -30,9 +31,11 @@
 #include "coarse_timer.h"
 #include "constants.h"
 #include "dmx_spec.h"
+#include "peripheral/dma/plib_dma.h"
 #include "peripheral/ic/plib_ic.h"
 #include "peripheral/tmr/plib_tmr.h"
 #include "peripheral/usart/plib_usart.h"
+#include "rdm.h"
 #include "setting_macros.h"
 #include "syslog.h"
 #include "system_definitions.h"
@@ -43,8 +46,9 @@
 
 enum { BUFFER_SIZE = DMX_FRAME_SIZE + 1u };
 
-// The number of buffers we maintain for overlapping I/O
-enum { NUMBER_OF_BUFFERS = 2};
+// The number of buffers we maintain for overlapping I/O, one for the active
+// operation plus one for each queued operation.
+enum { NUMBER_OF_BUFFERS = TRANSCEIVER_QUEUE_DEPTH + 1 };
 
 const int16_t TRANSCEIVER_NO_NOTIFICATION = -1;
 
@@ -54,10 +58,33 @@ static const uint16_t MARK_FUDGE_FACTOR = 270u;
 static const uint16_t RESPONSE_FUDGE_FACTOR = 37u;
 static const uint16_t RESPONSE_TIME_RX_FUDGE_FACTOR = 13u;
 
+// The length of a bit at 250kbps, in 10ths of a microsecond. This is the
+// resolution of the timer in responder mode.
+static const uint16_t RESPONDER_BIT_TICKS = 40u;
+
+// The number of RX events that can be queued between the ISRs and _Tasks().
+// This must be a power of two.
+enum { RX_EVENT_QUEUE_SIZE = 8u };
+
+// The number of frames that can be queued between the ISRs and _Tasks() in
+// sniffer mode, including the frame being captured. This must be a power of
+// two, and no more than NUMBER_OF_BUFFERS.
+enum { SNIFFER_QUEUE_SIZE = NUMBER_OF_BUFFERS >= 4u ? 4u : 2u };
+
 // The value of the test byte we send during the self test
 static const uint8_t SELF_TEST_VALUE = 0xa5;
 static const uint32_t SELF_TEST_TIMEOUT = 100;  // 10ms
 
+// USB frame numbers are 11 bits.
+static const uint16_t USB_FRAME_NUMBER_MASK = 0x7ff;
+
+// A sync point is ignored if the frame can't start within this time, 500us.
+static const uint32_t DMX_SYNC_LATE_LIMIT = 5u;
+
+// If no sync point arrives within two sync periods, the SOFs have stopped. This
+// is the timeout per USB frame in the period, in 10ths of a millisecond.
+static const uint32_t DMX_SYNC_LOSS_TICKS_PER_FRAME = 20u;
+
 typedef enum {
   // Controller states
   STATE_C_INITIALIZE = 0,  //!< Initialize controller state.
@@ -96,6 +123,12 @@ typedef enum {
   STATE_T_RX_WAIT = 42,  //!< Wait for response
   STATE_T_VERIFY = 43,  //!< Check response
 
+  // Sniffer states
+  STATE_S_INITIALIZE = 50,  //!< Init sniffer
+  STATE_S_IDLE = 51,  //!< Waiting for a break or a frame without one
+  STATE_S_MARK = 52,  //!< In mark after break
+  STATE_S_DATA = 53,  //!< Receiving slots
+
   // Common states
   STATE_RESET = 99,
   STATE_ERROR = 100
@@ -149,7 +182,7 @@ typedef struct {
   uint16_t data_index;
 
   /**
-   * @brief The index of the last byte delivered to the responder callback.
+   * @brief The index of the last byte queued for the responder callback.
    */
   uint16_t event_index;
 
@@ -177,9 +210,20 @@ typedef struct {
   /**
    * @brief If we're receiving a RDM response, this is the decoded length.
    */
-  uint8_t expected_length;
+  uint16_t expected_length;
   bool found_expected_length;  //!< If expected_length is valid.
 
+  /**
+   * @brief True if the RX DMA channel is writing into the active buffer.
+   */
+  bool rx_dma_active;
+
+  /**
+   * @brief The buffer indices of the start and end of the current RX DMA block.
+   */
+  uint16_t rx_dma_start;
+  uint16_t rx_dma_end;
+
   /**
    * @brief The token for a mode change event.
    *
@@ -192,12 +236,137 @@ typedef struct {
    * @brief The buffer current used for transmit / receive.
    */
   TransceiverBuffer* active;
-  TransceiverBuffer* next;  //!< The next buffer ready to be transmitted
+
+  /**
+   * @brief The buffers waiting to be transmitted, in FIFO order.
+   */
+  TransceiverBuffer* queue[TRANSCEIVER_QUEUE_DEPTH];
+  uint8_t queue_head;  //!< The index of the next buffer in the queue.
+  uint8_t queue_size;  //!< The number of buffers in the queue, may be 0.
+
+  /**
+   * @brief The last DMX frame sent, used for continuous refresh.
+   *
+   * This is never on the free list. When refresh is enabled, each new DMX
+   * frame replaces the resident frame once it has been sent.
+   */
+  TransceiverBuffer* resident;
+
+  /**
+   * @brief A buffer the responder can receive the next frame into, or NULL.
+   *
+   * This is taken from the free list by _Tasks() and only cleared by the ISRs,
+   * when a frame starts while the events for the previous one are still
+   * queued.
+   */
+  TransceiverBuffer* volatile rx_spare;
+
+  /**
+   * @brief The buffer the queued RX events refer to, or NULL.
+   *
+   * This is only set by the ISRs, when switching to rx_spare, and only cleared
+   * by _Tasks() once the events have been delivered, when it becomes the new
+   * rx_spare. At most one of rx_spare and rx_previous is set.
+   */
+  TransceiverBuffer* volatile rx_previous;
+
+  /**
+   * @brief The buffer the RX event being delivered refers to, or NULL.
+   *
+   * If this isn't the active buffer, the event is for a frame that has been
+   * followed by another, so it's too late to respond to it.
+   */
+  const TransceiverBuffer* rx_delivering;
+
+  /**
+   * @brief The approximate time the last DMX frame started.
+   */
+  CoarseTimer_Value dmx_frame_start;
 
   TransceiverBuffer* free_list[NUMBER_OF_BUFFERS];
   uint8_t free_size;  //!< The number of buffers in the free list, may be 0.
 } TransceiverData;
 
+/*
+ * @brief An RX event, waiting to be delivered to the responder callback.
+ *
+ * The event covers the bytes from the end of the previous event up to length.
+ * The data is read from the buffer the frame was received into, so that
+ * buffer can't be reused until the events have been delivered.
+ */
+typedef struct {
+  TransceiverOperationResult result;
+  uint16_t length;  //!< The number of bytes received in the frame so far.
+  const TransceiverBuffer *buffer;  //!< The buffer holding the frame data.
+} RXEvent;
+
+/*
+ * @brief A single producer, single consumer queue of RX events.
+ *
+ * The RX ISRs are the producer and _Tasks() is the consumer. When using RX
+ * DMA, _Tasks() also acts as the producer, with the DMA & error ISRs
+ * disabled. The producer only writes tail, the consumer only writes head, so
+ * no locking is required.
+ */
+typedef struct {
+  RXEvent events[RX_EVENT_QUEUE_SIZE];
+  volatile uint8_t head;  //!< The next event to deliver.
+  volatile uint8_t tail;  //!< The next free slot.
+  uint32_t overflows;  //!< The number of events or frames dropped.
+  uint8_t high_water;  //!< The maximum number of queued events.
+} RXEventQueue;
+
+/*
+ * @brief The DMX sync state.
+ *
+ * Transceiver_SOF() is the producer and _Tasks() is the consumer of the sync
+ * points.
+ */
+typedef struct {
+  bool anchored;  //!< True once the phase has been set from a frame number.
+  uint16_t last_frame;  //!< The last USB frame number.
+  uint16_t phase;  //!< The number of SOFs since the last sync point.
+  volatile bool pending;  //!< True if a sync point hasn't been used yet.
+  volatile CoarseTimer_Value sync_time;  //!< The time of the last sync point.
+} DMXSyncData;
+
+/*
+ * @brief A frame captured in sniffer mode.
+ */
+typedef struct {
+  SnifferFrameHeader header;
+  TransceiverBuffer* buffer;  //!< Holds the slot data.
+} SnifferFrame;
+
+/*
+ * @brief The sniffer state.
+ *
+ * The frames form a single producer, single consumer queue, in the same way
+ * as the RXEventQueue. The frame at tail is the one being captured, the
+ * frames from head up to tail are complete.
+ */
+typedef struct {
+  SnifferFrame frames[SNIFFER_QUEUE_SIZE];
+  volatile uint8_t head;  //!< The next frame to deliver.
+  volatile uint8_t tail;  //!< The frame being captured.
+
+  bool line_low;  //!< The line level, tracked from the IC events.
+  bool framing_error;  //!< A framing error is waiting to be classified.
+  bool dropped;  //!< A frame was dropped since the last one was queued.
+  uint16_t last_fall;  //!< The time of the last falling edge.
+  uint16_t last_rise;  //!< The time of the last rising edge.
+  CoarseTimer_Value last_fall_coarse;  //!< The coarse time of the last fall.
+
+  /**
+   * @brief The approximate time of the last break or slot.
+   */
+  CoarseTimer_Value last_activity;
+
+  uint8_t batch[PAYLOAD_SIZE];  //!< The frame records waiting to be sent.
+  uint16_t batch_size;  //!< The number of bytes in the batch.
+  CoarseTimer_Value batch_start;  //!< When the first record was added.
+} SnifferData;
+
 typedef struct {
   // Timing params
   uint16_t break_time;
@@ -209,10 +378,13 @@ typedef struct {
   uint16_t rdm_dub_response_limit;
   uint16_t rdm_responder_delay;
   uint16_t rdm_responder_jitter;
+  uint16_t dmx_refresh_interval;
+  uint16_t dmx_sync_period;
+  uint16_t dmx_sync_anchor;
 } TimingSettings;
 
-// The TX / RX buffers
-static TransceiverBuffer buffers[NUMBER_OF_BUFFERS];
+// The TX / RX buffers, plus one for the resident DMX frame.
+static TransceiverBuffer buffers[NUMBER_OF_BUFFERS + 1u];
 
 // The transceiver state
 TransceiverData g_transceiver;
@@ -223,10 +395,22 @@ static TransceiverHardwareSettings g_hw_settings;
 // The timing information for the current operation.
 static TransceiverTiming g_timing;
 
+// The RX events waiting to be delivered.
+static RXEventQueue g_rx_events;
+
+// The sniffer state
+static SnifferData g_sniffer;
+
+// The DMX sync state
+static DMXSyncData g_dmx_sync;
+
 // The event callback, or NULL if there isn't one.
 static TransceiverEventCallback g_tx_callback = NULL;
 static TransceiverEventCallback g_rx_callback = NULL;
 
+// The handler for RDM requests answered from the USART ISR, or NULL.
+static TransceiverRDMFastPath g_rdm_fast_path = NULL;
+
 // The timing settings
 static TimingSettings g_timing_settings;
 
@@ -320,12 +504,87 @@ static void UART_TXBytes() {
   }
 }
 
+/*
+ * @brief Hand the rest of the active buffer to the TX DMA channel.
+ *
+ * The channel moves a byte each time the UART TX FIFO has space. The DMA
+ * interrupt fires once the last byte is in the FIFO.
+ */
+static void UART_StartTXDMA() {
+  PLIB_DMA_ChannelXSourceStartAddressSet(
+      DMA_ID_0, g_hw_settings.tx_dma_channel,
+      KVA_TO_PA(&g_transceiver.active->data[g_transceiver.data_index]));
+  PLIB_DMA_ChannelXSourceSizeSet(
+      DMA_ID_0, g_hw_settings.tx_dma_channel,
+      g_transceiver.active->size - g_transceiver.data_index);
+  PLIB_DMA_ChannelXINTSourceFlagClear(DMA_ID_0, g_hw_settings.tx_dma_channel,
+                                      DMA_INT_BLOCK_TRANSFER_COMPLETE);
+  PLIB_USART_TransmitterInterruptModeSelect(g_hw_settings.usart,
+                                            USART_TRANSMIT_FIFO_NOT_FULL);
+  SYS_INT_SourceStatusClear(g_hw_settings.tx_dma_source);
+  SYS_INT_SourceEnable(g_hw_settings.tx_dma_source);
+  PLIB_DMA_ChannelXEnable(DMA_ID_0, g_hw_settings.tx_dma_channel);
+}
+
+/*
+ * @brief Start feeding the UART once the first byte is in the FIFO.
+ */
+static inline void UART_StartTX() {
+  if (g_hw_settings.tx_dma &&
+      g_transceiver.data_index != g_transceiver.active->size) {
+    UART_StartTXDMA();
+  } else {
+    SYS_INT_SourceStatusClear(g_hw_settings.usart_tx_source);
+    SYS_INT_SourceEnable(g_hw_settings.usart_tx_source);
+  }
+}
+
 void UART_FlushRX() {
   while (PLIB_USART_ReceiverDataIsAvailable(g_hw_settings.usart)) {
     PLIB_USART_ReceiverByteReceive(g_hw_settings.usart);
   }
 }
 
+/*
+ * @brief Check if we're a controller receiving an RDM response.
+ */
+static inline bool ExpectRDMResponse() {
+  return g_transceiver.mode == T_MODE_CONTROLLER &&
+         (g_transceiver.active->op == OP_RDM_WITH_RESPONSE ||
+          g_transceiver.active->op == OP_RDM_BROADCAST);
+}
+
+/*
+ * @brief Check if the complete RDM response has arrived.
+ *
+ * Once the start code, sub-start code & message length have been received we
+ * know how long the response is, and can stop as soon as the checksum
+ * arrives.
+ */
+static void CheckForEndOfResponse() {
+  if (!ExpectRDMResponse()) {
+    return;
+  }
+
+  if (!g_transceiver.found_expected_length &&
+      g_transceiver.data_index >= 3u &&
+      g_transceiver.active->data[0] == RDM_START_CODE &&
+      g_transceiver.active->data[1] == RDM_SUB_START_CODE) {
+    g_transceiver.found_expected_length = true;
+    // Add two bytes for the checksum
+    g_transceiver.expected_length = g_transceiver.active->data[2] + 2u;
+  }
+
+  if (g_transceiver.found_expected_length &&
+      g_transceiver.data_index >= g_transceiver.expected_length) {
+    // We've got enough data to move on
+    PLIB_TMR_Stop(g_hw_settings.timer_module_id);
+    PLIB_USART_ReceiverDisable(g_hw_settings.usart);
+    ResetToMark();
+    g_transceiver.state = STATE_C_COMPLETE;
+  }
+}
+
 /*
  * @brief Pull data out of the UART RX queue.
  * @returns true if the RX buffer is now full.
@@ -337,32 +596,104 @@ bool UART_RXBytes() {
         PLIB_USART_ReceiverByteReceive(g_hw_settings.usart);
     g_transceiver.data_index++;
   }
-  if (g_transceiver.active->op == OP_RDM_WITH_RESPONSE ||
-      g_transceiver.active->op == OP_RDM_BROADCAST) {
-    if (g_transceiver.found_expected_length) {
-      if (g_transceiver.data_index == g_transceiver.expected_length) {
-        // We've got enough data to move on
-        PLIB_USART_ReceiverDisable(g_hw_settings.usart);
-        ResetToMark();
-        g_transceiver.state = STATE_C_COMPLETE;
-      }
-    } else {
-      if (g_transceiver.data_index >= 3u) {
-        if (g_transceiver.active->data[0] == RDM_START_CODE &&
-            g_transceiver.active->data[1] == RDM_SUB_START_CODE) {
-          g_transceiver.found_expected_length = true;
-          // Add two bytes for the checksum
-          g_transceiver.expected_length = g_transceiver.active->data[2] + 2;
-        }
-      }
-    }
-  }
+  CheckForEndOfResponse();
   g_transceiver.last_byte = PLIB_TMR_Counter16BitGet(
       g_hw_settings.timer_module_id);
   g_transceiver.last_byte_coarse = CoarseTimer_GetTime();
   return g_transceiver.data_index >= BUFFER_SIZE;
 }
 
+/*
+ * @brief Receive the next block of the active buffer with the RX DMA channel.
+ * @param size The number of bytes in the block, starting from data_index.
+ *
+ * The DMA interrupt fires once the block is complete.
+ */
+static void UART_ReceiveRXDMABlock(uint16_t size) {
+  PLIB_DMA_ChannelXDisable(DMA_ID_0, g_hw_settings.rx_dma_channel);
+  PLIB_DMA_ChannelXDestinationStartAddressSet(
+      DMA_ID_0, g_hw_settings.rx_dma_channel,
+      KVA_TO_PA(&g_transceiver.active->data[g_transceiver.data_index]));
+  PLIB_DMA_ChannelXDestinationSizeSet(DMA_ID_0, g_hw_settings.rx_dma_channel,
+                                      size);
+  PLIB_DMA_ChannelXINTSourceFlagClear(DMA_ID_0, g_hw_settings.rx_dma_channel,
+                                      DMA_INT_BLOCK_TRANSFER_COMPLETE);
+  g_transceiver.rx_dma_start = g_transceiver.data_index;
+  g_transceiver.rx_dma_end = g_transceiver.data_index + size;
+  g_transceiver.rx_dma_active = true;
+  SYS_INT_SourceStatusClear(g_hw_settings.rx_dma_source);
+  SYS_INT_SourceEnable(g_hw_settings.rx_dma_source);
+  PLIB_DMA_ChannelXEnable(DMA_ID_0, g_hw_settings.rx_dma_channel);
+}
+
+/*
+ * @brief Point the RX DMA channel at the active buffer.
+ *
+ * From here on, received bytes are written directly into the buffer. The
+ * DMA interrupt fires if the buffer fills up, and breaks are reported
+ * by the USART error interrupt.
+ *
+ * For an RDM response, the first block ends at the message length. The DMA
+ * ISR then sizes the next block to end with the checksum, so the end of the
+ * response is detected in the ISR rather than by polling from _Tasks().
+ */
+static void UART_StartRXDMA() {
+  g_transceiver.data_index = 0u;
+  UART_ReceiveRXDMABlock(ExpectRDMResponse() ? MESSAGE_LENGTH_OFFSET + 1u :
+                         BUFFER_SIZE);
+  SYS_INT_SourceStatusClear(g_hw_settings.usart_error_source);
+  SYS_INT_SourceEnable(g_hw_settings.usart_error_source);
+}
+
+/*
+ * @brief Stop the RX DMA channel, if it's running.
+ */
+static void UART_StopRXDMA() {
+  if (g_transceiver.rx_dma_active) {
+    SYS_INT_SourceDisable(g_hw_settings.rx_dma_source);
+    PLIB_DMA_ChannelXDisable(DMA_ID_0, g_hw_settings.rx_dma_channel);
+    g_transceiver.rx_dma_active = false;
+  }
+}
+
+/*
+ * @brief Catch up with the bytes the RX DMA channel has written.
+ * @returns true if new data has arrived.
+ *
+ * This takes the place of UART_RXBytes() when receiving with DMA.
+ */
+static bool UART_RXDMASync() {
+  if (!g_transceiver.rx_dma_active) {
+    return false;
+  }
+
+  // The pointer resets at the end of the block, the DMA ISR handles that case.
+  uint16_t index = g_transceiver.rx_dma_start +
+      PLIB_DMA_ChannelXDestinationPointerGet(DMA_ID_0,
+                                             g_hw_settings.rx_dma_channel);
+  if (index <= g_transceiver.data_index) {
+    return false;
+  }
+  g_transceiver.data_index = index;
+  g_transceiver.last_byte = PLIB_TMR_Counter16BitGet(
+      g_hw_settings.timer_module_id);
+  g_transceiver.last_byte_coarse = CoarseTimer_GetTime();
+  CheckForEndOfResponse();
+  return true;
+}
+
+/*
+ * @brief Start receiving once the receiver is enabled.
+ */
+static inline void UART_StartRX() {
+  if (g_hw_settings.rx_dma) {
+    UART_StartRXDMA();
+  } else {
+    SYS_INT_SourceStatusClear(g_hw_settings.usart_rx_source);
+    SYS_INT_SourceEnable(g_hw_settings.usart_rx_source);
+  }
+}
+
 // Memory Buffer Management
 // ----------------------------------------------------------------------------
 
@@ -370,10 +701,11 @@ bool UART_RXBytes() {
 /*
  * @brief Return the number of free buffers.
  *
- * This is exposed for testing purposes.
+ * The responder's spare RX buffer counts as free. This is exposed for testing
+ * purposes.
  */
 uint8_t Transceiver_FreeBufferCount() {
-  return g_transceiver.free_size;
+  return g_transceiver.free_size + (g_transceiver.rx_spare ? 1u : 0u);
 }
 
 /*
@@ -381,26 +713,65 @@ uint8_t Transceiver_FreeBufferCount() {
  */
 static void InitializeBuffers() {
   g_transceiver.active = NULL;
-  g_transceiver.next = NULL;
+  g_transceiver.rx_spare = NULL;
+  g_transceiver.rx_previous = NULL;
+  g_transceiver.rx_delivering = NULL;
+  g_transceiver.queue_head = 0u;
+  g_transceiver.queue_size = 0u;
 
   unsigned int i = 0u;
   for (; i < NUMBER_OF_BUFFERS; i++) {
     g_transceiver.free_list[i] = &buffers[i];
   }
   g_transceiver.free_size = NUMBER_OF_BUFFERS;
+
+  g_transceiver.resident = &buffers[NUMBER_OF_BUFFERS];
+  g_transceiver.resident->size = 0u;
 }
 
 /*
  * @brief Return the active buffer to the free list.
  */
 static void FreeActiveBuffer() {
-  if (g_transceiver.active) {
+  if (g_transceiver.active == g_transceiver.resident) {
+    g_transceiver.active = NULL;
+  } else if (g_transceiver.active) {
     g_transceiver.free_list[g_transceiver.free_size] = g_transceiver.active;
     g_transceiver.free_size++;
     g_transceiver.active = NULL;
   }
 }
 
+/*
+ * @brief Return the buffer at the head of the queue.
+ * @returns The next buffer ready to be transmitted, or NULL if the queue is
+ *   empty.
+ */
+static inline TransceiverBuffer* NextBuffer() {
+  if (g_transceiver.queue_size == 0u) {
+    return NULL;
+  }
+  return g_transceiver.queue[g_transceiver.queue_head];
+}
+
+/*
+ * @brief Take a buffer from the free list and add it to the end of the queue.
+ * @returns The buffer, or NULL if the queue is full.
+ */
+static TransceiverBuffer* EnqueueBuffer() {
+  if (g_transceiver.free_size == 0u ||
+      g_transceiver.queue_size == TRANSCEIVER_QUEUE_DEPTH) {
+    return NULL;
+  }
+
+  g_transceiver.free_size--;
+  TransceiverBuffer* buffer = g_transceiver.free_list[g_transceiver.free_size];
+  g_transceiver.queue[(g_transceiver.queue_head + g_transceiver.queue_size) %
+                      TRANSCEIVER_QUEUE_DEPTH] = buffer;
+  g_transceiver.queue_size++;
+  return buffer;
+}
+
 /*
  * @brief Move the next buffer to the active buffer.
  */
@@ -409,11 +780,191 @@ static void TakeNextBuffer() {
     g_transceiver.free_list[g_transceiver.free_size] = g_transceiver.active;
     g_transceiver.free_size++;
   }
-  g_transceiver.active = g_transceiver.next;
-  g_transceiver.next = NULL;
+  g_transceiver.active = NextBuffer();
+  if (g_transceiver.active) {
+    g_transceiver.queue_head = (g_transceiver.queue_head + 1u) %
+                               TRANSCEIVER_QUEUE_DEPTH;
+    g_transceiver.queue_size--;
+  }
   g_transceiver.data_index = 0u;
 }
 
+/*
+ * @brief Move a queued buffer to the active buffer.
+ * @param offset The position of the buffer, relative to the head of the queue.
+ *
+ * The buffers ahead of it keep their order.
+ */
+static void TakeQueuedBuffer(uint8_t offset) {
+  TransceiverBuffer* buffer = g_transceiver.queue[
+      (g_transceiver.queue_head + offset) % TRANSCEIVER_QUEUE_DEPTH];
+  for (; offset != 0u; offset--) {
+    g_transceiver.queue[
+        (g_transceiver.queue_head + offset) % TRANSCEIVER_QUEUE_DEPTH] =
+        g_transceiver.queue[
+            (g_transceiver.queue_head + offset - 1u) % TRANSCEIVER_QUEUE_DEPTH];
+  }
+  g_transceiver.queue[g_transceiver.queue_head] = buffer;
+  TakeNextBuffer();
+}
+
+/*
+ * @brief Check if a buffer holds a DMX512 frame.
+ */
+static inline bool IsDMXFrame(const TransceiverBuffer* buffer) {
+  return buffer != NULL && buffer->op == OP_TX_ONLY &&
+         buffer->data[0] == NULL_START_CODE;
+}
+
+/*
+ * @brief Release the active buffer once the controller operation completes.
+ *
+ * If DMX refresh is enabled and the active buffer holds a new DMX frame, it
+ * becomes the resident frame and the old resident buffer is returned to the
+ * free list. Since this swaps pointers between frames, the ISRs never see a
+ * partially updated frame.
+ */
+static void RetireActiveBuffer() {
+  TransceiverBuffer* buffer = g_transceiver.active;
+  if (g_timing_settings.dmx_refresh_interval == 0u ||
+      buffer == g_transceiver.resident ||
+      !IsDMXFrame(buffer)) {
+    FreeActiveBuffer();
+    return;
+  }
+
+  // Refreshes don't generate events.
+  buffer->token = TRANSCEIVER_NO_NOTIFICATION;
+  g_transceiver.active = g_transceiver.resident;
+  g_transceiver.resident = buffer;
+  g_transceiver.free_list[g_transceiver.free_size] = g_transceiver.active;
+  g_transceiver.free_size++;
+  g_transceiver.active = NULL;
+}
+
+/*
+ * @brief Check if the sync points have stopped.
+ * @pre DMX sync is enabled.
+ *
+ * This happens if the USB bus is suspended or disconnected, or if the
+ * transport doesn't deliver SOFs.
+ */
+static bool DMXSyncLost() {
+  return CoarseTimer_HasElapsed(
+      g_dmx_sync.sync_time,
+      g_timing_settings.dmx_sync_period * DMX_SYNC_LOSS_TICKS_PER_FRAME);
+}
+
+/*
+ * @brief Check if the resident DMX frame should be sent again.
+ * @pre There is no active buffer.
+ */
+static bool DMXRefreshDue() {
+  if (g_timing_settings.dmx_refresh_interval == 0u) {
+    // Drop the resident frame, so we don't resume with stale data if refresh
+    // is enabled again.
+    g_transceiver.resident->size = 0u;
+    return false;
+  }
+  if (g_timing_settings.dmx_sync_period && !DMXSyncLost()) {
+    // The sync points pace the refresh.
+    return g_transceiver.resident->size != 0u;
+  }
+  return g_transceiver.resident->size != 0u &&
+         CoarseTimer_HasElapsed(g_transceiver.dmx_frame_start,
+                                g_timing_settings.dmx_refresh_interval);
+}
+
+/*
+ * @brief Check if a DMX frame can start now.
+ *
+ * When DMX sync is enabled, each sync point starts at most one frame. Sync
+ * points that were missed, because another operation was in progress, are
+ * dropped. If the sync points stop, frames are sent unsynchronized until they
+ * resume.
+ */
+static bool DMXSyncReady() {
+  if (g_timing_settings.dmx_sync_period == 0u) {
+    return true;
+  }
+  if (!g_dmx_sync.pending) {
+    return DMXSyncLost();
+  }
+  g_dmx_sync.pending = false;
+  return !CoarseTimer_HasElapsed(g_dmx_sync.sync_time, DMX_SYNC_LATE_LIMIT);
+}
+
+/*
+ * @brief Return the position of the first queued operation that isn't a DMX
+ * frame.
+ * @returns The offset from the head of the queue, or the queue size if every
+ *   queued operation is a DMX frame.
+ */
+static uint8_t FirstNonDMXOperation() {
+  uint8_t i = 0u;
+  for (; i < g_transceiver.queue_size; i++) {
+    if (!IsDMXFrame(g_transceiver.queue[
+            (g_transceiver.queue_head + i) % TRANSCEIVER_QUEUE_DEPTH])) {
+      break;
+    }
+  }
+  return i;
+}
+
+/*
+ * @brief Return the most recent DMX frame that is waiting in the queue.
+ * @returns The buffer, or NULL if there are no DMX frames queued.
+ *
+ * Queued buffers are only taken by Transceiver_Tasks(), so they can be
+ * modified without disabling interrupts.
+ */
+static TransceiverBuffer* QueuedDMXFrame() {
+  uint8_t i = g_transceiver.queue_size;
+  while (i != 0u) {
+    i--;
+    TransceiverBuffer* buffer = g_transceiver.queue[
+        (g_transceiver.queue_head + i) % TRANSCEIVER_QUEUE_DEPTH];
+    if (IsDMXFrame(buffer)) {
+      return buffer;
+    }
+  }
+  return NULL;
+}
+
+/*
+ * @brief Return the last operation in the queue, if it's a DMX frame.
+ * @returns The buffer, or NULL if the queue is empty or the last operation
+ *   isn't a DMX frame.
+ *
+ * Only this frame can be replaced by a newer one, a DMX frame that is queued
+ * behind other operations keeps its place in the queue.
+ */
+static TransceiverBuffer* TailDMXFrame() {
+  if (g_transceiver.queue_size == 0u) {
+    return NULL;
+  }
+  TransceiverBuffer* buffer = g_transceiver.queue[
+      (g_transceiver.queue_head + g_transceiver.queue_size - 1u) %
+      TRANSCEIVER_QUEUE_DEPTH];
+  return IsDMXFrame(buffer) ? buffer : NULL;
+}
+
+/*
+ * @brief Return the most recent DMX frame, which will become the resident
+ * frame.
+ */
+static TransceiverBuffer* LatestDMXFrame() {
+  TransceiverBuffer* buffer = QueuedDMXFrame();
+  if (buffer) {
+    return buffer;
+  }
+  if (g_transceiver.active != g_transceiver.resident &&
+      IsDMXFrame(g_transceiver.active)) {
+    return g_transceiver.active;
+  }
+  return g_transceiver.resident;
+}
+
 // Event Handler functions
 // ----------------------------------------------------------------------------
 static inline void RunTXEventHandler(TransceiverEvent *event) {
@@ -440,6 +991,18 @@ static inline void RunRXEventHandler(TransceiverEvent *event) {
 #endif
 }
 
+static inline int RunRDMFastPath(const uint8_t *frame, unsigned int size,
+                                 const uint8_t **response) {
+#ifdef PIPELINE_TRANSCEIVER_RDM_FAST_PATH
+  return PIPELINE_TRANSCEIVER_RDM_FAST_PATH(frame, size, response);
+#else
+  if (g_rdm_fast_path) {
+    return g_rdm_fast_path(frame, size, response);
+  }
+  return 0;
+#endif
+}
+
 /*
  * @brief Run the completion callback.
  */
@@ -466,14 +1029,112 @@ static inline void FrameComplete() {
 }
 
 /*
- * @brief Run the RX callback.
+ * @brief Queue an RX event for the bytes received since the last event.
+ *
+ * This is the producer side of the RX event queue. If the queue is full, the
+ * event is dropped and the bytes are covered by the next event instead.
  */
-static inline void RXFrameEvent() {
+static void RXQueueFrameEvent() {
+  if (g_transceiver.event_index == g_transceiver.data_index) {
+    return;
+  }
+
+  uint8_t depth = g_rx_events.tail - g_rx_events.head;
+  if (depth == RX_EVENT_QUEUE_SIZE) {
+    g_rx_events.overflows++;
+    return;
+  }
+
+  RXEvent *event = &g_rx_events.events[
+      g_rx_events.tail & (RX_EVENT_QUEUE_SIZE - 1u)];
+  event->result = g_transceiver.event_index == 0u ? T_RESULT_RX_START_FRAME :
+      T_RESULT_RX_CONTINUE_FRAME;
+  event->length = g_transceiver.data_index;
+  event->buffer = g_transceiver.active;
+  g_rx_events.tail++;
+  g_transceiver.event_index = g_transceiver.data_index;
+
+  depth++;
+  if (depth > g_rx_events.high_water) {
+    g_rx_events.high_water = depth;
+  }
+}
+
+/*
+ * @brief Receive the next frame into the spare buffer.
+ * @returns false if there is no spare buffer.
+ *
+ * This is called from the ISRs when a frame starts while RX events are still
+ * queued, so the queued events keep referring to the old buffer.
+ */
+static inline bool RXSwitchBuffer() {
+  if (g_transceiver.rx_spare == NULL) {
+    return false;
+  }
+  g_transceiver.rx_previous = g_transceiver.active;
+  g_transceiver.active = g_transceiver.rx_spare;
+  g_transceiver.rx_spare = NULL;
+  g_transceiver.active->op = OP_RX;
+  return true;
+}
+
+/*
+ * @brief Make the previous RX buffer the spare, once its events are delivered.
+ *
+ * This is only called from _Tasks(), with the RX event queue empty. The ISRs
+ * can't switch buffers until rx_spare is set, so as long as rx_previous is
+ * cleared first, no locking is required.
+ */
+static inline void RXReleasePreviousBuffer() {
+  TransceiverBuffer *previous = g_transceiver.rx_previous;
+  if (previous) {
+    g_transceiver.rx_previous = NULL;
+    g_transceiver.rx_spare = previous;
+  }
+}
+
+/*
+ * @brief Run the RX callback for each queued event.
+ *
+ * This is the consumer side of the RX event queue, it's only called from
+ * _Tasks().
+ */
+static void RXDeliverEvents() {
+  while (g_rx_events.head != g_rx_events.tail) {
+    const RXEvent *rx_event = &g_rx_events.events[
+        g_rx_events.head & (RX_EVENT_QUEUE_SIZE - 1u)];
+    TransceiverEvent event = {
+      0u,
+      T_OP_RX,
+      rx_event->result,
+      rx_event->buffer->data,
+      rx_event->length,
+      &g_timing
+    };
+    g_transceiver.rx_delivering = rx_event->buffer;
+    RunRXEventHandler(&event);
+    g_transceiver.rx_delivering = NULL;
+    g_rx_events.head++;
+  }
+  RXReleasePreviousBuffer();
+}
+
+/*
+ * @brief Drop any queued RX events.
+ */
+static inline void RXDiscardEvents() {
+  g_rx_events.head = g_rx_events.tail;
+  RXReleasePreviousBuffer();
+}
+
+/*
+ * @brief Run the RX callback with an end-of-frame event.
+ */
+static inline void RXEndFrameEvent() {
   TransceiverEvent event = {
     0u,
     T_OP_RX,
-    g_transceiver.event_index == 0u ? T_RESULT_RX_START_FRAME :
-        T_RESULT_RX_CONTINUE_FRAME,
+    T_RESULT_RX_FRAME_TIMEOUT,
     g_transceiver.active->data,
     g_transceiver.data_index,
     &g_timing
@@ -481,23 +1142,253 @@ static inline void RXFrameEvent() {
   RunRXEventHandler(&event);
 }
 
+// Sniffer functions
+// ----------------------------------------------------------------------------
 /*
- * @brief Run the RX callback with an end-of-frame event.
+ * @brief Return the frame being captured.
  */
-static inline void RXEndFrameEvent() {
+static inline SnifferFrame* SnifferCurrentFrame() {
+  return &g_sniffer.frames[g_sniffer.tail & (SNIFFER_QUEUE_SIZE - 1u)];
+}
+
+/*
+ * @brief Start capturing a new frame.
+ * @param timestamp The approximate start of the frame.
+ */
+static void SnifferStartFrame(CoarseTimer_Value timestamp) {
+  SnifferFrame* frame = SnifferCurrentFrame();
+  frame->header.timestamp = timestamp;
+  frame->header.break_time = 0u;
+  frame->header.mark_time = 0u;
+  frame->header.length = 0u;
+  frame->header.flags = g_sniffer.dropped ? SNIFFER_FLAG_FRAMES_DROPPED : 0u;
+  g_sniffer.dropped = false;
+}
+
+/*
+ * @brief Complete the frame being captured.
+ *
+ * This is the producer side of the frame queue. If there is no space to
+ * capture the next frame, the completed frame is dropped and the next frame
+ * is flagged.
+ */
+static void SnifferEndFrame() {
+  if ((uint8_t) (g_sniffer.tail - g_sniffer.head) ==
+      SNIFFER_QUEUE_SIZE - 1u) {
+    g_sniffer.dropped = true;
+  } else {
+    g_sniffer.tail++;
+  }
+  g_transceiver.state = STATE_S_IDLE;
+}
+
+/*
+ * @brief Handle an edge on the line.
+ * @param value The timer value when the edge occurred.
+ *
+ * The edges alternate, since we start looking for a falling edge while the
+ * line is idle.
+ */
+static void SnifferEdge(uint16_t value) {
+  g_sniffer.line_low = !g_sniffer.line_low;
+  if (g_sniffer.line_low) {
+    g_sniffer.last_fall = value;
+    g_sniffer.last_fall_coarse = CoarseTimer_GetTime();
+    if (g_transceiver.state == STATE_S_MARK) {
+      // The start bit of the first slot.
+      SnifferCurrentFrame()->header.mark_time = value - g_sniffer.last_rise;
+      g_transceiver.state = STATE_S_DATA;
+    }
+    return;
+  }
+
+  uint16_t low_time = value - g_sniffer.last_fall;
+  if (CoarseTimer_HasElapsed(g_sniffer.last_fall_coarse,
+                             SNIFFER_LONG_BREAK_TIME)) {
+    // The timer has wrapped.
+    low_time = UINT16_MAX;
+  }
+
+  if (low_time >= SNIFFER_BREAK_TIME_MIN) {
+    // The framing error, if any, was the break.
+    g_sniffer.framing_error = false;
+    if (g_transceiver.state != STATE_S_IDLE) {
+      SnifferEndFrame();
+    }
+    SnifferStartFrame(g_sniffer.last_fall_coarse);
+    SnifferFrame* frame = SnifferCurrentFrame();
+    frame->header.break_time = low_time;
+    frame->header.flags |= SNIFFER_FLAG_BREAK;
+    g_sniffer.last_rise = value;
+    g_sniffer.last_activity = CoarseTimer_GetTime();
+    g_transceiver.state = STATE_S_MARK;
+    return;
+  }
+
+  if (g_transceiver.state != STATE_S_IDLE) {
+    SnifferFrame* frame = SnifferCurrentFrame();
+    if (g_sniffer.framing_error) {
+      frame->header.flags |= SNIFFER_FLAG_FRAMING_ERROR;
+    }
+    if (low_time >= SNIFFER_COLLISION_TIME_MIN) {
+      frame->header.flags |= SNIFFER_FLAG_COLLISION;
+    }
+  }
+  g_sniffer.framing_error = false;
+}
+
+/*
+ * @brief Pull slots out of the UART RX queue.
+ *
+ * Bytes with framing errors are discarded. If the line is still low, the
+ * error can't be classified until the rising edge, since it may be the start
+ * of a break.
+ */
+static void SnifferRXBytes() {
+  while (PLIB_USART_ReceiverDataIsAvailable(g_hw_settings.usart)) {
+    bool framing_error = (PLIB_USART_ErrorsGet(g_hw_settings.usart) &
+                          USART_ERROR_FRAMING);
+    uint8_t slot = PLIB_USART_ReceiverByteReceive(g_hw_settings.usart);
+    if (framing_error) {
+      if (g_sniffer.line_low) {
+        g_sniffer.framing_error = true;
+      } else if (g_transceiver.state != STATE_S_IDLE) {
+        SnifferCurrentFrame()->header.flags |= SNIFFER_FLAG_FRAMING_ERROR;
+      }
+      continue;
+    }
+
+    if (g_transceiver.state == STATE_S_IDLE) {
+      // A frame without a break, e.g. a DUB response.
+      SnifferStartFrame(CoarseTimer_GetTime());
+      g_transceiver.state = STATE_S_DATA;
+    }
+
+    SnifferFrame* frame = SnifferCurrentFrame();
+    uint8_t* data = frame->buffer->data;
+    if (frame->header.length == BUFFER_SIZE) {
+      frame->header.flags |= SNIFFER_FLAG_TRUNCATED;
+      continue;
+    }
+    data[frame->header.length++] = slot;
+
+    // RDM frames are complete once the checksum arrives. Anything after that
+    // is a new frame, e.g. the response to a DUB.
+    if (frame->header.length >= 3u &&
+        data[0] == RDM_START_CODE &&
+        data[1] == RDM_SUB_START_CODE &&
+        frame->header.length == data[2] + 2u) {
+      SnifferEndFrame();
+    }
+  }
+  g_sniffer.last_activity = CoarseTimer_GetTime();
+}
+
+/*
+ * @brief Send the batch of frame records to the event handler.
+ */
+static void SnifferFlushBatch() {
+  if (g_sniffer.batch_size == 0u) {
+    return;
+  }
+
   TransceiverEvent event = {
     0u,
-    T_OP_RX,
-    T_RESULT_RX_FRAME_TIMEOUT,
-    g_transceiver.active->data,
-    g_transceiver.data_index,
+    T_OP_SNIFFER,
+    T_RESULT_OK,
+    g_sniffer.batch,
+    g_sniffer.batch_size,
     &g_timing
   };
-  RunRXEventHandler(&event);
+  RunTXEventHandler(&event);
+  g_sniffer.batch_size = 0u;
+}
+
+/*
+ * @brief Add a frame to the batch.
+ *
+ * Frames that don't fit in a single record are split, the additional records
+ * have SNIFFER_FLAG_CONTINUED set.
+ */
+static void SnifferBatchFrame(const SnifferFrame* frame) {
+  static const uint16_t MAX_RECORD_SLOTS =
+      PAYLOAD_SIZE - sizeof(SnifferFrameHeader);
+
+  SnifferFrameHeader header = frame->header;
+  uint16_t offset = 0u;
+  do {
+    uint16_t length = frame->header.length - offset;
+    if (length > MAX_RECORD_SLOTS) {
+      length = MAX_RECORD_SLOTS;
+    }
+    if (g_sniffer.batch_size + sizeof(header) + length > PAYLOAD_SIZE) {
+      SnifferFlushBatch();
+    }
+    if (g_sniffer.batch_size == 0u) {
+      g_sniffer.batch_start = CoarseTimer_GetTime();
+    }
+
+    header.length = length;
+    memcpy(&g_sniffer.batch[g_sniffer.batch_size], &header, sizeof(header));
+    g_sniffer.batch_size += sizeof(header);
+    memcpy(&g_sniffer.batch[g_sniffer.batch_size],
+           &frame->buffer->data[offset], length);
+    g_sniffer.batch_size += length;
+    offset += length;
+    header.flags |= SNIFFER_FLAG_CONTINUED;
+  } while (offset != frame->header.length);
+}
+
+/*
+ * @brief Batch the completed frames.
+ *
+ * This is the consumer side of the frame queue, it's only called from
+ * _Tasks().
+ */
+static void SnifferDeliverFrames() {
+  while (g_sniffer.head != g_sniffer.tail) {
+    SnifferBatchFrame(
+        &g_sniffer.frames[g_sniffer.head & (SNIFFER_QUEUE_SIZE - 1u)]);
+    g_sniffer.head++;
+  }
+
+  if (g_sniffer.batch_size != 0u &&
+      CoarseTimer_HasElapsed(g_sniffer.batch_start, SNIFFER_BATCH_INTERVAL)) {
+    SnifferFlushBatch();
+  }
 }
 
 // Operating Mode management
 // ----------------------------------------------------------------------------
+/*
+ * @brief Run the completion callback for an operation that won't be sent.
+ */
+static void CancelBuffer(const TransceiverBuffer* buffer) {
+  TransceiverEvent event = {
+    buffer->token,
+    (TransceiverOperation) buffer->op,
+    T_RESULT_CANCELLED,
+    NULL,
+    0,
+    &g_timing
+  };
+  RunTXEventHandler(&event);
+}
+
+/*
+ * @brief Cancel each queued operation, and remove it from the queue.
+ */
+static void CancelQueuedBuffers() {
+  TransceiverBuffer* buffer = NextBuffer();
+  while (buffer) {
+    CancelBuffer(buffer);
+    g_transceiver.queue_head = (g_transceiver.queue_head + 1u) %
+                               TRANSCEIVER_QUEUE_DEPTH;
+    g_transceiver.queue_size--;
+    buffer = NextBuffer();
+  }
+}
+
 static void SwitchMode() {
   g_transceiver.mode = g_transceiver.desired_mode;
   switch (g_transceiver.mode) {
@@ -513,23 +1404,17 @@ static void SwitchMode() {
       SysLog_Message(SYSLOG_INFO, "Changed to self-test mode");
       g_transceiver.state = STATE_T_INITIALIZE;
       break;
+    case T_MODE_SNIFFER:
+      SysLog_Message(SYSLOG_INFO, "Changed to sniffer mode");
+      g_transceiver.state = STATE_S_INITIALIZE;
+      break;
     default:
       SysLog_Print(SYSLOG_INFO, "Unknown mode: %d",
                    g_transceiver.desired_mode);
       return;
   }
   // Reset in case there were any pending commands
-  if (g_transceiver.next) {
-    TransceiverEvent event = {
-      g_transceiver.next->token,
-      (TransceiverOperation) g_transceiver.next->op,
-      T_RESULT_CANCELLED,
-      NULL,
-      0,
-      &g_timing
-    };
-    RunTXEventHandler(&event);
-  }
+  CancelQueuedBuffers();
   InitializeBuffers();
   if (g_transceiver.mode_change_token != TRANSCEIVER_NO_NOTIFICATION) {
     TransceiverEvent event = {
@@ -543,31 +1428,121 @@ static void SwitchMode() {
   }
 }
 
-// ----------------------------------------------------------------------------
-static inline void PrepareRDMResponse() {
-  // Rebase the timer to when the last byte was received
-  RebaseTimer(g_transceiver.last_byte);
+// ----------------------------------------------------------------------------
+/*
+ * @brief Enable the timer to trigger when we send the RDM response.
+ * @param extra_delay Ticks to add to the responder delay.
+ * @pre The timer has been rebased to the end of the request.
+ */
+static inline void StartResponseTimer(uint16_t extra_delay) {
+  unsigned int jitter = 0u;
+  if (g_timing_settings.rdm_responder_jitter) {
+    jitter = Random_PseudoGet() % g_timing_settings.rdm_responder_jitter;
+  }
+  // It's important to stop the timer before changing the period, see 14.3.11
+  PLIB_TMR_Stop(g_hw_settings.timer_module_id);
+  PLIB_TMR_Period16BitSet(
+      g_hw_settings.timer_module_id,
+      g_timing_settings.rdm_responder_delay - RESPONSE_FUDGE_FACTOR + jitter +
+      extra_delay);
+  PLIB_TMR_Start(g_hw_settings.timer_module_id);
+  SYS_INT_SourceStatusClear(g_hw_settings.timer_source);
+  SYS_INT_SourceEnable(g_hw_settings.timer_source);
+}
+
+static inline void PrepareRDMResponse() {
+  // Rebase the timer to when the last byte was received
+  RebaseTimer(g_transceiver.last_byte);
+  UART_StopRXDMA();
+  // Anything after the request is of no interest.
+  RXDiscardEvents();
+
+  g_transceiver.state = STATE_R_TX_WAITING;
+  PLIB_USART_ReceiverDisable(g_hw_settings.usart);
+  PLIB_USART_TransmitterInterruptModeSelect(g_hw_settings.usart,
+                                            USART_TRANSMIT_FIFO_EMPTY);
+
+  TakeNextBuffer();
+  StartResponseTimer(0u);
+}
+
+/*
+ * @brief Work out when the last slot of the request ended.
+ * @param slot The value of the last slot.
+ * @returns The time the stop bits finished, in timer ticks.
+ *
+ * The last edge seen by the IC module is the final rising edge within the
+ * slot. If bit n is the last low bit, counting the start bit as bit 0, the
+ * slot ends 10 - n bit times after that edge.
+ */
+static inline uint16_t SlotEndTime(uint8_t slot) {
+  // Pick up any edges the IC ISR hasn't handled yet.
+  while (!PLIB_IC_BufferIsEmpty(g_hw_settings.input_capture_module)) {
+    g_transceiver.last_change = PLIB_IC_Buffer16BitGet(
+        g_hw_settings.input_capture_module);
+  }
+
+  unsigned int last_low_bit = 0u;
+  uint8_t low_bits = ~slot;
+  while (low_bits) {
+    last_low_bit++;
+    low_bits >>= 1u;
+  }
+  return g_transceiver.last_change + (10u - last_low_bit) * RESPONDER_BIT_TICKS;
+}
+
+/*
+ * @brief Offer a complete RDM request to the fast path handler.
+ *
+ * This is called from the USART ISR. If the handler returns a response, it's
+ * written into the active buffer after the request, so the request data
+ * remains valid for the RX events that _Tasks() hasn't delivered yet. The
+ * timer is then armed from the end of the request, rather than from when
+ * _Tasks() noticed the response.
+ */
+static inline void RunFastPath() {
+  const uint8_t *request = g_transceiver.active->data;
+  uint16_t request_size = g_transceiver.data_index;
+  if (request_size <= MESSAGE_LENGTH_OFFSET ||
+      request[0] != RDM_START_CODE ||
+      request_size != request[MESSAGE_LENGTH_OFFSET] + RDM_CHECKSUM_LENGTH ||
+      g_transceiver.event_index != request_size ||
+      NextBuffer()) {
+    // The request is incomplete, the RX event queue overflowed so _Tasks()
+    // hasn't seen the end of the request, or a response is already queued.
+    return;
+  }
+
+  const uint8_t *response = NULL;
+  int response_size = RunRDMFastPath(request, request_size, &response);
+  unsigned int size = abs(response_size);
+  if (size == 0u || response == NULL || request_size + size > BUFFER_SIZE) {
+    return;
+  }
+
+  TransceiverBuffer *buffer = g_transceiver.active;
+  memcpy(&buffer->data[request_size], response, size);
+  buffer->size = request_size + size;
+  buffer->op = response_size < 0 ? OP_RDM_DUB_RESPONSE : OP_RDM_WITH_RESPONSE;
+  buffer->token = TRANSCEIVER_NO_NOTIFICATION;
 
+  SYS_INT_SourceDisable(g_hw_settings.usart_rx_source);
   g_transceiver.state = STATE_R_TX_WAITING;
   PLIB_USART_ReceiverDisable(g_hw_settings.usart);
   PLIB_USART_TransmitterInterruptModeSelect(g_hw_settings.usart,
                                             USART_TRANSMIT_FIFO_EMPTY);
 
-  TakeNextBuffer();
-
-  // Enable the timer to trigger when we send the RDM response.
-  unsigned int jitter = 0u;
-  if (g_timing_settings.rdm_responder_jitter) {
-    jitter = Random_PseudoGet() % g_timing_settings.rdm_responder_jitter;
+  // The UART interrupt fires part way through the stop bits, so the end of
+  // the request may still be in the future.
+  uint16_t elapsed = PLIB_TMR_Counter16BitGet(g_hw_settings.timer_module_id) -
+                     SlotEndTime(request[request_size - 1u]);
+  uint16_t extra_delay = 0u;
+  if (elapsed > UINT16_MAX / 2u) {
+    extra_delay = -elapsed;
+    elapsed = 0u;
   }
-  // It's important to stop the timer before changing the period, see 14.3.11
-  PLIB_TMR_Stop(g_hw_settings.timer_module_id);
-  PLIB_TMR_Period16BitSet(
-      g_hw_settings.timer_module_id,
-      g_timing_settings.rdm_responder_delay - RESPONSE_FUDGE_FACTOR + jitter);
-  PLIB_TMR_Start(g_hw_settings.timer_module_id);
-  SYS_INT_SourceStatusClear(g_hw_settings.timer_source);
-  SYS_INT_SourceEnable(g_hw_settings.timer_source);
+  PLIB_TMR_Counter16BitSet(g_hw_settings.timer_module_id, elapsed);
+  StartResponseTimer(extra_delay);
 }
 
 static inline void StartSendingRDMResponse() {
@@ -580,9 +1555,7 @@ static inline void StartSendingRDMResponse() {
     g_transceiver.data_index++;
   }
   g_transceiver.state = STATE_R_TX_DATA;
-
-  SYS_INT_SourceStatusClear(g_hw_settings.usart_tx_source);
-  SYS_INT_SourceEnable(g_hw_settings.usart_tx_source);
+  UART_StartTX();
 }
 
 static inline void LogStateChange() {
@@ -605,6 +1578,8 @@ static void ResetTimingSettings() {
   Transceiver_SetRDMDUBResponseLimit(DEFAULT_RDM_DUB_RESPONSE_LIMIT);
   Transceiver_SetRDMResponderDelay(DEFAULT_RDM_RESPONDER_DELAY);
   Transceiver_SetRDMResponderJitter(0u);
+  Transceiver_SetDMXRefreshInterval(DEFAULT_DMX_REFRESH_INTERVAL);
+  Transceiver_SetDMXSync(0u, 0u);
 }
 
 // Interrupt Handlers
@@ -637,8 +1612,7 @@ void __ISR(AS_IC_ISR_VECTOR(TRANSCEIVER_IC), ipl6AUTO)
         } else {
           g_timing.get_set_response.mark_start = value;
           // Break was good, enable UART
-          SYS_INT_SourceStatusClear(g_hw_settings.usart_rx_source);
-          SYS_INT_SourceEnable(g_hw_settings.usart_rx_source);
+          UART_StartRX();
           SYS_INT_SourceStatusClear(g_hw_settings.usart_error_source);
           SYS_INT_SourceEnable(g_hw_settings.usart_error_source);
           PLIB_USART_ReceiverEnable(g_hw_settings.usart);
@@ -658,17 +1632,22 @@ void __ISR(AS_IC_ISR_VECTOR(TRANSCEIVER_IC), ipl6AUTO)
         g_transceiver.state = STATE_R_RX_BREAK;
         break;
       case STATE_R_RX_BREAK:
-        if (value >= RESPONDER_RX_BREAK_TIME_MIN &&
-            value <= RESPONDER_RX_BREAK_TIME_MAX) {
+        if (value < RESPONDER_RX_BREAK_TIME_MIN ||
+            value > RESPONDER_RX_BREAK_TIME_MAX) {
+          // Break was out of range.
+          g_transceiver.state = STATE_R_RX_MBB;
+        } else if (g_rx_events.head != g_rx_events.tail && !RXSwitchBuffer()) {
+          // _Tasks() hasn't delivered the previous frames yet, and there's no
+          // other buffer to receive into. Drop this frame rather than
+          // overwrite the data the queued events refer to.
+          g_rx_events.overflows++;
+          g_transceiver.state = STATE_R_RX_MBB;
+        } else {
           // Break was good, enable UART
           g_timing.request.break_time = value;
-          SYS_INT_SourceStatusClear(g_hw_settings.usart_rx_source);
-          SYS_INT_SourceEnable(g_hw_settings.usart_rx_source);
+          UART_StartRX();
           PLIB_USART_ReceiverEnable(g_hw_settings.usart);
           g_transceiver.state = STATE_R_RX_MARK;
-        } else {
-          // Break was out of range.
-          g_transceiver.state = STATE_R_RX_MBB;
         }
         break;
       case STATE_R_RX_MARK:
@@ -683,6 +1662,7 @@ void __ISR(AS_IC_ISR_VECTOR(TRANSCEIVER_IC), ipl6AUTO)
           PLIB_USART_ReceiverDisable(g_hw_settings.usart);
           SYS_INT_SourceDisable(g_hw_settings.usart_rx_source);
           SYS_INT_SourceStatusClear(g_hw_settings.usart_rx_source);
+          UART_StopRXDMA();
           g_transceiver.state = STATE_R_RX_BREAK;
         } else {
           g_timing.request.mark_time = value - g_timing.request.break_time;
@@ -695,6 +1675,12 @@ void __ISR(AS_IC_ISR_VECTOR(TRANSCEIVER_IC), ipl6AUTO)
         g_transceiver.last_change = value;
         break;
 
+      case STATE_S_IDLE:
+      case STATE_S_MARK:
+      case STATE_S_DATA:
+        SnifferEdge(value);
+        break;
+
       case STATE_C_INITIALIZE:
       case STATE_C_TX_READY:
       case STATE_C_IN_BREAK:
@@ -717,6 +1703,7 @@ void __ISR(AS_IC_ISR_VECTOR(TRANSCEIVER_IC), ipl6AUTO)
       case STATE_T_TX_READY:
       case STATE_T_RX_WAIT:
       case STATE_T_VERIFY:
+      case STATE_S_INITIALIZE:
       case STATE_ERROR:
       case STATE_RESET:
         // Should never happen.
@@ -760,8 +1747,7 @@ void __ISR(AS_TIMER_ISR_VECTOR(TRANSCEIVER_TIMER), ipl6AUTO)
       PLIB_USART_Enable(g_hw_settings.usart);
       PLIB_USART_TransmitterEnable(g_hw_settings.usart);
       g_transceiver.state = STATE_C_TX_DATA;
-      SYS_INT_SourceStatusClear(g_hw_settings.usart_tx_source);
-      SYS_INT_SourceEnable(g_hw_settings.usart_tx_source);
+      UART_StartTX();
       break;
     case STATE_R_TX_WAITING:
       EnableTX();
@@ -816,6 +1802,10 @@ void __ISR(AS_TIMER_ISR_VECTOR(TRANSCEIVER_TIMER), ipl6AUTO)
     case STATE_T_TX_READY:
     case STATE_T_RX_WAIT:
     case STATE_T_VERIFY:
+    case STATE_S_INITIALIZE:
+    case STATE_S_IDLE:
+    case STATE_S_MARK:
+    case STATE_S_DATA:
     case STATE_ERROR:
     case STATE_RESET:
       // Should never happen
@@ -880,8 +1870,7 @@ void __ISR(AS_USART_ISR_VECTOR(TRANSCEIVER_UART), ipl6AUTO)
           SYS_INT_SourceEnable(g_hw_settings.input_capture_source);
 
           PLIB_USART_ReceiverEnable(g_hw_settings.usart);
-          SYS_INT_SourceStatusClear(g_hw_settings.usart_rx_source);
-          SYS_INT_SourceEnable(g_hw_settings.usart_rx_source);
+          UART_StartRX();
           SYS_INT_SourceStatusClear(g_hw_settings.usart_error_source);
           SYS_INT_SourceEnable(g_hw_settings.usart_error_source);
 
@@ -928,8 +1917,9 @@ void __ISR(AS_USART_ISR_VECTOR(TRANSCEIVER_UART), ipl6AUTO)
     SYS_INT_SourceStatusClear(g_hw_settings.usart_tx_source);
   }
 
-  // RX
-  if (SYS_INT_SourceStatusGet(g_hw_settings.usart_rx_source)) {
+  // RX, unless the DMA channel is handling it.
+  if (!g_transceiver.rx_dma_active &&
+      SYS_INT_SourceStatusGet(g_hw_settings.usart_rx_source)) {
     if (g_transceiver.state == STATE_C_RX_IN_DUB ||
         g_transceiver.state == STATE_C_RX_DATA) {
       // For the DUB case, It's impossible to overflow the buffer here, because
@@ -959,16 +1949,26 @@ void __ISR(AS_USART_ISR_VECTOR(TRANSCEIVER_UART), ipl6AUTO)
         g_transceiver.data_index = 0u;
         g_transceiver.event_index = 0u;
         g_transceiver.state = STATE_R_RX_BREAK;
-      } else if (UART_RXBytes()) {
-        // RX buffer is full.
-        SYS_INT_SourceDisable(g_hw_settings.usart_rx_source);
-        SYS_INT_SourceDisable(g_hw_settings.usart_error_source);
-        PLIB_USART_ReceiverDisable(g_hw_settings.usart);
-        g_transceiver.state = STATE_R_TX_COMPLETE;
+      } else {
+        if (UART_RXBytes()) {
+          // RX buffer is full.
+          SYS_INT_SourceDisable(g_hw_settings.usart_rx_source);
+          SYS_INT_SourceDisable(g_hw_settings.usart_error_source);
+          PLIB_USART_ReceiverDisable(g_hw_settings.usart);
+          g_transceiver.state = STATE_R_TX_COMPLETE;
+        }
+        RXQueueFrameEvent();
+        if (g_transceiver.state == STATE_R_RX_DATA) {
+          RunFastPath();
+        }
       }
     } else if (g_transceiver.state == STATE_T_RX_WAIT) {
       UART_RXBytes();
       g_transceiver.state = STATE_T_VERIFY;
+    } else if (g_transceiver.state == STATE_S_IDLE ||
+               g_transceiver.state == STATE_S_MARK ||
+               g_transceiver.state == STATE_S_DATA) {
+      SnifferRXBytes();
     }
     SYS_INT_SourceStatusClear(g_hw_settings.usart_rx_source);
   }
@@ -993,6 +1993,23 @@ void __ISR(AS_USART_ISR_VECTOR(TRANSCEIVER_UART), ipl6AUTO)
         SYS_INT_SourceDisable(g_hw_settings.usart_rx_source);
         SYS_INT_SourceDisable(g_hw_settings.usart_error_source);
         PLIB_USART_ReceiverDisable(g_hw_settings.usart);
+        if (g_transceiver.rx_dma_active) {
+          // _Tasks() may not have seen the end of the frame, so stop the
+          // channel and queue the slots it wrote since the last poll.
+          PLIB_DMA_ChannelXDisable(DMA_ID_0, g_hw_settings.rx_dma_channel);
+          bool break_in_fifo = (PLIB_USART_ErrorsGet(g_hw_settings.usart) &
+                                USART_ERROR_FRAMING);
+          UART_RXDMASync();
+          UART_StopRXDMA();
+          if (!break_in_fifo && g_transceiver.data_index != 0u) {
+            // The channel already moved the break into the buffer.
+            g_transceiver.data_index--;
+          }
+          UART_FlushRX();
+          RXQueueFrameEvent();
+          g_transceiver.data_index = 0u;
+          g_transceiver.event_index = 0u;
+        }
         RebaseTimer(g_transceiver.last_change);
         g_transceiver.state = STATE_R_RX_BREAK;
         break;
@@ -1025,6 +2042,10 @@ void __ISR(AS_USART_ISR_VECTOR(TRANSCEIVER_UART), ipl6AUTO)
       case STATE_T_TX_READY:
       case STATE_T_RX_WAIT:
       case STATE_T_VERIFY:
+      case STATE_S_INITIALIZE:
+      case STATE_S_IDLE:
+      case STATE_S_MARK:
+      case STATE_S_DATA:
       case STATE_ERROR:
       case STATE_RESET:
         // Should never happen.
@@ -1034,6 +2055,87 @@ void __ISR(AS_USART_ISR_VECTOR(TRANSCEIVER_UART), ipl6AUTO)
   }
 }
 
+/*
+ * @brief TX DMA Interrupt handler.
+ *
+ * This is called once the DMA channel has pushed the last byte of the frame
+ * into the USART TX FIFO. From here on we wait for the FIFO to drain, just as
+ * if the bytes had been sent from the USART ISR.
+ */
+void __ISR(AS_DMA_ISR_VECTOR(TRANSCEIVER_TX_DMA_CHANNEL), ipl6AUTO)
+    Transceiver_TXDMAEvent() {
+  if (PLIB_DMA_ChannelXINTSourceFlagGet(DMA_ID_0,
+                                        g_hw_settings.tx_dma_channel,
+                                        DMA_INT_BLOCK_TRANSFER_COMPLETE)) {
+    PLIB_DMA_ChannelXINTSourceFlagClear(DMA_ID_0,
+                                        g_hw_settings.tx_dma_channel,
+                                        DMA_INT_BLOCK_TRANSFER_COMPLETE);
+    SYS_INT_SourceDisable(g_hw_settings.tx_dma_source);
+
+    if (g_transceiver.state == STATE_C_TX_DATA ||
+        g_transceiver.state == STATE_R_TX_DATA) {
+      g_transceiver.data_index = g_transceiver.active->size;
+      PLIB_USART_TransmitterInterruptModeSelect(g_hw_settings.usart,
+                                                USART_TRANSMIT_FIFO_IDLE);
+      g_transceiver.state = g_transceiver.state == STATE_C_TX_DATA ?
+          STATE_C_TX_DRAIN : STATE_R_TX_DRAIN;
+      SYS_INT_SourceStatusClear(g_hw_settings.usart_tx_source);
+      SYS_INT_SourceEnable(g_hw_settings.usart_tx_source);
+    }
+  }
+  SYS_INT_SourceStatusClear(g_hw_settings.tx_dma_source);
+}
+
+/*
+ * @brief RX DMA Interrupt handler.
+ *
+ * This is called at the end of each block: when the length of an RDM response
+ * is known, at the end of the response, or if the DMA channel fills the active
+ * buffer. All other RX events are detected by the USART error ISR or polled
+ * from _Tasks().
+ */
+void __ISR(AS_DMA_ISR_VECTOR(TRANSCEIVER_RX_DMA_CHANNEL), ipl6AUTO)
+    Transceiver_RXDMAEvent() {
+  if (PLIB_DMA_ChannelXINTSourceFlagGet(DMA_ID_0,
+                                        g_hw_settings.rx_dma_channel,
+                                        DMA_INT_BLOCK_TRANSFER_COMPLETE)) {
+    PLIB_DMA_ChannelXINTSourceFlagClear(DMA_ID_0,
+                                        g_hw_settings.rx_dma_channel,
+                                        DMA_INT_BLOCK_TRANSFER_COMPLETE);
+    g_transceiver.data_index = g_transceiver.rx_dma_end;
+    g_transceiver.last_byte = PLIB_TMR_Counter16BitGet(
+        g_hw_settings.timer_module_id);
+    g_transceiver.last_byte_coarse = CoarseTimer_GetTime();
+    UART_StopRXDMA();
+    if (g_transceiver.state == STATE_C_RX_DATA &&
+        g_transceiver.data_index != BUFFER_SIZE) {
+      CheckForEndOfResponse();
+      if (g_transceiver.state == STATE_C_RX_DATA) {
+        // Receive the rest of the response, or the rest of the buffer if this
+        // isn't a valid RDM response.
+        UART_ReceiveRXDMABlock(
+            (g_transceiver.found_expected_length ?
+             g_transceiver.expected_length : BUFFER_SIZE) -
+            g_transceiver.data_index);
+      }
+    } else if (g_transceiver.state == STATE_C_RX_IN_DUB ||
+               g_transceiver.state == STATE_C_RX_DATA) {
+      // The RX buffer is full.
+      PLIB_TMR_Stop(g_hw_settings.timer_module_id);
+      SYS_INT_SourceDisable(g_hw_settings.usart_error_source);
+      PLIB_USART_ReceiverDisable(g_hw_settings.usart);
+      ResetToMark();
+      g_transceiver.state = STATE_C_COMPLETE;
+    } else if (g_transceiver.state == STATE_R_RX_DATA) {
+      SYS_INT_SourceDisable(g_hw_settings.usart_error_source);
+      PLIB_USART_ReceiverDisable(g_hw_settings.usart);
+      RXQueueFrameEvent();
+      g_transceiver.state = STATE_R_TX_COMPLETE;
+    }
+  }
+  SYS_INT_SourceStatusClear(g_hw_settings.rx_dma_source);
+}
+
 // Public API Functions
 // ----------------------------------------------------------------------------
 void Transceiver_Initialize(const TransceiverHardwareSettings* settings,
@@ -1042,6 +2144,7 @@ void Transceiver_Initialize(const TransceiverHardwareSettings* settings,
   g_hw_settings = *settings;
   g_tx_callback = tx_callback;
   g_rx_callback = rx_callback;
+  g_rdm_fast_path = NULL;
 
   g_transceiver.state = STATE_R_INITIALIZE;
   g_transceiver.mode = T_MODE_RESPONDER;
@@ -1090,6 +2193,50 @@ void Transceiver_Initialize(const TransceiverHardwareSettings* settings,
                                INT_SUBPRIORITY_LEVEL0);
   SYS_INT_SourceStatusClear(g_hw_settings.usart_tx_source);
 
+  // Setup the TX DMA channel, the source is set for each frame.
+  if (g_hw_settings.tx_dma) {
+    PLIB_DMA_Enable(DMA_ID_0);
+    PLIB_DMA_ChannelXTriggerEnable(DMA_ID_0, g_hw_settings.tx_dma_channel,
+                                   DMA_CHANNEL_TRIGGER_TRANSFER_START);
+    PLIB_DMA_ChannelXStartIRQSet(DMA_ID_0, g_hw_settings.tx_dma_channel,
+                                 g_hw_settings.tx_dma_trigger);
+    PLIB_DMA_ChannelXDestinationStartAddressSet(
+        DMA_ID_0, g_hw_settings.tx_dma_channel,
+        KVA_TO_PA(PLIB_USART_TransmitterAddressGet(g_hw_settings.usart)));
+    PLIB_DMA_ChannelXDestinationSizeSet(DMA_ID_0,
+                                        g_hw_settings.tx_dma_channel, 1u);
+    PLIB_DMA_ChannelXCellSizeSet(DMA_ID_0, g_hw_settings.tx_dma_channel, 1u);
+    PLIB_DMA_ChannelXINTSourceEnable(DMA_ID_0, g_hw_settings.tx_dma_channel,
+                                     DMA_INT_BLOCK_TRANSFER_COMPLETE);
+    SYS_INT_VectorPrioritySet(g_hw_settings.tx_dma_vector,
+                              INT_PRIORITY_LEVEL6);
+    SYS_INT_VectorSubprioritySet(g_hw_settings.tx_dma_vector,
+                                 INT_SUBPRIORITY_LEVEL0);
+  }
+
+  memset(&g_rx_events, 0, sizeof(g_rx_events));
+
+  // Setup the RX DMA channel, the destination is set for each frame.
+  g_transceiver.rx_dma_active = false;
+  if (g_hw_settings.rx_dma) {
+    PLIB_DMA_Enable(DMA_ID_0);
+    PLIB_DMA_ChannelXTriggerEnable(DMA_ID_0, g_hw_settings.rx_dma_channel,
+                                   DMA_CHANNEL_TRIGGER_TRANSFER_START);
+    PLIB_DMA_ChannelXStartIRQSet(DMA_ID_0, g_hw_settings.rx_dma_channel,
+                                 g_hw_settings.rx_dma_trigger);
+    PLIB_DMA_ChannelXSourceStartAddressSet(
+        DMA_ID_0, g_hw_settings.rx_dma_channel,
+        KVA_TO_PA(PLIB_USART_ReceiverAddressGet(g_hw_settings.usart)));
+    PLIB_DMA_ChannelXSourceSizeSet(DMA_ID_0, g_hw_settings.rx_dma_channel, 1u);
+    PLIB_DMA_ChannelXCellSizeSet(DMA_ID_0, g_hw_settings.rx_dma_channel, 1u);
+    PLIB_DMA_ChannelXINTSourceEnable(DMA_ID_0, g_hw_settings.rx_dma_channel,
+                                     DMA_INT_BLOCK_TRANSFER_COMPLETE);
+    SYS_INT_VectorPrioritySet(g_hw_settings.rx_dma_vector,
+                              INT_PRIORITY_LEVEL6);
+    SYS_INT_VectorSubprioritySet(g_hw_settings.rx_dma_vector,
+                                 INT_SUBPRIORITY_LEVEL0);
+  }
+
   // Setup input capture
   PLIB_IC_Disable(g_hw_settings.input_capture_module);
   PLIB_IC_ModeSelect(g_hw_settings.input_capture_module,
@@ -1109,6 +2256,10 @@ void Transceiver_Initialize(const TransceiverHardwareSettings* settings,
                                INT_SUBPRIORITY_LEVEL0);
 }
 
+void Transceiver_SetRDMFastPath(TransceiverRDMFastPath handler) {
+  g_rdm_fast_path = handler;
+}
+
 bool Transceiver_SetMode(TransceiverMode mode, int16_t token) {
   if (g_transceiver.mode != g_transceiver.desired_mode) {
     SysLog_Message(SYSLOG_WARN, "Mode change already pending");
@@ -1129,6 +2280,9 @@ bool Transceiver_SetMode(TransceiverMode mode, int16_t token) {
     case T_MODE_SELF_TEST:
       SysLog_Message(SYSLOG_INFO, "Switching to self-test mode");
       break;
+    case T_MODE_SNIFFER:
+      SysLog_Message(SYSLOG_INFO, "Switching to sniffer mode");
+      break;
     default:
       SysLog_Print(SYSLOG_INFO, "Unknown mode: %d", mode);
       return false;
@@ -1144,6 +2298,7 @@ TransceiverMode Transceiver_GetMode() {
 
 void Transceiver_Tasks() {
   bool ok;
+  unsigned int i;
   LogStateChange();
 
   switch (g_transceiver.state) {
@@ -1163,17 +2318,32 @@ void Transceiver_Tasks() {
         break;
       }
 
-      if (!g_transceiver.next) {
-        return;
-      }
       // @pre Timer is not running.
       // @pre UART is disabled
       // @pre TX is enabled.
       // @pre RX is disabled.
       // @pre RX InputCapture is disabled.
       // @pre line in marking state
-
-      TakeNextBuffer();
+      // @pre There is no active buffer.
+
+      if (NextBuffer()) {
+        if (IsDMXFrame(NextBuffer()) && !DMXSyncReady()) {
+          // Send the next operation that isn't a DMX frame, if there is one,
+          // while the frame waits for a sync point.
+          uint8_t offset = FirstNonDMXOperation();
+          if (offset == g_transceiver.queue_size) {
+            return;
+          }
+          TakeQueuedBuffer(offset);
+        } else {
+          TakeNextBuffer();
+        }
+      } else if (DMXRefreshDue() && DMXSyncReady()) {
+        g_transceiver.active = g_transceiver.resident;
+        g_transceiver.data_index = 0u;
+      } else {
+        return;
+      }
 
       // Reset state
       g_transceiver.found_expected_length = false;
@@ -1191,6 +2361,9 @@ void Transceiver_Tasks() {
       PLIB_TMR_PrescaleSelect(g_hw_settings.timer_module_id,
                               TMR_PRESCALE_VALUE_1);
       g_transceiver.tx_frame_start = CoarseTimer_GetTime();
+      if (IsDMXFrame(g_transceiver.active)) {
+        g_transceiver.dmx_frame_start = g_transceiver.tx_frame_start;
+      }
       PLIB_TMR_Counter16BitClear(g_hw_settings.timer_module_id);
       PLIB_TMR_Period16BitSet(g_hw_settings.timer_module_id,
                               g_timing_settings.break_ticks);
@@ -1272,6 +2445,14 @@ void Transceiver_Tasks() {
       // responder can block us for up to 1.04s.
       SYS_INT_SourceDisable(g_hw_settings.usart_rx_source);
       SYS_INT_SourceDisable(g_hw_settings.usart_error_source);
+      if (g_transceiver.rx_dma_active) {
+        SYS_INT_SourceDisable(g_hw_settings.rx_dma_source);
+        UART_RXDMASync();
+        if (g_transceiver.state != STATE_C_RX_DATA) {
+          // The complete response has arrived.
+          return;
+        }
+      }
       if (g_transceiver.data_index > 0 &&
           CoarseTimer_HasElapsed(g_transceiver.last_byte_coarse,
                                  CONTROLLER_RECEIVE_RDM_INTERSLOT_TIMEOUT)) {
@@ -1281,7 +2462,11 @@ void Transceiver_Tasks() {
         g_transceiver.state = STATE_C_COMPLETE;
         return;
       }
-      SYS_INT_SourceEnable(g_hw_settings.usart_rx_source);
+      if (g_transceiver.rx_dma_active) {
+        SYS_INT_SourceEnable(g_hw_settings.rx_dma_source);
+      } else {
+        SYS_INT_SourceEnable(g_hw_settings.usart_rx_source);
+      }
       SYS_INT_SourceEnable(g_hw_settings.usart_error_source);
       break;
 
@@ -1325,6 +2510,10 @@ void Transceiver_Tasks() {
       g_transceiver.result = T_RESULT_RX_TIMEOUT;
       break;
     case STATE_C_COMPLETE:
+      if (g_transceiver.rx_dma_active) {
+        UART_RXDMASync();
+        UART_StopRXDMA();
+      }
       if (g_transceiver.active->op == OP_RDM_DUB) {
         SysLog_Print(SYSLOG_INFO, "First DUB: %d", g_timing.dub_response.start);
         SysLog_Print(SYSLOG_INFO, "Last DUB: %d", g_timing.dub_response.end);
@@ -1388,7 +2577,7 @@ void Transceiver_Tasks() {
       }
 
       if (ok) {
-        FreeActiveBuffer();
+        RetireActiveBuffer();
         g_transceiver.state = STATE_C_TX_READY;
       }
       break;
@@ -1415,6 +2604,7 @@ void Transceiver_Tasks() {
 
       // Fall through
     case STATE_R_RX_PREPARE:
+      UART_StopRXDMA();
       // Setup RX buffer
       if (!g_transceiver.active) {
         if (g_transceiver.free_size == 0u) {
@@ -1433,6 +2623,15 @@ void Transceiver_Tasks() {
       g_transceiver.data_index = 0u;
       g_transceiver.event_index = 0u;
       g_transceiver.active->op = OP_RX;
+      RXDiscardEvents();
+
+      // Keep a spare buffer so the next frame doesn't have to be dropped if
+      // it starts before the events for this one have been delivered.
+      if (!g_transceiver.rx_spare && g_transceiver.free_size) {
+        g_transceiver.free_size--;
+        g_transceiver.rx_spare =
+            g_transceiver.free_list[g_transceiver.free_size];
+      }
 
       g_transceiver.state = STATE_R_RX_MBB;
 
@@ -1447,7 +2646,9 @@ void Transceiver_Tasks() {
 
       // Fall through
     case STATE_R_RX_MBB:
-      // noop, waiting for IC event
+      // Waiting for IC event. If the last frame was dropped, finish delivering
+      // the one before it.
+      RXDeliverEvents();
 
       SYS_INT_SourceDisable(g_hw_settings.input_capture_source);
       if (g_transceiver.desired_mode != T_MODE_RESPONDER) {
@@ -1462,14 +2663,28 @@ void Transceiver_Tasks() {
       break;
 
     case STATE_R_RX_BREAK:
-      // noop, waiting for IC event
-      break;
     case STATE_R_RX_MARK:
-      // noop, waiting for IC event
+      // Waiting for IC event, finish delivering the previous frame.
+      RXDeliverEvents();
       break;
 
     case STATE_R_RX_DATA:
+      // Run the callback with the RX interrupts enabled.
+      RXDeliverEvents();
+
       SYS_INT_SourceDisable(g_hw_settings.usart_rx_source);
+      if (g_transceiver.rx_dma_active) {
+        SYS_INT_SourceDisable(g_hw_settings.rx_dma_source);
+        SYS_INT_SourceDisable(g_hw_settings.usart_error_source);
+        UART_RXDMASync();
+      }
+      if (g_transceiver.state != STATE_R_RX_DATA) {
+        // The DMA or error ISR ran before the sources were disabled.
+        break;
+      }
+      // With the RX ISRs disabled, we can act as the producer. This picks up
+      // the bytes written by the DMA channel.
+      RXQueueFrameEvent();
 
       if (g_transceiver.data_index != 0u) {
         // Got at least one byte, so we have the start code.
@@ -1480,6 +2695,8 @@ void Transceiver_Tasks() {
             CoarseTimer_HasElapsed(g_transceiver.last_byte_coarse,
                                    RESPONDER_DMX_INTERSLOT_TIMEOUT)) {
           // RDM inter-slot timeout
+          UART_StopRXDMA();
+          RXDeliverEvents();
           RXEndFrameEvent();
           PLIB_USART_ReceiverDisable(g_hw_settings.usart);
           g_transceiver.state = STATE_R_RX_PREPARE;
@@ -1487,16 +2704,15 @@ void Transceiver_Tasks() {
         }
       }
 
-      if (g_transceiver.event_index != g_transceiver.data_index) {
-        RXFrameEvent();
-        g_transceiver.event_index = g_transceiver.data_index;
-      }
-
-      if (g_transceiver.next) {
+      if (NextBuffer()) {
         // Update the seed with the value from the coarse timer. This is a
         // useful source of entropy.
         Random_SetSeed(CoarseTimer_GetTime());
         PrepareRDMResponse();
+      } else if (g_transceiver.rx_dma_active) {
+        // Continue receiving
+        SYS_INT_SourceEnable(g_hw_settings.rx_dma_source);
+        SYS_INT_SourceEnable(g_hw_settings.usart_error_source);
       } else {
         // Continue receiving
         SYS_INT_SourceEnable(g_hw_settings.usart_rx_source);
@@ -1511,9 +2727,14 @@ void Transceiver_Tasks() {
       // noop
       break;
     case STATE_R_TX_DRAIN:
+      // If the fast path responded, the request is still queued.
+      RXDeliverEvents();
       FreeActiveBuffer();
       break;
     case STATE_R_TX_COMPLETE:
+      // If the RX buffer filled up or the fast path responded, the last events
+      // are still queued.
+      RXDeliverEvents();
       PLIB_TMR_Stop(g_hw_settings.timer_module_id);
       PLIB_TMR_Period16BitSet(g_hw_settings.timer_module_id, 65535u);
       PLIB_TMR_Start(g_hw_settings.timer_module_id);
@@ -1548,7 +2769,7 @@ void Transceiver_Tasks() {
         SwitchMode();
         return;
       }
-      if (!g_transceiver.next) {
+      if (!NextBuffer()) {
         return;
       }
       TakeNextBuffer();
@@ -1585,6 +2806,79 @@ void Transceiver_Tasks() {
       g_transceiver.state = STATE_T_TX_READY;
       break;
 
+    // Sniffer States
+    case STATE_S_INITIALIZE:
+      // Make sure we never drive the line.
+      PLIB_USART_TransmitterDisable(g_hw_settings.usart);
+      SYS_INT_SourceDisable(g_hw_settings.usart_tx_source);
+      EnableRX();
+      PLIB_USART_Enable(g_hw_settings.usart);
+      UART_FlushRX();
+
+      // Setup the timer, the IC events are in 10ths of a microsecond.
+      PLIB_TMR_Stop(g_hw_settings.timer_module_id);
+      PLIB_TMR_Counter16BitClear(g_hw_settings.timer_module_id);
+      PLIB_TMR_Period16BitSet(g_hw_settings.timer_module_id, 65535u);
+      PLIB_TMR_PrescaleSelect(g_hw_settings.timer_module_id,
+                              TMR_PRESCALE_VALUE_8);
+      PLIB_TMR_Start(g_hw_settings.timer_module_id);
+
+      // Each queued frame holds a buffer until we leave sniffer mode.
+      for (i = 0u; i < SNIFFER_QUEUE_SIZE; i++) {
+        g_transceiver.free_size--;
+        g_sniffer.frames[i].buffer =
+            g_transceiver.free_list[g_transceiver.free_size];
+      }
+      g_sniffer.head = 0u;
+      g_sniffer.tail = 0u;
+      g_sniffer.line_low = false;
+      g_sniffer.framing_error = false;
+      g_sniffer.dropped = false;
+      g_sniffer.batch_size = 0u;
+      g_transceiver.state = STATE_S_IDLE;
+
+      // Catch every edge, starting with the next falling edge.
+      SYS_INT_SourceDisable(g_hw_settings.input_capture_source);
+      PLIB_IC_Disable(g_hw_settings.input_capture_module);
+      PLIB_IC_FirstCaptureEdgeSelect(g_hw_settings.input_capture_module,
+                                     IC_EDGE_FALLING);
+      PLIB_IC_Enable(g_hw_settings.input_capture_module);
+      SYS_INT_SourceStatusClear(g_hw_settings.input_capture_source);
+      SYS_INT_SourceEnable(g_hw_settings.input_capture_source);
+
+      SYS_INT_SourceStatusClear(g_hw_settings.usart_rx_source);
+      SYS_INT_SourceEnable(g_hw_settings.usart_rx_source);
+      PLIB_USART_ReceiverEnable(g_hw_settings.usart);
+      // Fall through
+    case STATE_S_IDLE:
+    case STATE_S_MARK:
+    case STATE_S_DATA:
+      if (g_transceiver.desired_mode != T_MODE_SNIFFER) {
+        SYS_INT_SourceDisable(g_hw_settings.input_capture_source);
+        SYS_INT_SourceDisable(g_hw_settings.usart_rx_source);
+        PLIB_IC_Disable(g_hw_settings.input_capture_module);
+        PLIB_USART_ReceiverDisable(g_hw_settings.usart);
+        PLIB_TMR_Stop(g_hw_settings.timer_module_id);
+        SnifferDeliverFrames();
+        SnifferFlushBatch();
+        SwitchMode();
+        break;
+      }
+
+      // Disable interrupts so we don't race.
+      SYS_INT_SourceDisable(g_hw_settings.input_capture_source);
+      SYS_INT_SourceDisable(g_hw_settings.usart_rx_source);
+      if (g_transceiver.state != STATE_S_IDLE &&
+          CoarseTimer_HasElapsed(g_sniffer.last_activity,
+                                 SNIFFER_FRAME_TIMEOUT)) {
+        SnifferEndFrame();
+      }
+      SYS_INT_SourceEnable(g_hw_settings.input_capture_source);
+      SYS_INT_SourceEnable(g_hw_settings.usart_rx_source);
+
+      SnifferDeliverFrames();
+      break;
+
     case STATE_RESET:
       SwitchMode();
       break;
@@ -1593,6 +2887,25 @@ void Transceiver_Tasks() {
   }
 }
 
+/*
+ * @brief Copy a frame into a buffer.
+ */
+static void FillBuffer(TransceiverBuffer* buffer, int16_t token,
+                       uint8_t start_code, InternalOperation op,
+                       const uint8_t* data, unsigned int size) {
+  if (size > DMX_FRAME_SIZE) {
+    size = DMX_FRAME_SIZE;
+  }
+  buffer->size = size + 1u;  // include start code.
+  buffer->op = op;
+  buffer->token = token;
+  buffer->data[0] = start_code;
+  SysLog_Print(SYSLOG_INFO, "Start code %d", start_code);
+  if (size) {
+    memcpy(&buffer->data[1], data, size);
+  }
+}
+
 /*
  * Queue an operation.
  * @param token The token for this operation.
@@ -1600,15 +2913,11 @@ void Transceiver_Tasks() {
  * @param op The type of operation.
  * @param data The frame's slot data.
  * @param size The number of slots.
- * @returns true if the operation was queued, false if the buffer was full.
+ * @returns true if the operation was queued, false if the queue was full.
  */
 bool Transceiver_QueueFrame(int16_t token, uint8_t start_code,
                             InternalOperation op, const uint8_t* data,
                             unsigned int size) {
-  if (g_transceiver.free_size == 0u) {
-    return false;
-  }
-
   if (op == OP_SELF_TEST) {
     if (g_transceiver.mode != T_MODE_SELF_TEST) {
       return false;
@@ -1617,27 +2926,36 @@ bool Transceiver_QueueFrame(int16_t token, uint8_t start_code,
     return false;
   }
 
-  g_transceiver.free_size--;
-  g_transceiver.next = g_transceiver.free_list[g_transceiver.free_size];
-
-  if (size > DMX_FRAME_SIZE) {
-    size = DMX_FRAME_SIZE;
-  }
-  g_transceiver.next->size = size + 1u;  // include start code.
-  g_transceiver.next->op = op;
-  g_transceiver.next->token = token;
-  g_transceiver.next->data[0] = start_code;
-  SysLog_Print(SYSLOG_INFO, "Start code %d", start_code);
-  if (size) {
-    memcpy(&g_transceiver.next->data[1], data, size);
+  TransceiverBuffer* buffer = EnqueueBuffer();
+  if (!buffer) {
+    return false;
   }
+  FillBuffer(buffer, token, start_code, op, data, size);
   return true;
 }
 
 bool Transceiver_QueueDMX(int16_t token, const uint8_t* data,
                           unsigned int size) {
-  return Transceiver_QueueFrame(
-      token, NULL_START_CODE, OP_TX_ONLY, data, size);
+  if (g_transceiver.mode != T_MODE_CONTROLLER) {
+    return false;
+  }
+
+  TransceiverBuffer* buffer = TailDMXFrame();
+  if (!buffer) {
+    return Transceiver_QueueFrame(
+        token, NULL_START_CODE, OP_TX_ONLY, data, size);
+  }
+
+  // Only the newest frame matters, so overwrite the one that hasn't been sent.
+  TransceiverEvent event = {
+    buffer->token,
+    T_OP_TX_ONLY,
+    T_RESULT_SUPERSEDED,
+    NULL, 0, NULL
+  };
+  FillBuffer(buffer, token, NULL_START_CODE, OP_TX_ONLY, data, size);
+  RunTXEventHandler(&event);
+  return true;
 }
 
 bool Transceiver_QueueASC(int16_t token, uint8_t start_code,
@@ -1646,6 +2964,45 @@ bool Transceiver_QueueASC(int16_t token, uint8_t start_code,
       token, start_code, OP_TX_ONLY, data, size);
 }
 
+bool Transceiver_PatchDMX(uint16_t offset, const uint8_t* data,
+                          unsigned int size) {
+  if (g_transceiver.mode != T_MODE_CONTROLLER ||
+      g_timing_settings.dmx_refresh_interval == 0u ||
+      (uint32_t) offset + size > DMX_FRAME_SIZE) {
+    return false;
+  }
+
+  TransceiverBuffer* frame = LatestDMXFrame();
+  if (frame == g_transceiver.active) {
+    // The frame is on the wire. Rather than change it under the ISR, patch a
+    // copy, which is sent next and then becomes the resident frame.
+    TransceiverBuffer* copy = EnqueueBuffer();
+    if (!copy) {
+      return false;
+    }
+    copy->op = OP_TX_ONLY;
+    copy->token = TRANSCEIVER_NO_NOTIFICATION;
+    copy->size = frame->size;
+    memcpy(copy->data, frame->data, frame->size);
+    frame = copy;
+  }
+
+  if (frame->size == 0u) {
+    frame->data[0] = NULL_START_CODE;
+    frame->size = 1u;
+  }
+
+  uint16_t end = offset + size + 1u;  // include start code.
+  if (end > frame->size) {
+    memset(&frame->data[frame->size], 0, end - frame->size);
+    frame->size = end;
+  }
+  if (size) {
+    memcpy(&frame->data[offset + 1u], data, size);
+  }
+  return true;
+}
+
 bool Transceiver_QueueRDMDUB(int16_t token, const uint8_t* data,
                              unsigned int size) {
   return Transceiver_QueueFrame(
@@ -1664,35 +3021,43 @@ bool Transceiver_QueueRDMRequest(int16_t token, const uint8_t* data,
 bool Transceiver_QueueRDMResponse(bool include_break,
                                   const IOVec* data,
                                   unsigned int iov_count) {
-  if (g_transceiver.mode != T_MODE_RESPONDER || g_transceiver.free_size == 0u) {
+  if (g_transceiver.mode != T_MODE_RESPONDER) {
     return false;
   }
 
-  if (g_transceiver.state != STATE_R_RX_DATA) {
-    // Can only queue while we're receiving data
+  if (g_transceiver.state != STATE_R_RX_DATA || NextBuffer()) {
+    // Can only queue a single response while we're receiving data
     return false;
   }
 
-  g_transceiver.free_size--;
-  g_transceiver.next = g_transceiver.free_list[g_transceiver.free_size];
+  if (g_transceiver.rx_delivering &&
+      g_transceiver.rx_delivering != g_transceiver.active) {
+    // The request was followed by another frame, which is being received now.
+    return false;
+  }
+
+  TransceiverBuffer* buffer = EnqueueBuffer();
+  if (!buffer) {
+    return false;
+  }
 
   unsigned int i = 0u;
   uint16_t offset = 0u;
   for (; i != iov_count; i++) {
     if (offset + data[i].length > BUFFER_SIZE) {
-      memcpy(g_transceiver.next->data + offset, data[i].base,
+      memcpy(buffer->data + offset, data[i].base,
              BUFFER_SIZE - offset);
       offset = BUFFER_SIZE;
       SysLog_Message(SYSLOG_ERROR, "Truncated RDM response");
       break;
     } else {
-      memcpy(g_transceiver.next->data + offset, data[i].base, data[i].length);
+      memcpy(buffer->data + offset, data[i].base, data[i].length);
       offset += data[i].length;
     }
   }
-  g_transceiver.next->size = offset;
-  g_transceiver.next->op = include_break ? OP_RDM_WITH_RESPONSE :
-                           OP_RDM_DUB_RESPONSE;
+  buffer->size = offset;
+  buffer->op = include_break ? OP_RDM_WITH_RESPONSE : OP_RDM_DUB_RESPONSE;
+  buffer->token = TRANSCEIVER_NO_NOTIFICATION;
   return true;
 }
 
@@ -1713,6 +3078,14 @@ void Transceiver_Reset() {
   SYS_INT_SourceDisable(g_hw_settings.usart_error_source);
   SYS_INT_SourceStatusClear(g_hw_settings.usart_error_source);
 
+  // Reset DMA
+  if (g_hw_settings.tx_dma) {
+    SYS_INT_SourceDisable(g_hw_settings.tx_dma_source);
+    SYS_INT_SourceStatusClear(g_hw_settings.tx_dma_source);
+    PLIB_DMA_ChannelXDisable(DMA_ID_0, g_hw_settings.tx_dma_channel);
+  }
+  UART_StopRXDMA();
+
   // Reset Timer
   SYS_INT_SourceDisable(g_hw_settings.timer_source);
   SYS_INT_SourceStatusClear(g_hw_settings.timer_source);
@@ -1728,8 +3101,21 @@ void Transceiver_Reset() {
   PLIB_USART_TransmitterDisable(g_hw_settings.usart);
   PLIB_USART_Disable(g_hw_settings.usart);
 
+  // Cancel the operation in progress and any queued ones, so their owners
+  // aren't left waiting for a completion event. In the backoff state the
+  // completion event has already been sent.
+  if ((g_transceiver.mode == T_MODE_CONTROLLER ||
+       g_transceiver.mode == T_MODE_SELF_TEST) &&
+      g_transceiver.state != STATE_C_BACKOFF &&
+      g_transceiver.active &&
+      g_transceiver.active != g_transceiver.resident) {
+    CancelBuffer(g_transceiver.active);
+  }
+  CancelQueuedBuffers();
+
   // Reset buffers in case we got into a weird state.
   InitializeBuffers();
+  RXDiscardEvents();
 
   // Reset all timing configuration.
   ResetTimingSettings();
@@ -1840,3 +3226,84 @@ bool Transceiver_SetRDMResponderJitter(uint16_t max_jitter) {
 uint16_t Transceiver_GetRDMResponderJitter() {
   return g_timing_settings.rdm_responder_jitter;
 }
+
+bool Transceiver_SetDMXRefreshInterval(uint16_t interval) {
+  if (interval > MAXIMUM_DMX_REFRESH_INTERVAL) {
+    return false;
+  }
+  g_timing_settings.dmx_refresh_interval = interval;
+  return true;
+}
+
+uint16_t Transceiver_GetDMXRefreshInterval() {
+  return g_timing_settings.dmx_refresh_interval;
+}
+
+bool Transceiver_SetDMXSync(uint16_t period, uint16_t anchor) {
+  if (period > MAXIMUM_DMX_SYNC_PERIOD || anchor > USB_FRAME_NUMBER_MASK) {
+    return false;
+  }
+  g_timing_settings.dmx_sync_period = 0u;
+  g_dmx_sync.anchored = false;
+  g_dmx_sync.pending = false;
+  g_dmx_sync.sync_time = CoarseTimer_GetTime();
+  g_timing_settings.dmx_sync_anchor = anchor;
+  g_timing_settings.dmx_sync_period = period;
+  return true;
+}
+
+uint16_t Transceiver_GetDMXSyncPeriod() {
+  return g_timing_settings.dmx_sync_period;
+}
+
+uint16_t Transceiver_GetDMXSyncAnchor() {
+  return g_timing_settings.dmx_sync_anchor;
+}
+
+void Transceiver_SOF(uint16_t frame_number) {
+  uint16_t period = g_timing_settings.dmx_sync_period;
+  if (period == 0u) {
+    return;
+  }
+
+  frame_number &= USB_FRAME_NUMBER_MASK;
+  if (g_dmx_sync.anchored) {
+    g_dmx_sync.phase += (frame_number - g_dmx_sync.last_frame) &
+                        USB_FRAME_NUMBER_MASK;
+    if (g_dmx_sync.phase < period) {
+      g_dmx_sync.last_frame = frame_number;
+      return;
+    }
+    // If SOFs were missed, wait for the next sync point.
+    g_dmx_sync.phase %= period;
+  } else {
+    // Treat the distance from the anchor as a signed 11 bit value, so that
+    // devices anchored either side of the anchor frame agree on the phase.
+    int16_t delta = (frame_number - g_timing_settings.dmx_sync_anchor) &
+                    USB_FRAME_NUMBER_MASK;
+    if (delta > (USB_FRAME_NUMBER_MASK >> 1)) {
+      delta -= USB_FRAME_NUMBER_MASK + 1;
+    }
+    delta %= (int16_t) period;
+    g_dmx_sync.phase = delta < 0 ? delta + period : delta;
+    g_dmx_sync.anchored = true;
+  }
+  g_dmx_sync.last_frame = frame_number;
+
+  if (g_dmx_sync.phase == 0u) {
+    g_dmx_sync.sync_time = CoarseTimer_GetTime();
+    g_dmx_sync.pending = true;
+  }
+}
+
+uint32_t Transceiver_GetRXEventOverflowCount() {
+  return g_rx_events.overflows;
+}
+
+uint8_t Transceiver_GetRXEventHighWater() {
+  return g_rx_events.high_water;
+}
+
+CoarseTimer_Value Transceiver_GetFrameStartTime() {
+  return g_transceiver.tx_frame_start;
+}
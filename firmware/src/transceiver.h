@@ -37,6 +37,7 @@
  *  - DMX / RDM Controller
  *  - DMX / RDM Receiver
  *  - Self Test
+ *  - Sniffer
  *
  * Since we may be in the middle of performing an operation when the mode
  * change request occurs, the Transceiver_SetMode() function takes a token
@@ -47,10 +48,30 @@
  *
  * In controller mode, clients can send E1.11 frames by calling one of:
  *  - Transceiver_QueueDMX();
+ *  - Transceiver_PatchDMX();
  *  - Transceiver_QueueASC();
  *  - Transceiver_QueueRDMDUB();
  *  - Transceiver_QueueRDMRequest();
  *
+ * Up to TRANSCEIVER_QUEUE_DEPTH operations can be queued. Operations are sent
+ * in the order they were queued, and the TransceiverEventCallback is run for
+ * each one as it completes.
+ *
+ * If the last operation in the queue is a DMX frame, a newer DMX frame
+ * replaces it in place, and the replaced frame completes with
+ * T_RESULT_SUPERSEDED, so a host that sends faster than the line rate never
+ * sees the queue fill with DMX. A DMX frame that is queued behind other
+ * operations is never replaced, so operations are always sent in order.
+ *
+ * If a DMX refresh interval is configured with
+ * Transceiver_SetDMXRefreshInterval(), the last DMX frame is retransmitted
+ * until a new frame replaces it. Queued operations take priority over
+ * refresh frames.
+ *
+ * DMX frames can be aligned to the USB Start-of-Frame packets with
+ * Transceiver_SetDMXSync(), so that several devices attached to the same host
+ * output frames in phase.
+ *
  * See @ref controller-overview "Controller State Machine".
  *
  * @par Responder Mode
@@ -59,6 +80,12 @@
  * received. The handler should call Transceiver_QueueRDMResponse() to send a
  * response frame. See @ref responder-overview "Responder State Machine".
  *
+ * Requests that can be answered without the main loop, like the discovery
+ * PIDs, can be handled by a TransceiverRDMFastPath handler. This runs from the
+ * USART ISR as soon as the checksum arrives, and the response is sent exactly
+ * rdm_responder_delay after the end of the request, no matter how busy the
+ * main loop is.
+ *
  * @par Self Test Mode
  *
  * This puts the E1.11 driver circuit into loopback mode and allows the client
@@ -66,6 +93,14 @@
  * single byte which can be used to confirm the driver circuit is working
  * correctly.
  *
+ * @par Sniffer Mode
+ *
+ * In sniffer mode the transceiver never drives the line. Each frame on the
+ * line, including DMX512, RDM, ASC frames and DUB responses, is captured
+ * along with the break & mark timings. The frames are packed into batches of
+ * SnifferFrameHeader records and delivered to the TransceiverEventCallback as
+ * T_OP_SNIFFER events, with a token of 0.
+ *
  * @addtogroup transceiver
  * @{
  * @file transceiver.h
@@ -78,8 +113,10 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+#include "coarse_timer.h"
 #include "iovec.h"
 #include "system_config.h"
+#include "peripheral/dma/plib_dma.h"
 #include "peripheral/ic/plib_ic.h"
 #include "peripheral/ports/plib_ports.h"
 #include "peripheral/tmr/plib_tmr.h"
@@ -104,6 +141,7 @@ typedef enum {
   T_MODE_CONTROLLER,  //!< An RDM controller and/or source of DMX512
   T_MODE_RESPONDER,  //!< An RDM device and/or receiver of DMX512.
   T_MODE_SELF_TEST,  //!< Self test mode.
+  T_MODE_SNIFFER,  //!< Passively capture frames on the line.
   T_MODE_LAST  //!< The first 'undefined' mode
 } TransceiverMode;
 
@@ -117,9 +155,39 @@ typedef enum {
   T_OP_RDM_WITH_RESPONSE,  //!< A RDM Get / Set Request.
   T_OP_RX,  //!< Receive mode.
   T_OP_MODE_CHANGE,  //!< Mode change complete
-  T_OP_SELF_TEST  //!< Self test complete
+  T_OP_SELF_TEST,  //!< Self test complete
+  T_OP_SNIFFER  //!< A batch of captured frames.
 } TransceiverOperation;
 
+/**
+ * @brief The flags set in a SnifferFrameHeader.
+ */
+typedef enum {
+  SNIFFER_FLAG_BREAK = 0x01,  //!< The frame started with a break.
+  SNIFFER_FLAG_FRAMING_ERROR = 0x02,  //!< A slot had a framing error.
+  SNIFFER_FLAG_COLLISION = 0x04,  //!< The line was held low mid-frame.
+  SNIFFER_FLAG_TRUNCATED = 0x08,  //!< Slots were dropped from the frame.
+  SNIFFER_FLAG_FRAMES_DROPPED = 0x10,  //!< Earlier frames were dropped.
+  SNIFFER_FLAG_CONTINUED = 0x20  //!< The record continues the previous frame.
+} SnifferFlags;
+
+/**
+ * @brief The header of each frame record in a T_OP_SNIFFER event.
+ *
+ * The header is followed by length bytes of slot data, starting with the
+ * start code. All fields are little endian.
+ */
+typedef struct {
+  /**
+   * @brief The approximate start of the frame, in 10ths of a millisecond.
+   */
+  uint32_t timestamp;
+  uint16_t break_time;  //!< The break time in 10ths of a uS, or 0.
+  uint16_t mark_time;  //!< The mark time in 10ths of a uS, or 0.
+  uint16_t length;  //!< The number of slots that follow the header.
+  uint8_t flags;  //!< A bitfield of SnifferFlags.
+} __attribute__((packed)) SnifferFrameHeader;
+
 /**
  * @brief The result of an operation.
  */
@@ -140,7 +208,8 @@ typedef enum {
   T_RESULT_RX_FRAME_TIMEOUT,
 
   T_RESULT_CANCELLED,  //!< The operation was cancelled
-  T_RESULT_SELF_TEST_FAILED  //!< The test failed.
+  T_RESULT_SELF_TEST_FAILED,  //!< The test failed.
+  T_RESULT_SUPERSEDED  //!< A newer DMX frame replaced this one.
 } TransceiverOperationResult;
 
 /**
@@ -192,6 +261,8 @@ typedef union {
  *  - A RDM timeout has occured.
  *
  * In responder mode, events occur when a frame is received.
+ *
+ * In sniffer mode, events occur when a batch of frames is ready.
  */
 typedef struct {
   /**
@@ -240,6 +311,25 @@ typedef struct {
  */
 typedef bool (*TransceiverEventCallback)(const TransceiverEvent *event);
 
+/**
+ * @brief Answer a RDM request from the RX interrupt.
+ * @param frame The RDM request, starting with the start code and including
+ *   the checksum.
+ * @param size The size of the request.
+ * @param[out] response Set to the response frame, if there is one.
+ * @returns The size of the response, or the negated size if the response
+ *   should be sent without a break. 0 means there is no fast path response.
+ *
+ * This is run from the USART ISR so it must be quick, and it must not touch
+ * state that belongs to the main loop. The response is copied before the
+ * function returns. The request is still delivered to the
+ * TransceiverEventCallback later, but Transceiver_QueueRDMResponse() will
+ * fail if the fast path has already responded.
+ */
+typedef int (*TransceiverRDMFastPath)(const uint8_t *frame,
+                                      unsigned int size,
+                                      const uint8_t **response);
+
 /**
  * @brief The hardware settings to use for the Transceiver.
  *
@@ -264,6 +354,16 @@ typedef struct {
   INT_VECTOR timer_vector;  //!< The vector to use for timer
   INT_SOURCE timer_source;  //!< The source to use for timer
   IC_TIMERS input_capture_timer;  //!< The timer to use for IC
+  bool tx_dma;  //!< Use DMA to feed the USART during transmit.
+  DMA_CHANNEL tx_dma_channel;  //!< The DMA channel to use for transmit
+  INT_VECTOR tx_dma_vector;  //!< The vector to use for the DMA channel
+  INT_SOURCE tx_dma_source;  //!< The source of DMA channel events
+  DMA_TRIGGER_SOURCE tx_dma_trigger;  //!< The DMA trigger for USART TX
+  bool rx_dma;  //!< Use DMA to drain the USART during receive.
+  DMA_CHANNEL rx_dma_channel;  //!< The DMA channel to use for receive
+  INT_VECTOR rx_dma_vector;  //!< The vector to use for the DMA channel
+  INT_SOURCE rx_dma_source;  //!< The source of DMA channel events
+  DMA_TRIGGER_SOURCE rx_dma_trigger;  //!< The DMA trigger for USART RX
 } TransceiverHardwareSettings;
 
 /**
@@ -281,6 +381,17 @@ void Transceiver_Initialize(const TransceiverHardwareSettings *settings,
                             TransceiverEventCallback tx_callback,
                             TransceiverEventCallback rx_callback);
 
+/**
+ * @brief Set the handler for RDM requests that can be answered from the ISR.
+ * @param handler The handler to use, or NULL to disable the fast path.
+ *
+ * If PIPELINE_TRANSCEIVER_RDM_FAST_PATH is defined in app_pipeline.h, the
+ * macro will override the handler. The fast path only runs if the RX DMA
+ * channel is disabled, since otherwise there is no interrupt for each byte.
+ * Transceiver_Initialize() resets the handler to NULL.
+ */
+void Transceiver_SetRDMFastPath(TransceiverRDMFastPath handler);
+
 /**
  * @brief Change the operating mode of the transceiver.
  * @param mode the new operating mode.
@@ -314,11 +425,37 @@ void Transceiver_Tasks();
  * @param data The DMX data, excluding the start code.
  * @param size The size of the DMX data, excluding the start code.
  * @returns true if the frame was accepted and buffered, false if the transmit
- *   buffer is full.
+ *   queue is full.
+ *
+ * If the last operation in the queue is a DMX frame, it's overwritten with
+ * this one and an event with T_RESULT_SUPERSEDED is run for the old token.
+ * Otherwise the frame is added to the end of the queue.
  */
 bool Transceiver_QueueDMX(int16_t token, const uint8_t* data,
                           unsigned int size);
 
+/**
+ * @brief Update a range of slots in the DMX frame being refreshed.
+ * @param offset The slot offset to start at, excluding the start code.
+ * @param data The new slot data.
+ * @param size The number of slots to update.
+ * @returns true if the frame was updated, false if DMX refresh is disabled,
+ *   the transceiver isn't in controller mode, the range extends beyond the
+ *   end of the frame or the transmit queue is full.
+ *
+ * The most recently queued DMX frame is updated in place. If the frame is
+ * shorter than offset + size slots, it's extended and any new slots are set
+ * to 0. If no DMX frame has been sent, a new frame is started.
+ *
+ * A frame that is being sent is never changed. Instead a patched copy is
+ * queued, which uses a slot in the transmit queue, and later patches update
+ * the copy until it's sent. The copy doesn't generate an event.
+ *
+ * @sa Transceiver_SetDMXRefreshInterval.
+ */
+bool Transceiver_PatchDMX(uint16_t offset, const uint8_t* data,
+                          unsigned int size);
+
 /**
  * @brief Queue an alternate start code (ASC) frame for transmission.
  * @param token The token for this operation.
@@ -326,7 +463,7 @@ bool Transceiver_QueueDMX(int16_t token, const uint8_t* data,
  * @param data The ASC data, excluding the start code.
  * @param size The size of the data, excluding the start code.
  * @returns true if the frame was accepted and buffered, false if the transmit
- *   buffer is full.
+ *   queue is full.
  */
 bool Transceiver_QueueASC(int16_t token, uint8_t start_code,
                           const uint8_t* data, unsigned int size);
@@ -337,7 +474,7 @@ bool Transceiver_QueueASC(int16_t token, uint8_t start_code,
  * @param data The RDM DUB data, excluding the start code.
  * @param size The size of the RDM DUB data, excluding the start code.
  * @returns true if the frame was accepted and buffered, false if the transmit
- *   buffer is full.
+ *   queue is full.
  */
 bool Transceiver_QueueRDMDUB(int16_t token, const uint8_t* data,
                              unsigned int size);
@@ -349,7 +486,7 @@ bool Transceiver_QueueRDMDUB(int16_t token, const uint8_t* data,
  * @param size The size of the RDM data, excluding the start code.
  * @param is_broadcast True if this is a broadcast request.
  * @returns true if the frame was accepted and buffered, false if the transmit
- *   buffer is full.
+ *   queue is full.
  */
 bool Transceiver_QueueRDMRequest(int16_t token, const uint8_t* data,
                                  unsigned int size, bool is_broadcast);
@@ -360,7 +497,7 @@ bool Transceiver_QueueRDMRequest(int16_t token, const uint8_t* data,
  * @param iov The data to send in the response
  * @param iov_count The number of IOVecs.
  * @returns true if the frame was accepted and buffered, false if the transmit
- *   buffer is full.
+ *   queue is full, or another frame has started since the request.
  */
 bool Transceiver_QueueRDMResponse(bool include_break,
                                   const IOVec* iov,
@@ -376,7 +513,8 @@ bool Transceiver_QueueSelfTest(int16_t token);
  * @brief Reset the transceiver state.
  *
  * This can be used to recover from an error. The line will be placed back into
- * a MARK state.
+ * a MARK state. The operation in progress, and any queued operations, complete
+ * with T_RESULT_CANCELLED.
  */
 void Transceiver_Reset();
 
@@ -527,6 +665,115 @@ bool Transceiver_SetRDMResponderJitter(uint16_t max_jitter);
  */
 uint16_t Transceiver_GetRDMResponderJitter();
 
+/**
+ * @brief Configure continuous DMX output.
+ * @param interval the minimum time between the start of consecutive DMX
+ *   frames, in 10ths of a millisecond. Set to 0 to disable refresh. Valid
+ *   values are 0 to 10000 (0 - 1s).
+ * @returns true if the interval was updated, false if the value was out of
+ *   range.
+ *
+ * When refresh is enabled, the last frame passed to Transceiver_QueueDMX() is
+ * sent again each time the interval elapses and no other operation is
+ * pending. A new frame replaces the resident frame once it has been sent.
+ * Retransmissions do not generate events.
+ *
+ * Values less than the minimum break-to-break time result in frames being sent
+ * as fast as the break, mark and slot timing allows.
+ *
+ * The default value is 0.
+ */
+bool Transceiver_SetDMXRefreshInterval(uint16_t interval);
+
+/**
+ * @brief Return the DMX refresh interval.
+ * @returns The DMX refresh interval, in 10ths of a millisecond.
+ * @sa Transceiver_SetDMXRefreshInterval.
+ */
+uint16_t Transceiver_GetDMXRefreshInterval();
+
+/**
+ * @brief Align the start of DMX frames to USB Start-of-Frame packets.
+ * @param period the number of USB frames (1ms) between sync points. Set to 0
+ *   to disable sync. Valid values are 0 to 1000 (0 - 1s).
+ * @param anchor the USB frame number of a sync point, 0 to 2047.
+ * @returns true if the sync settings were updated, false if either value was
+ *   out of range.
+ *
+ * When sync is enabled, DMX frames are held until the next sync point, and
+ * each sync point starts at most one DMX frame. Sync points occur on the USB
+ * frames which are a multiple of period frames from the anchor. Other
+ * operations don't wait for a sync point, any that are queued behind a held
+ * DMX frame are sent ahead of it.
+ *
+ * If no sync point occurs for two periods, for example because the USB bus
+ * was suspended, DMX frames are sent unsynchronized until the sync points
+ * resume.
+ *
+ * Since every device attached to a host sees the same USB frame numbers,
+ * devices configured with the same period and anchor output frames in phase.
+ * The anchor is interpreted relative to the USB frame number when the first
+ * SOF arrives, so it should be within 1s of the host's current frame number.
+ *
+ * If DMX refresh is enabled, the resident frame is sent on each sync point
+ * rather than after the refresh interval.
+ *
+ * The default is 0, sync disabled.
+ */
+bool Transceiver_SetDMXSync(uint16_t period, uint16_t anchor);
+
+/**
+ * @brief Return the DMX sync period.
+ * @returns The DMX sync period, in USB frames.
+ * @sa Transceiver_SetDMXSync.
+ */
+uint16_t Transceiver_GetDMXSyncPeriod();
+
+/**
+ * @brief Return the DMX sync anchor.
+ * @returns The USB frame number the sync points are aligned to.
+ * @sa Transceiver_SetDMXSync.
+ */
+uint16_t Transceiver_GetDMXSyncAnchor();
+
+/**
+ * @brief Called on each USB Start-of-Frame.
+ * @param frame_number The USB frame number from the SOF packet.
+ *
+ * This may be called from an interrupt handler.
+ */
+void Transceiver_SOF(uint16_t frame_number);
+
+/**
+ * @brief Return the number of RX events that were dropped.
+ * @returns The number of events dropped because the RX event queue was full,
+ *   plus the number of frames dropped because the earlier frames hadn't been
+ *   delivered.
+ *
+ * In responder mode, RX events are queued by the interrupt handlers and
+ * delivered to the callback from Transceiver_Tasks(). A dropped event doesn't
+ * lose data, the bytes are included in the next event instead. If the events
+ * for a frame are still queued when the break for the next frame ends, the
+ * next frame is received into a spare buffer. It's only ignored if the spare
+ * buffer is already in use.
+ */
+uint32_t Transceiver_GetRXEventOverflowCount();
+
+/**
+ * @brief Return the maximum number of RX events that have been queued.
+ * @returns The high water mark of the RX event queue.
+ */
+uint8_t Transceiver_GetRXEventHighWater();
+
+/**
+ * @brief Return the time the most recent controller frame started.
+ * @returns The CoarseTimer value when the break for the frame started.
+ *
+ * When called from the TransceiverEventCallback, this is the start of the
+ * frame for the operation that completed.
+ */
+CoarseTimer_Value Transceiver_GetFrameStartTime();
+
 #ifdef __cplusplus
 }
 #endif
@@ -65,6 +65,21 @@
  */
 #define MAXIMUM_TX_MARK_TIME 800u
 
+/**
+ * @brief The maximum DMX refresh interval the user can configure.
+ *
+ * Measured in 10ths of a millisecond. Table 6 of E1.11 (2008) lists the
+ * maximum break-to-break time as 1s.
+ */
+#define MAXIMUM_DMX_REFRESH_INTERVAL 10000u
+
+/**
+ * @brief The maximum DMX sync period the user can configure.
+ *
+ * Measured in USB frames (1ms). This matches the maximum refresh interval.
+ */
+#define MAXIMUM_DMX_SYNC_PERIOD 1000u
+
 // Controller params
 // ----------------------------------------------------------------------------
 
@@ -206,6 +221,47 @@
  */
 #define CONTROLLER_RECEIVE_RDM_INTERSLOT_TIMEOUT 21u  // 2.1ms
 
+// Sniffer params
+// ----------------------------------------------------------------------------
+/**
+ * @brief The minimum low time the sniffer treats as a break.
+ *
+ * Measured in 10ths of a microsecond. This is the same as the responder limit.
+ */
+#define SNIFFER_BREAK_TIME_MIN 880u
+
+/**
+ * @brief The minimum low time that indicates a collision.
+ *
+ * Measured in 10ths of a microsecond. A valid slot holds the line low for at
+ * most 9 bit times (36us), anything longer that isn't a break means another
+ * device was driving the line.
+ */
+#define SNIFFER_COLLISION_TIME_MIN 400u
+
+/**
+ * @brief The low time beyond which the 16 bit timer may have wrapped.
+ *
+ * Measured in 10ths of a millisecond.
+ */
+#define SNIFFER_LONG_BREAK_TIME 60u  // 6ms
+
+/**
+ * @brief The idle time after which the sniffer ends a frame.
+ *
+ * Measured in 10ths of a millisecond. This is the same as the RDM inter-slot
+ * timeout, and ends frames that aren't followed by a break, such as DUB
+ * responses.
+ */
+#define SNIFFER_FRAME_TIMEOUT 21u  // 2.1ms
+
+/**
+ * @brief The maximum time a partial batch of frames is held.
+ *
+ * Measured in 10ths of a millisecond.
+ */
+#define SNIFFER_BATCH_INTERVAL 100u  // 10ms
+
 
 /**
  * @}
@@ -42,7 +42,8 @@
  */
 typedef enum {
   TRANSPORT_FLAGS_CHANGED = 0x02,  //!< Flags have changed
-  TRANSPORT_MSG_TRUNCATED = 0x04  //!< The message has been truncated.
+  TRANSPORT_MSG_TRUNCATED = 0x04,  //!< The message has been truncated.
+  TRANSPORT_LATENCY_TRACE = 0x08  //!< The message has a latency trace trailer.
 } TransportFlags;
 
 /**
@@ -64,6 +65,16 @@ typedef bool (*TransportTXFunction)(uint8_t, Command, uint8_t, const IOVec*,
  */
 typedef void (*TransportRxFunction)(const uint8_t*, unsigned int);
 
+/**
+ * @brief A function pointer to call with message data received from the host.
+ * @param data A pointer to the new data.
+ * @param size The size of the data received.
+ * @returns The number of bytes consumed. The function may stop after each
+ *   message, in which case it's called again with the remaining data.
+ */
+typedef unsigned int (*TransportMessageRxFunction)(const uint8_t*,
+                                                   unsigned int);
+
 #endif  // FIRMWARE_SRC_TRANSPORT_H_
 
 /**
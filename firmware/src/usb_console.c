@@ -450,6 +450,11 @@ void USBConsole_Tasks() {
                        Transceiver_GetRDMResponderDelay());
           SysLog_Print(SYSLOG_INFO, "RDM responder jitter: %d / 10 us",
                        Transceiver_GetRDMResponderJitter());
+          SysLog_Print(SYSLOG_INFO, "DMX refresh interval: %d / 10 ms",
+                       Transceiver_GetDMXRefreshInterval());
+          SysLog_Print(SYSLOG_INFO, "DMX sync: %d ms, anchor %d",
+                       Transceiver_GetDMXSyncPeriod(),
+                       Transceiver_GetDMXSyncAnchor());
           break;
         case 'w':
           SysLog_Message(SYSLOG_WARN, "warning");
@@ -40,7 +40,7 @@ static const USB_DEVICE_CDC_INIT g_cdc_init0 = {
 
 // USB Device Layer Function Driver Registration Table
 // ----------------------------------------------------------------------------
-static const USB_DEVICE_FUNCTION_REGISTRATION_TABLE g_func_table[3] = {
+static const USB_DEVICE_FUNCTION_REGISTRATION_TABLE g_func_table[4] = {
   /* Function 1 - CDC (serial port) */
   {
     .configurationValue = 1,
@@ -71,6 +71,16 @@ static const USB_DEVICE_FUNCTION_REGISTRATION_TABLE g_func_table[3] = {
     .driver = NULL,  // No function driver
     .funcDriverInit = NULL
   },
+  /* Function 4 - The Ja Rule DMX Interface */
+  {
+    .configurationValue = 1,
+    .interfaceNumber = 4,
+    .speed = USB_SPEED_FULL,
+    .numberOfInterfaces = 1,
+    .funcDriverIndex = 0,
+    .driver = NULL,  // No function driver
+    .funcDriverInit = NULL
+  },
 };
 
 // USB Device Layer Descriptors
@@ -101,8 +111,8 @@ static const uint8_t g_config_descriptor[] = {
   // Configuration Descriptor Header
   0x09,  // Size of this descriptor
   USB_DESCRIPTOR_CONFIGURATION,  // Descriptor type
-  0x74, 0x00,  // Total length of data for this cfg
-  4,  // Number of interfaces in this cfg
+  0x84, 0x00,  // Total length of data for this cfg
+  5,  // Number of interfaces in this cfg
   1,  // Index value of this configuration
   0,  // Configuration string index
   USB_ATTRIBUTE_DEFAULT | USB_ATTRIBUTE_SELF_POWERED,  // Attributes
@@ -231,7 +241,26 @@ static const uint8_t g_config_descriptor[] = {
   DFU_WILL_DETACH | DFU_MANIFESTATION_TOLERANT | DFU_CAN_DOWNLOAD,
   0x00, 0x00,  // detatch timeout
   DFU_BLOCK_SIZE, 0x00,  // transfer size
-  0x01, 0x10   // Rev 1.1
+  0x01, 0x10,  // Rev 1.1
+
+  // Ja Rule DMX Interface Descriptor
+  0x09,  // Size of this descriptor in bytes
+  USB_DESCRIPTOR_INTERFACE,  // Descriptor type
+  4,  // Interface Number
+  0,  // Alternate Setting Number
+  1,  // Number of endpoints in this intf
+  0xFF,  // Class code
+  0xFF,  // Subclass code
+  0xFF,  // Protocol code
+  0,  // Interface string index
+
+  // Ja Rule DMX Bulk Endpoint (OUT) Descriptor
+  0x07,  // Size of this descriptor in bytes
+  USB_DESCRIPTOR_ENDPOINT,  // Descriptor type
+  0x4 | USB_EP_DIRECTION_OUT,  // EndpointAddress
+  USB_TRANSFER_TYPE_BULK,  // Attributes
+  USB_MAX_PACKET_SIZE, 0x00,  // Size
+  USB_POLLING_INTERVAL  // Interval
 };
 
 //  String descriptors.
@@ -326,14 +355,14 @@ static const USB_DEVICE_MASTER_DESCRIPTOR g_usb_master_descriptor = {
 // ----------------------------------------------------------------------------
 static const USB_DEVICE_INIT g_usb_device_config = {
   .moduleInit = {SYS_MODULE_POWER_RUN_FULL},
-  .registeredFuncCount = 3,  // Must match the size of the g_func_table
+  .registeredFuncCount = 4,  // Must match the size of the g_func_table
   .registeredFunctions = (USB_DEVICE_FUNCTION_REGISTRATION_TABLE*) g_func_table,
   .usbMasterDescriptor =
       (USB_DEVICE_MASTER_DESCRIPTOR*) &g_usb_master_descriptor,
   .deviceSpeed = USB_SPEED_FULL,
   .driverIndex = DRV_USBFS_INDEX_0,
   .usbDriverInterface = DRV_USBFS_DEVICE_INTERFACE,
-  .queueSizeEndpointRead = 1,
+  .queueSizeEndpointRead = 2,  // The USB transport double buffers reads.
   .queueSizeEndpointWrite = 1
 };
 
@@ -26,16 +26,21 @@
 #include "constants.h"
 #include "dfu_properties.h"
 #include "dfu_spec.h"
+#include "dmx_stream.h"
 #include "flags.h"
+#include "latency_trace.h"
 #include "macros.h"
 #include "reset.h"
 #include "stream_decoder.h"
 #include "system_config.h"
 #include "system_definitions.h"
+#include "transceiver.h"
 #include "transport.h"
 #include "usb/usb_device.h"
 #include "utils.h"
 
+#include "app_settings.h"
+
 typedef enum {
   USB_STATE_INIT = 0,  //!< Initial state
   USB_STATE_WAIT_FOR_POWER,  //!< Waiting for power on the USB bus
@@ -47,35 +52,295 @@ typedef enum {
 } USBTransportState;
 
 typedef struct {
-  TransportRxFunction rx_cb;
+  TransportMessageRxFunction rx_cb;
+  TransportRxFunction dmx_rx_cb;
   USB_DEVICE_HANDLE usb_device;  //!< The USB Device layer handle.
   USBTransportState state;
   bool is_configured;  //!< Keep track of whether the device is configured.
 
   bool tx_in_progress;  //!< True if there is a TX in progress
-  bool rx_in_progress;  //!< True if there is a RX in progress.
+  bool dmx_in_progress;  //!< True if there is a DMX endpoint read scheduled.
   bool dfu_detach;  //!< True if we've received a DFU detach.
 
+  uint8_t tx_head;  //!< The index of the oldest message in the TX queue.
+  uint8_t tx_count;  //!< The number of messages in the TX queue.
+  uint8_t tx_in_flight;  //!< The number of messages in the current write.
+  uint8_t rx_next;  //!< The index of the next read buffer to process.
+  uint8_t rx_complete;  //!< The index of the next read buffer to complete.
+  USBTransportStats stats;
+
   USB_DEVICE_TRANSFER_HANDLE write_transfer;
-  USB_DEVICE_TRANSFER_HANDLE read_transfer;
+  USB_DEVICE_TRANSFER_HANDLE dmx_transfer;
   USB_ENDPOINT_ADDRESS tx_endpoint;  //!< TX endpoint address
   USB_ENDPOINT_ADDRESS rx_endpoint;  //!< RX endpoint address
+  USB_ENDPOINT_ADDRESS dmx_endpoint;  //!< DMX endpoint address
+  int dmx_data_size;
   uint8_t alt_setting;  //!< The alternate setting, always 0
-
-  int rx_data_size;
 } USBTransportData;
 
 static USBTransportData g_usb_transport_data;
 
-// Receive data buffer
-static uint8_t receivedDataBuffer[USB_READ_BUFFER_SIZE];
+/*
+ * @brief The number of receive buffers.
+ *
+ * While one buffer is being processed, the read into the other is already
+ * scheduled, so the host doesn't have to wait for the processing to finish
+ * before it can send the next message.
+ */
+enum { RX_BUFFER_COUNT = 2 };
+
+/*
+ * @brief A buffer for data received from the host.
+ */
+typedef struct {
+  USB_DEVICE_TRANSFER_HANDLE transfer;
+  bool in_progress;  //!< True if there is a read scheduled into this buffer.
+  int size;  //!< The amount of data received.
+  int offset;  //!< The amount of data processed.
+  uint8_t data[USB_READ_BUFFER_SIZE];
+} ReadBuffer;
 
-// Transmit data buffer
-static uint8_t transmitDataBuffer[USB_READ_BUFFER_SIZE];
+// The receive buffers, these are used in turn.
+static ReadBuffer g_rx_buffers[RX_BUFFER_COUNT];
+
+// The buffer for frames from the DMX endpoint.
+static uint8_t g_dmx_buffer[USB_READ_BUFFER_SIZE];
+
+/*
+ * @brief A serialized message waiting to be sent to the host.
+ */
+typedef struct {
+  uint16_t size;
+  bool traced;  //!< True if the message has a latency trace trailer.
+  uint8_t data[USB_READ_BUFFER_SIZE];
+} OutgoingMessage;
+
+// The transmit queue
+static OutgoingMessage g_tx_queue[USB_TRANSPORT_TX_QUEUE_SIZE];
+
+// Holds several messages which are written to the host in a single transfer.
+static uint8_t g_tx_transfer[USB_TRANSPORT_MAX_TRANSFER_SIZE];
 
 // The buffer that holds the DFU Status response.
 static uint8_t g_status_response[GET_STATUS_RESPONSE_SIZE];
 
+// TX Queue functions
+// ----------------------------------------------------------------------------
+
+/*
+ * @brief Serialize a message into the tail of the TX queue.
+ */
+static void EnqueueMessage(uint8_t token, Command command, uint8_t rc,
+                           const IOVec* data, unsigned int iov_count) {
+  unsigned int index = (g_usb_transport_data.tx_head +
+                        g_usb_transport_data.tx_count) %
+                       USB_TRANSPORT_TX_QUEUE_SIZE;
+  uint8_t *buffer = g_tx_queue[index].data;
+
+  buffer[0] = START_OF_MESSAGE_ID;
+  buffer[1] = token;
+  buffer[2] = ShortLSB(command);
+  buffer[3] = ShortMSB(command);
+  // 4 & 5 are the length.
+  buffer[6] = rc;
+
+  // Set appropriate flags.
+  buffer[7] = 0;
+  if (Flags_HasChanged()) {
+    buffer[7] |= TRANSPORT_FLAGS_CHANGED;
+  }
+
+  unsigned int i = 0;
+  uint16_t offset = 0;
+  for (; i != iov_count; i++) {
+    if (offset + data[i].length > PAYLOAD_SIZE) {
+      memcpy(buffer + offset + 8, data[i].base, PAYLOAD_SIZE - offset);
+      offset = PAYLOAD_SIZE;
+      buffer[7] |= TRANSPORT_MSG_TRUNCATED;
+      break;
+    } else {
+      memcpy(buffer + offset + 8, data[i].base, data[i].length);
+      offset += data[i].length;
+    }
+  }
+
+  buffer[4] = ShortLSB(offset);
+  buffer[5] = ShortMSB(offset);
+
+  // The trailer is filled in when the write is issued.
+  g_tx_queue[index].traced = LatencyTrace_IsEnabled();
+  if (g_tx_queue[index].traced) {
+    buffer[7] |= TRANSPORT_LATENCY_TRACE;
+    offset += LATENCY_TRACE_TRAILER_SIZE;
+  }
+  buffer[8 + offset] = END_OF_MESSAGE_ID;
+  g_tx_queue[index].size = offset + 9;
+
+  g_usb_transport_data.tx_count++;
+  if (g_usb_transport_data.tx_count >
+      g_usb_transport_data.stats.queue_high_water) {
+    g_usb_transport_data.stats.queue_high_water =
+        g_usb_transport_data.tx_count;
+  }
+}
+
+/*
+ * @brief Fill in the latency trace trailer, just before the message is written.
+ */
+static void FillTrailer(OutgoingMessage *message) {
+  if (!message->traced) {
+    return;
+  }
+  uint8_t token = message->data[1];
+  LatencyTrace_Record(token, LATENCY_TRACE_WRITE);
+  LatencyTrace_WriteTrailer(
+      token, &message->data[message->size - 1u - LATENCY_TRACE_TRAILER_SIZE]);
+}
+
+static void PopMessages(uint8_t count) {
+  g_usb_transport_data.tx_head = (g_usb_transport_data.tx_head + count) %
+                                 USB_TRANSPORT_TX_QUEUE_SIZE;
+  g_usb_transport_data.tx_count -= count;
+}
+
+/*
+ * @brief Write the messages at the head of the queue to the endpoint.
+ * @returns true if the write started, false if the messages were dropped.
+ *
+ * A single message is written directly from the queue. If more messages are
+ * waiting, as many as fit are packed into g_tx_transfer and sent as a single
+ * transfer. The host decoder splits them apart on the start / end markers.
+ */
+static bool StartWrite() {
+  OutgoingMessage *message = &g_tx_queue[g_usb_transport_data.tx_head];
+  const uint8_t *data = message->data;
+  uint16_t size = message->size;
+  uint8_t count = 1u;
+
+  FillTrailer(message);
+  if (g_usb_transport_data.tx_count > 1u) {
+    memcpy(g_tx_transfer, message->data, message->size);
+    for (; count < g_usb_transport_data.tx_count; count++) {
+      message = &g_tx_queue[(g_usb_transport_data.tx_head + count) %
+                            USB_TRANSPORT_TX_QUEUE_SIZE];
+      if (size + message->size > USB_TRANSPORT_MAX_TRANSFER_SIZE) {
+        break;
+      }
+      FillTrailer(message);
+      memcpy(g_tx_transfer + size, message->data, message->size);
+      size += message->size;
+    }
+    data = g_tx_transfer;
+    if (count > 1u) {
+      g_usb_transport_data.stats.coalesced += count;
+    }
+  }
+
+  g_usb_transport_data.tx_in_progress = true;
+  g_usb_transport_data.tx_in_flight = count;
+
+  USB_DEVICE_RESULT result = USB_DEVICE_EndpointWrite(
+      g_usb_transport_data.usb_device,
+      &g_usb_transport_data.write_transfer,
+      g_usb_transport_data.tx_endpoint, data, size,
+      USB_DEVICE_TRANSFER_FLAGS_DATA_COMPLETE);
+  if (result != USB_DEVICE_RESULT_OK) {
+    g_usb_transport_data.tx_in_progress = false;
+    g_usb_transport_data.tx_in_flight = 0u;
+    g_usb_transport_data.stats.tx_errors += count;
+    Flags_SetTXError();
+    PopMessages(count);
+    return false;
+  }
+  return true;
+}
+
+/*
+ * @brief Retire the last completed write, and start the next one.
+ *
+ * Messages queued while a write is in progress are coalesced into the next
+ * write, so the queue is flushed as soon as the endpoint goes idle.
+ *
+ * The event handler only clears tx_in_progress, the queue itself is only
+ * modified from the main loop.
+ */
+static void ServiceTXQueue() {
+  if (g_usb_transport_data.tx_in_progress) {
+    return;
+  }
+
+  if (g_usb_transport_data.tx_in_flight) {
+    PopMessages(g_usb_transport_data.tx_in_flight);
+    g_usb_transport_data.tx_in_flight = 0u;
+  }
+
+  while (g_usb_transport_data.tx_count && !StartWrite()) {}
+}
+
+static void ResetTXQueue() {
+  g_usb_transport_data.tx_in_progress = false;
+  g_usb_transport_data.tx_in_flight = 0u;
+  g_usb_transport_data.tx_head = 0u;
+  g_usb_transport_data.tx_count = 0u;
+}
+
+// RX functions
+// ----------------------------------------------------------------------------
+static void ScheduleRead(uint8_t index) {
+  ReadBuffer *buffer = &g_rx_buffers[index];
+  buffer->in_progress = true;
+  buffer->offset = 0;
+  USB_DEVICE_EndpointRead(g_usb_transport_data.usb_device,
+                          &buffer->transfer,
+                          g_usb_transport_data.rx_endpoint,
+                          buffer->data,
+                          sizeof(buffer->data));
+}
+
+static void ResetRXBuffers() {
+  unsigned int i = 0u;
+  for (; i < RX_BUFFER_COUNT; i++) {
+    g_rx_buffers[i].in_progress = false;
+    g_rx_buffers[i].size = 0;
+    g_rx_buffers[i].offset = 0;
+  }
+  g_usb_transport_data.rx_next = 0u;
+  g_usb_transport_data.rx_complete = 0u;
+}
+
+// DMX endpoint functions
+// ----------------------------------------------------------------------------
+static void ScheduleDMXRead() {
+  g_usb_transport_data.dmx_in_progress = true;
+  USB_DEVICE_EndpointRead(g_usb_transport_data.usb_device,
+                          &g_usb_transport_data.dmx_transfer,
+                          g_usb_transport_data.dmx_endpoint,
+                          g_dmx_buffer,
+                          sizeof(g_dmx_buffer));
+}
+
+/*
+ * @brief Pass a frame from the DMX endpoint on, and schedule the next read.
+ *
+ * This is done before the main endpoint is serviced, so DMX frames don't wait
+ * behind host messages.
+ */
+static void ProcessDMXEndpoint() {
+  if (g_usb_transport_data.dmx_in_progress) {
+    return;
+  }
+
+#ifdef PIPELINE_TRANSPORT_DMX_RX
+  PIPELINE_TRANSPORT_DMX_RX(g_dmx_buffer, g_usb_transport_data.dmx_data_size);
+#else
+  if (g_usb_transport_data.dmx_rx_cb) {
+    g_usb_transport_data.dmx_rx_cb(g_dmx_buffer,
+                                   g_usb_transport_data.dmx_data_size);
+  }
+#endif
+  ScheduleDMXRead();
+}
+
 // DFU functions
 // ----------------------------------------------------------------------------
 static inline bool IsDFUDetach(const USB_SETUP_PACKET *packet) {
@@ -120,6 +385,7 @@ static inline void DFUGetStatus() {
 void USBTransport_EventHandler(USB_DEVICE_EVENT event, void* event_data,
                                UNUSED uintptr_t context) {
   USB_SETUP_PACKET* setup_packet;
+  USB_DEVICE_EVENT_DATA_ENDPOINT_READ_COMPLETE* read_complete;
 
   switch (event) {
     case USB_DEVICE_EVENT_POWER_DETECTED:
@@ -153,6 +419,13 @@ void USBTransport_EventHandler(USB_DEVICE_EVENT event, void* event_data,
     case USB_DEVICE_EVENT_SUSPENDED:
       break;
 
+    case USB_DEVICE_EVENT_SOF:
+#ifdef PIPELINE_TRANSPORT_SOF
+      PIPELINE_TRANSPORT_SOF(
+          ((USB_DEVICE_EVENT_DATA_SOF*) event_data)->frameNumber);
+#endif
+      break;
+
     case USB_DEVICE_EVENT_CONTROL_TRANSFER_SETUP_REQUEST:
       // This means we have received a setup packet
       setup_packet = (USB_SETUP_PACKET*) event_data;
@@ -184,10 +457,20 @@ void USBTransport_EventHandler(USB_DEVICE_EVENT event, void* event_data,
       break;
 
     case USB_DEVICE_EVENT_ENDPOINT_READ_COMPLETE:
-      // Endpoint read is complete
-      g_usb_transport_data.rx_in_progress = false;
-      g_usb_transport_data.rx_data_size =
-          ((USB_DEVICE_EVENT_DATA_ENDPOINT_READ_COMPLETE*) event_data)->length;
+      // Endpoint read is complete. Reads on the main endpoint complete in the
+      // order they were scheduled.
+      read_complete = (USB_DEVICE_EVENT_DATA_ENDPOINT_READ_COMPLETE*) event_data;
+      if (g_usb_transport_data.dmx_in_progress &&
+          read_complete->transferHandle == g_usb_transport_data.dmx_transfer) {
+        g_usb_transport_data.dmx_in_progress = false;
+        g_usb_transport_data.dmx_data_size = read_complete->length;
+      } else {
+        ReadBuffer *buffer = &g_rx_buffers[g_usb_transport_data.rx_complete];
+        buffer->in_progress = false;
+        buffer->size = read_complete->length;
+        g_usb_transport_data.rx_complete =
+            (g_usb_transport_data.rx_complete + 1u) % RX_BUFFER_COUNT;
+      }
       break;
 
     case USB_DEVICE_EVENT_ENDPOINT_WRITE_COMPLETE:
@@ -204,17 +487,22 @@ void USBTransport_EventHandler(USB_DEVICE_EVENT event, void* event_data,
 
 // Public functions
 // ----------------------------------------------------------------------------
-void USBTransport_Initialize(TransportRxFunction rx_cb) {
+void USBTransport_Initialize(TransportMessageRxFunction rx_cb,
+                             TransportRxFunction dmx_rx_cb) {
   g_usb_transport_data.rx_cb = rx_cb;
+  g_usb_transport_data.dmx_rx_cb = dmx_rx_cb;
   g_usb_transport_data.state = USB_STATE_INIT;
   g_usb_transport_data.usb_device = USB_DEVICE_HANDLE_INVALID;
   g_usb_transport_data.rx_endpoint = 0x01;
   g_usb_transport_data.tx_endpoint = 0x81;
-  g_usb_transport_data.rx_in_progress = false;
-  g_usb_transport_data.tx_in_progress = false;
+  g_usb_transport_data.dmx_endpoint = 0x04;
+  g_usb_transport_data.dmx_in_progress = false;
+  g_usb_transport_data.dmx_data_size = 0;
   g_usb_transport_data.dfu_detach = false;
   g_usb_transport_data.alt_setting = 0;
-  g_usb_transport_data.rx_data_size = 0;
+  ResetRXBuffers();
+  ResetTXQueue();
+  USBTransport_ResetStats();
 }
 
 void USBTransport_Tasks() {
@@ -268,15 +556,23 @@ void USBTransport_Tasks() {
                                   USB_TRANSFER_TYPE_BULK, endpointSize);
       }
 
-      // Indicate that we are waiting for read
-      g_usb_transport_data.rx_in_progress = true;
+      if (!USB_DEVICE_EndpointIsEnabled(g_usb_transport_data.usb_device,
+                                        g_usb_transport_data.dmx_endpoint)) {
+        // Enable DMX Endpoint
+        USB_DEVICE_EndpointEnable(g_usb_transport_data.usb_device, 0,
+                                  g_usb_transport_data.dmx_endpoint,
+                                  USB_TRANSFER_TYPE_BULK, endpointSize);
+      }
 
-      // Place a new read request.
-      USB_DEVICE_EndpointRead(g_usb_transport_data.usb_device,
-                              &g_usb_transport_data.read_transfer,
-                              g_usb_transport_data.rx_endpoint,
-                              &receivedDataBuffer[0],
-                              sizeof(receivedDataBuffer));
+      // Schedule a read into each of the buffers.
+      ScheduleDMXRead();
+      ResetRXBuffers();
+      {
+        uint8_t i = 0u;
+        for (; i < RX_BUFFER_COUNT; i++) {
+          ScheduleRead(i);
+        }
+      }
 
       // Device is ready to run the main task
       g_usb_transport_data.state = USB_STATE_MAIN_TASK;
@@ -288,24 +584,31 @@ void USBTransport_Tasks() {
         Reset_SoftReset();
       }
 
-      if (g_usb_transport_data.rx_in_progress == false) {
-        // We have received data.
-        if (g_usb_transport_data.tx_in_progress == false) {
-          // we only go ahead and process the data if we can respond.
+      ProcessDMXEndpoint();
+      ServiceTXQueue();
+
+      {
+        // A transfer may contain many messages, so they're processed one at a
+        // time while there is room in the TX queue for the response. If the
+        // queue fills, the rest of the buffer waits for a later call. The read
+        // into the other buffer is still scheduled, so the host can send the
+        // next transfer while we process this one.
+        ReadBuffer *buffer = &g_rx_buffers[g_usb_transport_data.rx_next];
+        while (!buffer->in_progress && buffer->offset < buffer->size &&
+               g_usb_transport_data.tx_count < USB_TRANSPORT_TX_QUEUE_SIZE) {
 #ifdef PIPELINE_TRANSPORT_RX
-          PIPELINE_TRANSPORT_RX(receivedDataBuffer,
-                                g_usb_transport_data.rx_data_size);
+          buffer->offset += PIPELINE_TRANSPORT_RX(
+              buffer->data + buffer->offset, buffer->size - buffer->offset);
 #else
-          g_usb_transport_data.rx_cb(receivedDataBuffer,
-                                     g_usb_transport_data.rx_data_size);
+          buffer->offset += g_usb_transport_data.rx_cb(
+              buffer->data + buffer->offset, buffer->size - buffer->offset);
 #endif
-          // schedule the next read
-          g_usb_transport_data.rx_in_progress = true;
-          USB_DEVICE_EndpointRead(g_usb_transport_data.usb_device,
-                                  &g_usb_transport_data.read_transfer,
-                                  g_usb_transport_data.rx_endpoint,
-                                  &receivedDataBuffer[0],
-                                  sizeof (receivedDataBuffer));
+        }
+        if (!buffer->in_progress && buffer->offset >= buffer->size) {
+          // Hand the buffer back to the USB stack.
+          ScheduleRead(g_usb_transport_data.rx_next);
+          g_usb_transport_data.rx_next =
+              (g_usb_transport_data.rx_next + 1u) % RX_BUFFER_COUNT;
         }
       }
       break;
@@ -322,8 +625,14 @@ void USBTransport_Tasks() {
         USB_DEVICE_EndpointDisable(g_usb_transport_data.usb_device,
                                    g_usb_transport_data.rx_endpoint);
       }
-      g_usb_transport_data.rx_in_progress = false;
-      g_usb_transport_data.tx_in_progress = false;
+      if (USB_DEVICE_EndpointIsEnabled(g_usb_transport_data.usb_device,
+                                       g_usb_transport_data.dmx_endpoint)) {
+        USB_DEVICE_EndpointDisable(g_usb_transport_data.usb_device,
+                                   g_usb_transport_data.dmx_endpoint);
+      }
+      g_usb_transport_data.dmx_in_progress = false;
+      ResetRXBuffers();
+      ResetTXQueue();
 
       g_usb_transport_data.state = (
           g_usb_transport_data.state == USB_STATE_LOST_POWER ?
@@ -336,59 +645,38 @@ void USBTransport_Tasks() {
 
 bool USBTransport_SendResponse(uint8_t token, Command command, uint8_t rc,
                                const IOVec* data, unsigned int iov_count) {
-  if (g_usb_transport_data.tx_in_progress ||
-      g_usb_transport_data.state != USB_STATE_MAIN_TASK) {
+  if (g_usb_transport_data.state != USB_STATE_MAIN_TASK) {
     return false;
   }
 
-  transmitDataBuffer[0] = START_OF_MESSAGE_ID;
-  transmitDataBuffer[1] = token;
-  transmitDataBuffer[2] = ShortLSB(command);
-  transmitDataBuffer[3] = ShortMSB(command);
-  // 4 & 5 are the length.
-  transmitDataBuffer[6] = rc;
-
-  // Set appropriate flags.
-  transmitDataBuffer[7] = 0;
-  if (Flags_HasChanged()) {
-    transmitDataBuffer[7] |= TRANSPORT_FLAGS_CHANGED;
+  ServiceTXQueue();
+  if (g_usb_transport_data.tx_count == USB_TRANSPORT_TX_QUEUE_SIZE) {
+    g_usb_transport_data.stats.dropped++;
+    Flags_SetTXDrop();
+    return false;
   }
 
-  unsigned int i = 0;
-  uint16_t offset = 0;
-  for (; i != iov_count; i++) {
-    if (offset + data[i].length > PAYLOAD_SIZE) {
-      memcpy(transmitDataBuffer + offset + 8, data[i].base,
-             PAYLOAD_SIZE - offset);
-      offset = PAYLOAD_SIZE;
-      transmitDataBuffer[7] |= TRANSPORT_MSG_TRUNCATED;
-      break;
-    } else {
-      memcpy(transmitDataBuffer + offset + 8, data[i].base, data[i].length);
-      offset += data[i].length;
-    }
+  EnqueueMessage(token, command, rc, data, iov_count);
+  if (!g_usb_transport_data.tx_in_progress) {
+    // The queue was empty, so this message goes straight out.
+    return StartWrite();
   }
+  return true;
+}
 
-  transmitDataBuffer[4] = ShortLSB(offset);
-  transmitDataBuffer[5] = ShortMSB(offset);
-  transmitDataBuffer[8 + offset] = END_OF_MESSAGE_ID;
-
-  g_usb_transport_data.tx_in_progress = true;
+bool USBTransport_WritePending() {
+  // Messages which have been written, but not yet retired, don't count.
+  return g_usb_transport_data.tx_in_progress ||
+         g_usb_transport_data.tx_count > g_usb_transport_data.tx_in_flight;
+}
 
-  USB_DEVICE_RESULT result = USB_DEVICE_EndpointWrite(
-      g_usb_transport_data.usb_device,
-      &g_usb_transport_data.write_transfer,
-      g_usb_transport_data.tx_endpoint, transmitDataBuffer,
-      offset + 9,
-      USB_DEVICE_TRANSFER_FLAGS_DATA_COMPLETE);
-  if (result != USB_DEVICE_RESULT_OK) {
-    g_usb_transport_data.tx_in_progress = false;
-  }
-  return result == USB_DEVICE_RESULT_OK;
+void USBTransport_GetStats(USBTransportStats *stats) {
+  *stats = g_usb_transport_data.stats;
+  stats->queue_depth = g_usb_transport_data.tx_count;
 }
 
-bool USBTransport_WritePending() {
-  return g_usb_transport_data.tx_in_progress;
+void USBTransport_ResetStats() {
+  memset(&g_usb_transport_data.stats, 0, sizeof(g_usb_transport_data.stats));
 }
 
 USB_DEVICE_HANDLE USBTransport_GetHandle() {
@@ -24,6 +24,19 @@
  * A implementation of the generic transport that uses USB. The PIC acts as an
  * custom USB device.
  *
+ * Outgoing messages are serialized into a queue of USB_TRANSPORT_TX_QUEUE_SIZE
+ * slots, and written to the endpoint as each write completes. Messages that
+ * queue up while a write is in progress are packed into a single transfer of
+ * up to USB_TRANSPORT_MAX_TRANSFER_SIZE bytes.
+ *
+ * Data from the host continues to be processed while a write is in progress,
+ * as long as there is a free slot for the response. Two receive buffers are
+ * used in turn, so that a read is always scheduled while the data from the
+ * previous read is being processed.
+ *
+ * Frames received on the DMX endpoint are passed to the DMX callback before
+ * any data from the main endpoint is processed. See @ref dmx_stream.
+ *
  * @addtogroup usb_transport
  * @{
  * @file usb_transport.h
@@ -45,15 +58,32 @@
 extern "C" {
 #endif
 
+/**
+ * @brief Statistics for the TX queue.
+ */
+typedef struct {
+  uint32_t dropped;  //!< Messages dropped because the TX queue was full.
+  uint32_t tx_errors;  //!< Messages dropped because the write failed.
+  uint32_t coalesced;  //!< Messages sent in a transfer with other messages.
+  uint8_t queue_depth;  //!< The number of messages in the TX queue.
+  uint8_t queue_high_water;  //!< The most messages queued at once.
+} USBTransportStats;
+
 /**
  * @brief Initialize the USB Transport.
  * @param rx_cb The function to call when data is received from the host. This
- *   can be overridden, see below.
+ *   can be overridden, see below. Data is only passed to rx_cb when there is
+ *   room in the TX queue for a response, so rx_cb should return after each
+ *   message.
+ * @param dmx_rx_cb The function to call when a frame is received on the DMX
+ *   endpoint. This can be overridden, see below.
  *
  * If PIPELINE_TRANSPORT_RX is defined in app_pipeline.h, the macro
- * will override the rx_cb argument.
+ * will override the rx_cb argument. If PIPELINE_TRANSPORT_DMX_RX is defined in
+ * app_pipeline.h, the macro will override the dmx_rx_cb argument.
  */
-void USBTransport_Initialize(TransportRxFunction rx_cb);
+void USBTransport_Initialize(TransportMessageRxFunction rx_cb,
+                             TransportRxFunction dmx_rx_cb);
 
 /**
  * @brief Perform the periodic USB layer tasks.
@@ -70,19 +100,32 @@ void USBTransport_Tasks();
  * @param data The iovecs with the payload data.
  * @param iov_count The number of IOVecs.
  * @returns true if the message was queued for sending. False if the device was
- * not yet configured, or is there was already a message queued.
+ * not yet configured, or the TX queue was full.
  *
- * Only one message can be sent at a time. Until the send completes, any
- * further messages will be dropped.
+ * The message is copied into the TX queue, so the IOVecs don't need to remain
+ * valid once this returns. If the queue is full, the message is dropped and
+ * the TX Drop flag is set.
  */
 bool USBTransport_SendResponse(uint8_t token, Command command, uint8_t rc,
                                const IOVec* data, unsigned int iov_count);
 
 /**
- * @brief Check if there is a write in progress
+ * @brief Check if there is a write in progress, or messages waiting to be
+ * written.
  */
 bool USBTransport_WritePending();
 
+/**
+ * @brief Get the TX queue statistics.
+ * @param[out] stats The current statistics.
+ */
+void USBTransport_GetStats(USBTransportStats *stats);
+
+/**
+ * @brief Reset the TX queue drop counters and high-water mark.
+ */
+void USBTransport_ResetStats();
+
 /**
  * @brief Return the USB Device handle.
  * @returns The device handle or USB_DEVICE_HANDLE_INVALID.
@@ -2,3 +2,4 @@ include tests/harmony/Makefile.mk
 include tests/mocks/Makefile.mk
 include tests/sim/Makefile.mk
 include tests/tests/Makefile.mk
+include tests/virtual/Makefile.mk
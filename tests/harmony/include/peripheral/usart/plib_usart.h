@@ -99,6 +99,10 @@ void PLIB_USART_LineControlModeSelect(USART_MODULE_ID index,
 
 USART_ERROR PLIB_USART_ErrorsGet(USART_MODULE_ID index);
 
+void* PLIB_USART_TransmitterAddressGet(USART_MODULE_ID index);
+
+void* PLIB_USART_ReceiverAddressGet(USART_MODULE_ID index);
+
 #ifdef  __cplusplus
 }
 #endif
@@ -7,6 +7,7 @@
 #define TESTS_HARMONY_INCLUDE_USB_USB_DEVICE_H_
 
 #include <limits.h>
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 
@@ -168,6 +169,13 @@ typedef struct {
 USB_DEVICE_EVENT_DATA_ENDPOINT_READ_COMPLETE,
 USB_DEVICE_EVENT_DATA_ENDPOINT_WRITE_COMPLETE;
 
+typedef struct {
+  uint16_t frameNumber;
+} USB_DEVICE_EVENT_DATA_SOF;
+
+// The descriptor tables aren't used by the tests, so this is left incomplete.
+typedef struct _USB_DEVICE_INIT USB_DEVICE_INIT;
+
 typedef USB_DEVICE_EVENT_RESPONSE (*USB_DEVICE_EVENT_HANDLER) (
     USB_DEVICE_EVENT event,
     void *eventData,
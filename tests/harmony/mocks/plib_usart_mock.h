@@ -30,6 +30,8 @@ class PeripheralUSARTInterface {
   virtual void LineControlModeSelect(USART_MODULE_ID index,
                                      USART_LINECONTROL_MODE dataFlowConfig) = 0;
   virtual USART_ERROR ErrorsGet(USART_MODULE_ID index) = 0;
+  virtual void* TransmitterAddressGet(USART_MODULE_ID index) = 0;
+  virtual void* ReceiverAddressGet(USART_MODULE_ID index) = 0;
 };
 
 class MockPeripheralUSART : public PeripheralUSARTInterface {
@@ -59,6 +61,8 @@ class MockPeripheralUSART : public PeripheralUSARTInterface {
                void(USART_MODULE_ID index,
                     USART_LINECONTROL_MODE dataFlowConfig));
   MOCK_METHOD1(ErrorsGet, USART_ERROR(USART_MODULE_ID index));
+  MOCK_METHOD1(TransmitterAddressGet, void*(USART_MODULE_ID index));
+  MOCK_METHOD1(ReceiverAddressGet, void*(USART_MODULE_ID index));
 };
 
 void PLIB_USART_SetMock(PeripheralUSARTInterface* mock);
@@ -9,13 +9,16 @@ noinst_LTLIBRARIES += tests/mocks/libappmock.la \
                       tests/mocks/liblaunchermock.la \
                       tests/mocks/libmatchers.la \
                       tests/mocks/libmessagehandlermock.la \
+                      tests/mocks/librdmbatchmock.la \
+                      tests/mocks/librdmdiscoverymock.la \
                       tests/mocks/librdmhandlermock.la \
                       tests/mocks/libresetmock.la \
                       tests/mocks/libspirgbmock.la \
                       tests/mocks/libstreamdecodermock.la \
                       tests/mocks/libsyslogmock.la \
                       tests/mocks/libtransceivermock.la \
-                      tests/mocks/libtransportmock.la
+                      tests/mocks/libtransportmock.la \
+                      tests/mocks/libusbtransportmock.la
 
 MOCK_CXXFLAGS = $(BUILD_FLAGS) $(GMOCK_INCLUDES) $(GTEST_INCLUDES)
 MOCK_LIBS = $(GMOCK_LIBS) $(GTEST_LIBS)
@@ -62,6 +65,18 @@ tests_mocks_libmessagehandlermock_la_SOURCES = \
 tests_mocks_libmessagehandlermock_la_CXXFLAGS = $(MOCK_CXXFLAGS)
 tests_mocks_libmessagehandlermock_la_LIBADD = $(MOCK_LIBS)
 
+tests_mocks_librdmbatchmock_la_SOURCES = \
+    tests/mocks/RDMBatchMock.h \
+    tests/mocks/RDMBatchMock.cpp
+tests_mocks_librdmbatchmock_la_CXXFLAGS = $(MOCK_CXXFLAGS)
+tests_mocks_librdmbatchmock_la_LIBADD = $(MOCK_LIBS)
+
+tests_mocks_librdmdiscoverymock_la_SOURCES = \
+    tests/mocks/RDMDiscoveryMock.h \
+    tests/mocks/RDMDiscoveryMock.cpp
+tests_mocks_librdmdiscoverymock_la_CXXFLAGS = $(MOCK_CXXFLAGS)
+tests_mocks_librdmdiscoverymock_la_LIBADD = $(MOCK_LIBS)
+
 tests_mocks_librdmhandlermock_la_SOURCES = tests/mocks/RDMHandlerMock.h \
                                            tests/mocks/RDMHandlerMock.cpp
 tests_mocks_librdmhandlermock_la_CXXFLAGS = $(MOCK_CXXFLAGS)
@@ -96,3 +111,8 @@ tests_mocks_libtransportmock_la_SOURCES = tests/mocks/TransportMock.h \
                                           tests/mocks/TransportMock.cpp
 tests_mocks_libtransportmock_la_CXXFLAGS = $(MOCK_CXXFLAGS)
 tests_mocks_libtransportmock_la_LIBADD = $(MOCK_LIBS)
+
+tests_mocks_libusbtransportmock_la_SOURCES = tests/mocks/USBTransportMock.h \
+                                             tests/mocks/USBTransportMock.cpp
+tests_mocks_libusbtransportmock_la_CXXFLAGS = $(MOCK_CXXFLAGS)
+tests_mocks_libusbtransportmock_la_LIBADD = $(MOCK_LIBS)
@@ -0,0 +1,55 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * RDMBatchMock.cpp
+ * A mock RDM batch module.
+ * Copyright (C) 2015 Simon Newton
+ */
+
+#include "RDMBatchMock.h"
+
+namespace {
+MockRDMBatch *g_rdm_batch_mock = NULL;
+}
+
+void RDMBatch_SetMock(MockRDMBatch* mock) {
+  g_rdm_batch_mock = mock;
+}
+
+void RDMBatch_Initialize(TransportTXFunction tx_cb) {
+  if (g_rdm_batch_mock) {
+    g_rdm_batch_mock->Initialize(tx_cb);
+  }
+}
+
+ReturnCode RDMBatch_Start(uint8_t token, const uint8_t *data,
+                          unsigned int size) {
+  if (g_rdm_batch_mock) {
+    return g_rdm_batch_mock->Start(token, data, size);
+  }
+  return RC_BUFFER_FULL;
+}
+
+void RDMBatch_TransceiverEvent(const TransceiverEvent *event) {
+  if (g_rdm_batch_mock) {
+    g_rdm_batch_mock->TransceiverEvent(event);
+  }
+}
+
+void RDMBatch_Tasks() {
+  if (g_rdm_batch_mock) {
+    g_rdm_batch_mock->Tasks();
+  }
+}
@@ -0,0 +1,81 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * RDMDiscoveryMock.cpp
+ * A mock RDM discovery module.
+ * Copyright (C) 2015 Simon Newton
+ */
+
+#include "RDMDiscoveryMock.h"
+
+namespace {
+MockRDMDiscovery *g_rdm_discovery_mock = NULL;
+}
+
+void RDMDiscovery_SetMock(MockRDMDiscovery* mock) {
+  g_rdm_discovery_mock = mock;
+}
+
+void RDMDiscovery_Initialize(TransportTXFunction tx_cb) {
+  if (g_rdm_discovery_mock) {
+    g_rdm_discovery_mock->Initialize(tx_cb);
+  }
+}
+
+bool RDMDiscovery_Start(uint8_t token) {
+  if (g_rdm_discovery_mock) {
+    return g_rdm_discovery_mock->Start(token);
+  }
+  return false;
+}
+
+bool RDMDiscovery_IsRunning() {
+  if (g_rdm_discovery_mock) {
+    return g_rdm_discovery_mock->IsRunning();
+  }
+  return false;
+}
+
+bool RDMDiscovery_SetInterval(uint16_t interval) {
+  if (g_rdm_discovery_mock) {
+    return g_rdm_discovery_mock->SetInterval(interval);
+  }
+  return false;
+}
+
+uint16_t RDMDiscovery_GetInterval() {
+  if (g_rdm_discovery_mock) {
+    return g_rdm_discovery_mock->GetInterval();
+  }
+  return 0;
+}
+
+void RDMDiscovery_SendDevices(uint8_t token, uint16_t offset) {
+  if (g_rdm_discovery_mock) {
+    g_rdm_discovery_mock->SendDevices(token, offset);
+  }
+}
+
+void RDMDiscovery_TransceiverEvent(const TransceiverEvent *event) {
+  if (g_rdm_discovery_mock) {
+    g_rdm_discovery_mock->TransceiverEvent(event);
+  }
+}
+
+void RDMDiscovery_Tasks() {
+  if (g_rdm_discovery_mock) {
+    g_rdm_discovery_mock->Tasks();
+  }
+}
@@ -61,6 +61,15 @@ void RDMHandler_HandleRequest(const RDMHeader *header,
   }
 }
 
+int RDMHandler_HandleFastPath(const RDMHeader *header,
+                              const uint8_t *param_data,
+                              const uint8_t **response) {
+  if (g_rdmhandler_mock) {
+    return g_rdmhandler_mock->HandleFastPath(header, param_data, response);
+  }
+  return 0;
+}
+
 void RDMHandler_Tasks() {
   if (g_rdmhandler_mock) {
     g_rdmhandler_mock->Tasks();
@@ -33,6 +33,9 @@ class MockRDMHandler {
   MOCK_METHOD1(GetUID, void(uint8_t *uid));
   MOCK_METHOD2(HandleRequest, void(const RDMHeader *header,
                                    const uint8_t *param_data));
+  MOCK_METHOD3(HandleFastPath, int(const RDMHeader *header,
+                                   const uint8_t *param_data,
+                                   const uint8_t **response));
   MOCK_METHOD0(Tasks, void());
 };
 
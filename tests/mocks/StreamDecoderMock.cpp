@@ -30,8 +30,10 @@ void StreamDecoder_SetMock(MockStreamDecoder* mock) {
   g_stream_decoder_mock = mock;
 }
 
-void StreamDecoder_Process(const uint8_t* data, unsigned int size) {
+unsigned int StreamDecoder_ProcessMessage(const uint8_t* data,
+                                          unsigned int size) {
   if (g_stream_decoder_mock) {
-    g_stream_decoder_mock->Process(data, size);
+    return g_stream_decoder_mock->ProcessMessage(data, size);
   }
+  return size;
 }
@@ -26,11 +26,19 @@
 
 class MockStreamDecoder {
  public:
-  MOCK_METHOD2(Process, void(const uint8_t* data, unsigned int size));
+  MockStreamDecoder() {
+    // By default all the data is consumed.
+    ON_CALL(*this, ProcessMessage(testing::_, testing::_))
+        .WillByDefault(testing::ReturnArg<1>());
+  }
+
+  MOCK_METHOD2(ProcessMessage,
+               unsigned int(const uint8_t* data, unsigned int size));
 };
 
 void StreamDecoder_SetMock(MockStreamDecoder* mock);
 
-void StreamDecoder_Process(const uint8_t* data, unsigned int size);
+unsigned int StreamDecoder_ProcessMessage(const uint8_t* data,
+                                          unsigned int size);
 
 #endif  // TESTS_MOCKS_STREAMDECODERMOCK_H_
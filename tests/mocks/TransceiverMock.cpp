@@ -24,6 +24,8 @@ namespace {
 MockTransceiver *g_transceiver_mock = NULL;
 }
 
+const int16_t TRANSCEIVER_NO_NOTIFICATION = -1;
+
 void Transceiver_SetMock(MockTransceiver* mock) {
   g_transceiver_mock = mock;
 }
@@ -65,6 +67,14 @@ bool Transceiver_QueueDMX(int16_t token, const uint8_t* data,
   return true;
 }
 
+bool Transceiver_PatchDMX(uint16_t offset, const uint8_t* data,
+                          unsigned int size) {
+  if (g_transceiver_mock) {
+    return g_transceiver_mock->PatchDMX(offset, data, size);
+  }
+  return true;
+}
+
 bool Transceiver_QueueASC(int16_t token, uint8_t start_code,
                           const uint8_t* data, unsigned int size) {
   if (g_transceiver_mock) {
@@ -193,3 +203,51 @@ uint16_t Transceiver_GetRDMResponderJitter() {
   }
   return 0;
 }
+
+bool Transceiver_SetDMXRefreshInterval(uint16_t interval) {
+  if (g_transceiver_mock) {
+    return g_transceiver_mock->SetDMXRefreshInterval(interval);
+  }
+  return true;
+}
+
+uint16_t Transceiver_GetDMXRefreshInterval() {
+  if (g_transceiver_mock) {
+    return g_transceiver_mock->GetDMXRefreshInterval();
+  }
+  return 0;
+}
+
+bool Transceiver_SetDMXSync(uint16_t period, uint16_t anchor) {
+  if (g_transceiver_mock) {
+    return g_transceiver_mock->SetDMXSync(period, anchor);
+  }
+  return true;
+}
+
+uint16_t Transceiver_GetDMXSyncPeriod() {
+  if (g_transceiver_mock) {
+    return g_transceiver_mock->GetDMXSyncPeriod();
+  }
+  return 0;
+}
+
+uint16_t Transceiver_GetDMXSyncAnchor() {
+  if (g_transceiver_mock) {
+    return g_transceiver_mock->GetDMXSyncAnchor();
+  }
+  return 0;
+}
+
+void Transceiver_SOF(uint16_t frame_number) {
+  if (g_transceiver_mock) {
+    g_transceiver_mock->SOF(frame_number);
+  }
+}
+
+CoarseTimer_Value Transceiver_GetFrameStartTime() {
+  if (g_transceiver_mock) {
+    return g_transceiver_mock->GetFrameStartTime();
+  }
+  return 0;
+}
@@ -36,6 +36,8 @@ class MockTransceiver {
   MOCK_METHOD0(Tasks, void());
   MOCK_METHOD3(QueueDMX, bool(int16_t token, const uint8_t* data,
                               unsigned int size));
+  MOCK_METHOD3(PatchDMX, bool(uint16_t offset, const uint8_t* data,
+                              unsigned int size));
   MOCK_METHOD4(QueueASC, bool(int16_t token, uint8_t start_code,
                               const uint8_t* data, unsigned int size));
   MOCK_METHOD3(QueueRDMDUB, bool(int16_t token, const uint8_t* data,
@@ -58,6 +60,13 @@ class MockTransceiver {
   MOCK_METHOD0(GetRDMResponderDelay, uint16_t());
   MOCK_METHOD1(SetRDMResponderJitter, bool(uint16_t max_jitter));
   MOCK_METHOD0(GetRDMResponderJitter, uint16_t());
+  MOCK_METHOD1(SetDMXRefreshInterval, bool(uint16_t interval));
+  MOCK_METHOD0(GetDMXRefreshInterval, uint16_t());
+  MOCK_METHOD2(SetDMXSync, bool(uint16_t period, uint16_t anchor));
+  MOCK_METHOD0(GetDMXSyncPeriod, uint16_t());
+  MOCK_METHOD0(GetDMXSyncAnchor, uint16_t());
+  MOCK_METHOD1(SOF, void(uint16_t frame_number));
+  MOCK_METHOD0(GetFrameStartTime, CoarseTimer_Value());
 };
 
 void Transceiver_SetMock(MockTransceiver* mock);
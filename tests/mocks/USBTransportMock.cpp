@@ -0,0 +1,39 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * USBTransportMock.cpp
+ * A mock USB transport module.
+ * Copyright (C) 2015 Simon Newton
+ */
+
+#include "USBTransportMock.h"
+
+#include <string.h>
+
+namespace {
+MockUSBTransport *g_usb_transport_mock = NULL;
+}
+
+void USBTransport_SetMock(MockUSBTransport* mock) {
+  g_usb_transport_mock = mock;
+}
+
+void USBTransport_GetStats(USBTransportStats *stats) {
+  if (g_usb_transport_mock) {
+    g_usb_transport_mock->GetStats(stats);
+  } else {
+    memset(stats, 0, sizeof(*stats));
+  }
+}
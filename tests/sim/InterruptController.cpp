@@ -29,6 +29,7 @@
 InterruptController::Interrupt::Interrupt()
     : enabled(false),
       active(false),
+      isr_count(0),
       callback(nullptr) {
 }
 
@@ -61,6 +62,7 @@ void InterruptController::RaiseInterrupt(INT_SOURCE source) {
   while (interrupt->active) {
     if (interrupt->callback) {
       // The ISR is responsible for clearing the active flag
+      interrupt->isr_count++;
       interrupt->callback->Run();
     } else {
       FAIL() << "Interrupt " << source << " is active but no callback set!";
@@ -68,6 +70,10 @@ void InterruptController::RaiseInterrupt(INT_SOURCE source) {
   }
 }
 
+unsigned int InterruptController::ISRCount(INT_SOURCE source) {
+  return GetInterrupt(source)->isr_count;
+}
+
 bool InterruptController::SourceStatusGet(INT_SOURCE source) {
   Interrupt *interrupt = GetInterrupt(source);
   return interrupt->active;
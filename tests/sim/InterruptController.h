@@ -36,6 +36,9 @@ class InterruptController : public SysIntInterface {
 
   void RaiseInterrupt(INT_SOURCE source);
 
+  // Returns the number of times the ISR for a source has run.
+  unsigned int ISRCount(INT_SOURCE source);
+
   bool SourceStatusGet(INT_SOURCE source);
   void SourceStatusClear(INT_SOURCE source);
   void SourceEnable(INT_SOURCE source);
@@ -53,6 +56,7 @@ class InterruptController : public SysIntInterface {
 
     bool enabled;
     bool active;
+    unsigned int isr_count;
     ISRCallback *callback;
   };
 
@@ -5,6 +5,8 @@ noinst_LTLIBRARIES += tests/sim/libsim.la
 
 tests_sim_libsim_la_SOURCES = tests/sim/InterruptController.cpp \
                               tests/sim/InterruptController.h \
+                              tests/sim/PeripheralDMA.cpp \
+                              tests/sim/PeripheralDMA.h \
                               tests/sim/PeripheralInputCapture.cpp \
                               tests/sim/PeripheralInputCapture.h \
                               tests/sim/PeripheralSPI.cpp \
@@ -16,7 +18,9 @@ tests_sim_libsim_la_SOURCES = tests/sim/InterruptController.cpp \
                               tests/sim/SignalGenerator.cpp \
                               tests/sim/SignalGenerator.h \
                               tests/sim/Simulator.cpp \
-                              tests/sim/Simulator.h
+                              tests/sim/Simulator.h \
+                              tests/sim/SocketUSBDevice.cpp \
+                              tests/sim/SocketUSBDevice.h
 tests_sim_libsim_la_CXXFLAGS = $(BUILD_FLAGS) $(GMOCK_INCLUDES) \
                                $(GTEST_INCLUDES)  -I tests/harmony/mocks
 tests_sim_libsim_la_LIBADD = $(GMOCK_LIBS) $(GTEST_LIBS)
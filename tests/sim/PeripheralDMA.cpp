@@ -0,0 +1,264 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * PeripheralDMA.cpp
+ * The DMA controller used with the simulator.
+ * Copyright (C) 2015 Simon Newton
+ */
+
+#include "PeripheralDMA.h"
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <vector>
+
+#include "macros.h"
+#include "Simulator.h"
+#include "ola/Callback.h"
+
+using std::vector;
+
+PeripheralDMA::Channel::Channel(INT_SOURCE source)
+    : interrupt_source(source),
+      enabled(false),
+      start_irq_enabled(false),
+      start_irq(INT_SOURCE_TIMER_1),
+      source_address(0),
+      destination_address(0),
+      source_size(0),
+      destination_size(0),
+      cell_size(1),
+      source_pointer(0),
+      destination_pointer(0),
+      block_count(0),
+      interrupt_enables(0),
+      interrupt_flags(0) {
+}
+
+PeripheralDMA::PeripheralDMA(Simulator *simulator,
+                             InterruptController *interrupt_controller,
+                             PeripheralUART *uart)
+    : m_simulator(simulator),
+      m_interrupt_controller(interrupt_controller),
+      m_uart(uart),
+      m_callback(ola::NewCallback(this, &PeripheralDMA::Tick)),
+      m_enabled(false) {
+  m_simulator->AddTask(m_callback.get());
+
+  for (unsigned int i = 0; i < DMA_NUMBER_OF_CHANNELS; i++) {
+    m_channels.push_back(
+        Channel(static_cast<INT_SOURCE>(INT_SOURCE_DMA_0 + i)));
+  }
+}
+
+PeripheralDMA::~PeripheralDMA() {
+  m_simulator->RemoveTask(m_callback.get());
+}
+
+void PeripheralDMA::Tick() {
+  if (!m_enabled) {
+    return;
+  }
+
+  for (auto &channel : m_channels) {
+    if (!(channel.enabled && channel.start_irq_enabled &&
+          m_interrupt_controller->SourceStatusGet(channel.start_irq))) {
+      continue;
+    }
+    // The trigger is consumed by the transfer.
+    m_interrupt_controller->SourceStatusClear(channel.start_irq);
+    TransferCell(&channel);
+  }
+}
+
+void PeripheralDMA::Enable(UNUSED DMA_MODULE_ID index) {
+  m_enabled = true;
+}
+
+void PeripheralDMA::ChannelXTriggerEnable(DMA_MODULE_ID index,
+                                          DMA_CHANNEL channel,
+                                          DMA_CHANNEL_TRIGGER_TYPE trigger) {
+  Channel *dma_channel = GetChannel(index, channel);
+  if (!dma_channel) {
+    return;
+  }
+  if (trigger != DMA_CHANNEL_TRIGGER_TRANSFER_START) {
+    FAIL() << "Unimplemented trigger type: " << trigger;
+  }
+  dma_channel->start_irq_enabled = true;
+}
+
+void PeripheralDMA::ChannelXStartIRQSet(DMA_MODULE_ID index,
+                                        DMA_CHANNEL channel,
+                                        DMA_TRIGGER_SOURCE IRQnum) {
+  Channel *dma_channel = GetChannel(index, channel);
+  if (dma_channel) {
+    dma_channel->start_irq = static_cast<INT_SOURCE>(IRQnum);
+  }
+}
+
+void PeripheralDMA::ChannelXSourceStartAddressSet(DMA_MODULE_ID index,
+                                                  DMA_CHANNEL channel,
+                                                  uintptr_t address) {
+  Channel *dma_channel = GetChannel(index, channel);
+  if (dma_channel) {
+    dma_channel->source_address = address;
+    dma_channel->source_pointer = 0;
+    dma_channel->block_count = 0;
+  }
+}
+
+void PeripheralDMA::ChannelXDestinationStartAddressSet(DMA_MODULE_ID index,
+                                                       DMA_CHANNEL channel,
+                                                       uintptr_t address) {
+  Channel *dma_channel = GetChannel(index, channel);
+  if (dma_channel) {
+    dma_channel->destination_address = address;
+    dma_channel->destination_pointer = 0;
+    dma_channel->block_count = 0;
+  }
+}
+
+void PeripheralDMA::ChannelXSourceSizeSet(DMA_MODULE_ID index,
+                                          DMA_CHANNEL channel,
+                                          uint16_t size) {
+  Channel *dma_channel = GetChannel(index, channel);
+  if (dma_channel) {
+    dma_channel->source_size = size;
+  }
+}
+
+void PeripheralDMA::ChannelXDestinationSizeSet(DMA_MODULE_ID index,
+                                               DMA_CHANNEL channel,
+                                               uint16_t size) {
+  Channel *dma_channel = GetChannel(index, channel);
+  if (dma_channel) {
+    dma_channel->destination_size = size;
+  }
+}
+
+void PeripheralDMA::ChannelXCellSizeSet(DMA_MODULE_ID index,
+                                        DMA_CHANNEL channel,
+                                        uint16_t size) {
+  Channel *dma_channel = GetChannel(index, channel);
+  if (dma_channel) {
+    dma_channel->cell_size = size;
+  }
+}
+
+uint16_t PeripheralDMA::ChannelXDestinationPointerGet(DMA_MODULE_ID index,
+                                                     DMA_CHANNEL channel) {
+  Channel *dma_channel = GetChannel(index, channel);
+  return dma_channel ? dma_channel->destination_pointer : 0;
+}
+
+void PeripheralDMA::ChannelXEnable(DMA_MODULE_ID index, DMA_CHANNEL channel) {
+  Channel *dma_channel = GetChannel(index, channel);
+  if (dma_channel) {
+    dma_channel->enabled = true;
+  }
+}
+
+void PeripheralDMA::ChannelXDisable(DMA_MODULE_ID index, DMA_CHANNEL channel) {
+  Channel *dma_channel = GetChannel(index, channel);
+  if (dma_channel) {
+    dma_channel->enabled = false;
+  }
+}
+
+void PeripheralDMA::ChannelXINTSourceEnable(DMA_MODULE_ID index,
+                                            DMA_CHANNEL channel,
+                                            DMA_INT_TYPE source) {
+  Channel *dma_channel = GetChannel(index, channel);
+  if (dma_channel) {
+    dma_channel->interrupt_enables |= source;
+  }
+}
+
+bool PeripheralDMA::ChannelXINTSourceFlagGet(DMA_MODULE_ID index,
+                                             DMA_CHANNEL channel,
+                                             DMA_INT_TYPE source) {
+  Channel *dma_channel = GetChannel(index, channel);
+  return dma_channel && (dma_channel->interrupt_flags & source);
+}
+
+void PeripheralDMA::ChannelXINTSourceFlagClear(DMA_MODULE_ID index,
+                                               DMA_CHANNEL channel,
+                                               DMA_INT_TYPE source) {
+  Channel *dma_channel = GetChannel(index, channel);
+  if (dma_channel) {
+    dma_channel->interrupt_flags &= ~source;
+  }
+}
+
+PeripheralDMA::Channel *PeripheralDMA::GetChannel(DMA_MODULE_ID index,
+                                                  DMA_CHANNEL channel) {
+  if (index != DMA_ID_0 || channel >= m_channels.size()) {
+    ADD_FAILURE() << "Invalid DMA channel " << index << ":" << channel;
+    return nullptr;
+  }
+  return &m_channels[channel];
+}
+
+void PeripheralDMA::TransferCell(Channel *channel) {
+  const uint16_t block_size = std::max(channel->source_size,
+                                       channel->destination_size);
+  if (block_size == 0) {
+    return;
+  }
+
+  uint8_t flags = DMA_INT_CELL_TRANSFER_COMPLETE;
+  for (unsigned int i = 0; i < channel->cell_size; i++) {
+    const uintptr_t source = (channel->source_address +
+                              channel->source_pointer);
+    uint8_t value = 0;
+    if (!(m_uart && m_uart->RegisterRead(source, &value))) {
+      value = *reinterpret_cast<const uint8_t*>(source);
+    }
+    const uintptr_t destination = (channel->destination_address +
+                                   channel->destination_pointer);
+    if (!(m_uart && m_uart->RegisterWrite(destination, value))) {
+      *reinterpret_cast<uint8_t*>(destination) = value;
+    }
+
+    channel->block_count++;
+    if (++channel->source_pointer == channel->source_size) {
+      channel->source_pointer = 0;
+      flags |= DMA_INT_SOURCE_DONE;
+    }
+    if (++channel->destination_pointer == channel->destination_size) {
+      channel->destination_pointer = 0;
+      flags |= DMA_INT_DESTINATION_DONE;
+    }
+
+    if (channel->block_count == block_size) {
+      // The channel disables itself at the end of the block.
+      channel->block_count = 0;
+      channel->source_pointer = 0;
+      channel->destination_pointer = 0;
+      channel->enabled = false;
+      flags |= DMA_INT_BLOCK_TRANSFER_COMPLETE;
+      break;
+    }
+  }
+  SetFlags(channel, flags);
+}
+
+void PeripheralDMA::SetFlags(Channel *channel, uint8_t flags) {
+  channel->interrupt_flags |= flags;
+  if (channel->interrupt_enables & flags) {
+    m_interrupt_controller->RaiseInterrupt(channel->interrupt_source);
+  }
+}
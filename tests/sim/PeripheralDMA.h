@@ -0,0 +1,120 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * PeripheralDMA.h
+ * The DMA controller used with the simulator.
+ * Copyright (C) 2015 Simon Newton
+ */
+
+#ifndef TESTS_SIM_PERIPHERALDMA_H_
+#define TESTS_SIM_PERIPHERALDMA_H_
+
+#include <stdint.h>
+#include <memory>
+#include <vector>
+
+#include "plib_dma_mock.h"
+
+#include "InterruptController.h"
+#include "PeripheralUART.h"
+#include "Simulator.h"
+#include "ola/Callback.h"
+
+/*
+ * The DMA controller moves one cell each time the start IRQ of a channel is
+ * raised. Addresses that belong to a simulated UART are routed to that UART,
+ * all others are treated as host memory.
+ */
+class PeripheralDMA : public PeripheralDMAInterface {
+ public:
+  // Ownership of arguments is not transferred.
+  PeripheralDMA(Simulator *simulator,
+                InterruptController *interrupt_controller,
+                PeripheralUART *uart);
+  ~PeripheralDMA();
+
+  void Tick();
+
+  void Enable(DMA_MODULE_ID index);
+  void ChannelXTriggerEnable(DMA_MODULE_ID index,
+                             DMA_CHANNEL channel,
+                             DMA_CHANNEL_TRIGGER_TYPE trigger);
+  void ChannelXStartIRQSet(DMA_MODULE_ID index,
+                           DMA_CHANNEL channel,
+                           DMA_TRIGGER_SOURCE IRQnum);
+  void ChannelXSourceStartAddressSet(DMA_MODULE_ID index,
+                                     DMA_CHANNEL channel,
+                                     uintptr_t address);
+  void ChannelXDestinationStartAddressSet(DMA_MODULE_ID index,
+                                          DMA_CHANNEL channel,
+                                          uintptr_t address);
+  void ChannelXSourceSizeSet(DMA_MODULE_ID index,
+                             DMA_CHANNEL channel,
+                             uint16_t size);
+  void ChannelXDestinationSizeSet(DMA_MODULE_ID index,
+                                  DMA_CHANNEL channel,
+                                  uint16_t size);
+  void ChannelXCellSizeSet(DMA_MODULE_ID index,
+                           DMA_CHANNEL channel,
+                           uint16_t size);
+  uint16_t ChannelXDestinationPointerGet(DMA_MODULE_ID index,
+                                         DMA_CHANNEL channel);
+  void ChannelXEnable(DMA_MODULE_ID index, DMA_CHANNEL channel);
+  void ChannelXDisable(DMA_MODULE_ID index, DMA_CHANNEL channel);
+  void ChannelXINTSourceEnable(DMA_MODULE_ID index,
+                               DMA_CHANNEL channel,
+                               DMA_INT_TYPE source);
+  bool ChannelXINTSourceFlagGet(DMA_MODULE_ID index,
+                                DMA_CHANNEL channel,
+                                DMA_INT_TYPE source);
+  void ChannelXINTSourceFlagClear(DMA_MODULE_ID index,
+                                  DMA_CHANNEL channel,
+                                  DMA_INT_TYPE source);
+
+ private:
+  Simulator *m_simulator;
+  InterruptController *m_interrupt_controller;
+  PeripheralUART *m_uart;
+  std::unique_ptr<ola::Callback0<void>> m_callback;
+  bool m_enabled;
+
+  struct Channel {
+   public:
+    explicit Channel(INT_SOURCE source);
+
+    const INT_SOURCE interrupt_source;
+    bool enabled;
+    bool start_irq_enabled;
+    INT_SOURCE start_irq;
+    uintptr_t source_address;
+    uintptr_t destination_address;
+    uint16_t source_size;
+    uint16_t destination_size;
+    uint16_t cell_size;
+    uint16_t source_pointer;
+    uint16_t destination_pointer;
+    uint16_t block_count;
+    uint8_t interrupt_enables;
+    uint8_t interrupt_flags;
+  };
+
+  std::vector<Channel> m_channels;
+
+  Channel *GetChannel(DMA_MODULE_ID index, DMA_CHANNEL channel);
+  void TransferCell(Channel *channel);
+  void SetFlags(Channel *channel, uint8_t flags);
+};
+
+#endif  // TESTS_SIM_PERIPHERALDMA_H_
@@ -37,6 +37,8 @@ PeripheralUART::UART::UART(INT_SOURCE source)
       int_mode(USART_TRANSMIT_FIFO_NOT_FULL),
       tx_byte(0),
       errors(USART_ERROR_NONE),
+      tx_register(0),
+      rx_register(0),
       ticks_per_bit(16),
       tx_counter(0),
       tx_state(IDLE) {
@@ -154,6 +156,32 @@ void PeripheralUART::SignalFramingError(USART_MODULE_ID index, uint8_t byte) {
   }
 }
 
+bool PeripheralUART::RegisterRead(uintptr_t address, uint8_t *value) {
+  for (unsigned int i = 0; i < m_uarts.size(); i++) {
+    UART &uart = m_uarts[i];
+    if (address == reinterpret_cast<uintptr_t>(&uart.rx_register)) {
+      *value = ReceiverByteReceive(static_cast<USART_MODULE_ID>(i));
+      // The error interrupt fires when a byte with a framing error reaches
+      // the top of the FIFO.
+      if (uart.errors & USART_ERROR_FRAMING) {
+        m_interrupt_controller->RaiseInterrupt(uart.interrupt_source);
+      }
+      return true;
+    }
+  }
+  return false;
+}
+
+bool PeripheralUART::RegisterWrite(uintptr_t address, uint8_t value) {
+  for (unsigned int i = 0; i < m_uarts.size(); i++) {
+    if (address == reinterpret_cast<uintptr_t>(&m_uarts[i].tx_register)) {
+      TransmitterByteSend(static_cast<USART_MODULE_ID>(i), value);
+      return true;
+    }
+  }
+  return false;
+}
+
 void PeripheralUART::Enable(USART_MODULE_ID index) {
   if (index >= m_uarts.size()) {
     FAIL() << "Invalid UART " << index;
@@ -316,3 +344,19 @@ USART_ERROR PeripheralUART::ErrorsGet(USART_MODULE_ID index) {
   // Yuck
   return static_cast<USART_ERROR>(m_uarts[index].errors);
 }
+
+void* PeripheralUART::TransmitterAddressGet(USART_MODULE_ID index) {
+  if (index >= m_uarts.size()) {
+    ADD_FAILURE() << "Invalid UART " << index;
+    return nullptr;
+  }
+  return &m_uarts[index].tx_register;
+}
+
+void* PeripheralUART::ReceiverAddressGet(USART_MODULE_ID index) {
+  if (index >= m_uarts.size()) {
+    ADD_FAILURE() << "Invalid UART " << index;
+    return nullptr;
+  }
+  return &m_uarts[index].rx_register;
+}
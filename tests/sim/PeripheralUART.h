@@ -50,6 +50,11 @@ class PeripheralUART : public PeripheralUSARTInterface {
   // Signal a framing error has occured.
   void SignalFramingError(USART_MODULE_ID index, uint8_t byte);
 
+  // Used by the DMA controller to access the UART registers. These return
+  // false if the address doesn't belong to a UART.
+  bool RegisterRead(uintptr_t address, uint8_t *value);
+  bool RegisterWrite(uintptr_t address, uint8_t value);
+
   void Enable(USART_MODULE_ID index);
   void Disable(USART_MODULE_ID index);
   void TransmitterEnable(USART_MODULE_ID index);
@@ -71,6 +76,8 @@ class PeripheralUART : public PeripheralUSARTInterface {
   void LineControlModeSelect(USART_MODULE_ID index,
                              USART_LINECONTROL_MODE dataFlowConfig);
   USART_ERROR ErrorsGet(USART_MODULE_ID index);
+  void* TransmitterAddressGet(USART_MODULE_ID index);
+  void* ReceiverAddressGet(USART_MODULE_ID index);
 
  private:
   Simulator *m_simulator;
@@ -108,6 +115,9 @@ class PeripheralUART : public PeripheralUSARTInterface {
     std::queue<uint16_t> rx_buffer;
     uint8_t tx_byte;
     uint8_t errors;
+    // Only the addresses of these are used, for DMA.
+    uint8_t tx_register;
+    uint8_t rx_register;
 
     uint32_t ticks_per_bit;
     uint32_t tx_counter;
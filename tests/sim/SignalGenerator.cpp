@@ -58,9 +58,8 @@ SignalGenerator::~SignalGenerator() {
 void SignalGenerator::Tick() {
   uint64_t clock = m_simulator->Clock();
   if (m_framing_error_at && clock == m_framing_error_at) {
-    // A framing error causes a byte to be received as well.
+    // The byte with the framing error is received, with the error flag set.
     m_uart->SignalFramingError(m_uart_index, 0);
-    m_uart->ReceiveByte(m_uart_index, 0);
     m_framing_error_at = 0;
   }
 
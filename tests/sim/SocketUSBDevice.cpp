@@ -0,0 +1,350 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * SocketUSBDevice.cpp
+ * A USB device layer that bridges the bulk endpoints to a Unix domain socket.
+ * Copyright (C) 2015 Simon Newton
+ */
+
+#include "SocketUSBDevice.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <string>
+
+#include "macros.h"
+#include "ola/Callback.h"
+
+namespace {
+
+// The device handle returned by Open().
+const USB_DEVICE_HANDLE kDeviceHandle = 1;
+
+// The configuration value passed with USB_DEVICE_EVENT_CONFIGURED.
+const uint8_t kConfigurationValue = 1;
+
+// The frame number wraps at 11 bits.
+const uint16_t kFrameNumberMask = 0x7ff;
+
+// Check the socket every 100uS.
+const uint32_t kPollsPerSecond = 10000;
+
+bool SetNonBlocking(int fd) {
+  int flags = fcntl(fd, F_GETFL, 0);
+  return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+}  // namespace
+
+SocketUSBDevice::SocketUSBDevice(Simulator *simulator,
+                                 uint32_t clock_speed,
+                                 USB_ENDPOINT_ADDRESS out_endpoint,
+                                 USB_ENDPOINT_ADDRESS in_endpoint)
+    : m_simulator(simulator),
+      m_callback(ola::NewCallback(this, &SocketUSBDevice::Tick)),
+      m_out_endpoint(out_endpoint),
+      m_in_endpoint(in_endpoint),
+      m_poll_interval(clock_speed / kPollsPerSecond),
+      m_sof_interval(clock_speed / 1000),
+      m_listen_fd(-1),
+      m_client_fd(-1),
+      m_event_handler(nullptr),
+      m_context(0),
+      m_configured(false),
+      m_frame_number(0),
+      m_next_handle(1) {
+  m_simulator->AddTask(m_callback.get());
+}
+
+SocketUSBDevice::~SocketUSBDevice() {
+  m_simulator->RemoveTask(m_callback.get());
+  if (m_client_fd >= 0) {
+    close(m_client_fd);
+  }
+  if (m_listen_fd >= 0) {
+    close(m_listen_fd);
+    unlink(m_path.c_str());
+  }
+}
+
+bool SocketUSBDevice::Listen(const std::string &path) {
+  struct sockaddr_un address;
+  if (path.size() >= sizeof(address.sun_path)) {
+    return false;
+  }
+
+  // Sequenced packets preserve the message boundaries, so each write by the
+  // host is a single USB transfer.
+  int fd = socket(AF_UNIX, SOCK_SEQPACKET, 0);
+  if (fd < 0) {
+    return false;
+  }
+
+  // Remove the socket left behind by a previous run.
+  unlink(path.c_str());
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  memcpy(address.sun_path, path.c_str(), path.size());
+  if (bind(fd, reinterpret_cast<struct sockaddr*>(&address),
+           sizeof(address)) ||
+      listen(fd, 1) ||
+      !SetNonBlocking(fd)) {
+    close(fd);
+    return false;
+  }
+  m_listen_fd = fd;
+  m_path = path;
+  return true;
+}
+
+void SocketUSBDevice::Tick() {
+  // Writes complete on the tick after they were started, by which time the
+  // data has been handed to the socket.
+  while (!m_completed_writes.empty()) {
+    USB_DEVICE_EVENT_DATA_ENDPOINT_WRITE_COMPLETE write_complete = {
+      m_completed_writes.front(), 0
+    };
+    m_completed_writes.pop_front();
+    SendEvent(USB_DEVICE_EVENT_ENDPOINT_WRITE_COMPLETE, &write_complete);
+  }
+
+  uint64_t clock = m_simulator->Clock();
+  if (m_configured && clock % m_sof_interval == 0) {
+    USB_DEVICE_EVENT_DATA_SOF sof = { m_frame_number };
+    m_frame_number = (m_frame_number + 1) & kFrameNumberMask;
+    SendEvent(USB_DEVICE_EVENT_SOF, &sof);
+  }
+
+  if (clock % m_poll_interval) {
+    return;
+  }
+
+  if (m_client_fd < 0) {
+    Accept();
+  } else {
+    ReadFromHost();
+  }
+}
+
+void SocketUSBDevice::Attach(UNUSED USB_DEVICE_HANDLE usbDeviceHandle) {}
+
+void SocketUSBDevice::Detach(UNUSED USB_DEVICE_HANDLE usbDeviceHandle) {}
+
+USB_DEVICE_HANDLE SocketUSBDevice::Open(
+    UNUSED const uint16_t instanceIndex,
+    UNUSED const DRV_IO_INTENT intent) {
+  return kDeviceHandle;
+}
+
+void SocketUSBDevice::EventHandlerSet(
+    UNUSED USB_DEVICE_HANDLE usbDeviceHandle,
+    const USB_DEVICE_EVENT_HANDLER callBackFunc,
+    uintptr_t context) {
+  m_event_handler = callBackFunc;
+  m_context = context;
+}
+
+USB_DEVICE_CONTROL_TRANSFER_RESULT SocketUSBDevice::ControlStatus(
+    UNUSED USB_DEVICE_HANDLE usbDeviceHandle,
+    UNUSED USB_DEVICE_CONTROL_STATUS status) {
+  return USB_DEVICE_CONTROL_TRANSFER_RESULT_SUCCESS;
+}
+
+USB_DEVICE_CONTROL_TRANSFER_RESULT SocketUSBDevice::ControlSend(
+    UNUSED USB_DEVICE_HANDLE usbDeviceHandle,
+    UNUSED void *data,
+    UNUSED size_t length) {
+  return USB_DEVICE_CONTROL_TRANSFER_RESULT_SUCCESS;
+}
+
+USB_DEVICE_CONTROL_TRANSFER_RESULT SocketUSBDevice::ControlReceive(
+    UNUSED USB_DEVICE_HANDLE usbDeviceHandle,
+    UNUSED void* data,
+    UNUSED size_t length) {
+  return USB_DEVICE_CONTROL_TRANSFER_RESULT_SUCCESS;
+}
+
+USB_SPEED SocketUSBDevice::ActiveSpeedGet(
+    UNUSED USB_DEVICE_HANDLE usbDeviceHandle) {
+  return USB_SPEED_FULL;
+}
+
+bool SocketUSBDevice::EndpointIsEnabled(
+    UNUSED USB_DEVICE_HANDLE usbDeviceHandle,
+    USB_ENDPOINT_ADDRESS endpoint) {
+  return m_enabled_endpoints.find(endpoint) != m_enabled_endpoints.end();
+}
+
+USB_DEVICE_RESULT SocketUSBDevice::EndpointEnable(
+    UNUSED USB_DEVICE_HANDLE usbDeviceHandle,
+    UNUSED uint8_t interface,
+    USB_ENDPOINT_ADDRESS endpoint,
+    UNUSED USB_TRANSFER_TYPE transferType,
+    UNUSED size_t size) {
+  m_enabled_endpoints.insert(endpoint);
+  return USB_DEVICE_RESULT_OK;
+}
+
+USB_DEVICE_RESULT SocketUSBDevice::EndpointDisable(
+    UNUSED USB_DEVICE_HANDLE usbDeviceHandle,
+    USB_ENDPOINT_ADDRESS endpoint) {
+  m_enabled_endpoints.erase(endpoint);
+  if (endpoint == m_out_endpoint) {
+    m_reads.clear();
+  }
+  return USB_DEVICE_RESULT_OK;
+}
+
+void SocketUSBDevice::EndpointStall(
+    UNUSED USB_DEVICE_HANDLE usbDeviceHandle,
+    UNUSED USB_ENDPOINT_ADDRESS endpoint) {}
+
+USB_DEVICE_RESULT SocketUSBDevice::EndpointRead(
+    USB_DEVICE_HANDLE usbDeviceHandle,
+    USB_DEVICE_TRANSFER_HANDLE * transferHandle,
+    USB_ENDPOINT_ADDRESS endpoint,
+    void* buffer,
+    size_t bufferSize) {
+  if (!EndpointIsEnabled(usbDeviceHandle, endpoint)) {
+    return USB_DEVICE_RESULT_ERROR_ENDPOINT_NOT_CONFIGURED;
+  }
+
+  *transferHandle = m_next_handle++;
+  // Reads on the other OUT endpoints never complete.
+  if (endpoint == m_out_endpoint) {
+    Read read = {
+      *transferHandle, reinterpret_cast<uint8_t*>(buffer), bufferSize
+    };
+    m_reads.push_back(read);
+  }
+  return USB_DEVICE_RESULT_OK;
+}
+
+USB_DEVICE_RESULT SocketUSBDevice::EndpointWrite(
+    USB_DEVICE_HANDLE usbDeviceHandle,
+    USB_DEVICE_TRANSFER_HANDLE * transferHandle,
+    USB_ENDPOINT_ADDRESS endpoint,
+    const void* data,
+    size_t size,
+    UNUSED USB_DEVICE_TRANSFER_FLAGS flags) {
+  if (endpoint != m_in_endpoint ||
+      !EndpointIsEnabled(usbDeviceHandle, endpoint)) {
+    return USB_DEVICE_RESULT_ERROR_ENDPOINT_NOT_CONFIGURED;
+  }
+
+  while (m_client_fd >= 0) {
+    if (send(m_client_fd, data, size, MSG_NOSIGNAL) >= 0) {
+      break;
+    }
+    if (errno == EINTR) {
+      continue;
+    }
+    if (errno != EAGAIN && errno != EWOULDBLOCK) {
+      // The host went away, the deconfigure happens on the next poll.
+      break;
+    }
+    // The host is slow to drain the socket, this is the equivalent of the
+    // host not polling the IN endpoint.
+    struct pollfd pfd = {m_client_fd, POLLOUT, 0};
+    poll(&pfd, 1, -1);
+  }
+
+  *transferHandle = m_next_handle++;
+  m_completed_writes.push_back(*transferHandle);
+  return USB_DEVICE_RESULT_OK;
+}
+
+USB_DEVICE_RESULT SocketUSBDevice::EndpointTransferCancel(
+    UNUSED USB_DEVICE_HANDLE usbDeviceHandle,
+    UNUSED USB_ENDPOINT_ADDRESS endpoint,
+    USB_DEVICE_TRANSFER_HANDLE transferHandle) {
+  // Writes have already been handed to the socket, so only reads can be
+  // cancelled.
+  for (Reads::iterator iter = m_reads.begin(); iter != m_reads.end(); ++iter) {
+    if (iter->handle == transferHandle) {
+      m_reads.erase(iter);
+      break;
+    }
+  }
+  return USB_DEVICE_RESULT_OK;
+}
+
+void SocketUSBDevice::Accept() {
+  // Wait until the firmware is listening for events.
+  if (m_listen_fd < 0 || m_event_handler == nullptr) {
+    return;
+  }
+
+  int fd = accept(m_listen_fd, nullptr, nullptr);
+  if (fd < 0) {
+    return;
+  }
+  SetNonBlocking(fd);
+  m_client_fd = fd;
+
+  uint8_t configuration = kConfigurationValue;
+  SendEvent(USB_DEVICE_EVENT_POWER_DETECTED, nullptr);
+  SendEvent(USB_DEVICE_EVENT_RESET, nullptr);
+  m_configured = true;
+  SendEvent(USB_DEVICE_EVENT_CONFIGURED, &configuration);
+}
+
+void SocketUSBDevice::Disconnect() {
+  close(m_client_fd);
+  m_client_fd = -1;
+  m_configured = false;
+  m_reads.clear();
+  m_completed_writes.clear();
+  SendEvent(USB_DEVICE_EVENT_DECONFIGURED, nullptr);
+}
+
+void SocketUSBDevice::ReadFromHost() {
+  // Leave the data in the socket until the firmware is ready for it.
+  if (m_reads.empty()) {
+    struct pollfd pfd = {m_client_fd, POLLIN, 0};
+    if (poll(&pfd, 1, 0) > 0 && (pfd.revents & (POLLHUP | POLLERR))) {
+      Disconnect();
+    }
+    return;
+  }
+
+  // A transfer larger than the buffer is truncated.
+  Read read = m_reads.front();
+  ssize_t r = recv(m_client_fd, read.buffer, read.size, 0);
+  if (r < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+    return;
+  }
+  if (r <= 0) {
+    Disconnect();
+    return;
+  }
+
+  m_reads.pop_front();
+  USB_DEVICE_EVENT_DATA_ENDPOINT_READ_COMPLETE read_complete = {
+    read.handle, static_cast<size_t>(r)
+  };
+  SendEvent(USB_DEVICE_EVENT_ENDPOINT_READ_COMPLETE, &read_complete);
+}
+
+void SocketUSBDevice::SendEvent(USB_DEVICE_EVENT event, void *data) {
+  if (m_event_handler) {
+    m_event_handler(event, data, m_context);
+  }
+}
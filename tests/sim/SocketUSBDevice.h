@@ -0,0 +1,149 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * SocketUSBDevice.h
+ * A USB device layer that bridges the bulk endpoints to a Unix domain socket.
+ * Copyright (C) 2015 Simon Newton
+ */
+
+#ifndef TESTS_SIM_SOCKETUSBDEVICE_H_
+#define TESTS_SIM_SOCKETUSBDEVICE_H_
+
+#include <stdint.h>
+
+#include <deque>
+#include <memory>
+#include <set>
+#include <string>
+
+#include "usb_device_mock.h"
+
+#include "Simulator.h"
+#include "ola/Callback.h"
+
+/*
+ * Replaces the Harmony USB device layer.
+ *
+ * A host connecting to the socket appears to the firmware as the device being
+ * plugged in & configured. Each packet from the host completes a read on the
+ * OUT endpoint and each write to the IN endpoint is sent as a packet. Disconnecting
+ * deconfigures the device. Only one host may be connected at a time.
+ *
+ * Reads only complete when the firmware has one scheduled, so the socket
+ * provides the same back pressure as the USB bus does.
+ */
+class SocketUSBDevice : public USBDeviceInterface {
+ public:
+  // Ownership is not transferred.
+  SocketUSBDevice(Simulator *simulator, uint32_t clock_speed,
+                  USB_ENDPOINT_ADDRESS out_endpoint,
+                  USB_ENDPOINT_ADDRESS in_endpoint);
+  ~SocketUSBDevice();
+
+  // Listen on a SOCK_SEQPACKET Unix domain socket. Returns false if the
+  // socket couldn't be created.
+  bool Listen(const std::string &path);
+
+  void Tick();
+
+  void Attach(USB_DEVICE_HANDLE usbDeviceHandle);
+  void Detach(USB_DEVICE_HANDLE usbDeviceHandle);
+  USB_DEVICE_HANDLE Open(const uint16_t instanceIndex,
+                         const DRV_IO_INTENT intent);
+  void EventHandlerSet(USB_DEVICE_HANDLE usbDeviceHandle,
+                       const USB_DEVICE_EVENT_HANDLER callBackFunc,
+                       uintptr_t context);
+
+  USB_DEVICE_CONTROL_TRANSFER_RESULT ControlStatus(
+      USB_DEVICE_HANDLE usbDeviceHandle,
+      USB_DEVICE_CONTROL_STATUS status);
+  USB_DEVICE_CONTROL_TRANSFER_RESULT ControlSend(
+      USB_DEVICE_HANDLE usbDeviceHandle,
+      void *data,
+      size_t length);
+  USB_DEVICE_CONTROL_TRANSFER_RESULT ControlReceive(
+      USB_DEVICE_HANDLE usbDeviceHandle,
+      void* data,
+      size_t length);
+  USB_SPEED ActiveSpeedGet(USB_DEVICE_HANDLE usbDeviceHandle);
+  bool EndpointIsEnabled(USB_DEVICE_HANDLE usbDeviceHandle,
+                         USB_ENDPOINT_ADDRESS endpoint);
+  USB_DEVICE_RESULT EndpointEnable(
+      USB_DEVICE_HANDLE usbDeviceHandle,
+      uint8_t interface,
+      USB_ENDPOINT_ADDRESS endpoint,
+      USB_TRANSFER_TYPE transferType,
+      size_t size);
+  USB_DEVICE_RESULT EndpointDisable(USB_DEVICE_HANDLE usbDeviceHandle,
+                                    USB_ENDPOINT_ADDRESS endpoint);
+  void EndpointStall(USB_DEVICE_HANDLE usbDeviceHandle,
+                     USB_ENDPOINT_ADDRESS endpoint);
+  USB_DEVICE_RESULT EndpointRead(
+      USB_DEVICE_HANDLE usbDeviceHandle,
+      USB_DEVICE_TRANSFER_HANDLE * transferHandle,
+      USB_ENDPOINT_ADDRESS endpoint,
+      void* buffer,
+      size_t bufferSize);
+  USB_DEVICE_RESULT EndpointWrite(
+      USB_DEVICE_HANDLE usbDeviceHandle,
+      USB_DEVICE_TRANSFER_HANDLE * transferHandle,
+      USB_ENDPOINT_ADDRESS endpoint,
+      const void* data,
+      size_t size,
+      USB_DEVICE_TRANSFER_FLAGS flags);
+  USB_DEVICE_RESULT EndpointTransferCancel(
+      USB_DEVICE_HANDLE usbDeviceHandle,
+      USB_ENDPOINT_ADDRESS endpoint,
+      USB_DEVICE_TRANSFER_HANDLE transferHandle);
+
+ private:
+  struct Read {
+    USB_DEVICE_TRANSFER_HANDLE handle;
+    uint8_t *buffer;
+    size_t size;
+  };
+
+  typedef std::deque<Read> Reads;
+
+  Simulator *m_simulator;
+  std::unique_ptr<Simulator::TaskFn> m_callback;
+  const USB_ENDPOINT_ADDRESS m_out_endpoint;
+  const USB_ENDPOINT_ADDRESS m_in_endpoint;
+  // The number of clock cycles between checks of the socket.
+  const uint32_t m_poll_interval;
+  // The number of clock cycles between Start Of Frame events.
+  const uint32_t m_sof_interval;
+
+  std::string m_path;
+  int m_listen_fd;
+  int m_client_fd;
+
+  USB_DEVICE_EVENT_HANDLER m_event_handler;
+  uintptr_t m_context;
+  bool m_configured;
+  uint16_t m_frame_number;
+  USB_DEVICE_TRANSFER_HANDLE m_next_handle;
+
+  std::set<USB_ENDPOINT_ADDRESS> m_enabled_endpoints;
+  Reads m_reads;
+  std::deque<USB_DEVICE_TRANSFER_HANDLE> m_completed_writes;
+
+  void Accept();
+  void Disconnect();
+  void ReadFromHost();
+  void SendEvent(USB_DEVICE_EVENT event, void *data);
+};
+
+#endif  // TESTS_SIM_SOCKETUSBDEVICE_H_
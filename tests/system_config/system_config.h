@@ -40,7 +40,7 @@ extern "C" {
 #define USB_DEVICE_EP0_BUFFER_SIZE      64
 
 /* Endpoint Transfer Queue Size combined for Read and write */
-#define USB_DEVICE_ENDPOINT_QUEUE_DEPTH_COMBINED    2
+#define USB_DEVICE_ENDPOINT_QUEUE_DEPTH_COMBINED    4
 
 #define LOG_BUFFER_SIZE 256
 
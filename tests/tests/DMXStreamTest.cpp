@@ -0,0 +1,118 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ * DMXStreamTest.cpp
+ * Copyright (C) 2015 Simon Newton
+ */
+
+#include <gtest/gtest.h>
+#include <string.h>
+
+#include "Array.h"
+#include "Matchers.h"
+#include "TransceiverMock.h"
+#include "constants.h"
+#include "dmx_spec.h"
+#include "dmx_stream.h"
+
+using ::testing::Args;
+using ::testing::Return;
+using ::testing::StrictMock;
+using ::testing::_;
+
+class DMXStreamTest : public testing::Test {
+ public:
+  void SetUp() {
+    Transceiver_SetMock(&m_transceiver_mock);
+  }
+
+  void TearDown() {
+    Transceiver_SetMock(nullptr);
+  }
+
+ protected:
+  StrictMock<MockTransceiver> m_transceiver_mock;
+};
+
+TEST_F(DMXStreamTest, dmxFrame) {
+  const uint8_t frame[] = {0, 1, 2, 3, 4, 5};
+
+  EXPECT_CALL(m_transceiver_mock, GetMode())
+      .WillRepeatedly(Return(T_MODE_CONTROLLER));
+  EXPECT_CALL(m_transceiver_mock,
+              QueueDMX(TRANSCEIVER_NO_NOTIFICATION, _, 5u))
+      .With(Args<1, 2>(DataIs(frame + 1, arraysize(frame) - 1)))
+      .WillOnce(Return(true));
+
+  DMXStream_Process(frame, arraysize(frame));
+}
+
+TEST_F(DMXStreamTest, startCodeOnly) {
+  const uint8_t frame[] = {0};
+
+  EXPECT_CALL(m_transceiver_mock, GetMode())
+      .WillRepeatedly(Return(T_MODE_CONTROLLER));
+  EXPECT_CALL(m_transceiver_mock,
+              QueueDMX(TRANSCEIVER_NO_NOTIFICATION, _, 0u))
+      .WillOnce(Return(true));
+
+  DMXStream_Process(frame, arraysize(frame));
+}
+
+TEST_F(DMXStreamTest, alternateStartCode) {
+  const uint8_t frame[] = {0x99, 1, 2, 3};
+
+  EXPECT_CALL(m_transceiver_mock, GetMode())
+      .WillRepeatedly(Return(T_MODE_CONTROLLER));
+  EXPECT_CALL(m_transceiver_mock,
+              QueueASC(TRANSCEIVER_NO_NOTIFICATION, 0x99, _, 3u))
+      .With(Args<2, 3>(DataIs(frame + 1, arraysize(frame) - 1)))
+      .WillOnce(Return(true));
+
+  DMXStream_Process(frame, arraysize(frame));
+}
+
+/*
+ * Check that bad frames are dropped.
+ */
+TEST_F(DMXStreamTest, invalidFrames) {
+  EXPECT_CALL(m_transceiver_mock, GetMode())
+      .WillRepeatedly(Return(T_MODE_CONTROLLER));
+
+  // Empty transfer
+  const uint8_t frame[] = {0, 1, 2};
+  DMXStream_Process(frame, 0u);
+
+  // RDM frames aren't accepted.
+  const uint8_t rdm_frame[] = {RDM_START_CODE, 1, 2};
+  DMXStream_Process(rdm_frame, arraysize(rdm_frame));
+
+  // Too many slots
+  uint8_t large_frame[DMX_FRAME_SIZE + 2];
+  memset(large_frame, 0, arraysize(large_frame));
+  DMXStream_Process(large_frame, arraysize(large_frame));
+}
+
+/*
+ * Check frames are dropped if the transceiver isn't in controller mode.
+ */
+TEST_F(DMXStreamTest, responderMode) {
+  const uint8_t frame[] = {0, 1, 2, 3, 4, 5};
+
+  EXPECT_CALL(m_transceiver_mock, GetMode())
+      .WillRepeatedly(Return(T_MODE_RESPONDER));
+
+  DMXStream_Process(frame, arraysize(frame));
+}
@@ -25,6 +25,7 @@
 #include <ola/rdm/RDMEnums.h>
 #include <ola/rdm/RDMCommandSerializer.h>
 #include <ola/network/NetworkUtils.h>
+#include <ola/util/Utils.h>
 #include <string.h>
 #include <memory>
 
@@ -77,6 +78,27 @@ TEST_F(DimmerModelTest, testLifecycle) {
   DIMMER_MODEL_ENTRY.deactivate_fn();
 }
 
+TEST_F(DimmerModelTest, descriptorTable) {
+  ExpectSortedDescriptors();
+
+  // Sub-devices list every PID, in table order, in SUPPORTED_PARAMETERS.
+  unique_ptr<RDMRequest> request = BuildSubDeviceGetRequest(
+      PID_SUPPORTED_PARAMETERS, 1);
+  int size = InvokeRDMHandler(request.get());
+  ASSERT_GT(size, 0);
+
+  ola::rdm::RDMStatusCode status_code;
+  unique_ptr<RDMResponse> response(RDMResponse::InflateFromData(
+      g_rdm_buffer + 1, size - 1, &status_code, request.get()));
+  ASSERT_NE(nullptr, response.get());
+  ASSERT_EQ(0u, response->ParamDataSize() % 2);
+  const uint8_t *param_data = response->ParamData();
+  for (unsigned int i = 2; i < response->ParamDataSize(); i += 2) {
+    EXPECT_LT(ola::utils::JoinUInt8(param_data[i - 2], param_data[i - 1]),
+              ola::utils::JoinUInt8(param_data[i], param_data[i + 1]));
+  }
+}
+
 TEST_F(DimmerModelTest, dmxBlockAddress) {
   unique_ptr<RDMRequest> request = BuildGetRequest(PID_DMX_BLOCK_ADDRESS);
 
@@ -0,0 +1,319 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ * JaRuleClientTest.cpp
+ * Copyright (C) 2015 Simon Newton
+ */
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <memory>
+#include <vector>
+
+#include "latency_trace_format.h"
+#include "tools/ja_rule_client.h"
+
+using ::testing::ElementsAre;
+using ::testing::IsEmpty;
+using ja_rule::Client;
+using ja_rule::DescriptorTransport;
+using ja_rule::RequestResult;
+using ja_rule::Response;
+using std::vector;
+
+namespace {
+
+/*
+ * A request, as seen by the device end of the socket pair.
+ */
+struct DeviceRequest {
+  uint8_t token;
+  uint16_t command;
+  vector<uint8_t> payload;
+};
+
+/*
+ * The completions seen by the client.
+ */
+struct Completion {
+  RequestResult result;
+  Response response;
+};
+}  // namespace
+
+class JaRuleClientTest : public testing::Test {
+ public:
+  void SetUp() {
+    int fds[2];
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+    m_transport.reset(new DescriptorTransport(fds[0]));
+    m_device_fd = fds[1];
+  }
+
+  void TearDown() {
+    m_client.reset();
+    m_transport.reset();
+    close(m_device_fd);
+  }
+
+  void CreateClient(unsigned int window, unsigned int timeout = 1000u) {
+    m_client.reset(new Client(m_transport.get(), window, timeout));
+  }
+
+  void Send(Command command, const vector<uint8_t> &payload) {
+    ASSERT_TRUE(m_client->Send(
+        command, payload.data(), payload.size(),
+        [this](RequestResult result, const Response &response) {
+          m_completions.push_back({result, response});
+        }));
+  }
+
+  /*
+   * Read the requests the client has written to the socket.
+   */
+  vector<DeviceRequest> ReadRequests() {
+    uint8_t data[2048];
+    ssize_t r = recv(m_device_fd, data, sizeof(data), MSG_DONTWAIT);
+    if (r > 0) {
+      m_device_rx.insert(m_device_rx.end(), data, data + r);
+    }
+
+    vector<DeviceRequest> requests;
+    while (m_device_rx.size() >= 7u) {
+      EXPECT_EQ(START_OF_MESSAGE_ID, m_device_rx[0]);
+      unsigned int length = m_device_rx[4] | (m_device_rx[5] << 8);
+      if (m_device_rx.size() < 7u + length) {
+        break;
+      }
+      EXPECT_EQ(END_OF_MESSAGE_ID, m_device_rx[6 + length]);
+      DeviceRequest request;
+      request.token = m_device_rx[1];
+      request.command = m_device_rx[2] | (m_device_rx[3] << 8);
+      request.payload.assign(m_device_rx.begin() + 6,
+                             m_device_rx.begin() + 6 + length);
+      requests.push_back(request);
+      m_device_rx.erase(m_device_rx.begin(),
+                        m_device_rx.begin() + 7 + length);
+    }
+    return requests;
+  }
+
+  static vector<uint8_t> Frame(uint8_t token, uint16_t command, uint8_t rc,
+                               uint8_t status,
+                               const vector<uint8_t> &payload,
+                               const vector<uint8_t> &trailer = {}) {
+    vector<uint8_t> frame = {
+      START_OF_MESSAGE_ID, token,
+      static_cast<uint8_t>(command & 0xff),
+      static_cast<uint8_t>(command >> 8),
+      static_cast<uint8_t>(payload.size() & 0xff),
+      static_cast<uint8_t>(payload.size() >> 8),
+      rc, status
+    };
+    frame.insert(frame.end(), payload.begin(), payload.end());
+    frame.insert(frame.end(), trailer.begin(), trailer.end());
+    frame.push_back(END_OF_MESSAGE_ID);
+    return frame;
+  }
+
+  void Reply(const vector<uint8_t> &data) {
+    ASSERT_EQ(static_cast<ssize_t>(data.size()),
+              write(m_device_fd, data.data(), data.size()));
+    ASSERT_TRUE(m_client->Poll(100));
+  }
+
+ protected:
+  std::unique_ptr<DescriptorTransport> m_transport;
+  std::unique_ptr<Client> m_client;
+  int m_device_fd;
+  vector<uint8_t> m_device_rx;
+  vector<Completion> m_completions;
+};
+
+TEST_F(JaRuleClientTest, sendAndReceive) {
+  CreateClient(4u);
+  Send(COMMAND_ECHO, {1, 2, 3});
+
+  vector<DeviceRequest> requests = ReadRequests();
+  ASSERT_EQ(1u, requests.size());
+  EXPECT_EQ(COMMAND_ECHO, requests[0].command);
+  EXPECT_THAT(requests[0].payload, ElementsAre(1, 2, 3));
+  EXPECT_EQ(1u, m_client->InFlight());
+
+  Reply(Frame(requests[0].token, COMMAND_ECHO, RC_OK, 0, {1, 2, 3}));
+  ASSERT_EQ(1u, m_completions.size());
+  EXPECT_EQ(ja_rule::RESULT_OK, m_completions[0].result);
+  EXPECT_EQ(RC_OK, m_completions[0].response.return_code);
+  EXPECT_THAT(m_completions[0].response.payload, ElementsAre(1, 2, 3));
+  EXPECT_TRUE(m_client->Idle());
+}
+
+TEST_F(JaRuleClientTest, window) {
+  CreateClient(2u);
+  for (uint8_t i = 0; i < 5; i++) {
+    Send(COMMAND_ECHO, {i});
+  }
+
+  vector<DeviceRequest> requests = ReadRequests();
+  ASSERT_EQ(2u, requests.size());
+  EXPECT_NE(requests[0].token, requests[1].token);
+  EXPECT_EQ(2u, m_client->InFlight());
+  EXPECT_EQ(3u, m_client->Queued());
+
+  // Completing a request opens the window for the next one.
+  Reply(Frame(requests[0].token, COMMAND_ECHO, RC_OK, 0, {0}));
+  requests = ReadRequests();
+  ASSERT_EQ(1u, requests.size());
+  EXPECT_THAT(requests[0].payload, ElementsAre(2));
+  EXPECT_EQ(2u, m_client->InFlight());
+  EXPECT_EQ(2u, m_client->Queued());
+}
+
+TEST_F(JaRuleClientTest, outOfOrder) {
+  CreateClient(4u);
+  Send(COMMAND_ECHO, {1});
+  Send(TX_DMX, {2});
+  Send(COMMAND_ECHO, {3});
+
+  vector<DeviceRequest> requests = ReadRequests();
+  ASSERT_EQ(3u, requests.size());
+
+  // Responses with an unknown token or the wrong command are ignored.
+  uint8_t unknown_token = requests[2].token + 1;
+  Reply(Frame(unknown_token, COMMAND_ECHO, RC_OK, 0, {}));
+  Reply(Frame(requests[1].token, COMMAND_ECHO, RC_OK, 0, {}));
+  EXPECT_THAT(m_completions, IsEmpty());
+  EXPECT_EQ(2u, m_client->Stats().unmatched_responses);
+
+  // Both responses arrive in a single read.
+  vector<uint8_t> data = Frame(requests[2].token, COMMAND_ECHO, RC_OK, 0, {3});
+  vector<uint8_t> second = Frame(requests[1].token, TX_DMX,
+                                 RC_BUFFER_FULL, 0, {});
+  data.insert(data.end(), second.begin(), second.end());
+  Reply(data);
+
+  ASSERT_EQ(2u, m_completions.size());
+  EXPECT_EQ(requests[2].token, m_completions[0].response.token);
+  EXPECT_THAT(m_completions[0].response.payload, ElementsAre(3));
+  EXPECT_EQ(TX_DMX, m_completions[1].response.command);
+  EXPECT_EQ(RC_BUFFER_FULL, m_completions[1].response.return_code);
+  EXPECT_EQ(1u, m_client->InFlight());
+}
+
+TEST_F(JaRuleClientTest, framing) {
+  CreateClient(4u);
+  Send(COMMAND_ECHO, {1, 2});
+  vector<DeviceRequest> requests = ReadRequests();
+  ASSERT_EQ(1u, requests.size());
+
+  // Garbage before the frame, and a latency trace trailer after the payload.
+  vector<uint8_t> trailer(LATENCY_TRACE_TRAILER_SIZE, 0);
+  trailer[0] = 0x1f;
+  vector<uint8_t> data = {0x00, 0x12, END_OF_MESSAGE_ID};
+  vector<uint8_t> frame = Frame(requests[0].token, COMMAND_ECHO, RC_OK,
+                                TRANSPORT_LATENCY_TRACE, {1, 2}, trailer);
+  data.insert(data.end(), frame.begin(), frame.end());
+
+  // Split the frame across reads.
+  Reply(vector<uint8_t>(data.begin(), data.begin() + 8));
+  EXPECT_THAT(m_completions, IsEmpty());
+  Reply(vector<uint8_t>(data.begin() + 8, data.end()));
+
+  ASSERT_EQ(1u, m_completions.size());
+  EXPECT_THAT(m_completions[0].response.payload, ElementsAre(1, 2));
+  EXPECT_EQ(trailer, m_completions[0].response.trace);
+  EXPECT_EQ(3u, m_client->Stats().discarded_bytes);
+}
+
+TEST_F(JaRuleClientTest, truncatedAndFlags) {
+  CreateClient(4u);
+  vector<vector<uint8_t>> flags;
+  m_client->SetFlagsCallback([&flags](const vector<uint8_t> &data) {
+    flags.push_back(data);
+  });
+
+  Send(COMMAND_ECHO, {1, 2, 3});
+  vector<DeviceRequest> requests = ReadRequests();
+  ASSERT_EQ(1u, requests.size());
+
+  Reply(Frame(requests[0].token, COMMAND_ECHO, RC_OK,
+              TRANSPORT_MSG_TRUNCATED | TRANSPORT_FLAGS_CHANGED, {1, 2}));
+  ASSERT_EQ(1u, m_completions.size());
+  EXPECT_TRUE(m_completions[0].response.Truncated());
+  EXPECT_TRUE(m_completions[0].response.FlagsChanged());
+  EXPECT_EQ(1u, m_client->Stats().truncated_responses);
+
+  // The client fetches the flags.
+  requests = ReadRequests();
+  ASSERT_EQ(1u, requests.size());
+  EXPECT_EQ(GET_FLAGS, requests[0].command);
+  EXPECT_THAT(requests[0].payload, IsEmpty());
+
+  Reply(Frame(requests[0].token, GET_FLAGS, RC_OK, 0, {0x01}));
+  ASSERT_EQ(1u, flags.size());
+  EXPECT_THAT(flags[0], ElementsAre(0x01));
+  EXPECT_EQ(1u, m_completions.size());
+  EXPECT_TRUE(m_client->Idle());
+}
+
+TEST_F(JaRuleClientTest, moreData) {
+  CreateClient(4u);
+  Send(COMMAND_RDM_BATCH_REQUEST, {});
+  vector<DeviceRequest> requests = ReadRequests();
+  ASSERT_EQ(1u, requests.size());
+
+  Reply(Frame(requests[0].token, COMMAND_RDM_BATCH_REQUEST, RC_MORE_DATA, 0,
+              {1}));
+  EXPECT_EQ(1u, m_completions.size());
+  EXPECT_EQ(1u, m_client->InFlight());
+
+  Reply(Frame(requests[0].token, COMMAND_RDM_BATCH_REQUEST, RC_OK, 0, {2}));
+  ASSERT_EQ(2u, m_completions.size());
+  EXPECT_EQ(RC_MORE_DATA, m_completions[0].response.return_code);
+  EXPECT_EQ(RC_OK, m_completions[1].response.return_code);
+  EXPECT_TRUE(m_client->Idle());
+}
+
+TEST_F(JaRuleClientTest, timeout) {
+  CreateClient(1u, 10u);
+  Send(COMMAND_ECHO, {1});
+  Send(COMMAND_ECHO, {2});
+  EXPECT_EQ(1u, ReadRequests().size());
+
+  while (m_completions.empty()) {
+    ASSERT_TRUE(m_client->Poll(100));
+  }
+  EXPECT_EQ(ja_rule::RESULT_TIMEOUT, m_completions[0].result);
+  EXPECT_EQ(1u, m_client->Stats().timeouts);
+
+  // The next request goes out once the first one expires.
+  vector<DeviceRequest> requests = ReadRequests();
+  ASSERT_EQ(1u, requests.size());
+  EXPECT_THAT(requests[0].payload, ElementsAre(2));
+}
+
+TEST_F(JaRuleClientTest, closed) {
+  CreateClient(4u);
+  Send(COMMAND_ECHO, {1});
+  close(m_device_fd);
+  m_device_fd = -1;
+
+  EXPECT_FALSE(m_client->Poll(100));
+  ASSERT_EQ(1u, m_completions.size());
+  EXPECT_EQ(ja_rule::RESULT_CANCELLED, m_completions[0].result);
+}
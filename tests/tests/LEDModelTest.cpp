@@ -58,3 +58,7 @@ class LEDModelTest : public ModelTest {
     LED_MODEL_ENTRY.activate_fn();
   }
 };
+
+TEST_F(LEDModelTest, descriptorTable) {
+  ExpectSortedDescriptors();
+}
@@ -0,0 +1,118 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ * LatencyTraceTest.cpp
+ * Copyright (C) 2015 Simon Newton
+ */
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <vector>
+
+#include "CoarseTimerMock.h"
+#include "latency_trace.h"
+
+using ::testing::ElementsAre;
+using ::testing::NiceMock;
+using ::testing::Return;
+
+class LatencyTraceTest : public testing::Test {
+ public:
+  void SetUp() {
+    CoarseTimer_SetMock(&m_timer_mock);
+    LatencyTrace_Initialize();
+  }
+
+  void TearDown() {
+    CoarseTimer_SetMock(nullptr);
+  }
+
+  std::vector<uint8_t> Trailer(uint8_t token) {
+    std::vector<uint8_t> trailer(LATENCY_TRACE_TRAILER_SIZE, 0xff);
+    LatencyTrace_WriteTrailer(token, trailer.data());
+    return trailer;
+  }
+
+ protected:
+  NiceMock<MockCoarseTimer> m_timer_mock;
+};
+
+TEST_F(LatencyTraceTest, disabled) {
+  EXPECT_FALSE(LatencyTrace_IsEnabled());
+  EXPECT_CALL(m_timer_mock, GetTime()).Times(0);
+
+  LatencyTrace_Start(1);
+  LatencyTrace_Record(1, LATENCY_TRACE_QUEUED);
+  EXPECT_THAT(Trailer(1), ElementsAre(0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+                                      0, 0, 0, 0, 0, 0, 0, 0));
+}
+
+TEST_F(LatencyTraceTest, stages) {
+  LatencyTrace_SetEnabled(true);
+  EXPECT_TRUE(LatencyTrace_IsEnabled());
+
+  EXPECT_CALL(m_timer_mock, GetTime())
+      .WillOnce(Return(0x100))
+      .WillOnce(Return(0x102))
+      .WillOnce(Return(0x12345678))
+      .WillOnce(Return(0x12345680));
+
+  LatencyTrace_Start(1);
+  LatencyTrace_Record(1, LATENCY_TRACE_QUEUED);
+  LatencyTrace_RecordTime(1, LATENCY_TRACE_BREAK, 0x110);
+  LatencyTrace_Record(1, LATENCY_TRACE_COMPLETE);
+  LatencyTrace_Record(1, LATENCY_TRACE_WRITE);
+
+  EXPECT_THAT(Trailer(1),
+              ElementsAre(0x1f,
+                          0x00, 0x01, 0, 0,
+                          0x02, 0x01, 0, 0,
+                          0x10, 0x01, 0, 0,
+                          0x78, 0x56, 0x34, 0x12,
+                          0x80, 0x56, 0x34, 0x12));
+
+  // Unknown tokens have an empty trailer.
+  EXPECT_THAT(Trailer(2), ElementsAre(0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+                                      0, 0, 0, 0, 0, 0, 0, 0));
+}
+
+TEST_F(LatencyTraceTest, tokenReuse) {
+  LatencyTrace_SetEnabled(true);
+  EXPECT_CALL(m_timer_mock, GetTime())
+      .WillOnce(Return(1))
+      .WillOnce(Return(2))
+      .WillOnce(Return(3));
+
+  LatencyTrace_Start(7);
+  LatencyTrace_Record(7, LATENCY_TRACE_QUEUED);
+  // A new message with the same token replaces the timestamps.
+  LatencyTrace_Start(7);
+
+  EXPECT_THAT(Trailer(7), ElementsAre(0x01, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+                                      0, 0, 0, 0, 0, 0, 0, 0, 0));
+}
+
+TEST_F(LatencyTraceTest, slotsRecycled) {
+  LatencyTrace_SetEnabled(true);
+  ON_CALL(m_timer_mock, GetTime()).WillByDefault(Return(5));
+
+  // Start enough tokens to push out the first one.
+  for (uint8_t token = 0; token < 20; token++) {
+    LatencyTrace_Start(token);
+  }
+
+  EXPECT_EQ(0, Trailer(0)[0]);
+  EXPECT_EQ(1, Trailer(19)[0]);
+}
@@ -31,11 +31,16 @@ TESTS += tests/tests/bootloader_test \
          tests/tests/bootloader_transfer_test \
          tests/tests/coarse_timer_test \
          tests/tests/dimmer_model_test \
+         tests/tests/dmx_stream_test \
          tests/tests/flags_test \
+         tests/tests/ja_rule_client_test \
+         tests/tests/latency_trace_test \
          tests/tests/led_model_test \
          tests/tests/message_handler_test \
          tests/tests/network_model_test \
          tests/tests/proxy_model_test \
+         tests/tests/rdm_batch_test \
+         tests/tests/rdm_discovery_test \
          tests/tests/rdm_handler_test \
          tests/tests/rdm_responder_test \
          tests/tests/rdm_util_test \
@@ -93,6 +98,13 @@ tests_tests_dimmer_model_test_LDADD = $(TESTING_LIBS) $(OLA_LIBS) \
                                       tests/tests/libmodeltest.la \
                                       tests/mocks/libmatchers.la
 
+tests_tests_dmx_stream_test_SOURCES = tests/tests/DMXStreamTest.cpp
+tests_tests_dmx_stream_test_CXXFLAGS = $(TESTING_CXXFLAGS)
+tests_tests_dmx_stream_test_LDADD = $(TESTING_LIBS) \
+                                    firmware/src/libdmxstream.la \
+                                    tests/mocks/libmatchers.la \
+                                    tests/mocks/libtransceivermock.la
+
 tests_tests_flags_test_SOURCES = tests/tests/FlagsTest.cpp
 tests_tests_flags_test_CXXFLAGS = $(TESTING_CXXFLAGS)
 tests_tests_flags_test_LDADD = $(TESTING_LIBS) \
@@ -100,6 +112,17 @@ tests_tests_flags_test_LDADD = $(TESTING_LIBS) \
                                tests/mocks/libmatchers.la \
                                tests/mocks/libtransportmock.la
 
+tests_tests_ja_rule_client_test_SOURCES = tests/tests/JaRuleClientTest.cpp
+tests_tests_ja_rule_client_test_CXXFLAGS = $(TESTING_CXXFLAGS)
+tests_tests_ja_rule_client_test_LDADD = $(TESTING_LIBS) \
+                                        tools/libjaruleclient.la
+
+tests_tests_latency_trace_test_SOURCES = tests/tests/LatencyTraceTest.cpp
+tests_tests_latency_trace_test_CXXFLAGS = $(TESTING_CXXFLAGS)
+tests_tests_latency_trace_test_LDADD = $(TESTING_LIBS) \
+                                       firmware/src/liblatencytrace.la \
+                                       tests/mocks/libcoarsetimermock.la
+
 tests_tests_led_model_test_SOURCES = tests/tests/LEDModelTest.cpp
 tests_tests_led_model_test_CXXFLAGS = $(TESTING_CXXFLAGS) $(OLA_CFLAGS)
 tests_tests_led_model_test_LDADD = $(TESTING_LIBS) $(OLA_LIBS) \
@@ -118,13 +141,18 @@ tests_tests_message_handler_test_SOURCES = tests/tests/MessageHandlerTest.cpp
 tests_tests_message_handler_test_CXXFLAGS = $(TESTING_CXXFLAGS)
 tests_tests_message_handler_test_LDADD = $(GMOCK_LIBS) $(GTEST_LIBS) \
                                          firmware/src/libmessagehandler.la \
+                                         firmware/src/liblatencytrace.la \
                                          tests/mocks/libappmock.la \
+                                         tests/mocks/libcoarsetimermock.la \
                                          tests/mocks/libflagsmock.la \
                                          tests/mocks/libmatchers.la \
+                                         tests/mocks/librdmbatchmock.la \
+                                         tests/mocks/librdmdiscoverymock.la \
                                          tests/mocks/librdmhandlermock.la \
                                          tests/mocks/libsyslogmock.la \
                                          tests/mocks/libtransceivermock.la \
                                          tests/mocks/libtransportmock.la \
+                                         tests/mocks/libusbtransportmock.la \
                                          tests/harmony/mocks/libharmonymock.la
 
 tests_tests_network_model_test_SOURCES = tests/tests/NetworkModelTest.cpp
@@ -155,6 +183,29 @@ tests_tests_proxy_model_test_LDADD = $(TESTING_LIBS) $(OLA_LIBS) \
                                      tests/harmony/mocks/libharmonymock.la \
                                      tests/mocks/libmatchers.la
 
+tests_tests_rdm_batch_test_SOURCES = tests/tests/RDMBatchTest.cpp
+tests_tests_rdm_batch_test_CXXFLAGS = $(TESTING_CXXFLAGS)
+tests_tests_rdm_batch_test_LDADD = $(TESTING_LIBS) \
+                                   firmware/src/librdmbatch.la \
+                                   firmware/src/librdmutil.la \
+                                   tests/mocks/libmatchers.la \
+                                   tests/mocks/libsyslogmock.la \
+                                   tests/mocks/libtransceivermock.la \
+                                   tests/mocks/libtransportmock.la
+
+tests_tests_rdm_discovery_test_SOURCES = tests/tests/RDMDiscoveryTest.cpp
+tests_tests_rdm_discovery_test_CXXFLAGS = $(TESTING_CXXFLAGS)
+tests_tests_rdm_discovery_test_LDADD = $(TESTING_LIBS) \
+                                       firmware/src/libcoarsetimer.la \
+                                       firmware/src/librdmdiscovery.la \
+                                       firmware/src/librdmutil.la \
+                                       tests/harmony/mocks/libharmonymock.la \
+                                       tests/mocks/libmatchers.la \
+                                       tests/mocks/librdmhandlermock.la \
+                                       tests/mocks/libsyslogmock.la \
+                                       tests/mocks/libtransceivermock.la \
+                                       tests/mocks/libtransportmock.la
+
 tests_tests_rdm_handler_test_SOURCES = tests/tests/RDMHandlerTest.cpp
 tests_tests_rdm_handler_test_CXXFLAGS = $(TESTING_CXXFLAGS) $(OLA_CFLAGS)
 tests_tests_rdm_handler_test_LDADD = $(TESTING_LIBS) $(OLA_LIBS) \
@@ -214,8 +265,10 @@ tests_tests_usb_transport_test_SOURCES = tests/tests/USBTransportTest.cpp
 tests_tests_usb_transport_test_CXXFLAGS = $(TESTING_CXXFLAGS)
 tests_tests_usb_transport_test_LDADD = $(TESTING_LIBS) \
                                        firmware/src/libusbtransport.la \
+                                       firmware/src/liblatencytrace.la \
                                        tests/harmony/mocks/libharmonymock.la \
                                        tests/mocks/libbootloaderoptionsmock.la \
+                                       tests/mocks/libcoarsetimermock.la \
                                        tests/mocks/libmatchers.la \
                                        tests/mocks/libresetmock.la \
                                        tests/mocks/libstreamdecodermock.la \
@@ -254,3 +307,13 @@ tests_tests_utils_test_SOURCES = tests/tests/UtilsTest.cpp
 tests_tests_utils_test_CXXFLAGS = $(TESTING_CXXFLAGS)
 tests_tests_utils_test_LDADD = $(GMOCK_LIBS) $(GTEST_LIBS) \
                                tests/mocks/libmatchers.la
+
+# BENCHMARKS
+################################################
+noinst_PROGRAMS += tests/tests/stream_decoder_benchmark
+
+tests_tests_stream_decoder_benchmark_SOURCES = \
+    tests/tests/StreamDecoderBenchmark.cpp
+tests_tests_stream_decoder_benchmark_CXXFLAGS = $(TESTING_CFLAGS) \
+                                                $(WARNING_CXXFLAGS)
+tests_tests_stream_decoder_benchmark_LDADD = firmware/src/libstreamdecoder.la
@@ -24,15 +24,20 @@
 #include "Array.h"
 #include "FlagsMock.h"
 #include "Matchers.h"
+#include "RDMBatchMock.h"
+#include "RDMDiscoveryMock.h"
 #include "RDMHandlerMock.h"
 #include "TransceiverMock.h"
 #include "TransportMock.h"
+#include "USBTransportMock.h"
 #include "constants.h"
+#include "latency_trace.h"
 #include "message_handler.h"
 
 using ::testing::Args;
 using ::testing::Return;
 using ::testing::_;
+using ::testing::SetArgPointee;
 using ::testing::SetArrayArgument;
 
 
@@ -59,15 +64,19 @@ class ConfigurationTest
   void SetUp() {
     Transport_SetMock(&m_transport_mock);
     Transceiver_SetMock(&m_transceiver_mock);
+    RDMDiscovery_SetMock(&m_rdm_discovery_mock);
     MessageHandler_Initialize(Transport_Send);
+    LatencyTrace_Initialize();
   }
   void TearDown() {
+    RDMDiscovery_SetMock(nullptr);
     Transceiver_SetMock(nullptr);
     Transport_SetMock(nullptr);
   }
 
   MockTransport m_transport_mock;
   MockTransceiver m_transceiver_mock;
+  MockRDMDiscovery m_rdm_discovery_mock;
   static const uint8_t kToken = 0;
 };
 
@@ -137,6 +146,12 @@ TEST_P(ConfigurationTest, CheckSetGet) {
       EXPECT_CALL(m_transceiver_mock, GetMarkTime())
           .WillOnce(Return(args.value));
       break;
+    case COMMAND_GET_DMX_REFRESH_INTERVAL:
+      EXPECT_CALL(m_transceiver_mock, SetDMXRefreshInterval(args.value))
+          .WillOnce(Return(true));
+      EXPECT_CALL(m_transceiver_mock, GetDMXRefreshInterval())
+          .WillOnce(Return(args.value));
+      break;
     case COMMAND_GET_RDM_BROADCAST_TIMEOUT:
       EXPECT_CALL(m_transceiver_mock, SetRDMBroadcastTimeout(args.value))
           .WillOnce(Return(true));
@@ -167,6 +182,12 @@ TEST_P(ConfigurationTest, CheckSetGet) {
       EXPECT_CALL(m_transceiver_mock, GetRDMResponderJitter())
           .WillOnce(Return(args.value));
       break;
+    case COMMAND_GET_RDM_DISCOVERY_INTERVAL:
+      EXPECT_CALL(m_rdm_discovery_mock, SetInterval(args.value))
+          .WillOnce(Return(true));
+      EXPECT_CALL(m_rdm_discovery_mock, GetInterval())
+          .WillOnce(Return(args.value));
+      break;
     default:
       {}
   }
@@ -187,6 +208,8 @@ INSTANTIATE_TEST_CASE_P(
     ::testing::Values(
       ConfigurationTestArgs(COMMAND_GET_BREAK_TIME, COMMAND_SET_BREAK_TIME, 88),
       ConfigurationTestArgs(COMMAND_GET_MARK_TIME, COMMAND_SET_MARK_TIME, 16),
+      ConfigurationTestArgs(COMMAND_GET_DMX_REFRESH_INTERVAL,
+                            COMMAND_SET_DMX_REFRESH_INTERVAL, 250),
       ConfigurationTestArgs(COMMAND_GET_RDM_BROADCAST_TIMEOUT,
                             COMMAND_SET_RDM_BROADCAST_TIMEOUT, 20),
       ConfigurationTestArgs(COMMAND_GET_RDM_RESPONSE_TIMEOUT,
@@ -196,7 +219,9 @@ INSTANTIATE_TEST_CASE_P(
       ConfigurationTestArgs(COMMAND_GET_RDM_RESPONDER_DELAY,
                             COMMAND_SET_RDM_RESPONDER_DELAY, 2000),
       ConfigurationTestArgs(COMMAND_GET_RDM_RESPONDER_JITTER,
-                            COMMAND_SET_RDM_RESPONDER_JITTER, 10)));
+                            COMMAND_SET_RDM_RESPONDER_JITTER, 10),
+      ConfigurationTestArgs(COMMAND_GET_RDM_DISCOVERY_INTERVAL,
+                            COMMAND_SET_RDM_DISCOVERY_INTERVAL, 1000)));
 
 // Non-parametized tests.
 // ----------------------------------------------------------------------------
@@ -208,6 +233,8 @@ class MessageHandlerTest : public testing::Test {
     Transceiver_SetMock(&m_transceiver_mock);
     MessageHandler_Initialize(Transport_Send);
     RDMHandler_SetMock(&m_rdm_handler_mock);
+    RDMDiscovery_SetMock(&m_rdm_discovery_mock);
+    RDMBatch_SetMock(&m_rdm_batch_mock);
   }
 
   void TearDown() {
@@ -215,9 +242,11 @@ class MessageHandlerTest : public testing::Test {
     Flags_SetMock(nullptr);
     Transport_SetMock(nullptr);
     RDMHandler_SetMock(nullptr);
+    RDMDiscovery_SetMock(nullptr);
+    RDMBatch_SetMock(nullptr);
   }
 
-  void SendEvent(uint8_t token, TransceiverOperation op,
+  void SendEvent(int16_t token, TransceiverOperation op,
                  TransceiverOperationResult result, const uint8_t *data,
                  unsigned int length) {
     TransceiverTiming timing;
@@ -237,6 +266,8 @@ class MessageHandlerTest : public testing::Test {
   MockTransport m_transport_mock;
   MockTransceiver m_transceiver_mock;
   MockRDMHandler m_rdm_handler_mock;
+  MockRDMDiscovery m_rdm_discovery_mock;
+  MockRDMBatch m_rdm_batch_mock;
 
   static const uint8_t kToken = 0;
   static const uint8_t kEmptyDUBResponse[];
@@ -319,6 +350,127 @@ TEST_F(MessageHandlerTest, testDMX) {
   MessageHandler_HandleMessage(&message);
 }
 
+TEST_F(MessageHandlerTest, testPatchDMX) {
+  const uint8_t patch[] = {
+    0x02, 0x00, 0x02, 0x00, 0xff, 0xfe,
+    0xff, 0x01, 0x01, 0x00, 0x80
+  };
+  const uint8_t bad_length[] = {0x00, 0x00, 0x03, 0x00, 0xff, 0xfe};
+  const uint8_t bad_offset[] = {0x00, 0x02, 0x01, 0x00, 0xff};
+  const uint8_t short_header[] = {0x00, 0x00, 0x01};
+
+  testing::InSequence seq;
+  EXPECT_CALL(m_transceiver_mock, GetDMXRefreshInterval())
+      .WillOnce(Return(100));
+  EXPECT_CALL(m_transceiver_mock, PatchDMX(2, &patch[4], 2))
+      .WillOnce(Return(true));
+  EXPECT_CALL(m_transceiver_mock, PatchDMX(511, &patch[10], 1))
+      .WillOnce(Return(true));
+  EXPECT_CALL(m_transport_mock, Send(kToken, COMMAND_PATCH_DMX, RC_OK, NULL, 0))
+      .WillOnce(Return(true));
+  EXPECT_CALL(m_transport_mock,
+              Send(kToken, COMMAND_PATCH_DMX, RC_BAD_PARAM, NULL, 0))
+      .Times(4)
+      .WillRepeatedly(Return(true));
+  EXPECT_CALL(m_transceiver_mock, GetDMXRefreshInterval())
+      .WillOnce(Return(0));
+  EXPECT_CALL(m_transport_mock,
+              Send(kToken, COMMAND_PATCH_DMX, RC_REFRESH_DISABLED, NULL, 0))
+      .WillOnce(Return(true));
+  EXPECT_CALL(m_transceiver_mock, GetDMXRefreshInterval())
+      .WillOnce(Return(100));
+  EXPECT_CALL(m_transceiver_mock, PatchDMX(2, &patch[4], 2))
+      .WillOnce(Return(false));
+  EXPECT_CALL(m_transport_mock,
+              Send(kToken, COMMAND_PATCH_DMX, RC_BUFFER_FULL, NULL, 0))
+      .WillOnce(Return(true));
+
+  Message message = { kToken, COMMAND_PATCH_DMX, arraysize(patch), patch };
+  MessageHandler_HandleMessage(&message);
+
+  message = { kToken, COMMAND_PATCH_DMX, 0, NULL };
+  MessageHandler_HandleMessage(&message);
+  message = { kToken, COMMAND_PATCH_DMX, arraysize(bad_length), bad_length };
+  MessageHandler_HandleMessage(&message);
+  message = { kToken, COMMAND_PATCH_DMX, arraysize(bad_offset), bad_offset };
+  MessageHandler_HandleMessage(&message);
+  message = { kToken, COMMAND_PATCH_DMX, arraysize(short_header),
+              short_header };
+  MessageHandler_HandleMessage(&message);
+
+  // Refresh is disabled.
+  message = { kToken, COMMAND_PATCH_DMX, arraysize(patch), patch };
+  MessageHandler_HandleMessage(&message);
+
+  // The frame is being sent and the queue is full.
+  MessageHandler_HandleMessage(&message);
+}
+
+TEST_F(MessageHandlerTest, testDMXSync) {
+  const uint8_t sync[] = {0x19, 0x00, 0x01, 0x07};
+
+  testing::InSequence seq;
+  EXPECT_CALL(m_transceiver_mock, SetDMXSync(25, 0x0701))
+      .WillOnce(Return(true));
+  EXPECT_CALL(m_transport_mock,
+              Send(kToken, COMMAND_SET_DMX_SYNC, RC_OK, NULL, 0))
+      .WillOnce(Return(true));
+  EXPECT_CALL(m_transceiver_mock, SetDMXSync(25, 0x0701))
+      .WillOnce(Return(false));
+  EXPECT_CALL(m_transport_mock,
+              Send(kToken, COMMAND_SET_DMX_SYNC, RC_BAD_PARAM, NULL, 0))
+      .Times(2)
+      .WillRepeatedly(Return(true));
+  EXPECT_CALL(m_transceiver_mock, GetDMXSyncPeriod()).WillOnce(Return(25));
+  EXPECT_CALL(m_transceiver_mock, GetDMXSyncAnchor()).WillOnce(Return(0x0701));
+  EXPECT_CALL(m_transport_mock, Send(kToken, COMMAND_GET_DMX_SYNC, RC_OK, _, 1))
+      .With(Args<3, 4>(PayloadIs(sync, arraysize(sync))))
+      .WillOnce(Return(true));
+  EXPECT_CALL(m_transport_mock,
+              Send(kToken, COMMAND_GET_DMX_SYNC, RC_BAD_PARAM, NULL, 0))
+      .WillOnce(Return(true));
+
+  Message message = { kToken, COMMAND_SET_DMX_SYNC, arraysize(sync), sync };
+  MessageHandler_HandleMessage(&message);
+  MessageHandler_HandleMessage(&message);
+  message = { kToken, COMMAND_SET_DMX_SYNC, 2, sync };
+  MessageHandler_HandleMessage(&message);
+
+  message = { kToken, COMMAND_GET_DMX_SYNC, 0, NULL };
+  MessageHandler_HandleMessage(&message);
+  message = { kToken, COMMAND_GET_DMX_SYNC, arraysize(sync), sync };
+  MessageHandler_HandleMessage(&message);
+}
+
+TEST_F(MessageHandlerTest, testLatencyTrace) {
+  const uint8_t enable = 1;
+  const uint8_t invalid = 2;
+
+  testing::InSequence seq;
+  EXPECT_CALL(m_transport_mock,
+              Send(kToken, COMMAND_SET_LATENCY_TRACE, RC_OK, NULL, 0))
+      .WillOnce(Return(true));
+  EXPECT_CALL(m_transport_mock,
+              Send(kToken, COMMAND_SET_LATENCY_TRACE, RC_BAD_PARAM, NULL, 0))
+      .Times(2)
+      .WillRepeatedly(Return(true));
+  EXPECT_CALL(m_transport_mock,
+              Send(kToken, COMMAND_GET_LATENCY_TRACE, RC_OK, _, 1))
+      .With(Args<3, 4>(PayloadIs(&enable, sizeof(enable))))
+      .WillOnce(Return(true));
+
+  Message message = { kToken, COMMAND_SET_LATENCY_TRACE, sizeof(enable),
+                      &enable };
+  MessageHandler_HandleMessage(&message);
+  message = { kToken, COMMAND_SET_LATENCY_TRACE, sizeof(invalid), &invalid };
+  MessageHandler_HandleMessage(&message);
+  message = { kToken, COMMAND_SET_LATENCY_TRACE, 0, NULL };
+  MessageHandler_HandleMessage(&message);
+
+  message = { kToken, COMMAND_GET_LATENCY_TRACE, 0, NULL };
+  MessageHandler_HandleMessage(&message);
+}
+
 TEST_F(MessageHandlerTest, testFlags) {
   MockFlags flags_mock;
   Flags_SetMock(&flags_mock);
@@ -329,6 +481,44 @@ TEST_F(MessageHandlerTest, testFlags) {
   MessageHandler_HandleMessage(&message);
 }
 
+TEST_F(MessageHandlerTest, testTransportStats) {
+  MockUSBTransport usb_transport_mock;
+  USBTransport_SetMock(&usb_transport_mock);
+
+  USBTransportStats stats;
+  stats.dropped = 2;
+  stats.tx_errors = 1;
+  stats.coalesced = 0x01020304;
+  stats.queue_depth = 3;
+  stats.queue_high_water = 8;
+
+  const uint8_t response[] = {
+    2, 0, 0, 0,
+    1, 0, 0, 0,
+    4, 3, 2, 1,
+    3, 8
+  };
+  const uint8_t extra = 0;
+
+  testing::InSequence seq;
+  EXPECT_CALL(m_transport_mock,
+              Send(kToken, COMMAND_GET_TRANSPORT_STATS, RC_BAD_PARAM, NULL, 0))
+      .WillOnce(Return(true));
+  EXPECT_CALL(usb_transport_mock, GetStats(_))
+      .WillOnce(SetArgPointee<0>(stats));
+  EXPECT_CALL(m_transport_mock,
+              Send(kToken, COMMAND_GET_TRANSPORT_STATS, RC_OK, _, 1))
+      .With(Args<3, 4>(PayloadIs(response, arraysize(response))))
+      .WillOnce(Return(true));
+
+  Message message = { kToken, COMMAND_GET_TRANSPORT_STATS, sizeof(extra),
+                      &extra };
+  MessageHandler_HandleMessage(&message);
+  message = { kToken, COMMAND_GET_TRANSPORT_STATS, 0, NULL };
+  MessageHandler_HandleMessage(&message);
+  USBTransport_SetMock(nullptr);
+}
+
 TEST_F(MessageHandlerTest, testReset) {
   MockApp app_mock;
   APP_SetMock(&app_mock);
@@ -351,6 +541,105 @@ TEST_F(MessageHandlerTest, testUnknownMessage) {
   MessageHandler_HandleMessage(&message);
 }
 
+TEST_F(MessageHandlerTest, testRDMDiscovery) {
+  testing::InSequence seq;
+  EXPECT_CALL(m_transceiver_mock, GetMode())
+      .WillOnce(Return(T_MODE_RESPONDER));
+  EXPECT_CALL(m_transport_mock,
+              Send(kToken, COMMAND_RDM_DISCOVERY, RC_INVALID_MODE, NULL, 0))
+      .WillOnce(Return(true));
+  EXPECT_CALL(m_transceiver_mock, GetMode())
+      .WillOnce(Return(T_MODE_CONTROLLER));
+  EXPECT_CALL(m_rdm_discovery_mock, Start(kToken))
+      .WillOnce(Return(true));
+  EXPECT_CALL(m_transceiver_mock, GetMode())
+      .WillOnce(Return(T_MODE_CONTROLLER));
+  EXPECT_CALL(m_rdm_discovery_mock, Start(kToken))
+      .WillOnce(Return(false));
+  EXPECT_CALL(m_transport_mock,
+              Send(kToken, COMMAND_RDM_DISCOVERY, RC_BUSY, NULL, 0))
+      .WillOnce(Return(true));
+
+  Message message = { kToken, COMMAND_RDM_DISCOVERY, 0, NULL };
+  MessageHandler_HandleMessage(&message);
+  MessageHandler_HandleMessage(&message);
+  MessageHandler_HandleMessage(&message);
+}
+
+TEST_F(MessageHandlerTest, testRDMGetDevices) {
+  testing::InSequence seq;
+  EXPECT_CALL(m_rdm_discovery_mock, SendDevices(kToken, 0));
+  EXPECT_CALL(m_rdm_discovery_mock, SendDevices(kToken, 0x102));
+  EXPECT_CALL(m_transport_mock,
+              Send(kToken, COMMAND_RDM_GET_DEVICES, RC_BAD_PARAM, NULL, 0))
+      .WillOnce(Return(true));
+
+  Message message = { kToken, COMMAND_RDM_GET_DEVICES, 0, NULL };
+  MessageHandler_HandleMessage(&message);
+
+  const uint8_t offset[] = {2, 1, 0};
+  message.payload = offset;
+  message.length = 2;
+  MessageHandler_HandleMessage(&message);
+
+  message.length = arraysize(offset);
+  MessageHandler_HandleMessage(&message);
+}
+
+TEST_F(MessageHandlerTest, testRDMBatch) {
+  const uint8_t requests[] = {1, 2, 3, 4};
+
+  testing::InSequence seq;
+  EXPECT_CALL(m_transceiver_mock, GetMode())
+      .WillOnce(Return(T_MODE_RESPONDER));
+  EXPECT_CALL(m_transport_mock,
+              Send(kToken, COMMAND_RDM_BATCH_REQUEST, RC_INVALID_MODE, NULL,
+                   0))
+      .WillOnce(Return(true));
+  EXPECT_CALL(m_transceiver_mock, GetMode())
+      .WillOnce(Return(T_MODE_CONTROLLER));
+  EXPECT_CALL(m_rdm_batch_mock,
+              Start(kToken, requests, arraysize(requests)))
+      .WillOnce(Return(RC_OK));
+  EXPECT_CALL(m_transceiver_mock, GetMode())
+      .WillOnce(Return(T_MODE_CONTROLLER));
+  EXPECT_CALL(m_rdm_batch_mock,
+              Start(kToken, requests, arraysize(requests)))
+      .WillOnce(Return(RC_BAD_PARAM));
+  EXPECT_CALL(m_transport_mock,
+              Send(kToken, COMMAND_RDM_BATCH_REQUEST, RC_BAD_PARAM, NULL, 0))
+      .WillOnce(Return(true));
+
+  Message message = {
+    kToken, COMMAND_RDM_BATCH_REQUEST, arraysize(requests), requests
+  };
+  MessageHandler_HandleMessage(&message);
+  MessageHandler_HandleMessage(&message);
+  MessageHandler_HandleMessage(&message);
+}
+
+TEST_F(MessageHandlerTest, transceiverBatchEvent) {
+  // Events for batched requests don't go to the host.
+  EXPECT_CALL(m_rdm_batch_mock, TransceiverEvent(_)).Times(2);
+  EXPECT_CALL(m_rdm_discovery_mock, TransceiverEvent(_)).Times(0);
+  EXPECT_CALL(m_transport_mock, Send(_, _, _, _, _)).Times(0);
+
+  SendEvent(RDM_BATCH_TOKEN, T_OP_RDM_WITH_RESPONSE, T_RESULT_RX_TIMEOUT,
+            NULL, 0);
+  SendEvent(RDM_BATCH_TOKEN + 5, T_OP_RDM_BROADCAST, T_RESULT_RX_TIMEOUT,
+            NULL, 0);
+}
+
+TEST_F(MessageHandlerTest, transceiverDiscoveryEvent) {
+  // Events for discovery requests don't go to the host.
+  EXPECT_CALL(m_rdm_discovery_mock, TransceiverEvent(_)).Times(2);
+  EXPECT_CALL(m_transport_mock, Send(_, _, _, _, _)).Times(0);
+
+  SendEvent(RDM_DISCOVERY_TOKEN, T_OP_RDM_DUB, T_RESULT_RX_TIMEOUT, NULL, 0);
+  SendEvent(RDM_DISCOVERY_TOKEN + 1, T_OP_RDM_WITH_RESPONSE,
+            T_RESULT_RX_TIMEOUT, NULL, 0);
+}
+
 TEST_F(MessageHandlerTest, transceiverDMXEvent) {
   EXPECT_CALL(m_transport_mock, Send(kToken, TX_DMX, RC_OK, _, _))
       .With(Args<3, 4>(EmptyPayload()))
@@ -358,9 +647,14 @@ TEST_F(MessageHandlerTest, transceiverDMXEvent) {
   EXPECT_CALL(m_transport_mock, Send(kToken + 1, TX_DMX, RC_TX_ERROR, _, _))
       .With(Args<3, 4>(EmptyPayload()))
       .WillOnce(Return(true));
+  EXPECT_CALL(m_transport_mock,
+              Send(kToken + 2, TX_DMX, RC_SUPERSEDED, _, _))
+      .With(Args<3, 4>(EmptyPayload()))
+      .WillOnce(Return(true));
 
   SendEvent(kToken, T_OP_TX_ONLY, T_RESULT_OK, NULL, 0);
   SendEvent(kToken + 1, T_OP_TX_ONLY, T_RESULT_TX_ERROR, NULL, 0);
+  SendEvent(kToken + 2, T_OP_TX_ONLY, T_RESULT_SUPERSEDED, NULL, 0);
 }
 
 TEST_F(MessageHandlerTest, transceiverRDMDiscoveryRequest) {
@@ -430,6 +724,55 @@ TEST_F(MessageHandlerTest, transceiverRDMBroadcastRequest) {
   SendEvent(kToken + 3, T_OP_RDM_BROADCAST, T_RESULT_RX_INVALID, NULL, 0);
 }
 
+TEST_F(MessageHandlerTest, transceiverSnifferEvent) {
+  // Any data, doesn't have to be valid frame records
+  const uint8_t records[] = {1, 3, 4, 4, 5};
+
+  EXPECT_CALL(m_transport_mock,
+              Send(kToken, COMMAND_SNIFFER_FRAMES, RC_OK, _, _))
+      .With(Args<3, 4>(PayloadIs(records, arraysize(records))))
+      .WillOnce(Return(true));
+
+  SendEvent(kToken, T_OP_SNIFFER, T_RESULT_OK,
+            static_cast<const uint8_t*>(records), arraysize(records));
+}
+
+TEST_F(MessageHandlerTest, transceiverCancelledEventHasNoBreak) {
+  EXPECT_CALL(m_transport_mock, Send(kToken, TX_DMX, RC_CANCELLED, _, _))
+      .With(Args<3, 4>(EmptyPayload()))
+      .WillOnce(Return(true));
+
+  LatencyTrace_SetEnabled(true);
+  LatencyTrace_Start(kToken);
+
+  // The frame was flushed by a mode change, so it never had a break.
+  SendEvent(kToken, T_OP_TX_ONLY, T_RESULT_CANCELLED, NULL, 0);
+
+  uint8_t trailer[LATENCY_TRACE_TRAILER_SIZE];
+  LatencyTrace_WriteTrailer(kToken, trailer);
+  EXPECT_EQ((1u << LATENCY_TRACE_DECODED) | (1u << LATENCY_TRACE_COMPLETE),
+            trailer[0]);
+}
+
+TEST_F(MessageHandlerTest, transceiverSnifferEventIsNotTraced) {
+  const uint8_t records[] = {1, 3, 4, 4, 5};
+
+  EXPECT_CALL(m_transport_mock,
+              Send(0, COMMAND_SNIFFER_FRAMES, RC_OK, _, _))
+      .WillOnce(Return(true));
+
+  // A host request with token 0 is in progress.
+  LatencyTrace_SetEnabled(true);
+  LatencyTrace_Start(0);
+
+  SendEvent(0, T_OP_SNIFFER, T_RESULT_OK,
+            static_cast<const uint8_t*>(records), arraysize(records));
+
+  uint8_t trailer[LATENCY_TRACE_TRAILER_SIZE];
+  LatencyTrace_WriteTrailer(0, trailer);
+  EXPECT_EQ(1u << LATENCY_TRACE_DECODED, trailer[0]);
+}
+
 TEST_F(MessageHandlerTest, transceiverRDMRequestWithResponse) {
   // Any data, doesn't have to be valid RDM
   const uint8_t rdm_reply[] = {1, 3, 4, 4, 5};
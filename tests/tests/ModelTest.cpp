@@ -30,6 +30,8 @@
 
 #include "constants.h"
 #include "rdm.h"
+#include "rdm_buffer.h"
+#include "rdm_responder.h"
 #include "TestHelpers.h"
 #include "ModelTest.h"
 
@@ -92,6 +94,17 @@ int ModelTest::InvokeRDMHandler(const ola::rdm::RDMRequest *request) {
   data.push_back(RDM_START_CODE);
   EXPECT_TRUE(ola::rdm::RDMCommandSerializer::Pack(*request, &data));
 
+  g_rdm_response = g_rdm_buffer;
   return m_model->request_fn(
       AsHeader(data.data()), request->ParamData());
 }
+
+void ModelTest::ExpectSortedDescriptors() {
+  const ResponderDefinition *definition = g_responder->def;
+  ASSERT_NE(nullptr, definition);
+  for (unsigned int i = 1; i < definition->descriptor_count; i++) {
+    EXPECT_LT(definition->descriptors[i - 1].pid,
+              definition->descriptors[i].pid)
+      << "PID descriptor " << i << " is out of order";
+  }
+}
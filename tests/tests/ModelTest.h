@@ -63,6 +63,11 @@ class ModelTest : public testing::Test {
       unsigned int param_data_size = 0);
 
   int InvokeRDMHandler(const ola::rdm::RDMRequest *request);
+
+  /**
+   * @brief Check the active responder's PID descriptors are sorted & unique.
+   */
+  void ExpectSortedDescriptors();
 };
 
 #endif  // TESTS_TESTS_MODELTEST_H_
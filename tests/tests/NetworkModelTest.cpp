@@ -65,6 +65,10 @@ TEST_F(NetworkModelTest, testLifecycle) {
   NETWORK_MODEL_ENTRY.deactivate_fn();
 }
 
+TEST_F(NetworkModelTest, descriptorTable) {
+  ExpectSortedDescriptors();
+}
+
 TEST_F(NetworkModelTest, listInterfaces) {
   // Get the list of interfaces
   unique_ptr<RDMRequest> request = BuildGetRequest(PID_LIST_INTERFACES);
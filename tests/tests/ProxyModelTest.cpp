@@ -88,6 +88,10 @@ class ProxyModelTest : public ModelTest {
   static const uint16_t ACK_TIMER_TIME = 1u;
 };
 
+TEST_F(ProxyModelTest, descriptorTable) {
+  ExpectSortedDescriptors();
+}
+
 TEST_F(ProxyModelTest, rootProxiedDeviceCount) {
   unique_ptr<RDMRequest> request = BuildGetRequest(PID_PROXIED_DEVICE_COUNT);
 
@@ -205,13 +209,12 @@ TEST_F(ProxyModelTest, testDiscovery) {
     0xfa, 0x7f, 0xfa, 0x75, 0xba, 0x57, 0xbe, 0x75,
     0xfe, 0x57, 0xfa, 0x7d, 0xaf, 0x57, 0xfa, 0xfd
   };
-  ArrayTuple tuple(g_rdm_buffer, DUB_RESPONSE_LENGTH);
 
   unique_ptr<RDMDiscoveryRequest> request(NewDiscoveryUniqueBranchRequest(
       m_controller_uid, UID(0, 0), UID::AllDevices(), 0));
   int size = InvokeRDMHandler(request.get());
   EXPECT_LT(size, 0);
-  EXPECT_THAT(ArrayTuple(g_rdm_buffer, abs(size)),
+  EXPECT_THAT(ArrayTuple(g_rdm_response, abs(size)),
               DataIs(parent_response, arraysize(parent_response)));
 
   // Mute the parent
@@ -228,7 +231,7 @@ TEST_F(ProxyModelTest, testDiscovery) {
 
   size = InvokeRDMHandler(request.get());
   EXPECT_LT(size, 0);
-  EXPECT_THAT(ArrayTuple(g_rdm_buffer, abs(size)),
+  EXPECT_THAT(ArrayTuple(g_rdm_response, abs(size)),
               DataIs(first_child_response, arraysize(first_child_response)));
 
   // Mute the first child
@@ -245,7 +248,7 @@ TEST_F(ProxyModelTest, testDiscovery) {
 
   size = InvokeRDMHandler(request.get());
   EXPECT_LT(size, 0);
-  EXPECT_THAT(ArrayTuple(g_rdm_buffer, abs(size)),
+  EXPECT_THAT(ArrayTuple(g_rdm_response, abs(size)),
               DataIs(second_child_response, arraysize(second_child_response)));
 }
 
@@ -0,0 +1,389 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * RDMBatchTest.cpp
+ * Tests for the RDM Batch code.
+ * Copyright (C) 2015 Simon Newton
+ */
+
+#include <gtest/gtest.h>
+#include <string.h>
+
+#include <deque>
+#include <vector>
+
+#include "TransceiverMock.h"
+#include "TransportMock.h"
+#include "constants.h"
+#include "rdm.h"
+#include "rdm_batch.h"
+#include "rdm_util.h"
+#include "utils.h"
+
+using ::testing::Invoke;
+using ::testing::Return;
+using ::testing::_;
+using std::deque;
+using std::vector;
+
+namespace {
+
+struct QueuedRequest {
+  int16_t token;
+  vector<uint8_t> frame;
+  bool is_broadcast;
+};
+
+struct Record {
+  uint8_t rc;
+  uint16_t break_start;
+  uint16_t mark_start;
+  uint16_t mark_end;
+  vector<uint8_t> data;
+};
+
+struct Response {
+  uint8_t rc;
+  vector<Record> records;
+};
+
+}  // namespace
+
+class RDMBatchTest : public testing::Test {
+ public:
+  void SetUp() {
+    Transceiver_SetMock(&m_transceiver_mock);
+    Transport_SetMock(&m_transport_mock);
+    ON_CALL(m_transceiver_mock, GetMode())
+        .WillByDefault(Return(T_MODE_CONTROLLER));
+    ON_CALL(m_transceiver_mock, QueueRDMRequest(_, _, _, _))
+        .WillByDefault(Invoke(this, &RDMBatchTest::QueueRequest));
+    ON_CALL(m_transport_mock,
+            Send(kToken, COMMAND_RDM_BATCH_REQUEST, _, _, _))
+        .WillByDefault(Invoke(this, &RDMBatchTest::Send));
+    RDMBatch_Initialize(Transport_Send);
+    memset(&m_timing, 0, sizeof(m_timing));
+  }
+
+  void TearDown() {
+    Transceiver_SetMock(nullptr);
+    Transport_SetMock(nullptr);
+  }
+
+  bool QueueRequest(int16_t token, const uint8_t* data, unsigned int size,
+                    bool is_broadcast) {
+    QueuedRequest request = {
+      token, vector<uint8_t>(data, data + size), is_broadcast
+    };
+    m_queue.push_back(request);
+    return true;
+  }
+
+  bool Send(uint8_t, Command, uint8_t rc, const IOVec* iov,
+            unsigned int iov_count) {
+    EXPECT_EQ(1u, iov_count);
+    const uint8_t *data = reinterpret_cast<const uint8_t*>(iov[0].base);
+    Response response;
+    response.rc = rc;
+    unsigned int offset = 0;
+    while (offset + 9 <= iov[0].length) {
+      Record record;
+      record.rc = data[offset];
+      uint16_t length = JoinShort(data[offset + 2], data[offset + 1]);
+      record.break_start = JoinShort(data[offset + 4], data[offset + 3]);
+      record.mark_start = JoinShort(data[offset + 6], data[offset + 5]);
+      record.mark_end = JoinShort(data[offset + 8], data[offset + 7]);
+      offset += 9;
+      EXPECT_LE(offset + length, iov[0].length);
+      record.data.assign(data + offset, data + offset + length);
+      offset += length;
+      response.records.push_back(record);
+    }
+    EXPECT_EQ(offset, iov[0].length);
+    m_responses.push_back(response);
+    return true;
+  }
+
+  /*
+   * Complete the oldest queued request.
+   */
+  void Complete(TransceiverOperationResult result,
+                const vector<uint8_t> &data = vector<uint8_t>()) {
+    ASSERT_FALSE(m_queue.empty());
+    QueuedRequest request = m_queue.front();
+    m_queue.pop_front();
+    TransceiverEvent event = {
+      request.token,
+      request.is_broadcast ? T_OP_RDM_BROADCAST : T_OP_RDM_WITH_RESPONSE,
+      result,
+      data.empty() ? nullptr : data.data(),
+      static_cast<unsigned int>(data.size()),
+      &m_timing
+    };
+    RDMBatch_TransceiverEvent(&event);
+  }
+
+  /*
+   * Build a GET request, without the start code.
+   */
+  static vector<uint8_t> BuildRequest(const uint8_t dest[UID_LENGTH],
+                                      uint16_t pid) {
+    vector<uint8_t> frame(sizeof(RDMHeader) + RDM_CHECKSUM_LENGTH, 0);
+    frame[0] = RDM_START_CODE;
+    frame[1] = SUB_START_CODE;
+    frame[MESSAGE_LENGTH_OFFSET] = sizeof(RDMHeader);
+    memcpy(&frame[3], dest, UID_LENGTH);
+    frame[20] = GET_COMMAND;
+    frame[21] = ShortMSB(pid);
+    frame[22] = ShortLSB(pid);
+    RDMUtil_AppendChecksum(frame.data());
+    frame.erase(frame.begin());
+    return frame;
+  }
+
+  static vector<uint8_t> Join(const vector<vector<uint8_t> > &frames) {
+    vector<uint8_t> output;
+    for (const auto &frame : frames) {
+      output.insert(output.end(), frame.begin(), frame.end());
+    }
+    return output;
+  }
+
+ protected:
+  testing::NiceMock<MockTransceiver> m_transceiver_mock;
+  testing::NiceMock<MockTransport> m_transport_mock;
+
+  deque<QueuedRequest> m_queue;
+  vector<Response> m_responses;
+  TransceiverTiming m_timing;
+
+  static const uint8_t kToken = 7;
+  static const uint8_t kUID[UID_LENGTH];
+  static const uint8_t kBroadcastUID[UID_LENGTH];
+};
+
+const uint8_t RDMBatchTest::kToken;
+const uint8_t RDMBatchTest::kUID[] = {0x7a, 0x70, 0, 0, 0, 1};
+const uint8_t RDMBatchTest::kBroadcastUID[] = {
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff
+};
+
+TEST_F(RDMBatchTest, invalidBatch) {
+  vector<uint8_t> request = BuildRequest(kUID, PID_DEVICE_INFO);
+
+  EXPECT_EQ(RC_BAD_PARAM, RDMBatch_Start(kToken, nullptr, 0));
+
+  // Truncated request.
+  EXPECT_EQ(RC_BAD_PARAM,
+            RDMBatch_Start(kToken, request.data(), request.size() - 1));
+  EXPECT_EQ(RC_BAD_PARAM, RDMBatch_Start(kToken, request.data(), 1));
+
+  // Message length too small.
+  vector<uint8_t> short_request = request;
+  short_request[1] = 10;
+  EXPECT_EQ(RC_BAD_PARAM, RDMBatch_Start(kToken, short_request.data(),
+                                         short_request.size()));
+
+  // Trailing data.
+  vector<uint8_t> trailing = request;
+  trailing.push_back(0);
+  EXPECT_EQ(RC_BAD_PARAM,
+            RDMBatch_Start(kToken, trailing.data(), trailing.size()));
+
+  // Only GET and SET commands can be batched.
+  const uint8_t command_classes[] = {
+    DISCOVERY_COMMAND, DISCOVERY_COMMAND_RESPONSE, GET_COMMAND_RESPONSE,
+    SET_COMMAND_RESPONSE
+  };
+  for (uint8_t command_class : command_classes) {
+    vector<uint8_t> other = request;
+    other[RDM_COMMAND_CLASS_OFFSET - 1] = command_class;
+    vector<uint8_t> batch = Join({request, other});
+    EXPECT_EQ(RC_BAD_PARAM, RDMBatch_Start(kToken, batch.data(), batch.size()));
+  }
+
+  RDMBatch_Tasks();
+  EXPECT_TRUE(m_queue.empty());
+  EXPECT_TRUE(m_responses.empty());
+}
+
+TEST_F(RDMBatchTest, singleRequest) {
+  vector<uint8_t> request = BuildRequest(kUID, PID_DEVICE_INFO);
+  EXPECT_EQ(RC_OK, RDMBatch_Start(kToken, request.data(), request.size()));
+  EXPECT_EQ(RC_BUSY,
+            RDMBatch_Start(kToken, request.data(), request.size()));
+
+  RDMBatch_Tasks();
+  ASSERT_EQ(1u, m_queue.size());
+  EXPECT_EQ(RDM_BATCH_TOKEN, m_queue[0].token);
+  EXPECT_EQ(request, m_queue[0].frame);
+  EXPECT_FALSE(m_queue[0].is_broadcast);
+
+  m_timing.get_set_response.break_start = 1234;
+  m_timing.get_set_response.mark_start = 1410;
+  m_timing.get_set_response.mark_end = 1530;
+  vector<uint8_t> rdm_response = {0xcc, 1, 2, 3, 4};
+  Complete(T_RESULT_RX_DATA, rdm_response);
+
+  ASSERT_EQ(1u, m_responses.size());
+  EXPECT_EQ(RC_OK, m_responses[0].rc);
+  ASSERT_EQ(1u, m_responses[0].records.size());
+  const Record &record = m_responses[0].records[0];
+  EXPECT_EQ(RC_OK, record.rc);
+  EXPECT_EQ(1234, record.break_start);
+  EXPECT_EQ(1410, record.mark_start);
+  EXPECT_EQ(1530, record.mark_end);
+  EXPECT_EQ(rdm_response, record.data);
+
+  // A new batch can now be started.
+  EXPECT_EQ(RC_OK, RDMBatch_Start(kToken, request.data(), request.size()));
+}
+
+TEST_F(RDMBatchTest, backToBack) {
+  vector<vector<uint8_t> > requests = {
+    BuildRequest(kUID, PID_DEVICE_INFO),
+    BuildRequest(kUID, PID_SENSOR_VALUE),
+    BuildRequest(kBroadcastUID, PID_STATUS_MESSAGES),
+  };
+  vector<uint8_t> batch = Join(requests);
+  EXPECT_EQ(RC_OK, RDMBatch_Start(kToken, batch.data(), batch.size()));
+
+  // The next request is queued while the current one is in progress.
+  RDMBatch_Tasks();
+  ASSERT_EQ(2u, m_queue.size());
+  EXPECT_EQ(requests[0], m_queue[0].frame);
+  EXPECT_EQ(requests[1], m_queue[1].frame);
+  RDMBatch_Tasks();
+  EXPECT_EQ(2u, m_queue.size());
+
+  Complete(T_RESULT_RX_TIMEOUT);
+  RDMBatch_Tasks();
+  ASSERT_EQ(2u, m_queue.size());
+  EXPECT_EQ(RDM_BATCH_TOKEN + 2, m_queue[1].token);
+  EXPECT_EQ(requests[2], m_queue[1].frame);
+  EXPECT_TRUE(m_queue[1].is_broadcast);
+
+  Complete(T_RESULT_RX_INVALID);
+  EXPECT_TRUE(m_responses.empty());
+  Complete(T_RESULT_RX_TIMEOUT);
+
+  // All the results are returned in a single message.
+  ASSERT_EQ(1u, m_responses.size());
+  EXPECT_EQ(RC_OK, m_responses[0].rc);
+  ASSERT_EQ(3u, m_responses[0].records.size());
+  EXPECT_EQ(RC_RDM_TIMEOUT, m_responses[0].records[0].rc);
+  EXPECT_EQ(RC_RDM_INVALID_RESPONSE, m_responses[0].records[1].rc);
+  EXPECT_EQ(RC_OK, m_responses[0].records[2].rc);
+}
+
+TEST_F(RDMBatchTest, largeResponses) {
+  vector<vector<uint8_t> > requests(10, BuildRequest(kUID, PID_DEVICE_INFO));
+  vector<uint8_t> batch = Join(requests);
+  EXPECT_EQ(RC_OK, RDMBatch_Start(kToken, batch.data(), batch.size()));
+
+  vector<uint8_t> rdm_response(200, 0xcc);
+  for (unsigned int i = 0; i < requests.size(); i++) {
+    RDMBatch_Tasks();
+    Complete(T_RESULT_RX_DATA, rdm_response);
+  }
+  EXPECT_TRUE(m_queue.empty());
+
+  // Two records fit in each message.
+  ASSERT_EQ(5u, m_responses.size());
+  for (unsigned int i = 0; i < m_responses.size(); i++) {
+    EXPECT_EQ(i == 4 ? RC_OK : RC_MORE_DATA, m_responses[i].rc);
+    ASSERT_EQ(2u, m_responses[i].records.size());
+    EXPECT_EQ(rdm_response, m_responses[i].records[1].data);
+  }
+}
+
+TEST_F(RDMBatchTest, queueFull) {
+  vector<uint8_t> request = BuildRequest(kUID, PID_DEVICE_INFO);
+  EXPECT_EQ(RC_OK, RDMBatch_Start(kToken, request.data(), request.size()));
+
+  EXPECT_CALL(m_transceiver_mock, QueueRDMRequest(_, _, _, _))
+      .WillOnce(Return(false))
+      .WillOnce(Invoke(this, &RDMBatchTest::QueueRequest));
+  RDMBatch_Tasks();
+  EXPECT_TRUE(m_queue.empty());
+  RDMBatch_Tasks();
+  ASSERT_EQ(1u, m_queue.size());
+
+  Complete(T_RESULT_TX_ERROR);
+  ASSERT_EQ(1u, m_responses.size());
+  EXPECT_EQ(RC_OK, m_responses[0].rc);
+  ASSERT_EQ(1u, m_responses[0].records.size());
+  EXPECT_EQ(RC_TX_ERROR, m_responses[0].records[0].rc);
+}
+
+TEST_F(RDMBatchTest, cancelled) {
+  vector<vector<uint8_t> > requests(4, BuildRequest(kUID, PID_DEVICE_INFO));
+  vector<uint8_t> batch = Join(requests);
+  EXPECT_EQ(RC_OK, RDMBatch_Start(kToken, batch.data(), batch.size()));
+
+  RDMBatch_Tasks();
+  ASSERT_EQ(2u, m_queue.size());
+  Complete(T_RESULT_RX_TIMEOUT);
+
+  // The mode change cancels the queued request, and the rest aren't sent.
+  Complete(T_RESULT_CANCELLED);
+  RDMBatch_Tasks();
+  EXPECT_TRUE(m_queue.empty());
+
+  ASSERT_EQ(1u, m_responses.size());
+  EXPECT_EQ(RC_CANCELLED, m_responses[0].rc);
+  EXPECT_EQ(1u, m_responses[0].records.size());
+}
+
+TEST_F(RDMBatchTest, resetWithRequestsInFlight) {
+  vector<vector<uint8_t> > requests(4, BuildRequest(kUID, PID_DEVICE_INFO));
+  vector<uint8_t> batch = Join(requests);
+  EXPECT_EQ(RC_OK, RDMBatch_Start(kToken, batch.data(), batch.size()));
+
+  RDMBatch_Tasks();
+  ASSERT_EQ(2u, m_queue.size());
+  Complete(T_RESULT_RX_TIMEOUT);
+  RDMBatch_Tasks();
+  ASSERT_EQ(2u, m_queue.size());
+
+  // Transceiver_Reset() cancels the active and the queued request.
+  Complete(T_RESULT_CANCELLED);
+  Complete(T_RESULT_CANCELLED);
+  RDMBatch_Tasks();
+  EXPECT_TRUE(m_queue.empty());
+
+  // The records collected so far are returned.
+  ASSERT_EQ(1u, m_responses.size());
+  EXPECT_EQ(RC_CANCELLED, m_responses[0].rc);
+  ASSERT_EQ(1u, m_responses[0].records.size());
+  EXPECT_EQ(RC_RDM_TIMEOUT, m_responses[0].records[0].rc);
+
+  // A new batch can now be started.
+  EXPECT_EQ(RC_OK, RDMBatch_Start(kToken, batch.data(), batch.size()));
+}
+
+TEST_F(RDMBatchTest, modeChange) {
+  vector<uint8_t> request = BuildRequest(kUID, PID_DEVICE_INFO);
+  EXPECT_EQ(RC_OK, RDMBatch_Start(kToken, request.data(), request.size()));
+
+  EXPECT_CALL(m_transceiver_mock, GetMode())
+      .WillOnce(Return(T_MODE_RESPONDER));
+  RDMBatch_Tasks();
+  EXPECT_TRUE(m_queue.empty());
+
+  ASSERT_EQ(1u, m_responses.size());
+  EXPECT_EQ(RC_CANCELLED, m_responses[0].rc);
+  EXPECT_TRUE(m_responses[0].records.empty());
+}
@@ -0,0 +1,596 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * RDMDiscoveryTest.cpp
+ * Tests for the RDM Discovery code.
+ * Copyright (C) 2015 Simon Newton
+ */
+
+#include <gtest/gtest.h>
+#include <string.h>
+
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "Matchers.h"
+#include "TransceiverMock.h"
+#include "TransportMock.h"
+#include "coarse_timer.h"
+#include "constants.h"
+#include "rdm.h"
+#include "rdm_discovery.h"
+#include "rdm_util.h"
+#include "utils.h"
+
+using ::testing::Invoke;
+using ::testing::Return;
+using ::testing::_;
+using std::pair;
+using std::set;
+using std::vector;
+
+namespace {
+
+uint64_t ToUInt64(const uint8_t *uid) {
+  uint64_t value = 0;
+  for (unsigned int i = 0; i < UID_LENGTH; i++) {
+    value = (value << 8) + uid[i];
+  }
+  return value;
+}
+
+void ToUID(uint64_t value, uint8_t *uid) {
+  for (int i = UID_LENGTH - 1; i >= 0; i--) {
+    uid[i] = value & 0xff;
+    value >>= 8;
+  }
+}
+
+}  // namespace
+
+/*
+ * Simulates the responders on the line, and records the responses sent to the
+ * host.
+ */
+class RDMDiscoveryTest : public testing::Test {
+ public:
+  RDMDiscoveryTest()
+      : m_has_event(false),
+        m_collision_data(false),
+        m_dub_count(0),
+        m_request_count(0) {
+  }
+
+  void SetUp() {
+    Transceiver_SetMock(&m_transceiver_mock);
+    Transport_SetMock(&m_transport_mock);
+    ON_CALL(m_transceiver_mock, GetMode())
+        .WillByDefault(Return(T_MODE_CONTROLLER));
+    ON_CALL(m_transceiver_mock, QueueRDMDUB(_, _, _))
+        .WillByDefault(Invoke(this, &RDMDiscoveryTest::QueueDUB));
+    ON_CALL(m_transceiver_mock, QueueRDMRequest(_, _, _, _))
+        .WillByDefault(Invoke(this, &RDMDiscoveryTest::QueueRequest));
+    ON_CALL(m_transport_mock, Send(kToken, COMMAND_RDM_DISCOVERY, _, _, _))
+        .WillByDefault(Invoke(this, &RDMDiscoveryTest::Send));
+    ON_CALL(m_transport_mock, Send(0, COMMAND_RDM_DEVICES_CHANGED, _, _, _))
+        .WillByDefault(Invoke(this, &RDMDiscoveryTest::SendChange));
+    ON_CALL(m_transport_mock, Send(kToken, COMMAND_RDM_GET_DEVICES, _, _, _))
+        .WillByDefault(Invoke(this, &RDMDiscoveryTest::SendDevices));
+    CoarseTimer_SetCounter(0);
+    RDMDiscovery_Initialize(Transport_Send);
+  }
+
+  void TearDown() {
+    Transceiver_SetMock(nullptr);
+    Transport_SetMock(nullptr);
+  }
+
+  bool QueueDUB(int16_t token, const uint8_t* data, unsigned int size) {
+    EXPECT_FALSE(m_has_event);
+    CheckRequest(data, size, PID_DISC_UNIQUE_BRANCH);
+    m_dub_count++;
+    m_request_count++;
+
+    uint64_t lower = ToUInt64(data + RDM_PARAM_DATA_OFFSET - 1);
+    uint64_t upper = ToUInt64(data + RDM_PARAM_DATA_OFFSET - 1 + UID_LENGTH);
+    vector<uint64_t> matches;
+    for (uint64_t uid : m_responders) {
+      if (uid >= lower && uid <= upper && !m_muted.count(uid)) {
+        matches.push_back(uid);
+      }
+    }
+
+    m_event_data.clear();
+    if (matches.empty()) {
+      SetEvent(token, T_OP_RDM_DUB, T_RESULT_RX_TIMEOUT);
+    } else if (matches.size() == 1) {
+      EncodeDUBResponse(matches[0]);
+      SetEvent(token, T_OP_RDM_DUB, T_RESULT_RX_DATA);
+    } else if (m_collision_data) {
+      // Two responses on top of each other.
+      EncodeDUBResponse(matches[0]);
+      vector<uint8_t> first = m_event_data;
+      m_event_data.clear();
+      EncodeDUBResponse(matches[1]);
+      for (unsigned int i = 0; i < m_event_data.size(); i++) {
+        m_event_data[i] &= first[i];
+      }
+      SetEvent(token, T_OP_RDM_DUB, T_RESULT_RX_DATA);
+    } else {
+      SetEvent(token, T_OP_RDM_DUB, T_RESULT_RX_INVALID);
+    }
+    return true;
+  }
+
+  bool QueueRequest(int16_t token, const uint8_t* data, unsigned int size,
+                    bool is_broadcast) {
+    EXPECT_FALSE(m_has_event);
+    uint16_t pid = JoinShort(data[20], data[21]);
+    CheckRequest(data, size, pid);
+    m_request_count++;
+    m_event_data.clear();
+
+    if (pid == PID_DISC_UN_MUTE) {
+      EXPECT_TRUE(is_broadcast);
+      m_muted.clear();
+      SetEvent(token, T_OP_RDM_BROADCAST, T_RESULT_RX_TIMEOUT);
+      return true;
+    }
+
+    EXPECT_EQ(PID_DISC_MUTE, pid);
+    EXPECT_FALSE(is_broadcast);
+    uint64_t uid = ToUInt64(data + 2);
+    if (!m_responders.count(uid) || m_unmutable.count(uid)) {
+      SetEvent(token, T_OP_RDM_WITH_RESPONSE, T_RESULT_RX_TIMEOUT);
+      return true;
+    }
+    m_muted.insert(uid);
+
+    // Build the mute response.
+    m_event_data.resize(sizeof(RDMHeader) + 2 + RDM_CHECKSUM_LENGTH, 0);
+    m_event_data[0] = RDM_START_CODE;
+    m_event_data[1] = SUB_START_CODE;
+    m_event_data[MESSAGE_LENGTH_OFFSET] = sizeof(RDMHeader) + 2;
+    memcpy(&m_event_data[3], data + 8, UID_LENGTH);
+    if (m_wrong_source.count(uid)) {
+      ToUID(uid + 1, &m_event_data[9]);
+    } else {
+      memcpy(&m_event_data[9], data + 2, UID_LENGTH);
+    }
+    m_event_data[20] = DISCOVERY_COMMAND_RESPONSE;
+    m_event_data[22] = PID_DISC_MUTE;
+    m_event_data[23] = 2;
+    RDMUtil_AppendChecksum(m_event_data.data());
+    SetEvent(token, T_OP_RDM_WITH_RESPONSE, T_RESULT_RX_DATA);
+    return true;
+  }
+
+  bool Send(uint8_t, Command, uint8_t rc, const IOVec* iov,
+            unsigned int iov_count) {
+    EXPECT_EQ(1u, iov_count);
+    EXPECT_EQ(0u, iov[0].length % UID_LENGTH);
+    const uint8_t *data = reinterpret_cast<const uint8_t*>(iov[0].base);
+    for (unsigned int i = 0; i < iov[0].length; i += UID_LENGTH) {
+      m_found.push_back(ToUInt64(data + i));
+    }
+    m_response_codes.push_back(rc);
+    return true;
+  }
+
+  bool SendChange(uint8_t, Command, uint8_t rc, const IOVec* iov,
+                  unsigned int iov_count) {
+    EXPECT_EQ(RC_OK, rc);
+    EXPECT_EQ(1u, iov_count);
+    EXPECT_EQ(1u + UID_LENGTH, iov[0].length);
+    const uint8_t *data = reinterpret_cast<const uint8_t*>(iov[0].base);
+    m_changes.push_back(std::make_pair(data[0], ToUInt64(data + 1)));
+    return true;
+  }
+
+  bool SendDevices(uint8_t, Command, uint8_t rc, const IOVec* iov,
+                   unsigned int iov_count) {
+    m_devices_rc = rc;
+    m_devices.clear();
+    if (rc != RC_OK) {
+      EXPECT_EQ(0u, iov_count);
+      return true;
+    }
+    EXPECT_LE(1u, iov_count);
+    EXPECT_EQ(2u, iov[0].length);
+    const uint8_t *count = reinterpret_cast<const uint8_t*>(iov[0].base);
+    m_device_count = JoinShort(count[1], count[0]);
+    if (iov_count == 2) {
+      EXPECT_EQ(0u, iov[1].length % UID_LENGTH);
+      const uint8_t *data = reinterpret_cast<const uint8_t*>(iov[1].base);
+      for (unsigned int i = 0; i < iov[1].length; i += UID_LENGTH) {
+        m_devices.push_back(ToUInt64(data + i));
+      }
+    }
+    return true;
+  }
+
+  void DeliverEvent() {
+    if (m_has_event) {
+      m_has_event = false;
+      TransceiverEvent event = {
+        m_event_token,
+        m_event_op,
+        m_event_result,
+        m_event_data.empty() ? nullptr : m_event_data.data(),
+        static_cast<unsigned int>(m_event_data.size()),
+        nullptr
+      };
+      RDMDiscovery_TransceiverEvent(&event);
+    }
+  }
+
+  /*
+   * Run background discovery, advancing the clock by the interval each time.
+   */
+  void RunBackground(uint16_t interval, unsigned int iterations) {
+    for (unsigned int i = 0; i < iterations; i++) {
+      CoarseTimer_SetCounter(CoarseTimer_GetTime() + interval + 1);
+      RDMDiscovery_Tasks();
+      DeliverEvent();
+    }
+  }
+
+  void RunDiscovery() {
+    EXPECT_TRUE(RDMDiscovery_Start(kToken));
+    unsigned int i = 0;
+    while (RDMDiscovery_IsRunning() && i < 100000) {
+      RDMDiscovery_Tasks();
+      DeliverEvent();
+      i++;
+    }
+    EXPECT_FALSE(RDMDiscovery_IsRunning());
+  }
+
+ protected:
+  testing::NiceMock<MockTransceiver> m_transceiver_mock;
+  testing::NiceMock<MockTransport> m_transport_mock;
+
+  set<uint64_t> m_responders;
+  set<uint64_t> m_unmutable;
+  set<uint64_t> m_wrong_source;  // Mute responses have the wrong source UID.
+  set<uint64_t> m_muted;
+  vector<uint64_t> m_found;
+  vector<uint8_t> m_response_codes;
+  vector<pair<uint8_t, uint64_t> > m_changes;
+  vector<uint64_t> m_devices;
+  uint16_t m_device_count;
+  uint8_t m_devices_rc;
+
+  bool m_has_event;
+  bool m_collision_data;
+  unsigned int m_dub_count;
+  unsigned int m_request_count;
+  int16_t m_event_token;
+  TransceiverOperation m_event_op;
+  TransceiverOperationResult m_event_result;
+  vector<uint8_t> m_event_data;
+
+  static const uint8_t kToken = 12;
+
+  void SetEvent(int16_t token, TransceiverOperation op,
+                TransceiverOperationResult result) {
+    EXPECT_LE(RDM_DISCOVERY_TOKEN, token);
+    EXPECT_GT(RDM_DISCOVERY_TOKEN_LIMIT, token);
+    m_has_event = true;
+    m_event_token = token;
+    m_event_op = op;
+    m_event_result = result;
+  }
+
+  void CheckRequest(const uint8_t *data, unsigned int size, uint16_t pid) {
+    vector<uint8_t> frame(data, data + size);
+    frame.insert(frame.begin(), RDM_START_CODE);
+    EXPECT_TRUE(RDMUtil_VerifyChecksum(frame.data(), frame.size()));
+    EXPECT_EQ(DISCOVERY_COMMAND, data[19]);
+    EXPECT_EQ(pid, JoinShort(data[20], data[21]));
+  }
+
+  void EncodeDUBResponse(uint64_t value) {
+    uint8_t uid[UID_LENGTH];
+    ToUID(value, uid);
+    m_event_data.assign(7, 0xfe);
+    m_event_data.push_back(0xaa);
+    uint16_t checksum = 0;
+    for (unsigned int i = 0; i < UID_LENGTH; i++) {
+      m_event_data.push_back(uid[i] | 0xaa);
+      m_event_data.push_back(uid[i] | 0x55);
+      checksum += (uid[i] | 0xaa) + (uid[i] | 0x55);
+    }
+    m_event_data.push_back(ShortMSB(checksum) | 0xaa);
+    m_event_data.push_back(ShortMSB(checksum) | 0x55);
+    m_event_data.push_back(ShortLSB(checksum) | 0xaa);
+    m_event_data.push_back(ShortLSB(checksum) | 0x55);
+  }
+};
+
+const uint8_t RDMDiscoveryTest::kToken;
+
+TEST_F(RDMDiscoveryTest, noResponders) {
+  RunDiscovery();
+  EXPECT_EQ(vector<uint8_t>({RC_OK}), m_response_codes);
+  EXPECT_TRUE(m_found.empty());
+  EXPECT_EQ(1u, m_dub_count);
+}
+
+TEST_F(RDMDiscoveryTest, singleResponder) {
+  m_responders.insert(0x7a7012345678);
+  RunDiscovery();
+  EXPECT_EQ(vector<uint8_t>({RC_OK}), m_response_codes);
+  EXPECT_EQ(vector<uint64_t>({0x7a7012345678}), m_found);
+  EXPECT_EQ(2u, m_dub_count);
+}
+
+TEST_F(RDMDiscoveryTest, collisions) {
+  m_responders = {0x000000000000, 0x000000000001, 0x7a7000000001,
+                  0x7a7000000002, 0x7a70ffffff00, 0xfffffffffffe};
+  RunDiscovery();
+  EXPECT_EQ(vector<uint8_t>({RC_OK}), m_response_codes);
+  EXPECT_EQ(vector<uint64_t>(m_responders.begin(), m_responders.end()),
+            m_found);
+}
+
+TEST_F(RDMDiscoveryTest, corruptResponses) {
+  m_collision_data = true;
+  m_responders = {0x7a7000000001, 0x7a7000000002, 0x7a7000000003,
+                  0x4a4000000010};
+  RunDiscovery();
+  EXPECT_EQ(vector<uint8_t>({RC_OK}), m_response_codes);
+  EXPECT_EQ(vector<uint64_t>(m_responders.begin(), m_responders.end()),
+            m_found);
+}
+
+TEST_F(RDMDiscoveryTest, manyResponders) {
+  // Enough UIDs that they span several responses.
+  uint64_t uid = 0x7a7000000000;
+  for (unsigned int i = 0; i < 200; i++) {
+    m_responders.insert(uid);
+    uid += 0x01234567 + i * 37;
+  }
+  RunDiscovery();
+  EXPECT_EQ(vector<uint8_t>({RC_MORE_DATA, RC_MORE_DATA, RC_OK}),
+            m_response_codes);
+  EXPECT_EQ(vector<uint64_t>(m_responders.begin(), m_responders.end()),
+            m_found);
+}
+
+TEST_F(RDMDiscoveryTest, unmutableResponder) {
+  m_responders = {0x7a7000000001, 0x7a7000000002};
+  m_unmutable = {0x7a7000000001};
+  RunDiscovery();
+  EXPECT_EQ(vector<uint8_t>({RC_OK}), m_response_codes);
+  EXPECT_EQ(vector<uint64_t>({0x7a7000000002}), m_found);
+}
+
+TEST_F(RDMDiscoveryTest, muteResponseFromWrongResponder) {
+  m_responders = {0x7a7000000001, 0x7a7000000004};
+  m_wrong_source = {0x7a7000000001};
+  RunDiscovery();
+  EXPECT_EQ(vector<uint8_t>({RC_OK}), m_response_codes);
+  EXPECT_EQ(vector<uint64_t>({0x7a7000000004}), m_found);
+}
+
+TEST_F(RDMDiscoveryTest, alreadyRunning) {
+  EXPECT_FALSE(RDMDiscovery_IsRunning());
+  EXPECT_TRUE(RDMDiscovery_Start(kToken));
+  EXPECT_TRUE(RDMDiscovery_IsRunning());
+  EXPECT_FALSE(RDMDiscovery_Start(kToken));
+}
+
+TEST_F(RDMDiscoveryTest, cancelled) {
+  m_responders.insert(0x7a7012345678);
+  EXPECT_TRUE(RDMDiscovery_Start(kToken));
+  RDMDiscovery_Tasks();
+  ASSERT_TRUE(m_has_event);
+
+  // The mode change cancels the pending request.
+  TransceiverEvent event = {
+    m_event_token, m_event_op, T_RESULT_CANCELLED, nullptr, 0, nullptr
+  };
+  RDMDiscovery_TransceiverEvent(&event);
+  EXPECT_FALSE(RDMDiscovery_IsRunning());
+  EXPECT_EQ(vector<uint8_t>({RC_CANCELLED}), m_response_codes);
+}
+
+TEST_F(RDMDiscoveryTest, resetWithRequestInFlight) {
+  m_responders.insert(0x7a7012345678);
+  EXPECT_TRUE(RDMDiscovery_Start(kToken));
+  RDMDiscovery_Tasks();
+  ASSERT_TRUE(m_has_event);
+  m_has_event = false;
+
+  // Transceiver_Reset() cancels the request in flight.
+  TransceiverEvent event = {
+    m_event_token, m_event_op, T_RESULT_CANCELLED, nullptr, 0, nullptr
+  };
+  RDMDiscovery_TransceiverEvent(&event);
+  EXPECT_FALSE(RDMDiscovery_IsRunning());
+  EXPECT_EQ(vector<uint8_t>({RC_CANCELLED}), m_response_codes);
+
+  // The next discovery runs to completion.
+  m_response_codes.clear();
+  RunDiscovery();
+  EXPECT_EQ(vector<uint8_t>({RC_OK}), m_response_codes);
+  EXPECT_EQ(vector<uint64_t>({0x7a7012345678}), m_found);
+}
+
+TEST_F(RDMDiscoveryTest, modeChange) {
+  EXPECT_TRUE(RDMDiscovery_Start(kToken));
+  EXPECT_CALL(m_transceiver_mock, GetMode())
+      .WillOnce(Return(T_MODE_RESPONDER));
+  RDMDiscovery_Tasks();
+  EXPECT_FALSE(RDMDiscovery_IsRunning());
+  EXPECT_EQ(vector<uint8_t>({RC_CANCELLED}), m_response_codes);
+}
+
+TEST_F(RDMDiscoveryTest, getDevices) {
+  RDMDiscovery_SendDevices(kToken, 0);
+  EXPECT_EQ(RC_OK, m_devices_rc);
+  EXPECT_EQ(0u, m_device_count);
+  EXPECT_TRUE(m_devices.empty());
+
+  uint64_t uid = 0x7a7000000000;
+  for (unsigned int i = 0; i < 100; i++) {
+    m_responders.insert(uid);
+    uid += 0x01234567 + i * 37;
+  }
+  RunDiscovery();
+  vector<uint64_t> expected(m_responders.begin(), m_responders.end());
+
+  // The table is sent in pages, in UID order.
+  RDMDiscovery_SendDevices(kToken, 0);
+  EXPECT_EQ(100u, m_device_count);
+  EXPECT_EQ(vector<uint64_t>(expected.begin(), expected.begin() + 85),
+            m_devices);
+
+  RDMDiscovery_SendDevices(kToken, 85);
+  EXPECT_EQ(100u, m_device_count);
+  EXPECT_EQ(vector<uint64_t>(expected.begin() + 85, expected.end()),
+            m_devices);
+
+  RDMDiscovery_SendDevices(kToken, 200);
+  EXPECT_EQ(100u, m_device_count);
+  EXPECT_TRUE(m_devices.empty());
+}
+
+TEST_F(RDMDiscoveryTest, getDevicesDuringDiscovery) {
+  // Enough UIDs that they span several discovery responses.
+  uint64_t uid = 0x7a7000000000;
+  for (unsigned int i = 0; i < 200; i++) {
+    m_responders.insert(uid);
+    uid += 0x01234567 + i * 37;
+  }
+
+  // Asking for the table mustn't disturb the UIDs waiting to be sent.
+  EXPECT_TRUE(RDMDiscovery_Start(kToken));
+  unsigned int busy_count = 0;
+  unsigned int i = 0;
+  while (RDMDiscovery_IsRunning() && i < 100000) {
+    RDMDiscovery_Tasks();
+    DeliverEvent();
+    RDMDiscovery_SendDevices(kToken, 0);
+    if (m_devices_rc == RC_BUSY) {
+      busy_count++;
+    }
+    i++;
+  }
+  EXPECT_FALSE(RDMDiscovery_IsRunning());
+  EXPECT_LT(0u, busy_count);
+
+  EXPECT_EQ(vector<uint8_t>({RC_MORE_DATA, RC_MORE_DATA, RC_OK}),
+            m_response_codes);
+  EXPECT_EQ(vector<uint64_t>(m_responders.begin(), m_responders.end()),
+            m_found);
+
+  RDMDiscovery_SendDevices(kToken, 0);
+  EXPECT_EQ(RC_OK, m_devices_rc);
+  EXPECT_EQ(200u, m_device_count);
+}
+
+TEST_F(RDMDiscoveryTest, setInterval) {
+  EXPECT_EQ(0u, RDMDiscovery_GetInterval());
+  EXPECT_FALSE(RDMDiscovery_SetInterval(99));
+  EXPECT_EQ(0u, RDMDiscovery_GetInterval());
+  EXPECT_TRUE(RDMDiscovery_SetInterval(100));
+  EXPECT_EQ(100u, RDMDiscovery_GetInterval());
+  EXPECT_TRUE(RDMDiscovery_SetInterval(0));
+  EXPECT_EQ(0u, RDMDiscovery_GetInterval());
+}
+
+TEST_F(RDMDiscoveryTest, backgroundDisabled) {
+  m_responders.insert(0x7a7012345678);
+  RunBackground(1000, 10);
+  EXPECT_EQ(0u, m_request_count);
+  EXPECT_TRUE(m_changes.empty());
+}
+
+TEST_F(RDMDiscoveryTest, backgroundInterval) {
+  m_responders.insert(0x7a7012345678);
+  EXPECT_TRUE(RDMDiscovery_SetInterval(1000));
+
+  // Nothing is sent until the interval has passed.
+  CoarseTimer_SetCounter(1000);
+  RDMDiscovery_Tasks();
+  EXPECT_EQ(0u, m_request_count);
+  CoarseTimer_SetCounter(1001);
+  RDMDiscovery_Tasks();
+  EXPECT_EQ(1u, m_request_count);
+  DeliverEvent();
+
+  // Each following request also waits for the interval.
+  CoarseTimer_SetCounter(2001);
+  RDMDiscovery_Tasks();
+  EXPECT_EQ(1u, m_request_count);
+  CoarseTimer_SetCounter(2002);
+  RDMDiscovery_Tasks();
+  EXPECT_EQ(2u, m_request_count);
+}
+
+TEST_F(RDMDiscoveryTest, backgroundChanges) {
+  m_responders = {0x7a7000000001, 0x7a7000000002};
+  EXPECT_TRUE(RDMDiscovery_SetInterval(100));
+
+  // The first sweep un-mutes everything, so both devices are added.
+  RunBackground(100, 200);
+  EXPECT_EQ((vector<pair<uint8_t, uint64_t> >({
+                {RDM_DEVICE_ADDED, 0x7a7000000001},
+                {RDM_DEVICE_ADDED, 0x7a7000000002}})),
+            m_changes);
+  EXPECT_TRUE(m_response_codes.empty());
+
+  // Later sweeps only find new devices.
+  m_changes.clear();
+  m_responders.insert(0x4a4000000010);
+  RunBackground(100, 200);
+  EXPECT_EQ((vector<pair<uint8_t, uint64_t> >({
+                {RDM_DEVICE_ADDED, 0x4a4000000010}})),
+            m_changes);
+
+  // A device which doesn't respond to a mute is removed.
+  m_changes.clear();
+  m_responders.erase(0x7a7000000001);
+  RunBackground(100, 200);
+  EXPECT_EQ((vector<pair<uint8_t, uint64_t> >({
+                {RDM_DEVICE_REMOVED, 0x7a7000000001}})),
+            m_changes);
+
+  RDMDiscovery_SendDevices(kToken, 0);
+  EXPECT_EQ(vector<uint64_t>({0x4a4000000010, 0x7a7000000002}), m_devices);
+}
+
+TEST_F(RDMDiscoveryTest, fullDiscoveryPreemptsBackground) {
+  m_responders = {0x7a7000000001, 0x7a7000000002};
+  EXPECT_TRUE(RDMDiscovery_SetInterval(100));
+  CoarseTimer_SetCounter(101);
+  RDMDiscovery_Tasks();
+  ASSERT_TRUE(m_has_event);
+  EXPECT_FALSE(RDMDiscovery_IsRunning());
+
+  // The result of the background request is ignored.
+  RunDiscovery();
+  EXPECT_EQ(vector<uint8_t>({RC_OK}), m_response_codes);
+  EXPECT_EQ(vector<uint64_t>(m_responders.begin(), m_responders.end()),
+            m_found);
+  EXPECT_TRUE(m_changes.empty());
+
+  // The devices are already in the table, so there are no changes.
+  RunBackground(100, 200);
+  EXPECT_TRUE(m_changes.empty());
+}
@@ -20,6 +20,7 @@
 
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
+#include <string.h>
 #include <memory>
 #include <ola/rdm/RDMCommand.h>
 #include <ola/rdm/RDMCommandSerializer.h>
@@ -33,6 +34,7 @@
 #include "Matchers.h"
 #include "TestHelpers.h"
 
+using ::testing::Invoke;
 using ::testing::Return;
 using ::testing::StrictMock;
 using ::testing::WithArgs;
@@ -140,6 +142,22 @@ void TasksSecond() {
   }
 }
 
+// A DUB request for the whole UID space.
+const uint8_t DUB_REQUEST[] = {
+  0xcc, 0x01, 0x24, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x7a, 0x70, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x10, 0x00, 0x01, 0x0c,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0x0d, 0xed
+};
+
+// Called from the model's activate / deactivate functions.
+void CheckFastPathIsDisabled() {
+  const uint8_t *response = nullptr;
+  EXPECT_EQ(0, RDMHandler_HandleFastPath(
+      AsHeader(DUB_REQUEST), DUB_REQUEST + RDM_PARAM_DATA_OFFSET, &response));
+  EXPECT_EQ(nullptr, response);
+}
+
 class MockSender {
  public:
   MOCK_METHOD3(SendResponse, void(bool include_break,
@@ -410,6 +428,29 @@ TEST_F(RDMHandlerTest, testGetSetModelId) {
   EXPECT_EQ(MODEL_TWO, RDMHandler_ActiveModel());
 }
 
+TEST_F(RDMHandlerTest, testFastPathDuringModelChange) {
+  RDMHandlerSettings settings = {
+    .default_model = MODEL_ONE,
+    .send_callback = SendResponse
+  };
+  RDMHandler_Initialize(&settings);
+
+  EXPECT_CALL(m_first_model, Activate())
+    .WillOnce(Invoke(CheckFastPathIsDisabled));
+  EXPECT_TRUE(RDMHandler_AddModel(&FIRST_MODEL));
+  EXPECT_TRUE(RDMHandler_AddModel(&SECOND_MODEL));
+
+  EXPECT_CALL(m_first_model, Deactivate())
+    .WillOnce(Invoke(CheckFastPathIsDisabled));
+  EXPECT_CALL(m_second_model, Activate())
+    .WillOnce(Invoke(CheckFastPathIsDisabled));
+  EXPECT_TRUE(RDMHandler_SetActiveModel(MODEL_TWO));
+
+  EXPECT_CALL(m_second_model, Deactivate())
+    .WillOnce(Invoke(CheckFastPathIsDisabled));
+  EXPECT_TRUE(RDMHandler_SetActiveModel(NULL_MODEL_ID));
+}
+
 TEST_F(RDMHandlerTest, testGetModelList) {
   RDMHandlerSettings settings = {
     .default_model = MODEL_ONE,
@@ -441,3 +482,79 @@ TEST_F(RDMHandlerTest, testGetModelList) {
 
   CallRDMHandler(get_request.get());
 }
+
+TEST_F(RDMHandlerTest, testRetransmit) {
+  RDMHandlerSettings settings = {
+    .default_model = MODEL_ONE,
+    .send_callback = SendResponse
+  };
+  RDMHandler_Initialize(&settings);
+
+  EXPECT_CALL(m_first_model, Activate()).Times(1);
+  EXPECT_TRUE(RDMHandler_AddModel(&FIRST_MODEL));
+
+  const uint8_t label[] = {'f', 'o', 'o'};
+  unique_ptr<RDMRequest> set_request(new RDMSetRequest(
+      m_controller_uid, m_our_uid, 5, 0, 0, PID_DEVICE_LABEL,
+      label, arraysize(label)));
+  unique_ptr<RDMResponse> set_response(GetResponseFromData(set_request.get()));
+
+  ola::io::ByteString response_data;
+  response_data.push_back(RDM_START_CODE);
+  EXPECT_TRUE(ola::rdm::RDMCommandSerializer::Pack(*set_response,
+                                                   &response_data));
+  auto build_response = [&](const RDMHeader*, const uint8_t*) {
+    memcpy(g_rdm_buffer, response_data.data(), response_data.size());
+    return static_cast<int>(response_data.size());
+  };
+
+  // The first request runs the model's handler.
+  EXPECT_CALL(m_first_model, Request(_, _))
+    .WillOnce(testing::Invoke(build_response));
+  EXPECT_CALL(m_sender_mock, SendResponse(true, _, 1))
+      .With(testing::Args<1, 2>(IOVecResponseIs(set_response.get())));
+  CallRDMHandler(set_request.get());
+  testing::Mock::VerifyAndClearExpectations(&m_first_model);
+  testing::Mock::VerifyAndClearExpectations(&m_sender_mock);
+
+  // A retry is answered from the cache, even if g_rdm_buffer was reused.
+  memset(g_rdm_buffer, 0, response_data.size());
+  EXPECT_CALL(m_sender_mock, SendResponse(true, _, 1))
+      .With(testing::Args<1, 2>(IOVecResponseIs(set_response.get())));
+  CallRDMHandler(set_request.get());
+  testing::Mock::VerifyAndClearExpectations(&m_sender_mock);
+
+  // A new transaction number, different param data or a different sub device
+  // is a new request.
+  const uint8_t other_label[] = {'b', 'a', 'r'};
+  // The same bytes in a different order.
+  const uint8_t reordered_label[] = {'o', 'o', 'f'};
+  unique_ptr<RDMRequest> new_requests[] = {
+    unique_ptr<RDMRequest>(new RDMSetRequest(
+        m_controller_uid, m_our_uid, 6, 0, 0, PID_DEVICE_LABEL,
+        label, arraysize(label))),
+    unique_ptr<RDMRequest>(new RDMSetRequest(
+        m_controller_uid, m_our_uid, 5, 0, 0, PID_DEVICE_LABEL,
+        other_label, arraysize(other_label))),
+    unique_ptr<RDMRequest>(new RDMSetRequest(
+        m_controller_uid, m_our_uid, 5, 0, 0, PID_DEVICE_LABEL,
+        reordered_label, arraysize(reordered_label))),
+    unique_ptr<RDMRequest>(new RDMSetRequest(
+        m_controller_uid, m_our_uid, 5, 0, 1, PID_DEVICE_LABEL,
+        label, arraysize(label))),
+  };
+  for (const auto &request : new_requests) {
+    EXPECT_CALL(m_first_model, Request(_, _)).WillOnce(Return(0));
+    CallRDMHandler(request.get());
+    testing::Mock::VerifyAndClearExpectations(&m_first_model);
+  }
+
+  // Changing the model clears the cache.
+  EXPECT_CALL(m_first_model, Deactivate()).Times(1);
+  EXPECT_CALL(m_first_model, Activate()).Times(1);
+  EXPECT_TRUE(RDMHandler_SetActiveModel(NULL_MODEL_ID));
+  EXPECT_TRUE(RDMHandler_SetActiveModel(MODEL_ONE));
+
+  EXPECT_CALL(m_first_model, Request(_, _)).WillOnce(Return(0));
+  CallRDMHandler(set_request.get());
+}
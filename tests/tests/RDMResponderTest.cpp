@@ -211,8 +211,9 @@ class RDMResponderTest : public testing::Test {
                           uint8_t *param_data) {
     lower.Pack(param_data, UID_LENGTH);
     upper.Pack(param_data + UID_LENGTH, UID_LENGTH);
-    // reset g_rdm_buffer here as well
+    // reset g_rdm_buffer & g_rdm_response here as well
     memset(g_rdm_buffer, 0, DUB_RESPONSE_LENGTH);
+    g_rdm_response = g_rdm_buffer;
   }
 
   void InitDefinition(ResponderDefinition *def) {
@@ -239,6 +240,7 @@ class RDMResponderTest : public testing::Test {
     }
 
     g_responder->def = def;
+    RDMResponder_InvalidateCache(g_responder);
   }
 
   void InitResponder() {
@@ -290,30 +292,35 @@ TEST_F(RDMResponderTest, DiscoveryUniqueBranch) {
     0xfa, 0x7f, 0xfa, 0x75, 0xba, 0x57, 0xbe, 0x75,
     0xfe, 0x57, 0xfa, 0x7d, 0xaf, 0x57, 0xfa, 0xfd
   };
-  ArrayTuple tuple(g_rdm_buffer, DUB_RESPONSE_LENGTH);
 
   uint8_t param_data[UID_LENGTH * 2];
   CreateDUBParamData(UID(0, 0), UID::AllDevices(), param_data);
   EXPECT_EQ(-DUB_RESPONSE_LENGTH,
             RDMResponder_HandleDUBRequest(param_data, arraysize(param_data)));
-  EXPECT_THAT(tuple, DataIs(expected_data, arraysize(expected_data)));
+  // The prebuilt response is used, rather than a copy in g_rdm_buffer.
+  EXPECT_EQ(g_responder->dub_response, g_rdm_response);
+  EXPECT_THAT(ArrayTuple(g_rdm_response, DUB_RESPONSE_LENGTH),
+              DataIs(expected_data, arraysize(expected_data)));
 
   CreateDUBParamData(m_our_uid, m_our_uid, param_data);
   EXPECT_EQ(-DUB_RESPONSE_LENGTH,
             RDMResponder_HandleDUBRequest(param_data, arraysize(param_data)));
-  EXPECT_THAT(tuple, DataIs(expected_data, arraysize(expected_data)));
+  EXPECT_THAT(ArrayTuple(g_rdm_response, DUB_RESPONSE_LENGTH),
+              DataIs(expected_data, arraysize(expected_data)));
 
   CreateDUBParamData(UID(m_our_uid.ManufacturerId(), 0),
                      UID::AllDevices(), param_data);
   EXPECT_EQ(-DUB_RESPONSE_LENGTH,
             RDMResponder_HandleDUBRequest(param_data, arraysize(param_data)));
-  EXPECT_THAT(tuple, DataIs(expected_data, arraysize(expected_data)));
+  EXPECT_THAT(ArrayTuple(g_rdm_response, DUB_RESPONSE_LENGTH),
+              DataIs(expected_data, arraysize(expected_data)));
 
   CreateDUBParamData(UID(m_our_uid.ManufacturerId(), 0),
                      UID::VendorcastAddress(m_our_uid), param_data);
   EXPECT_EQ(-DUB_RESPONSE_LENGTH,
             RDMResponder_HandleDUBRequest(param_data, arraysize(param_data)));
-  EXPECT_THAT(tuple, DataIs(expected_data, arraysize(expected_data)));
+  EXPECT_THAT(ArrayTuple(g_rdm_response, DUB_RESPONSE_LENGTH),
+              DataIs(expected_data, arraysize(expected_data)));
 
   // Check we don't respond if muted
   g_responder->is_muted = true;
@@ -383,6 +390,55 @@ TEST_F(RDMResponderTest, setMute) {
   EXPECT_TRUE(g_responder->is_muted);
 }
 
+TEST_F(RDMResponderTest, fastPath) {
+  InitResponder();
+
+  const uint8_t *response = nullptr;
+  auto fast_path = [&response](const RDMHeader *header,
+                               const uint8_t *param_data) {
+    return RDMResponder_HandleFastPath(header, param_data, &response);
+  };
+
+  unique_ptr<RDMDiscoveryRequest> discovery(NewDiscoveryUniqueBranchRequest(
+      m_controller_uid, UID(0, 0), UID::AllDevices(), 0));
+  unique_ptr<RDMDiscoveryRequest> unicast_mute(NewMuteRequest(
+      m_controller_uid, m_our_uid, 0));
+  unique_ptr<RDMDiscoveryRequest> broadcast_unmute(NewUnMuteRequest(
+      m_controller_uid, UID::AllDevices(), 0));
+
+  // DUBs use the prebuilt response.
+  EXPECT_EQ(-DUB_RESPONSE_LENGTH, InvokeHandler(fast_path, discovery.get()));
+  EXPECT_EQ(g_responder->dub_response, response);
+
+  // Mute responses are built without using g_rdm_buffer.
+  uint8_t control_bits[2] = {0, 0};
+  unique_ptr<RDMResponse> mute_response(GetResponseFromData(
+        unicast_mute.get(), control_bits, arraysize(control_bits)));
+
+  int size = InvokeHandler(fast_path, unicast_mute.get());
+  EXPECT_EQ(28, size);
+  EXPECT_NE(g_rdm_buffer, response);
+  EXPECT_THAT(ArrayTuple(response, size), ResponseIs(mute_response.get()));
+  EXPECT_TRUE(g_responder->is_muted);
+
+  // Once muted, DUBs aren't answered.
+  EXPECT_EQ(0, InvokeHandler(fast_path, discovery.get()));
+
+  // Broadcasts change the mute state, but aren't answered.
+  EXPECT_EQ(0, InvokeHandler(fast_path, broadcast_unmute.get()));
+  EXPECT_FALSE(g_responder->is_muted);
+
+  // Requests for other responders, and non-discovery requests, are left for
+  // the model.
+  unique_ptr<RDMDiscoveryRequest> other_mute(NewMuteRequest(
+      m_controller_uid, UID(0x7a70, 1), 0));
+  EXPECT_EQ(0, InvokeHandler(fast_path, other_mute.get()));
+  EXPECT_FALSE(g_responder->is_muted);
+
+  unique_ptr<RDMRequest> get_request(BuildGetRequest(PID_DEVICE_INFO));
+  EXPECT_EQ(0, InvokeHandler(fast_path, get_request.get()));
+}
+
 TEST_F(RDMResponderTest, testBuildNack) {
   unique_ptr<RDMRequest> request(new RDMGetRequest(
       m_controller_uid, m_our_uid, 0, 0, 0, PID_SUPPORTED_PARAMETERS,
@@ -400,8 +456,8 @@ TEST_F(RDMResponderTest, testBuildNack) {
 
 TEST_F(RDMResponderTest, testDispatch) {
   const PIDDescriptor pid_descriptors[] = {
-    {PID_IDENTIFY_DEVICE, GetIdentifyDevice, 0, (PIDCommandHandler) nullptr},
     {PID_RECORD_SENSORS, (PIDCommandHandler) nullptr, 0, ClearSensors},
+    {PID_IDENTIFY_DEVICE, GetIdentifyDevice, 0, (PIDCommandHandler) nullptr},
   };
   ResponderDefinition responder_def;
   InitDefinition(&responder_def);
@@ -518,6 +574,58 @@ TEST_F(RDMResponderTest, supportedParameters) {
   int size = InvokeHandler(RDMResponder_GetSupportedParameters,
                            request.get());
   EXPECT_THAT(ArrayTuple(g_rdm_buffer, size), ResponseIs(response.get()));
+
+  // The second request is answered from the cache.
+  size = InvokeHandler(RDMResponder_GetSupportedParameters, request.get());
+  EXPECT_THAT(ArrayTuple(g_rdm_buffer, size), ResponseIs(response.get()));
+}
+
+TEST_F(RDMResponderTest, deviceInfo) {
+  unique_ptr<RDMRequest> request = BuildGetRequest(PID_DEVICE_INFO);
+
+  ResponderDefinition responder_def;
+  InitDefinition(&responder_def);
+  responder_def.model_id = 0x0102;
+  responder_def.product_category = PRODUCT_CATEGORY_TEST_EQUIPMENT;
+  responder_def.software_version = 0x01020304;
+  RDMResponder_ResetToFactoryDefaults();
+
+  const uint8_t device_info[] = {
+    1, 0, 1, 2, 0x71, 1, 1, 2, 3, 4, 0, 2, 1, 2, 0, 1, 0, 0, 2
+  };
+  unique_ptr<RDMResponse> response(GetResponseFromData(
+        request.get(), device_info, arraysize(device_info)));
+
+  int size = InvokeHandler(RDMResponder_GetDeviceInfo, request.get());
+  EXPECT_THAT(ArrayTuple(g_rdm_buffer, size), ResponseIs(response.get()));
+
+  // A cached response is still patched with the new transaction number.
+  request.reset(new RDMGetRequest(
+      m_controller_uid, m_our_uid, 1, 0, 0, PID_DEVICE_INFO, nullptr, 0));
+  response.reset(GetResponseFromData(
+        request.get(), device_info, arraysize(device_info)));
+  size = InvokeHandler(RDMResponder_GetDeviceInfo, request.get());
+  EXPECT_THAT(ArrayTuple(g_rdm_buffer, size), ResponseIs(response.get()));
+
+  // Changing the start address & personality invalidates the cache.
+  uint8_t start_address[] = { 0, 10 };
+  request = BuildSetRequest(
+      PID_DMX_START_ADDRESS, start_address, arraysize(start_address));
+  InvokeHandler(RDMResponder_SetDMXStartAddress, request.get());
+
+  uint8_t personality = 2;
+  request = BuildSetRequest(
+      PID_DMX_PERSONALITY, &personality, sizeof(personality));
+  InvokeHandler(RDMResponder_SetDMXPersonality, request.get());
+
+  const uint8_t updated_device_info[] = {
+    1, 0, 1, 2, 0x71, 1, 1, 2, 3, 4, 0, 2, 2, 2, 0, 10, 0, 0, 2
+  };
+  request = BuildGetRequest(PID_DEVICE_INFO);
+  response.reset(GetResponseFromData(
+        request.get(), updated_device_info, arraysize(updated_device_info)));
+  size = InvokeHandler(RDMResponder_GetDeviceInfo, request.get());
+  EXPECT_THAT(ArrayTuple(g_rdm_buffer, size), ResponseIs(response.get()));
 }
 
 TEST_F(RDMResponderTest, productDetailIds) {
@@ -30,8 +30,10 @@
 #include "RDMHandlerMock.h"
 #include "SPIRGBMock.h"
 
+using ::testing::DoAll;
 using ::testing::IgnoreResult;
 using ::testing::Return;
+using ::testing::SetArgPointee;
 using ::testing::StrictMock;
 using ::testing::WithArgs;
 using ::testing::_;
@@ -229,6 +231,54 @@ TEST_F(ResponderTest, paramDataLenMismatch) {
   EXPECT_EQ(2, ReceiverCounters_RDMParamDataLenInvalidCounter());
 }
 
+TEST_F(ResponderTest, fastPath) {
+  const uint8_t dub_response[] = {0xfe, 0xfe, 0xaa};
+  EXPECT_CALL(handler_mock, HandleFastPath(
+        reinterpret_cast<const RDMHeader*>(RDM_FRAME), NULL, _))
+    .WillOnce(DoAll(
+          SetArgPointee<2>(static_cast<const uint8_t*>(dub_response)),
+          Return(-static_cast<int>(arraysize(dub_response)))));
+
+  const uint8_t *response = NULL;
+  EXPECT_EQ(-static_cast<int>(arraysize(dub_response)),
+            Responder_HandleFastPath(RDM_FRAME, arraysize(RDM_FRAME),
+                                     &response));
+  EXPECT_EQ(dub_response, response);
+
+  // Anything that fails the checks is left for Responder_Receive().
+  EXPECT_EQ(0, Responder_HandleFastPath(RDM_FRAME, arraysize(RDM_FRAME) - 1,
+                                        &response));
+
+  const uint8_t bad_checksum[] = {
+    0xcc, 0x01, 0x18, 0x7a, 0x70, 0xff, 0xff, 0xff, 0xff, 0x7a, 0x70, 0x12,
+    0x34, 0x56, 0x78, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x02, 0x00,
+    0xAB, 0xCD
+  };
+  EXPECT_EQ(0, Responder_HandleFastPath(bad_checksum, arraysize(bad_checksum),
+                                        &response));
+
+  const uint8_t bad_sub_start_code[] = {
+    0xcc, 0x02, 0x18, 0x7a, 0x70, 0x00, 0x00, 0x00, 0x00, 0x7a, 0x70, 0x12,
+    0x34, 0x56, 0x78, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x02, 0x00,
+    0x03, 0xe0
+  };
+  EXPECT_EQ(0, Responder_HandleFastPath(bad_sub_start_code,
+                                        arraysize(bad_sub_start_code),
+                                        &response));
+
+  const uint8_t bad_pdl[] = {
+    0xcc, 0x01, 0x18, 0x7a, 0x70, 0x00, 0x00, 0x00, 0x00, 0x7a, 0x70, 0x12,
+    0x34, 0x56, 0x78, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x02, 0x01,
+    0x03, 0xe0
+  };
+  EXPECT_EQ(0, Responder_HandleFastPath(bad_pdl, arraysize(bad_pdl),
+                                        &response));
+
+  // The counters are only updated by Responder_Receive().
+  EXPECT_EQ(0, ReceiverCounters_RDMFrames());
+  EXPECT_EQ(0, ReceiverCounters_RDMChecksumInvalidCounter());
+}
+
 // Send an RDM frame that's too short, that also contains a valid checksum
 
 TEST_F(ResponderTest, nonRxOp) {
@@ -24,17 +24,23 @@
 #include <ola/rdm/RDMCommand.h>
 #include <ola/rdm/RDMCommandSerializer.h>
 #include <ola/rdm/RDMEnums.h>
+#include <string.h>
 
+#include <algorithm>
 #include <vector>
 
 #include "Array.h"
+#include "app_settings.h"
 #include "coarse_timer.h"
 #include "constants.h"
 #include "dmx_spec.h"
+#include "plib_ports_mock.h"
+#include "rdm.h"
 #include "setting_macros.h"
 #include "transceiver.h"
 
 #include "tests/sim/InterruptController.h"
+#include "tests/sim/PeripheralDMA.h"
 #include "tests/sim/PeripheralInputCapture.h"
 #include "tests/sim/PeripheralTimer.h"
 #include "tests/sim/PeripheralUART.h"
@@ -45,6 +51,7 @@ using ::testing::AllOf;
 using ::testing::AnyOf;
 using ::testing::Contains;
 using ::testing::DoAll;
+using ::testing::Each;
 using ::testing::ElementsAreArray;
 using ::testing::Ge;
 using ::testing::Gt;
@@ -53,6 +60,8 @@ using ::testing::InvokeWithoutArgs;
 using ::testing::IsEmpty;
 using ::testing::Le;
 using ::testing::Lt;
+using ::testing::NiceMock;
+using ::testing::Not;
 using ::testing::Return;
 using ::testing::SizeIs;
 using ::testing::StrictMock;
@@ -75,6 +84,8 @@ extern "C" {
 void InputCaptureEvent(void);
 void Transceiver_TimerEvent();
 void Transceiver_UARTEvent();
+void Transceiver_TXDMAEvent();
+void Transceiver_RXDMAEvent();
 uint8_t Transceiver_FreeBufferCount();
 
 
@@ -151,6 +162,12 @@ MATCHER_P2(MatchesFrame, expected_data, expected_length, "") {
   return true;
 }
 
+// Check that a vector is a prefix of the expected data.
+MATCHER_P2(IsPrefixOf, expected_data, expected_length, "") {
+  return arg.size() <= expected_length &&
+         std::equal(arg.begin(), arg.end(), expected_data);
+}
+
 // Capture TransceiverEvents and store the data to a vector of bytes.
 ACTION_P(AppendTo, output) {
   for (unsigned int i = output->size(); i < arg0->length; i++) {
@@ -159,6 +176,40 @@ ACTION_P(AppendTo, output) {
   return true;
 }
 
+// Capture the data from each TransceiverEvent.
+ACTION_P(CopyTo, output) {
+  output->push_back(vector<uint8_t>(arg0->data, arg0->data + arg0->length));
+  return true;
+}
+
+// Queue a response from the RX callback, as the responder does.
+ACTION_P2(QueueRDMResponse, iovec, queued) {
+  *queued = Transceiver_QueueRDMResponse(true, iovec, 1);
+  return true;
+}
+
+// A frame record from a T_OP_SNIFFER event.
+struct SnifferRecord {
+  SnifferFrameHeader header;
+  vector<uint8_t> data;
+};
+
+// Split a T_OP_SNIFFER event into records.
+ACTION_P(AppendSnifferRecords, output) {
+  unsigned int offset = 0u;
+  while (offset + sizeof(SnifferFrameHeader) <= arg0->length) {
+    SnifferRecord record;
+    memcpy(&record.header, arg0->data + offset, sizeof(record.header));
+    offset += sizeof(record.header);
+    ASSERT_LE(offset + record.header.length, arg0->length);
+    record.data.assign(arg0->data + offset,
+                       arg0->data + offset + record.header.length);
+    offset += record.header.length;
+    output->push_back(record);
+  }
+  EXPECT_EQ(offset, arg0->length);
+}
+
 // This mock is used to capture Transceiver event handlers.
 class MockEventHandler {
  public:
@@ -174,18 +225,23 @@ bool EventHandler(const TransceiverEvent *event) {
   return true;
 }
 
-class TransceiverTest : public testing::Test {
+// The tests are run twice, once with the USART ISR feeding the transmitter
+// & draining the receiver and once using DMA.
+class TransceiverTest : public testing::TestWithParam<bool> {
  public:
   TransceiverTest()
       : m_tx_callback(NewCallback(this, &TransceiverTest::GotByte)),
-        m_callback(ola::NewCallback(&Transceiver_Tasks)),
+        m_callback(NewCallback(this, &TransceiverTest::RunTasks)),
         m_simulator(kClockSpeed),  // limit to 1s of CPU runtime.
         m_timer(&m_simulator, &m_interrupt_controller),
         m_ic(&m_simulator, &m_interrupt_controller),
         m_uart(&m_simulator, &m_interrupt_controller, m_tx_callback.get()),
+        m_dma(&m_simulator, &m_interrupt_controller, &m_uart),
         m_generator(&m_simulator, &m_ic, &m_uart, AS_IC_ID(2),
                     AS_USART_ID(1), kClockSpeed, kBaudRate),
         m_stop_after(-1),
+        m_hold_tasks_start(0),
+        m_hold_tasks_end(0),
         m_controller_uid(0x7a70, 0),
         m_device_uid(0x7a70, 1) {
   }
@@ -193,6 +249,7 @@ class TransceiverTest : public testing::Test {
   void GotByte(USART_MODULE_ID uart_id, uint8_t byte) {
     if (uart_id == AS_USART_ID(1)) {
       m_tx_bytes.push_back(byte);
+      m_tx_times.push_back(m_simulator.Clock());
       if (m_stop_after > 0 &&
           static_cast<int>(m_tx_bytes.size()) == m_stop_after) {
         m_simulator.Stop();
@@ -206,8 +263,14 @@ class TransceiverTest : public testing::Test {
     PLIB_TMR_SetMock(&m_timer);
     PLIB_IC_SetMock(&m_ic);
     PLIB_USART_SetMock(&m_uart);
+    PLIB_DMA_SetMock(&m_dma);
+    PLIB_PORTS_SetMock(&m_ports);
     SYS_INT_SetMock(&m_interrupt_controller);
 
+    // Record when the transceiver starts a break.
+    ON_CALL(m_ports, PinClear(_, PORT_CHANNEL_F, PORTS_BIT_POS_8))
+      .WillByDefault(InvokeWithoutArgs(this, &TransceiverTest::BreakStarted));
+
     m_interrupt_controller.RegisterISR(INT_SOURCE_TIMER_1,
         NewCallback(&CoarseTimer_TimerEvent));
     m_interrupt_controller.RegisterISR(INT_SOURCE_TIMER_3,
@@ -220,6 +283,12 @@ class TransceiverTest : public testing::Test {
         NewCallback(&Transceiver_UARTEvent));
     m_interrupt_controller.RegisterISR(INT_SOURCE_USART_1_RECEIVE,
         NewCallback(&Transceiver_UARTEvent));
+    m_interrupt_controller.RegisterISR(
+        AS_DMA_INTERRUPT_SOURCE(TRANSCEIVER_TX_DMA_CHANNEL),
+        NewCallback(&Transceiver_TXDMAEvent));
+    m_interrupt_controller.RegisterISR(
+        AS_DMA_INTERRUPT_SOURCE(TRANSCEIVER_RX_DMA_CHANNEL),
+        NewCallback(&Transceiver_RXDMAEvent));
 
     m_simulator.AddTask(m_callback.get());
 
@@ -241,9 +310,9 @@ class TransceiverTest : public testing::Test {
       // if we're in responder mode, then one buffer is used for the incoming
       // frame.
       if (Transceiver_GetMode() == T_MODE_RESPONDER) {
-        EXPECT_EQ(1, Transceiver_FreeBufferCount());
+        EXPECT_EQ(TRANSCEIVER_QUEUE_DEPTH, Transceiver_FreeBufferCount());
       } else {
-        EXPECT_EQ(2, Transceiver_FreeBufferCount());
+        EXPECT_EQ(TRANSCEIVER_QUEUE_DEPTH + 1, Transceiver_FreeBufferCount());
       }
     }
 
@@ -251,6 +320,8 @@ class TransceiverTest : public testing::Test {
     PLIB_TMR_SetMock(nullptr);
     PLIB_IC_SetMock(nullptr);
     PLIB_USART_SetMock(nullptr);
+    PLIB_DMA_SetMock(nullptr);
+    PLIB_PORTS_SetMock(nullptr);
     SYS_INT_SetMock(nullptr);
 
     m_simulator.RemoveTask(m_callback.get());
@@ -274,6 +345,16 @@ class TransceiverTest : public testing::Test {
       .timer_vector = AS_TIMER_INTERRUPT_VECTOR(3),
       .timer_source = AS_TIMER_INTERRUPT_SOURCE(3),
       .input_capture_timer = AS_IC_TMR_ID(3),
+      .tx_dma = GetParam(),
+      .tx_dma_channel = AS_DMA_CHANNEL(TRANSCEIVER_TX_DMA_CHANNEL),
+      .tx_dma_vector = AS_DMA_INTERRUPT_VECTOR(TRANSCEIVER_TX_DMA_CHANNEL),
+      .tx_dma_source = AS_DMA_INTERRUPT_SOURCE(TRANSCEIVER_TX_DMA_CHANNEL),
+      .tx_dma_trigger = AS_USART_DMA_TX_TRIGGER(1),
+      .rx_dma = GetParam(),
+      .rx_dma_channel = AS_DMA_CHANNEL(TRANSCEIVER_RX_DMA_CHANNEL),
+      .rx_dma_vector = AS_DMA_INTERRUPT_VECTOR(TRANSCEIVER_RX_DMA_CHANNEL),
+      .rx_dma_source = AS_DMA_INTERRUPT_SOURCE(TRANSCEIVER_RX_DMA_CHANNEL),
+      .rx_dma_trigger = AS_USART_DMA_RX_TRIGGER(1),
     };
     return settings;
   }
@@ -282,6 +363,28 @@ class TransceiverTest : public testing::Test {
     m_stop_after = byte_count;
   }
 
+  // Don't run Transceiver_Tasks() between start and end, in microseconds.
+  void HoldTasks(uint32_t start, uint32_t end) {
+    m_hold_tasks_start = static_cast<uint64_t>(start) * kClockSpeed / 1000000;
+    m_hold_tasks_end = static_cast<uint64_t>(end) * kClockSpeed / 1000000;
+  }
+
+  void RunTasks() {
+    if (m_simulator.Clock() < m_hold_tasks_start ||
+        m_simulator.Clock() >= m_hold_tasks_end) {
+      Transceiver_Tasks();
+    }
+  }
+
+  void BreakStarted() {
+    m_break_times.push_back(m_simulator.Clock());
+  }
+
+  vector<uint8_t> DiscoveryRequest(uint16_t pid, uint8_t last_slot);
+  double FastPathResponseDelay(const vector<uint8_t> &request);
+  static int FastPath(const uint8_t *frame, unsigned int size,
+                      const uint8_t **response);
+
  protected:
   std::unique_ptr<PeripheralUART::TXCallback> m_tx_callback;
   std::unique_ptr<ola::Callback0<void>> m_callback;
@@ -291,8 +394,12 @@ class TransceiverTest : public testing::Test {
   PeripheralTimer m_timer;
   PeripheralInputCapture m_ic;
   PeripheralUART m_uart;
+  PeripheralDMA m_dma;
   SignalGenerator m_generator;
+  NiceMock<MockPeripheralPorts> m_ports;
   int m_stop_after;
+  uint64_t m_hold_tasks_start;
+  uint64_t m_hold_tasks_end;
 
   UID m_controller_uid;
   UID m_device_uid;
@@ -300,9 +407,13 @@ class TransceiverTest : public testing::Test {
   StrictMock<MockEventHandler> m_event_handler;
 
   vector<uint8_t> m_tx_bytes;
+  vector<uint64_t> m_tx_times;  // The clock at the end of each TX byte.
+  vector<uint64_t> m_break_times;  // The clock at the start of each TX break.
 
   void SwitchToControllerMode();
   void SwitchToSelfTestMode();
+  void SwitchToSnifferMode();
+  void LeaveSnifferMode();
 
   static const uint32_t kClockSpeed = 80000000;
   static const uint32_t kBaudRate = 250000;
@@ -339,6 +450,8 @@ const uint8_t TransceiverTest::kRDMResponse[] = {
   0xce
 };
 
+INSTANTIATE_TEST_CASE_P(DMA, TransceiverTest, ::testing::Bool());
+
 void TransceiverTest::SwitchToControllerMode() {
   uint8_t token = 1;
   EXPECT_CALL(m_event_handler,
@@ -362,7 +475,135 @@ void TransceiverTest::SwitchToSelfTestMode() {
   m_simulator.Run();
 }
 
-TEST_F(TransceiverTest, controllerTxDMX) {
+void TransceiverTest::SwitchToSnifferMode() {
+  uint8_t token = 1;
+  EXPECT_CALL(m_event_handler,
+              Run(EventIs(token, T_OP_MODE_CHANGE, T_RESULT_OK, 0)))
+    .WillOnce(DoAll(InvokeWithoutArgs(&m_simulator, &Simulator::Stop),
+                    Return(true)));
+
+  EXPECT_TRUE(Transceiver_SetMode(T_MODE_SNIFFER, token));
+  m_simulator.Run();
+}
+
+/*
+ * Build a DUB or DISC_MUTE request from the controller to the device. The
+ * transaction number is picked so that the last slot, the low byte of the
+ * checksum, has the given value.
+ */
+vector<uint8_t> TransceiverTest::DiscoveryRequest(uint16_t pid,
+                                                  uint8_t last_slot) {
+  const uint8_t header[] = {
+    RDM_START_CODE, RDM_SUB_START_CODE, 0,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff,  // dest UID
+    0x7a, 0x70, 0, 0, 0, 0,  // src UID
+    0, 1, 0, 0, 0,  // transaction number, port, message count & sub device
+    DISCOVERY_COMMAND, static_cast<uint8_t>(pid >> 8),
+    static_cast<uint8_t>(pid & 0xff), 0
+  };
+  vector<uint8_t> request(header, header + arraysize(header));
+  if (pid == PID_DISC_UNIQUE_BRANCH) {
+    // The DUB request is broadcast, and covers the whole UID space.
+    for (unsigned int i = 0; i < 2 * UID_LENGTH; i++) {
+      request.push_back(i < UID_LENGTH ? 0x00 : 0xff);
+    }
+    request[RDM_PARAM_DATA_OFFSET - 1] = 2 * UID_LENGTH;
+  } else {
+    m_device_uid.Pack(&request[3], UID_LENGTH);
+  }
+  request[2] = request.size();
+
+  uint16_t sum = 0;
+  for (uint8_t byte : request) {
+    sum += byte;
+  }
+  // Offset 15 is the transaction number.
+  request[15] = static_cast<uint8_t>(last_slot - sum);
+  sum += request[15];
+  request.push_back(sum >> 8);
+  request.push_back(sum & 0xff);
+  return request;
+}
+
+/*
+ * Send a request to the responder, with the fast path enabled, and return the
+ * time from the end of the request to the start of the response, in
+ * microseconds. The break starts 100us after the simulator starts.
+ */
+double TransceiverTest::FastPathResponseDelay(const vector<uint8_t> &request) {
+  m_tx_bytes.clear();
+  m_tx_times.clear();
+  m_break_times.clear();
+
+  bool is_dub = request[22] == PID_DISC_UNIQUE_BRANCH;
+  const uint8_t *response = NULL;
+  unsigned int response_size = abs(FastPath(request.data(), request.size(),
+                                            &response));
+
+  m_generator.Reset();
+  m_generator.SetStopOnComplete(false);
+  m_generator.AddDelay(100);
+  m_generator.AddBreak(176);
+  m_generator.AddMark(12);
+  m_generator.AddFrame(request.data(), request.size());
+  StopAfter(response_size);
+  m_simulator.Run();
+  HoldTasks(0, 0);
+
+  EXPECT_THAT(m_tx_bytes, MatchesFrame(response, response_size));
+  if (m_tx_times.empty()) {
+    return 0;
+  }
+
+  // Each slot is 11 bits of 4us.
+  uint64_t request_end = (100 + 176 + 12 + 44 * request.size()) *
+                         (kClockSpeed / 1000000);
+  uint64_t response_start = m_tx_times[0] - 44 * (kClockSpeed / 1000000);
+  if (!is_dub) {
+    EXPECT_THAT(m_break_times, SizeIs(1));
+    if (m_break_times.empty()) {
+      return 0;
+    }
+    response_start = m_break_times[0];
+  }
+  return static_cast<double>(response_start - request_end) * 1000000 /
+         kClockSpeed;
+}
+
+/*
+ * Answer DUB and DISC_MUTE requests with a canned response. The transceiver
+ * doesn't look at the response, only the timing matters.
+ */
+int TransceiverTest::FastPath(const uint8_t *frame, unsigned int size,
+                              const uint8_t **response) {
+  if (size <= RDM_PARAM_DATA_OFFSET) {
+    return 0;
+  }
+  switch (frame[22]) {
+    case PID_DISC_UNIQUE_BRANCH:
+      *response = kDUBResponse;
+      return -static_cast<int>(arraysize(kDUBResponse));
+    case PID_DISC_MUTE:
+      *response = kRDMResponse;
+      return arraysize(kRDMResponse);
+    default:
+      return 0;
+  }
+}
+
+// Return to responder mode, which releases the buffers held by the sniffer.
+void TransceiverTest::LeaveSnifferMode() {
+  uint8_t token = 2;
+  EXPECT_CALL(m_event_handler,
+              Run(EventIs(token, T_OP_MODE_CHANGE, T_RESULT_OK, 0)))
+    .WillOnce(DoAll(InvokeWithoutArgs(&m_simulator, &Simulator::Stop),
+                    Return(true)));
+
+  EXPECT_TRUE(Transceiver_SetMode(T_MODE_RESPONDER, token));
+  m_simulator.Run();
+}
+
+TEST_P(TransceiverTest, controllerTxDMX) {
   SwitchToControllerMode();
 
   uint8_t token = 1;
@@ -377,7 +618,7 @@ TEST_F(TransceiverTest, controllerTxDMX) {
               MatchesFrameWithSC(NULL_START_CODE, kDMX1, arraysize(kDMX1)));
 }
 
-TEST_F(TransceiverTest, controllerTxEmptyDMX) {
+TEST_P(TransceiverTest, controllerTxEmptyDMX) {
   SwitchToControllerMode();
 
   uint8_t token = 1;
@@ -393,7 +634,7 @@ TEST_F(TransceiverTest, controllerTxEmptyDMX) {
   EXPECT_THAT(m_tx_bytes, MatchesFrameWithSC(NULL_START_CODE, dmx, 0ul));
 }
 
-TEST_F(TransceiverTest, controllerTxJumboDMX) {
+TEST_P(TransceiverTest, controllerTxJumboDMX) {
   SwitchToControllerMode();
 
   uint8_t dmx[1024];
@@ -411,7 +652,7 @@ TEST_F(TransceiverTest, controllerTxJumboDMX) {
   EXPECT_THAT(m_tx_bytes, MatchesFrameWithSC(NULL_START_CODE, dmx, 512ul));
 }
 
-TEST_F(TransceiverTest, controllerTxASCFrame) {
+TEST_P(TransceiverTest, controllerTxASCFrame) {
   const uint8_t ASC = 0xdd;
   SwitchToControllerMode();
 
@@ -429,7 +670,73 @@ TEST_F(TransceiverTest, controllerTxASCFrame) {
               MatchesFrameWithSC(ASC, asc_frame, arraysize(asc_frame)));
 }
 
-TEST_F(TransceiverTest, controllerTxRDMBroadcast) {
+// Check that queued operations are sent in order.
+TEST_P(TransceiverTest, controllerQueue) {
+  Transceiver_SetRDMBroadcastTimeout(0);
+  SwitchToControllerMode();
+
+  testing::InSequence seq;
+  uint8_t token = 1;
+  EXPECT_CALL(m_event_handler,
+              Run(EventIs(token, T_OP_TX_ONLY, T_RESULT_OK, 0)))
+    .WillOnce(Return(true));
+  EXPECT_TRUE(Transceiver_QueueDMX(token, kDMX1, arraysize(kDMX1)));
+
+  token++;
+  EXPECT_CALL(m_event_handler,
+              Run(EventIs(token, T_OP_RDM_BROADCAST, T_RESULT_OK, 0)))
+    .WillOnce(Return(true));
+  EXPECT_TRUE(Transceiver_QueueRDMRequest(token, kRDMRequest,
+                                          arraysize(kRDMRequest), true));
+
+  // A DMX frame queued behind the RDM request keeps its position, rather than
+  // replacing the first frame.
+  token++;
+  EXPECT_CALL(m_event_handler,
+              Run(EventIs(token, T_OP_TX_ONLY, T_RESULT_OK, 0)))
+    .WillOnce(Return(true));
+  EXPECT_TRUE(Transceiver_QueueDMX(token, kDMX3, arraysize(kDMX3)));
+
+  // Fill the remainder of the queue.
+  for (unsigned int i = 3; i < TRANSCEIVER_QUEUE_DEPTH; i++) {
+    token++;
+    EXPECT_CALL(m_event_handler,
+                Run(EventIs(token, T_OP_TX_ONLY, T_RESULT_OK, 0)))
+      .WillOnce(Return(true));
+    EXPECT_TRUE(Transceiver_QueueASC(token, 0xdd, kDMX3, arraysize(kDMX3)));
+  }
+  EXPECT_FALSE(Transceiver_QueueDMX(token + 1, kDMX2, arraysize(kDMX2)));
+
+  token++;
+  EXPECT_CALL(m_event_handler,
+              Run(EventIs(token, T_OP_TX_ONLY, T_RESULT_OK, 0)))
+    .WillOnce(DoAll(InvokeWithoutArgs(&m_simulator, &Simulator::Stop),
+                    Return(true)));
+
+  // Run until the first frame starts, which frees up a slot in the queue.
+  StopAfter(1);
+  m_simulator.Run();
+  EXPECT_TRUE(Transceiver_QueueDMX(token, kDMX2, arraysize(kDMX2)));
+  StopAfter(-1);
+  m_simulator.Run();
+
+  vector<uint8_t> first_frame(m_tx_bytes.begin(),
+                              m_tx_bytes.begin() + arraysize(kDMX1) + 1);
+  EXPECT_THAT(first_frame,
+              MatchesFrameWithSC(NULL_START_CODE, kDMX1, arraysize(kDMX1)));
+  unsigned int third_start = arraysize(kDMX1) + arraysize(kRDMRequest) + 2;
+  vector<uint8_t> third_frame(
+      m_tx_bytes.begin() + third_start,
+      m_tx_bytes.begin() + third_start + arraysize(kDMX3) + 1);
+  EXPECT_THAT(third_frame,
+              MatchesFrameWithSC(NULL_START_CODE, kDMX3, arraysize(kDMX3)));
+  vector<uint8_t> last_frame(m_tx_bytes.end() - arraysize(kDMX2) - 1,
+                             m_tx_bytes.end());
+  EXPECT_THAT(last_frame,
+              MatchesFrameWithSC(NULL_START_CODE, kDMX2, arraysize(kDMX2)));
+}
+
+TEST_P(TransceiverTest, controllerTxRDMBroadcast) {
   SwitchToControllerMode();
 
   uint8_t token = 1;
@@ -446,7 +753,7 @@ TEST_F(TransceiverTest, controllerTxRDMBroadcast) {
       MatchesFrameWithSC(RDM_START_CODE, kRDMRequest, arraysize(kRDMRequest)));
 }
 
-TEST_F(TransceiverTest, controllerTxRDMBroadcastNoListen) {
+TEST_P(TransceiverTest, controllerTxRDMBroadcastNoListen) {
   Transceiver_SetRDMBroadcastTimeout(0);
   SwitchToControllerMode();
 
@@ -464,7 +771,7 @@ TEST_F(TransceiverTest, controllerTxRDMBroadcastNoListen) {
       MatchesFrameWithSC(RDM_START_CODE, kRDMRequest, arraysize(kRDMRequest)));
 }
 
-TEST_F(TransceiverTest, controllerRDMDUBNoResponse) {
+TEST_P(TransceiverTest, controllerRDMDUBNoResponse) {
   SwitchToControllerMode();
 
   uint8_t token = 1;
@@ -481,7 +788,7 @@ TEST_F(TransceiverTest, controllerRDMDUBNoResponse) {
       MatchesFrameWithSC(RDM_START_CODE, kDUBRequest, arraysize(kDUBRequest)));
 }
 
-TEST_F(TransceiverTest, controllerRDMDUBWithResponse) {
+TEST_P(TransceiverTest, controllerRDMDUBWithResponse) {
   SwitchToControllerMode();
 
   uint8_t token = 1;
@@ -507,7 +814,7 @@ TEST_F(TransceiverTest, controllerRDMDUBWithResponse) {
   m_simulator.Run();
 }
 
-TEST_F(TransceiverTest, controllerRDMDUBWithLargeResponse) {
+TEST_P(TransceiverTest, controllerRDMDUBWithLargeResponse) {
   SwitchToControllerMode();
 
   uint8_t token = 1;
@@ -539,7 +846,7 @@ TEST_F(TransceiverTest, controllerRDMDUBWithLargeResponse) {
   m_simulator.Run();
 }
 
-TEST_F(TransceiverTest, controllerRDMGetTimeout) {
+TEST_P(TransceiverTest, controllerRDMGetTimeout) {
   SwitchToControllerMode();
 
   uint8_t token = 1;
@@ -558,7 +865,7 @@ TEST_F(TransceiverTest, controllerRDMGetTimeout) {
                            arraysize(kRDMRequest)));
 }
 
-TEST_F(TransceiverTest, controllerRDMGetWithResponse) {
+TEST_P(TransceiverTest, controllerRDMGetWithResponse) {
   SwitchToControllerMode();
 
   uint8_t token = 1;
@@ -586,7 +893,41 @@ TEST_F(TransceiverTest, controllerRDMGetWithResponse) {
   m_simulator.Run();
 }
 
-TEST_F(TransceiverTest, controllerRDMGetWithJumboResponse) {
+// Check the end of the response is detected without waiting for _Tasks().
+TEST_P(TransceiverTest, controllerRDMGetWithResponseAndTasksHeld) {
+  SwitchToControllerMode();
+
+  uint8_t token = 1;
+  StopAfter(1 + arraysize(kRDMRequest));
+  Transceiver_QueueRDMRequest(token, kRDMRequest, arraysize(kRDMRequest),
+                              false);
+  m_simulator.Run();
+
+  // The responder sends extra data after the checksum, which is ignored.
+  vector<uint8_t> response(kRDMResponse,
+                           kRDMResponse + arraysize(kRDMResponse));
+  response.push_back(0x55);
+  response.push_back(0xaa);
+
+  // The response ends at 1552us.
+  HoldTasks(0, 2000);
+  m_generator.AddDelay(176);
+  m_generator.AddBreak(176);
+  m_generator.AddMark(12);
+  m_generator.AddFrame(response.data(), response.size());
+
+  vector<uint8_t> rx_data;
+  EXPECT_CALL(m_event_handler,
+              Run(EventIs(token, T_OP_RDM_WITH_RESPONSE, T_RESULT_RX_DATA,
+                          arraysize(kRDMResponse))))
+    .WillOnce(DoAll(InvokeWithoutArgs(&m_simulator, &Simulator::Stop),
+                    AppendTo(&rx_data)));
+
+  m_simulator.Run();
+  EXPECT_THAT(rx_data, ElementsAreArray(kRDMResponse, arraysize(kRDMResponse)));
+}
+
+TEST_P(TransceiverTest, controllerRDMGetWithJumboResponse) {
   SwitchToControllerMode();
 
   uint8_t response[600];
@@ -619,7 +960,7 @@ TEST_F(TransceiverTest, controllerRDMGetWithJumboResponse) {
   m_simulator.Run();
 }
 
-TEST_F(TransceiverTest, controllerRDMGetInterslotTimeout) {
+TEST_P(TransceiverTest, controllerRDMGetInterslotTimeout) {
   vector<uint8_t> rx_data;
   const uint8_t expected_frame[] = {RDM_START_CODE, 10, 20, 30};
 
@@ -664,7 +1005,7 @@ TEST_F(TransceiverTest, controllerRDMGetInterslotTimeout) {
               ElementsAreArray(expected_frame, arraysize(expected_frame)));
 }
 
-TEST_F(TransceiverTest, controllerRDMGetWithShortBreak) {
+TEST_P(TransceiverTest, controllerRDMGetWithShortBreak) {
   SwitchToControllerMode();
 
   uint8_t token = 1;
@@ -692,7 +1033,7 @@ TEST_F(TransceiverTest, controllerRDMGetWithShortBreak) {
   m_simulator.Run();
 }
 
-TEST_F(TransceiverTest, controllerRDMGetWithLongBreak) {
+TEST_P(TransceiverTest, controllerRDMGetWithLongBreak) {
   SwitchToControllerMode();
 
   uint8_t token = 1;
@@ -720,7 +1061,7 @@ TEST_F(TransceiverTest, controllerRDMGetWithLongBreak) {
   m_simulator.Run();
 }
 
-TEST_F(TransceiverTest, controllerRDMGetWithNoMark) {
+TEST_P(TransceiverTest, controllerRDMGetWithNoMark) {
   SwitchToControllerMode();
 
   uint8_t token = 1;
@@ -746,7 +1087,7 @@ TEST_F(TransceiverTest, controllerRDMGetWithNoMark) {
   m_simulator.Run();
 }
 
-TEST_F(TransceiverTest, controllerRDMGetWithNoData) {
+TEST_P(TransceiverTest, controllerRDMGetWithNoData) {
   SwitchToControllerMode();
 
   uint8_t token = 1;
@@ -773,8 +1114,235 @@ TEST_F(TransceiverTest, controllerRDMGetWithNoData) {
   m_simulator.Run();
 }
 
+// Check the resident DMX frame is retransmitted when refresh is enabled.
+TEST_P(TransceiverTest, controllerDMXRefresh) {
+  SwitchToControllerMode();
+  EXPECT_TRUE(Transceiver_SetDMXRefreshInterval(1));
+
+  // Only the first frame generates an event.
+  uint8_t token = 1;
+  EXPECT_CALL(m_event_handler,
+              Run(EventIs(token, T_OP_TX_ONLY, T_RESULT_OK, 0)))
+    .WillOnce(Return(true));
+
+  const unsigned int frame_size = arraysize(kDMX1) + 1;
+  StopAfter(3 * frame_size);
+  EXPECT_TRUE(Transceiver_QueueDMX(token, kDMX1, arraysize(kDMX1)));
+  m_simulator.Run();
+
+  ASSERT_EQ(3 * frame_size, m_tx_bytes.size());
+  for (unsigned int i = 0; i < 3; i++) {
+    vector<uint8_t> frame(m_tx_bytes.begin() + i * frame_size,
+                          m_tx_bytes.begin() + (i + 1) * frame_size);
+    EXPECT_THAT(frame,
+                MatchesFrameWithSC(NULL_START_CODE, kDMX1, arraysize(kDMX1)));
+  }
+}
+
+// Check a new DMX frame replaces the resident frame.
+TEST_P(TransceiverTest, controllerDMXRefreshReplace) {
+  SwitchToControllerMode();
+  EXPECT_TRUE(Transceiver_SetDMXRefreshInterval(1));
+
+  uint8_t token = 1;
+  EXPECT_CALL(m_event_handler,
+              Run(EventIs(token, T_OP_TX_ONLY, T_RESULT_OK, 0)))
+    .WillOnce(DoAll(InvokeWithoutArgs(&m_simulator, &Simulator::Stop),
+                    Return(true)));
+  EXPECT_TRUE(Transceiver_QueueDMX(token, kDMX1, arraysize(kDMX1)));
+  m_simulator.Run();
+
+  token++;
+  EXPECT_CALL(m_event_handler,
+              Run(EventIs(token, T_OP_TX_ONLY, T_RESULT_OK, 0)))
+    .WillOnce(Return(true));
+
+  const unsigned int frame_size = arraysize(kDMX2) + 1;
+  m_tx_bytes.clear();
+  StopAfter(2 * frame_size);
+  EXPECT_TRUE(Transceiver_QueueDMX(token, kDMX2, arraysize(kDMX2)));
+  m_simulator.Run();
+
+  ASSERT_EQ(2 * frame_size, m_tx_bytes.size());
+  for (unsigned int i = 0; i < 2; i++) {
+    vector<uint8_t> frame(m_tx_bytes.begin() + i * frame_size,
+                          m_tx_bytes.begin() + (i + 1) * frame_size);
+    EXPECT_THAT(frame,
+                MatchesFrameWithSC(NULL_START_CODE, kDMX2, arraysize(kDMX2)));
+  }
+}
+
+// Check patches are applied to the resident DMX frame.
+TEST_P(TransceiverTest, controllerDMXRefreshPatch) {
+  SwitchToControllerMode();
+  EXPECT_TRUE(Transceiver_SetDMXRefreshInterval(1));
+
+  uint8_t token = 1;
+  EXPECT_CALL(m_event_handler,
+              Run(EventIs(token, T_OP_TX_ONLY, T_RESULT_OK, 0)))
+    .WillOnce(DoAll(InvokeWithoutArgs(&m_simulator, &Simulator::Stop),
+                    Return(true)));
+  EXPECT_TRUE(Transceiver_QueueDMX(token, kDMX2, arraysize(kDMX2)));
+  m_simulator.Run();
+
+  // Update a slot and extend the frame by 2 slots.
+  const uint8_t first_patch[] = {10};
+  const uint8_t second_patch[] = {20};
+  EXPECT_TRUE(Transceiver_PatchDMX(1, first_patch, arraysize(first_patch)));
+  EXPECT_TRUE(Transceiver_PatchDMX(6, second_patch, arraysize(second_patch)));
+  EXPECT_FALSE(Transceiver_PatchDMX(512, second_patch,
+                                    arraysize(second_patch)));
+
+  const uint8_t expected[] = {0, 10, 0, 127, 128, 0, 20};
+  m_tx_bytes.clear();
+  StopAfter(arraysize(expected) + 1);
+  m_simulator.Run();
+  EXPECT_THAT(m_tx_bytes,
+              MatchesFrameWithSC(NULL_START_CODE, expected,
+                                 arraysize(expected)));
+}
+
+// Check a patch that arrives while the frame is being sent doesn't modify
+// that frame.
+TEST_P(TransceiverTest, controllerDMXRefreshPatchDuringFrame) {
+  SwitchToControllerMode();
+  EXPECT_TRUE(Transceiver_SetDMXRefreshInterval(1));
+
+  uint8_t token = 1;
+  EXPECT_CALL(m_event_handler,
+              Run(EventIs(token, T_OP_TX_ONLY, T_RESULT_OK, 0)))
+    .WillOnce(Return(true));
+  EXPECT_TRUE(Transceiver_QueueDMX(token, kDMX1, arraysize(kDMX1)));
+  StopAfter(3);
+  m_simulator.Run();
+
+  // Patch a slot that has been sent, and one that hasn't.
+  const uint8_t patch[] = {100};
+  EXPECT_TRUE(Transceiver_PatchDMX(0, patch, arraysize(patch)));
+  EXPECT_TRUE(Transceiver_PatchDMX(8, patch, arraysize(patch)));
+
+  const unsigned int frame_size = arraysize(kDMX1) + 1;
+  StopAfter(2 * frame_size);
+  m_simulator.Run();
+  ASSERT_EQ(2 * frame_size, m_tx_bytes.size());
+
+  vector<uint8_t> first_frame(m_tx_bytes.begin(),
+                              m_tx_bytes.begin() + frame_size);
+  EXPECT_THAT(first_frame,
+              MatchesFrameWithSC(NULL_START_CODE, kDMX1, arraysize(kDMX1)));
+
+  const uint8_t expected[] = {100, 1, 2, 3, 4, 5, 6, 7, 100, 9, 10};
+  vector<uint8_t> second_frame(m_tx_bytes.begin() + frame_size,
+                               m_tx_bytes.end());
+  EXPECT_THAT(second_frame,
+              MatchesFrameWithSC(NULL_START_CODE, expected,
+                                 arraysize(expected)));
+}
+
+// Check DMX frames are held until the next sync point.
+TEST_P(TransceiverTest, controllerDMXSync) {
+  SwitchToControllerMode();
+  EXPECT_TRUE(Transceiver_SetDMXSync(4, 2));
+
+  uint8_t token = 1;
+  EXPECT_TRUE(Transceiver_QueueDMX(token, kDMX1, arraysize(kDMX1)));
+
+  // Without a sync point the frame isn't sent.
+  m_simulator.SetClockLimit(2000, false);
+  m_simulator.Run();
+  EXPECT_TRUE(m_tx_bytes.empty());
+
+  // Frame 1 is 3 frames after the previous sync point.
+  Transceiver_SOF(1);
+  m_simulator.SetClockLimit(2000, false);
+  m_simulator.Run();
+  EXPECT_TRUE(m_tx_bytes.empty());
+
+  EXPECT_CALL(m_event_handler,
+              Run(EventIs(token, T_OP_TX_ONLY, T_RESULT_OK, 0)))
+    .WillOnce(DoAll(InvokeWithoutArgs(&m_simulator, &Simulator::Stop),
+                    Return(true)));
+
+  Transceiver_SOF(2);
+  m_simulator.SetClockLimit(1000000, true);
+  m_simulator.Run();
+  EXPECT_THAT(m_tx_bytes,
+              MatchesFrameWithSC(NULL_START_CODE, kDMX1, arraysize(kDMX1)));
+}
+
+// Check an RDM request queued behind a held DMX frame is sent before the next
+// sync point.
+TEST_P(TransceiverTest, controllerDMXSyncRDMNotHeld) {
+  SwitchToControllerMode();
+  EXPECT_TRUE(Transceiver_SetDMXSync(4, 2));
+
+  uint8_t token = 1;
+  EXPECT_TRUE(Transceiver_QueueDMX(token, kDMX1, arraysize(kDMX1)));
+
+  token++;
+  StopAfter(1 + arraysize(kRDMRequest));
+  EXPECT_TRUE(Transceiver_QueueRDMRequest(token, kRDMRequest,
+                                          arraysize(kRDMRequest), false));
+  m_simulator.SetClockLimit(3000, true);
+  m_simulator.Run();
+  EXPECT_THAT(
+      m_tx_bytes,
+      MatchesFrameWithSC(RDM_START_CODE, kRDMRequest, arraysize(kRDMRequest)));
+
+  m_generator.AddDelay(176);
+  m_generator.AddBreak(176);
+  m_generator.AddMark(12);
+  m_generator.AddFrame(kRDMResponse, arraysize(kRDMResponse));
+
+  EXPECT_CALL(m_event_handler,
+              Run(EventIs(token, T_OP_RDM_WITH_RESPONSE, T_RESULT_RX_DATA,
+                          arraysize(kRDMResponse))))
+    .WillOnce(DoAll(InvokeWithoutArgs(&m_simulator, &Simulator::Stop),
+                    Return(true)));
+  m_simulator.SetClockLimit(2000, true);
+  m_simulator.Run();
+
+  // The DMX frame is still held for the sync point.
+  token--;
+  m_tx_bytes.clear();
+  StopAfter(-1);
+  EXPECT_CALL(m_event_handler,
+              Run(EventIs(token, T_OP_TX_ONLY, T_RESULT_OK, 0)))
+    .WillOnce(DoAll(InvokeWithoutArgs(&m_simulator, &Simulator::Stop),
+                    Return(true)));
+
+  Transceiver_SOF(2);
+  m_simulator.SetClockLimit(1000000, true);
+  m_simulator.Run();
+  EXPECT_THAT(m_tx_bytes,
+              MatchesFrameWithSC(NULL_START_CODE, kDMX1, arraysize(kDMX1)));
+}
+
+// Check DMX frames aren't held forever if the sync points stop.
+TEST_P(TransceiverTest, controllerDMXSyncLost) {
+  SwitchToControllerMode();
+  EXPECT_TRUE(Transceiver_SetDMXSync(4, 2));
+
+  uint8_t token = 1;
+  EXPECT_TRUE(Transceiver_QueueDMX(token, kDMX1, arraysize(kDMX1)));
+
+  // The frame is held for up to two periods, 8ms.
+  m_simulator.SetClockLimit(6000, false);
+  m_simulator.Run();
+  EXPECT_TRUE(m_tx_bytes.empty());
+
+  EXPECT_CALL(m_event_handler,
+              Run(EventIs(token, T_OP_TX_ONLY, T_RESULT_OK, 0)))
+    .WillOnce(DoAll(InvokeWithoutArgs(&m_simulator, &Simulator::Stop),
+                    Return(true)));
+  m_simulator.SetClockLimit(10000, true);
+  m_simulator.Run();
+  EXPECT_THAT(m_tx_bytes,
+              MatchesFrameWithSC(NULL_START_CODE, kDMX1, arraysize(kDMX1)));
+}
+
 // Check that switching to responder mode cancels any in-flight transmissions.
-TEST_F(TransceiverTest, controllerModeChange) {
+TEST_P(TransceiverTest, controllerModeChange) {
   SwitchToControllerMode();
 
   uint8_t token = 1;
@@ -797,7 +1365,7 @@ TEST_F(TransceiverTest, controllerModeChange) {
   EXPECT_THAT(m_tx_bytes, IsEmpty());
 }
 
-TEST_F(TransceiverTest, responderRxDMX) {
+TEST_P(TransceiverTest, responderRxDMX) {
   vector<uint8_t> rx_data;
 
   uint8_t token = 0;
@@ -822,9 +1390,38 @@ TEST_F(TransceiverTest, responderRxDMX) {
   m_simulator.Run();
 
   EXPECT_THAT(rx_data, ElementsAreArray(kDMX1, arraysize(kDMX1)));
+  EXPECT_EQ(0u, Transceiver_GetRXEventOverflowCount());
+  EXPECT_LT(0u, Transceiver_GetRXEventHighWater());
+}
+
+TEST_P(TransceiverTest, responderRxDMXInterruptLoad) {
+  EXPECT_CALL(m_event_handler, Run(EventIs(0, T_OP_RX, _, _)))
+    .WillRepeatedly(Return(true));
+
+  m_generator.SetStopOnComplete(true);
+  m_generator.AddDelay(100);
+  m_generator.AddBreak(176);
+  m_generator.AddMark(12);
+  m_generator.AddFrame(kDMX1, arraysize(kDMX1));
+
+  m_simulator.Run();
+
+  unsigned int rx_isrs = m_interrupt_controller.ISRCount(
+      AS_USART_INTERRUPT_RX_SOURCE(1));
+  unsigned int dma_isrs = m_interrupt_controller.ISRCount(
+      AS_DMA_INTERRUPT_SOURCE(TRANSCEIVER_RX_DMA_CHANNEL));
+  RecordProperty("usart_rx_isrs", rx_isrs);
+  RecordProperty("rx_dma_isrs", dma_isrs);
+  if (GetParam()) {
+    // The frame fits in the buffer, so no RX interrupts are required.
+    EXPECT_EQ(0u, rx_isrs);
+    EXPECT_EQ(0u, dma_isrs);
+  } else {
+    EXPECT_LT(0u, rx_isrs);
+  }
 }
 
-TEST_F(TransceiverTest, responderRxShortBreak) {
+TEST_P(TransceiverTest, responderRxShortBreak) {
   vector<uint8_t> rx_data;
 
   uint8_t token = 0;
@@ -851,7 +1448,7 @@ TEST_F(TransceiverTest, responderRxShortBreak) {
   EXPECT_THAT(rx_data, ElementsAreArray(kDMX2, arraysize(kDMX2)));
 }
 
-TEST_F(TransceiverTest, responderRxShortMark) {
+TEST_P(TransceiverTest, responderRxShortMark) {
   vector<uint8_t> rx_data;
 
   uint8_t token = 0;
@@ -879,7 +1476,7 @@ TEST_F(TransceiverTest, responderRxShortMark) {
 }
 
 // Interslot delay, this test can take a while to run.
-TEST_F(TransceiverTest, responderRxInterSlotDelay) {
+TEST_P(TransceiverTest, responderRxInterSlotDelay) {
   vector<uint8_t> rx_data;
 
   const uint8_t expected_frame[] = {0, 10, 20, 30, 40, 50};
@@ -924,7 +1521,7 @@ TEST_F(TransceiverTest, responderRxInterSlotDelay) {
 }
 
 // Interslot delay for RDM frames.
-TEST_F(TransceiverTest, responderRxRDMInterSlotDelay) {
+TEST_P(TransceiverTest, responderRxRDMInterSlotDelay) {
   vector<uint8_t> rx_data;
 
   const uint8_t expected_frame[] = {RDM_START_CODE, 10, 20, 30};
@@ -962,7 +1559,7 @@ TEST_F(TransceiverTest, responderRxRDMInterSlotDelay) {
 
 // Test what happens if we send a break / mark sequence, followed by another
 // break / mark sequence with data.
-TEST_F(TransceiverTest, responderRxZeroLengthFrame) {
+TEST_P(TransceiverTest, responderRxZeroLengthFrame) {
   vector<uint8_t> rx_data;
 
   uint8_t token = 0;
@@ -991,7 +1588,7 @@ TEST_F(TransceiverTest, responderRxZeroLengthFrame) {
 }
 
 // Test we can receive two frames back to back.
-TEST_F(TransceiverTest, responderRxDoubleFrame) {
+TEST_P(TransceiverTest, responderRxDoubleFrame) {
   vector<uint8_t> rx_data1, rx_data2;
 
   uint8_t token = 0;
@@ -1027,8 +1624,114 @@ TEST_F(TransceiverTest, responderRxDoubleFrame) {
   EXPECT_THAT(rx_data2, ElementsAreArray(kDMX2, arraysize(kDMX2)));
 }
 
+// Test that a frame isn't overwritten by the next one if _Tasks() is slow.
+TEST_P(TransceiverTest, responderRxDoubleFrameWithSlowTasks) {
+  const uint8_t kFrame3[] = {0, 10, 20, 30, 40, 50, 60, 70};
+  vector<vector<uint8_t>> frames;
+
+  EXPECT_CALL(m_event_handler, Run(EventIs(0, T_OP_RX, _, _)))
+    .WillRepeatedly(CopyTo(&frames));
+
+  // Hold off _Tasks() from the middle of the first frame until the second
+  // frame has been received.
+  HoldTasks(500, 1200);
+
+  m_generator.SetStopOnComplete(true);
+  m_generator.AddDelay(100);
+  m_generator.AddBreak(176);
+  m_generator.AddMark(12);
+  m_generator.AddFrame(kDMX1, arraysize(kDMX1));
+  m_generator.AddBreak(180);
+  m_generator.AddMark(14);
+  m_generator.AddFrame(kDMX2, arraysize(kDMX2));
+  m_generator.AddBreak(176);
+  m_generator.AddMark(12);
+  m_generator.AddFrame(kFrame3, arraysize(kFrame3));
+  m_generator.AddDelay(100);
+
+  m_simulator.Run();
+
+  // No frame was delivered with data from another frame.
+  EXPECT_THAT(frames, Each(AnyOf(IsPrefixOf(kDMX1, arraysize(kDMX1)),
+                                 IsPrefixOf(kDMX2, arraysize(kDMX2)),
+                                 IsPrefixOf(kFrame3, arraysize(kFrame3)))));
+  ASSERT_THAT(frames, Not(IsEmpty()));
+  EXPECT_THAT(frames.back(), ElementsAreArray(kFrame3, arraysize(kFrame3)));
+  // The end of the first frame was queued by the ISR, so it's delivered in
+  // full, and the second frame is received into the spare buffer.
+  EXPECT_THAT(frames, Contains(ElementsAreArray(kDMX1, arraysize(kDMX1))));
+  EXPECT_THAT(frames, Contains(ElementsAreArray(kDMX2, arraysize(kDMX2))));
+}
+
+// Test a frame is dropped if _Tasks() is held while the spare buffer is in
+// use.
+TEST_P(TransceiverTest, responderRxTripleFrameWithSlowTasks) {
+  const uint8_t kFrame3[] = {0, 10, 20, 30, 40, 50, 60, 70};
+  vector<vector<uint8_t>> frames;
+
+  EXPECT_CALL(m_event_handler, Run(EventIs(0, T_OP_RX, _, _)))
+    .WillRepeatedly(CopyTo(&frames));
+
+  // Hold off _Tasks() from the middle of the first frame until the third
+  // frame has started.
+  HoldTasks(500, 1500);
+
+  m_generator.SetStopOnComplete(true);
+  m_generator.AddDelay(100);
+  m_generator.AddBreak(176);
+  m_generator.AddMark(12);
+  m_generator.AddFrame(kDMX1, arraysize(kDMX1));
+  m_generator.AddBreak(180);
+  m_generator.AddMark(14);
+  m_generator.AddFrame(kDMX2, arraysize(kDMX2));
+  m_generator.AddBreak(176);
+  m_generator.AddMark(12);
+  m_generator.AddFrame(kFrame3, arraysize(kFrame3));
+  m_generator.AddDelay(100);
+
+  m_simulator.Run();
+
+  EXPECT_THAT(frames, Each(AnyOf(IsPrefixOf(kDMX1, arraysize(kDMX1)),
+                                 IsPrefixOf(kDMX2, arraysize(kDMX2)))));
+  EXPECT_THAT(frames, Contains(ElementsAreArray(kDMX1, arraysize(kDMX1))));
+  EXPECT_LT(0u, Transceiver_GetRXEventOverflowCount());
+}
+
+// Test a frame received with DMA is delivered in full if _Tasks() doesn't run
+// while it's received.
+TEST_P(TransceiverTest, responderRxDMXWithTasksHeld) {
+  if (!GetParam()) {
+    // Without DMA, each slot is queued as a separate event, and there are more
+    // slots than the event queue holds.
+    return;
+  }
+
+  vector<vector<uint8_t>> frames;
+
+  EXPECT_CALL(m_event_handler, Run(EventIs(0, T_OP_RX, _, _)))
+    .WillRepeatedly(CopyTo(&frames));
+
+  // Hold off _Tasks() from the first break until after the second break, at
+  // 772us.
+  HoldTasks(200, 900);
+
+  m_generator.SetStopOnComplete(true);
+  m_generator.AddDelay(100);
+  m_generator.AddBreak(176);
+  m_generator.AddMark(12);
+  m_generator.AddFrame(kDMX1, arraysize(kDMX1));
+  m_generator.AddBreak(176);
+  m_generator.AddMark(12);
+  m_generator.AddFrame(kDMX2, arraysize(kDMX2));
+  m_generator.AddDelay(100);
+
+  m_simulator.Run();
+
+  EXPECT_THAT(frames, Contains(ElementsAreArray(kDMX1, arraysize(kDMX1))));
+}
+
 // Test we don't crash if we receive a frame larger than 512 slots.
-TEST_F(TransceiverTest, responderRxJumboFrameWithResponse) {
+TEST_P(TransceiverTest, responderRxJumboFrameWithResponse) {
   uint8_t jumbo_frame[600];
   for (unsigned int i = 0; i < arraysize(jumbo_frame); i++) {
     jumbo_frame[i] = i & 0xff;
@@ -1065,7 +1768,7 @@ TEST_F(TransceiverTest, responderRxJumboFrameWithResponse) {
 
 // Test we handle framing errors correctly.
 // This ensures we deliver up to but not including the bad data
-TEST_F(TransceiverTest, responderRxFramingError) {
+TEST_P(TransceiverTest, responderRxFramingError) {
   vector<uint8_t> rx_data;
 
   uint8_t token = 0;
@@ -1091,7 +1794,7 @@ TEST_F(TransceiverTest, responderRxFramingError) {
   EXPECT_THAT(rx_data, ElementsAreArray(kDMX2, arraysize(kDMX2)));
 }
 
-TEST_F(TransceiverTest, responderRDMRequest) {
+TEST_P(TransceiverTest, responderRDMRequest) {
   vector<uint8_t> rx_data;
 
   EXPECT_CALL(m_event_handler,
@@ -1129,7 +1832,47 @@ TEST_F(TransceiverTest, responderRDMRequest) {
   EXPECT_THAT(m_tx_bytes, MatchesFrame(kRDMResponse, arraysize(kRDMResponse)));
 }
 
-TEST_F(TransceiverTest, responderRDMDUB) {
+// Test a response to a request isn't sent if the next frame started before
+// the request was delivered.
+TEST_P(TransceiverTest, responderRDMRequestWithSlowTasks) {
+  vector<vector<uint8_t>> frames;
+  IOVec iovec = {
+    .base = kRDMResponse,
+    .length = arraysize(kRDMResponse)
+  };
+  bool queued = true;
+
+  EXPECT_CALL(m_event_handler, Run(EventIs(0, T_OP_RX, _, _)))
+    .WillRepeatedly(CopyTo(&frames));
+  EXPECT_CALL(m_event_handler,
+              Run(EventIs(0, T_OP_RX, _, arraysize(kRDMRequest))))
+    .WillOnce(QueueRDMResponse(&iovec, &queued));
+
+  // Hold off _Tasks() from the end of the request, at 1388us, until the
+  // second frame has started.
+  HoldTasks(1300, 1650);
+
+  m_generator.SetStopOnComplete(true);
+  m_generator.AddDelay(100);
+  m_generator.AddBreak(176);
+  m_generator.AddMark(12);
+  m_generator.AddFrame(kRDMRequest, arraysize(kRDMRequest));
+  m_generator.AddBreak(176);
+  m_generator.AddMark(12);
+  m_generator.AddFrame(kDMX2, arraysize(kDMX2));
+  m_generator.AddDelay(100);
+
+  m_simulator.Run();
+
+  // The response would have been sent after the second frame, and cut it
+  // short.
+  EXPECT_FALSE(queued);
+  EXPECT_THAT(m_tx_bytes, IsEmpty());
+  ASSERT_THAT(frames, Not(IsEmpty()));
+  EXPECT_THAT(frames.back(), ElementsAreArray(kDMX2, arraysize(kDMX2)));
+}
+
+TEST_P(TransceiverTest, responderRDMDUB) {
   vector<uint8_t> rx_data;
 
   EXPECT_CALL(m_event_handler,
@@ -1167,7 +1910,7 @@ TEST_F(TransceiverTest, responderRDMDUB) {
   EXPECT_THAT(m_tx_bytes, MatchesFrame(kDUBResponse, arraysize(kDUBResponse)));
 }
 
-TEST_F(TransceiverTest, responderRDMOversizedDUB) {
+TEST_P(TransceiverTest, responderRDMOversizedDUB) {
   vector<uint8_t> rx_data;
 
   EXPECT_CALL(m_event_handler,
@@ -1211,7 +1954,7 @@ TEST_F(TransceiverTest, responderRDMOversizedDUB) {
   EXPECT_THAT(m_tx_bytes, MatchesFrame(dub_response, 512u));
 }
 
-TEST_F(TransceiverTest, responderRDMDUBWithJitter) {
+TEST_P(TransceiverTest, responderRDMDUBWithJitter) {
   EXPECT_TRUE(Transceiver_SetRDMResponderJitter(1000));  // 100uS of jitter
 
   vector<uint8_t> rx_data;
@@ -1251,7 +1994,251 @@ TEST_F(TransceiverTest, responderRDMDUBWithJitter) {
   EXPECT_THAT(m_tx_bytes, MatchesFrame(kDUBResponse, arraysize(kDUBResponse)));
 }
 
-TEST_F(TransceiverTest, selfTestPass) {
+// Check that the fast path responses start rdm_responder_delay after the end
+// of the request, whatever the value of the last slot.
+TEST_P(TransceiverTest, responderFastPathTiming) {
+  if (GetParam()) {
+    // The fast path only runs when the USART ISR drains the receiver.
+    return;
+  }
+  Transceiver_SetRDMFastPath(&TransceiverTest::FastPath);
+
+  EXPECT_CALL(m_event_handler, Run(EventIs(0, T_OP_RX, _, _)))
+    .WillRepeatedly(Return(true));
+
+  const double delay = Transceiver_GetRDMResponderDelay() / 10.0;
+  const uint16_t pids[] = {PID_DISC_UNIQUE_BRANCH, PID_DISC_MUTE};
+  const uint8_t last_slots[] = {0x00, 0x01, 0x55, 0x7f, 0x80, 0xfe, 0xff};
+  for (uint16_t pid : pids) {
+    for (uint8_t last_slot : last_slots) {
+      SCOPED_TRACE(testing::Message() << "PID " << pid << ", last slot "
+                                      << static_cast<int>(last_slot));
+      vector<uint8_t> request = DiscoveryRequest(pid, last_slot);
+      ASSERT_EQ(last_slot, request.back());
+      // The timer expires RESPONSE_FUDGE_FACTOR (3.7us) early, to cover the
+      // interrupt latency on the real hardware.
+      EXPECT_THAT(FastPathResponseDelay(request),
+                  AllOf(Ge(delay - 4.0), Le(delay)));
+    }
+  }
+}
+
+// Check the fast path answers while Transceiver_Tasks() is busy, and the
+// request is still delivered intact afterwards.
+TEST_P(TransceiverTest, responderFastPathWithBusyTasks) {
+  if (GetParam()) {
+    return;
+  }
+  Transceiver_SetRDMFastPath(&TransceiverTest::FastPath);
+
+  const double delay = Transceiver_GetRDMResponderDelay() / 10.0;
+  const uint16_t pids[] = {PID_DISC_UNIQUE_BRANCH, PID_DISC_MUTE};
+  for (uint16_t pid : pids) {
+    SCOPED_TRACE(testing::Message() << "PID " << pid);
+    vector<uint8_t> request = DiscoveryRequest(pid, 0x80);
+    vector<uint8_t> rx_data;
+    uint64_t delivered_at = 0;
+
+    EXPECT_CALL(m_event_handler,
+                Run(EventIs(0, T_OP_RX, _, Lt(request.size()))))
+      .WillRepeatedly(Return(true));
+    EXPECT_CALL(m_event_handler,
+                Run(EventIs(0, T_OP_RX, T_RESULT_RX_CONTINUE_FRAME,
+                            request.size())))
+      .WillOnce(DoAll(
+          InvokeWithoutArgs([this, &delivered_at]() {
+            delivered_at = m_simulator.Clock();
+          }),
+          AppendTo(&rx_data)));
+
+    // Hold Tasks() from the last 4 slots of the request until 300us after
+    // it. Any longer and the RX event queue overflows, and then the fast path
+    // leaves the request alone.
+    uint32_t request_end = 100 + 176 + 12 + 44 * request.size();
+    HoldTasks(request_end - 4 * 44, request_end + 300);
+    EXPECT_THAT(FastPathResponseDelay(request),
+                AllOf(Ge(delay - 4.0), Le(delay)));
+
+    EXPECT_GE(delivered_at,
+              static_cast<uint64_t>(request_end + 300) *
+              (kClockSpeed / 1000000));
+    EXPECT_THAT(rx_data, ElementsAreArray(request));
+    testing::Mock::VerifyAndClearExpectations(&m_event_handler);
+  }
+}
+
+TEST_P(TransceiverTest, snifferDMXFrames) {
+  SwitchToSnifferMode();
+
+  vector<SnifferRecord> records;
+  EXPECT_CALL(m_event_handler,
+              Run(EventIs(0, T_OP_SNIFFER, T_RESULT_OK, Gt(0))))
+    .WillOnce(DoAll(AppendSnifferRecords(&records),
+                    InvokeWithoutArgs(&m_simulator, &Simulator::Stop),
+                    Return(true)));
+
+  // The first frame ends at the next break, the second when the line is idle.
+  // The batch is sent once SNIFFER_BATCH_INTERVAL has passed.
+  m_generator.AddDelay(100);
+  m_generator.AddBreak(176);
+  m_generator.AddMark(12);
+  m_generator.AddFrame(kDMX1, arraysize(kDMX1));
+  m_generator.AddBreak(180);
+  m_generator.AddMark(14);
+  m_generator.AddFrame(kDMX2, arraysize(kDMX2));
+  m_generator.AddDelay(20000);
+
+  m_simulator.Run();
+
+  ASSERT_THAT(records, SizeIs(2));
+  EXPECT_EQ(1760u, records[0].header.break_time);
+  EXPECT_EQ(120u, records[0].header.mark_time);
+  EXPECT_EQ(SNIFFER_FLAG_BREAK, records[0].header.flags);
+  EXPECT_THAT(records[0].data, ElementsAreArray(kDMX1, arraysize(kDMX1)));
+  EXPECT_EQ(1800u, records[1].header.break_time);
+  EXPECT_EQ(140u, records[1].header.mark_time);
+  EXPECT_EQ(SNIFFER_FLAG_BREAK, records[1].header.flags);
+  EXPECT_THAT(records[1].data, ElementsAreArray(kDMX2, arraysize(kDMX2)));
+  EXPECT_LE(records[0].header.timestamp, records[1].header.timestamp);
+  EXPECT_THAT(m_tx_bytes, IsEmpty());
+
+  LeaveSnifferMode();
+}
+
+TEST_P(TransceiverTest, snifferRDMFrameBoundaries) {
+  SwitchToSnifferMode();
+
+  vector<SnifferRecord> records;
+  EXPECT_CALL(m_event_handler,
+              Run(EventIs(0, T_OP_SNIFFER, T_RESULT_OK, Gt(0))))
+    .WillOnce(DoAll(AppendSnifferRecords(&records),
+                    InvokeWithoutArgs(&m_simulator, &Simulator::Stop),
+                    Return(true)));
+
+  // The RDM frame ends with the checksum, so the DUB response that follows
+  // without a break is a new frame.
+  m_generator.AddDelay(100);
+  m_generator.AddBreak(176);
+  m_generator.AddMark(12);
+  m_generator.AddFrame(kRDMResponse, arraysize(kRDMResponse));
+  m_generator.AddDelay(200);
+  m_generator.AddFrame(kDUBResponse, arraysize(kDUBResponse));
+  m_generator.AddDelay(20000);
+
+  m_simulator.Run();
+
+  ASSERT_THAT(records, SizeIs(2));
+  EXPECT_EQ(1760u, records[0].header.break_time);
+  EXPECT_EQ(120u, records[0].header.mark_time);
+  EXPECT_EQ(SNIFFER_FLAG_BREAK, records[0].header.flags);
+  EXPECT_THAT(records[0].data,
+              ElementsAreArray(kRDMResponse, arraysize(kRDMResponse)));
+  EXPECT_EQ(0u, records[1].header.break_time);
+  EXPECT_EQ(0u, records[1].header.mark_time);
+  EXPECT_EQ(0u, records[1].header.flags);
+  EXPECT_THAT(records[1].data,
+              ElementsAreArray(kDUBResponse, arraysize(kDUBResponse)));
+
+  LeaveSnifferMode();
+}
+
+TEST_P(TransceiverTest, snifferJumboFrame) {
+  uint8_t jumbo_frame[600];
+  for (unsigned int i = 0; i < arraysize(jumbo_frame); i++) {
+    jumbo_frame[i] = i & 0xff;
+  }
+
+  SwitchToSnifferMode();
+
+  // The frame doesn't fit in a single record, so the first record fills a
+  // batch, which is sent straight away. The rest of the frame is sent once
+  // SNIFFER_BATCH_INTERVAL has passed.
+  vector<SnifferRecord> records;
+  InSequence seq;
+  EXPECT_CALL(m_event_handler,
+              Run(EventIs(0, T_OP_SNIFFER, T_RESULT_OK, PAYLOAD_SIZE)))
+    .WillOnce(DoAll(AppendSnifferRecords(&records), Return(true)));
+  EXPECT_CALL(m_event_handler,
+              Run(EventIs(0, T_OP_SNIFFER, T_RESULT_OK, Lt(PAYLOAD_SIZE))))
+    .WillOnce(DoAll(AppendSnifferRecords(&records),
+                    InvokeWithoutArgs(&m_simulator, &Simulator::Stop),
+                    Return(true)));
+
+  m_generator.AddDelay(100);
+  m_generator.AddBreak(176);
+  m_generator.AddMark(12);
+  m_generator.AddFrame(jumbo_frame, arraysize(jumbo_frame));
+  m_generator.AddDelay(20000);
+
+  m_simulator.Run();
+
+  // The slots past the end of the buffer are dropped.
+  const unsigned int kFirstRecordSize =
+      PAYLOAD_SIZE - sizeof(SnifferFrameHeader);
+  ASSERT_THAT(records, SizeIs(2));
+  EXPECT_EQ(SNIFFER_FLAG_BREAK | SNIFFER_FLAG_TRUNCATED,
+            records[0].header.flags);
+  EXPECT_THAT(records[0].data,
+              ElementsAreArray(jumbo_frame, kFirstRecordSize));
+  EXPECT_EQ(SNIFFER_FLAG_BREAK | SNIFFER_FLAG_TRUNCATED |
+                SNIFFER_FLAG_CONTINUED,
+            records[1].header.flags);
+  EXPECT_EQ(records[0].header.timestamp, records[1].header.timestamp);
+  EXPECT_THAT(records[1].data,
+              ElementsAreArray(jumbo_frame + kFirstRecordSize,
+                               DMX_FRAME_SIZE + 1 - kFirstRecordSize));
+
+  LeaveSnifferMode();
+}
+
+TEST_P(TransceiverTest, snifferQueueOverflow) {
+  const uint8_t kFrames[][3] = {
+    {0, 1, 1}, {0, 2, 2}, {0, 3, 3}, {0, 4, 4}, {0, 5, 5}
+  };
+
+  SwitchToSnifferMode();
+
+  vector<SnifferRecord> records;
+  EXPECT_CALL(m_event_handler,
+              Run(EventIs(0, T_OP_SNIFFER, T_RESULT_OK, Gt(0))))
+    .WillOnce(DoAll(AppendSnifferRecords(&records),
+                    InvokeWithoutArgs(&m_simulator, &Simulator::Stop),
+                    Return(true)));
+
+  // Let _Tasks() finish setting up sniffer mode, then hold it off until the
+  // last frame starts, so the frame queue fills up and the frames that don't
+  // fit are dropped.
+  HoldTasks(50, 1500);
+
+  m_generator.AddDelay(100);
+  for (unsigned int i = 0; i < arraysize(kFrames); i++) {
+    m_generator.AddBreak(100);
+    m_generator.AddMark(12);
+    m_generator.AddFrame(kFrames[i], arraysize(kFrames[i]));
+  }
+  m_generator.AddBreak(100);
+  m_generator.AddMark(12);
+  m_generator.AddFrame(kDMX1, arraysize(kDMX1));
+  m_generator.AddDelay(20000);
+
+  m_simulator.Run();
+
+  // The queue holds three complete frames.
+  ASSERT_THAT(records, SizeIs(4));
+  for (unsigned int i = 0; i < 3; i++) {
+    EXPECT_EQ(SNIFFER_FLAG_BREAK, records[i].header.flags);
+    EXPECT_THAT(records[i].data,
+                ElementsAreArray(kFrames[i], arraysize(kFrames[i])));
+  }
+  EXPECT_EQ(SNIFFER_FLAG_BREAK | SNIFFER_FLAG_FRAMES_DROPPED,
+            records[3].header.flags);
+  EXPECT_THAT(records[3].data, ElementsAreArray(kDMX1, arraysize(kDMX1)));
+
+  HoldTasks(0, 0);
+  LeaveSnifferMode();
+}
+
+TEST_P(TransceiverTest, selfTestPass) {
   SwitchToSelfTestMode();
   uint8_t token = 2;
   EXPECT_CALL(m_event_handler,
@@ -1272,7 +2259,7 @@ TEST_F(TransceiverTest, selfTestPass) {
   m_simulator.Run();
 }
 
-TEST_F(TransceiverTest, selfTestFailCorrupt) {
+TEST_P(TransceiverTest, selfTestFailCorrupt) {
   SwitchToSelfTestMode();
   uint8_t token = 2;
   EXPECT_CALL(m_event_handler,
@@ -1293,7 +2280,7 @@ TEST_F(TransceiverTest, selfTestFailCorrupt) {
   m_simulator.Run();
 }
 
-TEST_F(TransceiverTest, selfTestFailTimeout) {
+TEST_P(TransceiverTest, selfTestFailTimeout) {
   SwitchToSelfTestMode();
   uint8_t token = 2;
   EXPECT_CALL(m_event_handler,
@@ -1308,14 +2295,14 @@ TEST_F(TransceiverTest, selfTestFailTimeout) {
   EXPECT_THAT(m_tx_bytes, Contains(0xa5));
 }
 
-TEST_F(TransceiverTest, switchModes) {
+TEST_P(TransceiverTest, switchModes) {
   SwitchToSelfTestMode();
   EXPECT_EQ(T_MODE_SELF_TEST, Transceiver_GetMode());
   SwitchToControllerMode();
   EXPECT_EQ(T_MODE_CONTROLLER, Transceiver_GetMode());
 }
 
-TEST_F(TransceiverTest, reset) {
+TEST_P(TransceiverTest, reset) {
   SwitchToControllerMode();
 
   Transceiver_Reset();
@@ -1332,3 +2319,28 @@ TEST_F(TransceiverTest, reset) {
   EXPECT_THAT(m_tx_bytes,
               MatchesFrameWithSC(NULL_START_CODE, kDMX1, arraysize(kDMX1)));
 }
+
+// Check a reset cancels the operation in progress and the queued operations.
+TEST_P(TransceiverTest, resetCancelsOperations) {
+  SwitchToControllerMode();
+
+  InSequence seq;
+  uint8_t token = 1;
+  EXPECT_CALL(m_event_handler,
+              Run(EventIs(token, T_OP_TX_ONLY, T_RESULT_CANCELLED, 0)))
+    .WillOnce(Return(true));
+  EXPECT_TRUE(Transceiver_QueueDMX(token, kDMX1, arraysize(kDMX1)));
+
+  token++;
+  EXPECT_CALL(m_event_handler,
+              Run(EventIs(token, T_OP_RDM_WITH_RESPONSE, T_RESULT_CANCELLED,
+                          0)))
+    .WillOnce(Return(true));
+  EXPECT_TRUE(Transceiver_QueueRDMRequest(token, kRDMRequest,
+                                          arraysize(kRDMRequest), false));
+
+  // Reset part way through the DMX frame.
+  StopAfter(3);
+  m_simulator.Run();
+  Transceiver_Reset();
+}
@@ -0,0 +1,108 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * StreamDecoderBenchmark.cpp
+ * Tests for the StreamDecoder code.
+ * Copyright (C) 2015 Simon Newton
+ */
+
+/*
+ * A host side benchmark for the stream decoder.
+ *
+ * This measures the cost of decoding messages which arrive in USB transfer
+ * sized chunks. It isn't run as part of the tests since the results depend on
+ * the host.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+#include "constants.h"
+#include "stream_decoder.h"
+
+namespace {
+
+unsigned int g_message_count = 0;
+
+void CountMessage(const Message *message) {
+  g_message_count++;
+  (void) message;
+}
+
+/*
+ * @brief Build a stream of messages, each with the given payload size.
+ */
+std::vector<uint8_t> BuildStream(unsigned int message_count,
+                                 unsigned int payload_size) {
+  std::vector<uint8_t> stream;
+  for (unsigned int i = 0; i < message_count; i++) {
+    stream.push_back(START_OF_MESSAGE_ID);
+    stream.push_back(i & 0xff);
+    stream.push_back(0x01);
+    stream.push_back(0x02);
+    stream.push_back(payload_size & 0xff);
+    stream.push_back(payload_size >> 8);
+    for (unsigned int j = 0; j < payload_size; j++) {
+      stream.push_back(j & 0xff);
+    }
+    stream.push_back(END_OF_MESSAGE_ID);
+  }
+  return stream;
+}
+
+/*
+ * @brief Decode the stream in chunks, and print the time per message.
+ */
+void RunBenchmark(const char *name, unsigned int payload_size,
+                  unsigned int chunk_size) {
+  const unsigned int kMessages = 1000;
+  const unsigned int kIterations = 200;
+  const std::vector<uint8_t> stream = BuildStream(kMessages, payload_size);
+
+  StreamDecoder_Initialize(CountMessage);
+  g_message_count = 0;
+
+  auto start = std::chrono::steady_clock::now();
+  for (unsigned int i = 0; i < kIterations; i++) {
+    for (unsigned int offset = 0; offset < stream.size();
+         offset += chunk_size) {
+      unsigned int size = std::min<unsigned int>(chunk_size,
+                                                 stream.size() - offset);
+      StreamDecoder_Process(stream.data() + offset, size);
+    }
+  }
+  auto end = std::chrono::steady_clock::now();
+
+  double ns = std::chrono::duration<double, std::nano>(end - start).count();
+  std::cout << name << ": payload " << payload_size << ", chunk "
+            << chunk_size << ", " << g_message_count << " messages, "
+            << ns / g_message_count << " ns / message" << std::endl;
+}
+
+}  // namespace
+
+int main() {
+  RunBenchmark("small messages", 0, USB_READ_BUFFER_SIZE);
+  RunBenchmark("DMX sized messages", 25, USB_READ_BUFFER_SIZE);
+  RunBenchmark("RDM sized messages", 40, USB_READ_BUFFER_SIZE);
+  RunBenchmark("full messages", PAYLOAD_SIZE, USB_READ_BUFFER_SIZE);
+  RunBenchmark("small messages, 64 byte chunks", 0, 64);
+  RunBenchmark("RDM sized messages, 64 byte chunks", 40, 64);
+  return 0;
+}
@@ -19,13 +19,16 @@
  */
 
 #include <gtest/gtest.h>
+#include <string.h>
 
+#include <vector>
 
 #include "stream_decoder.h"
 #include "Array.h"
 #include "MessageHandlerMock.h"
 
 using ::testing::Args;
+using ::testing::Invoke;
 using ::testing::StrictMock;
 using ::testing::Return;
 using ::testing::_;
@@ -123,6 +126,49 @@ TEST_F(StreamDecoderTest, fragmentedMessage) {
   EXPECT_FALSE(StreamDecoder_GetFragmentedFrameFlag());
 }
 
+/*
+ * Check StreamDecoder_ProcessMessage() stops after each message.
+ */
+TEST_F(StreamDecoderTest, processMessage) {
+  StreamDecoder_Initialize(MessageHandler_HandleMessage);
+
+  std::vector<uint8_t> data(empty_msg1, empty_msg1 + arraysize(empty_msg1));
+  data.insert(data.end(), message1, message1 + arraysize(message1));
+  data.push_back(0);  // Garbage
+  data.insert(data.end(), message1, message1 + PAYLOAD_OFFSET);
+
+  testing::InSequence seq;
+  EXPECT_CALL(message_handler_mock,
+              HandleMessage(MessageIs(0x44, 0x0201, nullptr, 0u)));
+  EXPECT_CALL(message_handler_mock,
+              HandleMessage(MessageIs(0x45, 0x0202, message1 + PAYLOAD_OFFSET,
+                                      MSG1_PAYLOAD_SIZE)))
+    .Times(2);
+  EXPECT_CALL(message_handler_mock,
+              HandleMessage(MessageIs(0x44, 0x0201, nullptr, 0u)));
+
+  unsigned int offset = 0;
+  offset += StreamDecoder_ProcessMessage(data.data(), data.size());
+  EXPECT_EQ(arraysize(empty_msg1), offset);
+  offset += StreamDecoder_ProcessMessage(data.data() + offset,
+                                         data.size() - offset);
+  EXPECT_EQ(arraysize(empty_msg1) + arraysize(message1), offset);
+
+  // The garbage and the start of the next message are consumed.
+  offset += StreamDecoder_ProcessMessage(data.data() + offset,
+                                         data.size() - offset);
+  EXPECT_EQ(data.size(), offset);
+
+  // The rest of the fragmented message, followed by another message.
+  data.assign(message1 + PAYLOAD_OFFSET, message1 + arraysize(message1));
+  data.insert(data.end(), empty_msg1, empty_msg1 + arraysize(empty_msg1));
+  unsigned int remaining = arraysize(message1) - PAYLOAD_OFFSET;
+  EXPECT_EQ(remaining, StreamDecoder_ProcessMessage(data.data(), data.size()));
+  EXPECT_EQ(arraysize(empty_msg1),
+            StreamDecoder_ProcessMessage(data.data() + remaining,
+                                         data.size() - remaining));
+}
+
 TEST_F(StreamDecoderTest, singleByteRx) {
   StreamDecoder_Initialize(MessageHandler_HandleMessage);
 
@@ -180,3 +226,93 @@ TEST_F(StreamDecoderTest, missingEOM) {
   uint8_t not_eom = 0;
   StreamDecoder_Process(&not_eom, 1);  // not an EOM marker
 }
+
+/*
+ * Check that several messages in a single buffer are all decoded, without
+ * copying the payloads.
+ */
+TEST_F(StreamDecoderTest, multipleMessages) {
+  StreamDecoder_Initialize(MessageHandler_HandleMessage);
+
+  uint8_t buffer[2 * arraysize(message1) + arraysize(empty_msg1) + 2];
+  uint8_t *ptr = buffer;
+  memcpy(ptr, message1, arraysize(message1));
+  ptr += arraysize(message1);
+  *ptr++ = 'x';  // noise between messages
+  memcpy(ptr, empty_msg1, arraysize(empty_msg1));
+  ptr += arraysize(empty_msg1);
+  *ptr++ = 'y';
+  const uint8_t *second_payload = ptr + PAYLOAD_OFFSET;
+  memcpy(ptr, message1, arraysize(message1));
+
+  const uint8_t* payloads[2] = {nullptr, nullptr};
+  testing::InSequence seq;
+  EXPECT_CALL(message_handler_mock,
+              HandleMessage(MessageIs(0x45, 0x0202, message1 + PAYLOAD_OFFSET,
+                                      MSG1_PAYLOAD_SIZE)))
+      .WillOnce(Invoke([&](const Message *message) {
+        payloads[0] = message->payload;
+      }));
+  EXPECT_CALL(message_handler_mock,
+              HandleMessage(MessageIs(0x44, 0x0201, nullptr, 0)));
+  EXPECT_CALL(message_handler_mock,
+              HandleMessage(MessageIs(0x45, 0x0202, message1 + PAYLOAD_OFFSET,
+                                      MSG1_PAYLOAD_SIZE)))
+      .WillOnce(Invoke([&](const Message *message) {
+        payloads[1] = message->payload;
+      }));
+
+  StreamDecoder_Process(buffer, arraysize(buffer));
+  EXPECT_EQ(buffer + PAYLOAD_OFFSET, payloads[0]);
+  EXPECT_EQ(second_payload, payloads[1]);
+  EXPECT_FALSE(StreamDecoder_GetFragmentedFrameFlag());
+}
+
+/*
+ * Check that a message which spans two buffers is reassembled, and the
+ * complete messages either side of it are still decoded.
+ */
+TEST_F(StreamDecoderTest, messageSpansBuffers) {
+  StreamDecoder_Initialize(MessageHandler_HandleMessage);
+
+  const unsigned int split_index = PAYLOAD_OFFSET + 2;
+  uint8_t first[arraysize(empty_msg1) + split_index];
+  memcpy(first, empty_msg1, arraysize(empty_msg1));
+  memcpy(first + arraysize(empty_msg1), message1, split_index);
+
+  const unsigned int remainder = arraysize(message1) - split_index;
+  uint8_t second[remainder + arraysize(empty_msg1)];
+  memcpy(second, message1 + split_index, remainder);
+  memcpy(second + remainder, empty_msg1, arraysize(empty_msg1));
+
+  testing::InSequence seq;
+  EXPECT_CALL(message_handler_mock,
+              HandleMessage(MessageIs(0x44, 0x0201, nullptr, 0)));
+  EXPECT_CALL(message_handler_mock,
+              HandleMessage(MessageIs(0x45, 0x0202, message1 + PAYLOAD_OFFSET,
+                                      MSG1_PAYLOAD_SIZE)));
+  EXPECT_CALL(message_handler_mock,
+              HandleMessage(MessageIs(0x44, 0x0201, nullptr, 0)));
+
+  StreamDecoder_Process(first, arraysize(first));
+  StreamDecoder_Process(second, arraysize(second));
+  EXPECT_TRUE(StreamDecoder_GetFragmentedFrameFlag());
+  StreamDecoder_ClearFragmentedFrameFlag();
+}
+
+/*
+ * Check a complete message without an EOM is skipped.
+ */
+TEST_F(StreamDecoderTest, badEOMInBuffer) {
+  StreamDecoder_Initialize(MessageHandler_HandleMessage);
+
+  uint8_t buffer[arraysize(message1) + arraysize(empty_msg1)];
+  memcpy(buffer, message1, arraysize(message1));
+  buffer[arraysize(message1) - 1] = 0;
+  memcpy(buffer + arraysize(message1), empty_msg1, arraysize(empty_msg1));
+
+  EXPECT_CALL(message_handler_mock,
+              HandleMessage(MessageIs(0x44, 0x0201, nullptr, 0)));
+
+  StreamDecoder_Process(buffer, arraysize(buffer));
+}
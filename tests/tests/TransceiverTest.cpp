@@ -22,6 +22,7 @@
 #include <gtest/gtest.h>
 
 #include "Array.h"
+#include "app_settings.h"
 #include "transceiver.h"
 #include "setting_macros.h"
 
@@ -77,6 +78,16 @@ class TransceiverTest : public testing::Test {
       .timer_vector = AS_TIMER_INTERRUPT_VECTOR(3),
       .timer_source = AS_TIMER_INTERRUPT_SOURCE(3),
       .input_capture_timer = AS_IC_TMR_ID(3),
+      .tx_dma = false,
+      .tx_dma_channel = AS_DMA_CHANNEL(0),
+      .tx_dma_vector = AS_DMA_INTERRUPT_VECTOR(0),
+      .tx_dma_source = AS_DMA_INTERRUPT_SOURCE(0),
+      .tx_dma_trigger = AS_USART_DMA_TX_TRIGGER(1),
+      .rx_dma = false,
+      .rx_dma_channel = AS_DMA_CHANNEL(1),
+      .rx_dma_vector = AS_DMA_INTERRUPT_VECTOR(1),
+      .rx_dma_source = AS_DMA_INTERRUPT_SOURCE(1),
+      .rx_dma_trigger = AS_USART_DMA_RX_TRIGGER(1),
     };
     return settings;
   }
@@ -145,6 +156,23 @@ TEST_F(TransceiverTest, testModeChanges) {
   EXPECT_FALSE(Transceiver_QueueRDMRequest(token, NULL, 0, false));
   EXPECT_FALSE(Transceiver_QueueRDMResponse(token, NULL, 0));
 
+  // Switch to sniffer mode.
+  token++;
+  EXPECT_TRUE(Transceiver_SetMode(T_MODE_SNIFFER, token));
+  EXPECT_CALL(m_event_handler,
+              Run(EventIs(token, T_OP_MODE_CHANGE, T_RESULT_OK)))
+    .WillOnce(Return(true));
+  Transceiver_Tasks();
+  ASSERT_EQ(T_MODE_SNIFFER, Transceiver_GetMode());
+
+  // In sniffer mode nothing is sent.
+  EXPECT_FALSE(Transceiver_QueueDMX(token, NULL, 0));
+  EXPECT_FALSE(Transceiver_QueueASC(token, 0xdd, NULL, 0));
+  EXPECT_FALSE(Transceiver_QueueRDMDUB(token, NULL, 0));
+  EXPECT_FALSE(Transceiver_QueueRDMRequest(token, NULL, 0, false));
+  EXPECT_FALSE(Transceiver_QueueRDMResponse(token, NULL, 0));
+  EXPECT_FALSE(Transceiver_QueueSelfTest(token));
+
   // Switch back to controller mode
   token++;
   EXPECT_TRUE(Transceiver_SetMode(T_MODE_CONTROLLER, token));
@@ -152,6 +180,44 @@ TEST_F(TransceiverTest, testModeChanges) {
   EXPECT_FALSE(Transceiver_SetMode(T_MODE_CONTROLLER, ++token));
 }
 
+TEST_F(TransceiverTest, testDMXCoalescing) {
+  TransceiverHardwareSettings settings = DefaultSettings();
+  Transceiver_Initialize(&settings, &EventHandler, &EventHandler);
+
+  EXPECT_TRUE(Transceiver_SetMode(T_MODE_CONTROLLER, 1));
+  EXPECT_CALL(m_event_handler,
+              Run(EventIs(1, T_OP_MODE_CHANGE, T_RESULT_OK)))
+    .WillOnce(Return(true));
+  Transceiver_Tasks();
+
+  const uint8_t first[] = {1, 2, 3};
+  const uint8_t second[] = {4, 5, 6, 7};
+  EXPECT_TRUE(Transceiver_QueueDMX(2, first, arraysize(first)));
+
+  // The second frame replaces the first, which hasn't been sent yet.
+  EXPECT_CALL(m_event_handler,
+              Run(EventIs(2, T_OP_TX_ONLY, T_RESULT_SUPERSEDED)))
+    .WillOnce(Return(true));
+  EXPECT_TRUE(Transceiver_QueueDMX(3, second, arraysize(second)));
+
+  // A frame queued behind another operation doesn't replace the earlier one.
+  EXPECT_TRUE(Transceiver_QueueASC(10, 0xdd, NULL, 0));
+  EXPECT_TRUE(Transceiver_QueueDMX(4, first, arraysize(first)));
+
+  // But it can be replaced itself.
+  EXPECT_CALL(m_event_handler,
+              Run(EventIs(4, T_OP_TX_ONLY, T_RESULT_SUPERSEDED)))
+    .WillOnce(Return(true));
+  EXPECT_TRUE(Transceiver_QueueDMX(5, second, arraysize(second)));
+
+  // Once the queue is full, a DMX frame behind another operation is rejected.
+  for (unsigned int i = 3; i < TRANSCEIVER_QUEUE_DEPTH; i++) {
+    EXPECT_TRUE(Transceiver_QueueASC(10 + i, 0xdd, NULL, 0));
+  }
+  EXPECT_FALSE(Transceiver_QueueASC(20, 0xdd, NULL, 0));
+  EXPECT_FALSE(Transceiver_QueueDMX(6, first, arraysize(first)));
+}
+
 TEST_F(TransceiverTest, testSetBreakTime) {
   TransceiverHardwareSettings settings = DefaultSettings();
   Transceiver_Initialize(&settings, NULL, NULL);
@@ -182,6 +248,52 @@ TEST_F(TransceiverTest, testSetMarkTime) {
   EXPECT_EQ(800, Transceiver_GetMarkTime());
 }
 
+TEST_F(TransceiverTest, testSetDMXRefreshInterval) {
+  TransceiverHardwareSettings settings = DefaultSettings();
+  Transceiver_Initialize(&settings, NULL, NULL);
+
+  EXPECT_EQ(0, Transceiver_GetDMXRefreshInterval());
+  EXPECT_TRUE(Transceiver_SetDMXRefreshInterval(1));
+  EXPECT_EQ(1, Transceiver_GetDMXRefreshInterval());
+  EXPECT_TRUE(Transceiver_SetDMXRefreshInterval(10000));
+  EXPECT_EQ(10000, Transceiver_GetDMXRefreshInterval());
+  EXPECT_FALSE(Transceiver_SetDMXRefreshInterval(10001));
+  EXPECT_EQ(10000, Transceiver_GetDMXRefreshInterval());
+  EXPECT_TRUE(Transceiver_SetDMXRefreshInterval(0));
+  EXPECT_EQ(0, Transceiver_GetDMXRefreshInterval());
+}
+
+TEST_F(TransceiverTest, testSetDMXSync) {
+  TransceiverHardwareSettings settings = DefaultSettings();
+  Transceiver_Initialize(&settings, NULL, NULL);
+
+  EXPECT_EQ(0, Transceiver_GetDMXSyncPeriod());
+  EXPECT_EQ(0, Transceiver_GetDMXSyncAnchor());
+  EXPECT_TRUE(Transceiver_SetDMXSync(25, 100));
+  EXPECT_EQ(25, Transceiver_GetDMXSyncPeriod());
+  EXPECT_EQ(100, Transceiver_GetDMXSyncAnchor());
+  EXPECT_TRUE(Transceiver_SetDMXSync(1000, 2047));
+  EXPECT_EQ(1000, Transceiver_GetDMXSyncPeriod());
+  EXPECT_EQ(2047, Transceiver_GetDMXSyncAnchor());
+  EXPECT_FALSE(Transceiver_SetDMXSync(1001, 0));
+  EXPECT_FALSE(Transceiver_SetDMXSync(1, 2048));
+  EXPECT_EQ(1000, Transceiver_GetDMXSyncPeriod());
+  EXPECT_EQ(2047, Transceiver_GetDMXSyncAnchor());
+  EXPECT_TRUE(Transceiver_SetDMXSync(0, 0));
+  EXPECT_EQ(0, Transceiver_GetDMXSyncPeriod());
+}
+
+TEST_F(TransceiverTest, testPatchDMX) {
+  TransceiverHardwareSettings settings = DefaultSettings();
+  Transceiver_Initialize(&settings, NULL, NULL);
+
+  // Patching is only possible in controller mode, with refresh enabled.
+  const uint8_t data[] = {1, 2, 3};
+  EXPECT_FALSE(Transceiver_PatchDMX(0, data, arraysize(data)));
+  EXPECT_TRUE(Transceiver_SetDMXRefreshInterval(250));
+  EXPECT_FALSE(Transceiver_PatchDMX(0, data, arraysize(data)));
+}
+
 TEST_F(TransceiverTest, testSetRDMBroadcastListen) {
   TransceiverHardwareSettings settings = DefaultSettings();
   Transceiver_Initialize(&settings, NULL, NULL);
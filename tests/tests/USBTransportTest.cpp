@@ -22,29 +22,67 @@
 
 #include <string.h>
 
+#include <vector>
+
 #include "system_definitions.h"
 
 #include "Array.h"
 #include "BootloaderOptionsMock.h"
+#include "CoarseTimerMock.h"
 #include "Matchers.h"
 #include "ResetMock.h"
 #include "StreamDecoderMock.h"
+#include "app_settings.h"
 #include "flags.h"
+#include "latency_trace.h"
 #include "usb_device_mock.h"
 #include "usb_transport.h"
 
 using ::testing::Args;
+using ::testing::DoAll;
 using ::testing::InSequence;
+using ::testing::Invoke;
 using ::testing::Mock;
 using ::testing::NotNull;
 using ::testing::Pointee;
 using ::testing::Return;
 using ::testing::SaveArg;
+using ::testing::SetArgPointee;
 using ::testing::StrictMock;
 using ::testing::_;
 
 typedef void (*USBEventHandler)(USB_DEVICE_EVENT, void*, uintptr_t);
 
+namespace {
+
+std::vector<std::vector<uint8_t>> g_dmx_frames;
+
+void ReceiveDMXFrame(const uint8_t *data, unsigned int size) {
+  g_dmx_frames.push_back(std::vector<uint8_t>(data, data + size));
+}
+
+// Treat each byte as a message, and respond using the byte as the token.
+unsigned int EchoEachByte(const uint8_t *data, unsigned int) {
+  USBTransport_SendResponse(data[0], COMMAND_ECHO, RC_OK, NULL, 0);
+  return 1;
+}
+
+// Record the token of each message in a transfer to the host.
+std::vector<uint8_t> g_sent_tokens;
+
+USB_DEVICE_RESULT RecordTokens(USB_DEVICE_HANDLE, USB_DEVICE_TRANSFER_HANDLE*,
+                               USB_ENDPOINT_ADDRESS, const void *data,
+                               size_t size, USB_DEVICE_TRANSFER_FLAGS) {
+  // The responses have no payload, so each one is 9 bytes.
+  const uint8_t *transfer = reinterpret_cast<const uint8_t*>(data);
+  for (size_t i = 0; i + 9 <= size; i += 9) {
+    g_sent_tokens.push_back(transfer[i + 1]);
+  }
+  return USB_DEVICE_RESULT_OK;
+}
+
+}  // namespace
+
 class USBTransportTest : public testing::Test {
  public:
   void SetUp() {
@@ -52,6 +90,10 @@ class USBTransportTest : public testing::Test {
     StreamDecoder_SetMock(&m_stream_decoder_mock);
     BootloaderOptions_SetMock(&m_bootloader_options_mock);
     Reset_SetMock(&m_reset_mock);
+    Flags_Initialize(nullptr);
+    LatencyTrace_Initialize();
+    g_dmx_frames.clear();
+    g_sent_tokens.clear();
   }
 
   void TearDown() {
@@ -63,6 +105,8 @@ class USBTransportTest : public testing::Test {
 
   void ConfigureDevice();
   void CompleteWrite();
+  void CompleteRead(const uint8_t *data, unsigned int size);
+  void CompleteDMXRead(const uint8_t *data, unsigned int size);
 
  protected:
   StrictMock<MockUSBDevice> m_usb_mock;
@@ -78,10 +122,15 @@ class USBTransportTest : public testing::Test {
   // ConfigureDevice() has run
   USBEventHandler m_event_handler = nullptr;
 
-  // Pointer to the read buffer
-  void *m_read_buffer = nullptr;
+  // Pointers to the read buffers, and the index of the next one to complete.
+  void *m_read_buffers[2] = {nullptr, nullptr};
+  unsigned int m_next_read = 0;
+
+  // Pointer to the DMX endpoint read buffer.
+  void *m_dmx_buffer = nullptr;
 
   static const uint8_t kToken = 99;
+  static const USB_DEVICE_TRANSFER_HANDLE kDMXTransfer = 0x44;
 };
 
 /*
@@ -108,8 +157,19 @@ void USBTransportTest::ConfigureDevice() {
   EXPECT_CALL(m_usb_mock,
               EndpointEnable(m_usb_handle, 0, 0x81, USB_TRANSFER_TYPE_BULK, 64))
     .WillOnce(Return(USB_DEVICE_RESULT_OK));
+  EXPECT_CALL(m_usb_mock, EndpointIsEnabled(m_usb_handle, 4))
+    .WillOnce(Return(false));
+  EXPECT_CALL(m_usb_mock,
+              EndpointEnable(m_usb_handle, 0, 4, USB_TRANSFER_TYPE_BULK, 64))
+    .WillOnce(Return(USB_DEVICE_RESULT_OK));
+  EXPECT_CALL(m_usb_mock, EndpointRead(m_usb_handle, _, 4, _, _))
+    .WillOnce(DoAll(SetArgPointee<1>(kDMXTransfer),
+                    SaveArg<3>(&m_dmx_buffer),
+                    Return(USB_DEVICE_RESULT_OK)));
   EXPECT_CALL(m_usb_mock, EndpointRead(m_usb_handle, _, 1, _, _))
-    .WillOnce(DoAll(SaveArg<3>(&m_read_buffer),
+    .WillOnce(DoAll(SaveArg<3>(&m_read_buffers[0]),
+                    Return(USB_DEVICE_RESULT_OK)))
+    .WillOnce(DoAll(SaveArg<3>(&m_read_buffers[1]),
                     Return(USB_DEVICE_RESULT_OK)));
 
   USBTransport_Tasks();
@@ -138,6 +198,42 @@ void USBTransportTest::CompleteWrite() {
                   reinterpret_cast<void*>(&configurationValue), 0);
 }
 
+/*
+ * @brief Copy data into the next read buffer and trigger a read-complete event.
+ */
+void USBTransportTest::CompleteRead(const uint8_t *data, unsigned int size) {
+  ASSERT_THAT(m_event_handler, NotNull());
+  ASSERT_THAT(m_read_buffers[m_next_read], NotNull());
+  memcpy(m_read_buffers[m_next_read], data, size);
+  m_next_read = (m_next_read + 1) % arraysize(m_read_buffers);
+
+  USB_DEVICE_EVENT_DATA_ENDPOINT_READ_COMPLETE read_complete = {
+    .transferHandle = 0,
+    .length = size
+  };
+  m_event_handler(USB_DEVICE_EVENT_ENDPOINT_READ_COMPLETE,
+                  reinterpret_cast<void*>(&read_complete),
+                  sizeof(read_complete));
+}
+
+/*
+ * @brief Copy a frame into the DMX buffer and trigger a read-complete event.
+ */
+void USBTransportTest::CompleteDMXRead(const uint8_t *data,
+                                       unsigned int size) {
+  ASSERT_THAT(m_event_handler, NotNull());
+  ASSERT_THAT(m_dmx_buffer, NotNull());
+  memcpy(m_dmx_buffer, data, size);
+
+  USB_DEVICE_EVENT_DATA_ENDPOINT_READ_COMPLETE read_complete = {
+    .transferHandle = kDMXTransfer,
+    .length = size
+  };
+  m_event_handler(USB_DEVICE_EVENT_ENDPOINT_READ_COMPLETE,
+                  reinterpret_cast<void*>(&read_complete),
+                  sizeof(read_complete));
+}
+
 /*
  * Check an uninitialized transport doesn't send anything.
  */
@@ -145,7 +241,7 @@ TEST_F(USBTransportTest, uninitialized) {
   // Even though we call USBTransport_Initialize() here, since we haven't
   // called USBTransport_Tasks() the transport remains in an uninitialized
   // state.
-  USBTransport_Initialize(nullptr);
+  USBTransport_Initialize(nullptr, nullptr);
   EXPECT_FALSE(USBTransport_SendResponse(kToken, COMMAND_ECHO, RC_OK, NULL, 0));
 }
 
@@ -173,10 +269,18 @@ TEST_F(USBTransportTest, usbLifecycle) {
   EXPECT_CALL(m_usb_mock,
               EndpointEnable(m_usb_handle, 0, 0x81, USB_TRANSFER_TYPE_BULK, 64))
     .WillOnce(Return(USB_DEVICE_RESULT_OK));
-  EXPECT_CALL(m_usb_mock, EndpointRead(m_usb_handle, _, 1, _, _))
+  EXPECT_CALL(m_usb_mock, EndpointIsEnabled(m_usb_handle, 4))
+    .WillOnce(Return(false));
+  EXPECT_CALL(m_usb_mock,
+              EndpointEnable(m_usb_handle, 0, 4, USB_TRANSFER_TYPE_BULK, 64))
+    .WillOnce(Return(USB_DEVICE_RESULT_OK));
+  EXPECT_CALL(m_usb_mock, EndpointRead(m_usb_handle, _, 4, _, _))
     .WillOnce(Return(USB_DEVICE_RESULT_OK));
+  EXPECT_CALL(m_usb_mock, EndpointRead(m_usb_handle, _, 1, _, _))
+    .Times(2)
+    .WillRepeatedly(Return(USB_DEVICE_RESULT_OK));
 
-  USBTransport_Initialize(nullptr);
+  USBTransport_Initialize(nullptr, nullptr);
   EXPECT_FALSE(USBTransport_IsConfigured());
 
   // First call the USB stack isn't ready yet
@@ -214,6 +318,10 @@ TEST_F(USBTransportTest, usbLifecycle) {
     .WillOnce(Return(true));
   EXPECT_CALL(m_usb_mock, EndpointDisable(m_usb_handle, 1))
     .WillOnce(Return(USB_DEVICE_RESULT_OK));
+  EXPECT_CALL(m_usb_mock, EndpointIsEnabled(m_usb_handle, 4))
+    .WillOnce(Return(true));
+  EXPECT_CALL(m_usb_mock, EndpointDisable(m_usb_handle, 4))
+    .WillOnce(Return(USB_DEVICE_RESULT_OK));
 
   event_handler(USB_DEVICE_EVENT_POWER_REMOVED, nullptr, 0u);
   USBTransport_Tasks();
@@ -221,7 +329,7 @@ TEST_F(USBTransportTest, usbLifecycle) {
 }
 
 TEST_F(USBTransportTest, alternateSettings) {
-  USBTransport_Initialize(nullptr);
+  USBTransport_Initialize(nullptr, nullptr);
   ConfigureDevice();
 
   // Get alt settings
@@ -260,7 +368,7 @@ TEST_F(USBTransportTest, alternateSettings) {
 }
 
 TEST_F(USBTransportTest, dfuGetStatus) {
-  USBTransport_Initialize(nullptr);
+  USBTransport_Initialize(nullptr, nullptr);
   ConfigureDevice();
 
   // Response is all 0s.
@@ -283,7 +391,7 @@ TEST_F(USBTransportTest, dfuGetStatus) {
 }
 
 TEST_F(USBTransportTest, dfuDetach) {
-  USBTransport_Initialize(nullptr);
+  USBTransport_Initialize(nullptr, nullptr);
   ConfigureDevice();
 
   EXPECT_CALL(m_usb_mock,
@@ -312,33 +420,69 @@ TEST_F(USBTransportTest, read) {
     1, 2, 3, 4, 5, 6, 7, 8, 9, 0
   };
 
-  USBTransport_Initialize(StreamDecoder_Process);
+  USBTransport_Initialize(StreamDecoder_ProcessMessage, nullptr);
   ConfigureDevice();
 
-  EXPECT_CALL(m_stream_decoder_mock, Process(_, _))
+  EXPECT_CALL(m_stream_decoder_mock, ProcessMessage(_, _))
       .With(Args<0, 1>(DataIs(packet, arraysize(packet))));
-  EXPECT_CALL(m_usb_mock, EndpointRead(m_usb_handle, _, 1, _, _))
-    .WillOnce(DoAll(SaveArg<3>(&m_read_buffer),
-                    Return(USB_DEVICE_RESULT_OK)));
+  // The buffer is handed back to the USB stack once it's processed.
+  EXPECT_CALL(m_usb_mock, EndpointRead(m_usb_handle, _, 1, m_read_buffers[0],
+                                       USB_READ_BUFFER_SIZE))
+    .WillOnce(Return(USB_DEVICE_RESULT_OK));
 
-  memcpy(reinterpret_cast<uint8_t*>(m_read_buffer), packet, arraysize(packet));
-  USB_DEVICE_EVENT_DATA_ENDPOINT_READ_COMPLETE read_complete = {
-    .transferHandle = 0,
-    .length = arraysize(packet)
-  };
+  CompleteRead(packet, arraysize(packet));
+  USBTransport_Tasks();
+}
 
-  m_event_handler(USB_DEVICE_EVENT_ENDPOINT_READ_COMPLETE,
-                  reinterpret_cast<void*>(&read_complete),
-                  sizeof(read_complete));
+/*
+ * Check a second message from the host is received while the first is
+ * processed.
+ */
+TEST_F(USBTransportTest, doubleBufferedRead) {
+  const uint8_t packet1[] = {1, 2, 3, 4};
+  const uint8_t packet2[] = {5, 6, 7, 8, 9};
+
+  USBTransport_Initialize(StreamDecoder_ProcessMessage, nullptr);
+  ConfigureDevice();
+
+  // Both reads complete before the first is processed.
+  CompleteRead(packet1, arraysize(packet1));
+  CompleteRead(packet2, arraysize(packet2));
+
+  InSequence seq;
+  EXPECT_CALL(m_stream_decoder_mock, ProcessMessage(_, _))
+      .With(Args<0, 1>(DataIs(packet1, arraysize(packet1))));
+  EXPECT_CALL(m_usb_mock, EndpointRead(m_usb_handle, _, 1, m_read_buffers[0],
+                                       USB_READ_BUFFER_SIZE))
+    .WillOnce(Return(USB_DEVICE_RESULT_OK));
+  EXPECT_CALL(m_stream_decoder_mock, ProcessMessage(_, _))
+      .With(Args<0, 1>(DataIs(packet2, arraysize(packet2))));
+  EXPECT_CALL(m_usb_mock, EndpointRead(m_usb_handle, _, 1, m_read_buffers[1],
+                                       USB_READ_BUFFER_SIZE))
+    .WillOnce(Return(USB_DEVICE_RESULT_OK));
 
   USBTransport_Tasks();
+  USBTransport_Tasks();
+
+  // Nothing more to process.
+  USBTransport_Tasks();
+  Mock::VerifyAndClearExpectations(&m_stream_decoder_mock);
+
+  // The buffers continue to be used in turn.
+  EXPECT_CALL(m_stream_decoder_mock, ProcessMessage(_, _))
+      .With(Args<0, 1>(DataIs(packet1, arraysize(packet1))));
+  EXPECT_CALL(m_usb_mock, EndpointRead(m_usb_handle, _, 1, m_read_buffers[0],
+                                       USB_READ_BUFFER_SIZE))
+    .WillOnce(Return(USB_DEVICE_RESULT_OK));
+  CompleteRead(packet1, arraysize(packet1));
+  USBTransport_Tasks();
 }
 
 /*
  * Check sending messages to the Host works.
  */
 TEST_F(USBTransportTest, sendResponse) {
-  USBTransport_Initialize(StreamDecoder_Process);
+  USBTransport_Initialize(StreamDecoder_ProcessMessage, nullptr);
 
   // Try with a unconfigured transport.
   EXPECT_FALSE(USBTransport_SendResponse(kToken, COMMAND_ECHO, RC_OK, NULL, 0));
@@ -366,7 +510,7 @@ TEST_F(USBTransportTest, sendResponse) {
 }
 
 TEST_F(USBTransportTest, doubleSendResponse) {
-  USBTransport_Initialize(StreamDecoder_Process);
+  USBTransport_Initialize(StreamDecoder_ProcessMessage, nullptr);
   ConfigureDevice();
 
   const uint8_t expected_message[] = {
@@ -380,18 +524,319 @@ TEST_F(USBTransportTest, doubleSendResponse) {
       .With(Args<3, 4>(DataIs(expected_message, arraysize(expected_message))))
       .WillOnce(Return(USB_DEVICE_RESULT_OK));
 
+  const uint8_t expected_message2[] = {
+    0x5a, kToken + 1, 0xf0, 0x00, 0x00, 0x00, 0x00, 0x00, 0xa5
+  };
+
+  InSequence seq;
+  EXPECT_CALL(
+      m_usb_mock,
+      EndpointWrite(m_usb_handle, _, 0x81, _, _,
+                    USB_DEVICE_TRANSFER_FLAGS_DATA_COMPLETE))
+      .With(Args<3, 4>(DataIs(expected_message2,
+                              arraysize(expected_message2))))
+      .WillOnce(Return(USB_DEVICE_RESULT_OK));
+
   EXPECT_TRUE(USBTransport_SendResponse(kToken, COMMAND_ECHO, RC_OK, NULL, 0));
-  // Try to send a second message while the first is pending.
-  EXPECT_FALSE(
+  // The second message is queued while the first is pending.
+  EXPECT_TRUE(
       USBTransport_SendResponse(kToken + 1, COMMAND_ECHO, RC_OK, NULL, 0));
   EXPECT_TRUE(USBTransport_WritePending());
 
+  // The second message is written once the first completes.
+  CompleteWrite();
+  EXPECT_TRUE(USBTransport_WritePending());
+  USBTransport_Tasks();
+  EXPECT_TRUE(USBTransport_WritePending());
+
+  CompleteWrite();
+  EXPECT_FALSE(USBTransport_WritePending());
+}
+
+TEST_F(USBTransportTest, queueFull) {
+  USBTransport_Initialize(StreamDecoder_ProcessMessage, nullptr);
+  ConfigureDevice();
+
+  EXPECT_CALL(
+      m_usb_mock,
+      EndpointWrite(m_usb_handle, _, 0x81, _, _,
+                    USB_DEVICE_TRANSFER_FLAGS_DATA_COMPLETE))
+      .Times(2)
+      .WillRepeatedly(Return(USB_DEVICE_RESULT_OK));
+
+  for (unsigned int i = 0; i < USB_TRANSPORT_TX_QUEUE_SIZE; i++) {
+    EXPECT_TRUE(
+        USBTransport_SendResponse(kToken + i, COMMAND_ECHO, RC_OK, NULL, 0));
+  }
+  EXPECT_FALSE(Flags_HasChanged());
+
+  // The queue is full, so this is dropped.
+  EXPECT_FALSE(USBTransport_SendResponse(kToken, COMMAND_ECHO, RC_OK, NULL, 0));
+  EXPECT_TRUE(Flags_HasChanged());
+
+  USBTransportStats stats;
+  USBTransport_GetStats(&stats);
+  EXPECT_EQ(1u, stats.dropped);
+  EXPECT_EQ(0u, stats.tx_errors);
+  EXPECT_EQ(USB_TRANSPORT_TX_QUEUE_SIZE, stats.queue_depth);
+  EXPECT_EQ(USB_TRANSPORT_TX_QUEUE_SIZE, stats.queue_high_water);
+
+  // Drain the queue, the remaining messages go out in a single transfer.
+  CompleteWrite();
+  USBTransport_Tasks();
+  EXPECT_TRUE(USBTransport_WritePending());
+  CompleteWrite();
+  USBTransport_Tasks();
+  EXPECT_FALSE(USBTransport_WritePending());
+
+  USBTransport_GetStats(&stats);
+  EXPECT_EQ(0u, stats.queue_depth);
+  EXPECT_EQ(USB_TRANSPORT_TX_QUEUE_SIZE, stats.queue_high_water);
+
+  USBTransport_ResetStats();
+  USBTransport_GetStats(&stats);
+  EXPECT_EQ(0u, stats.dropped);
+  EXPECT_EQ(0u, stats.queue_high_water);
+}
+
+/*
+ * Check data from the host is processed while a write is pending.
+ */
+TEST_F(USBTransportTest, readWhileWritePending) {
+  const uint8_t packet[] = {1, 2, 3, 4};
+
+  USBTransport_Initialize(StreamDecoder_ProcessMessage, nullptr);
+  ConfigureDevice();
+
+  EXPECT_CALL(
+      m_usb_mock,
+      EndpointWrite(m_usb_handle, _, 0x81, _, _,
+                    USB_DEVICE_TRANSFER_FLAGS_DATA_COMPLETE))
+      .Times(2)
+      .WillRepeatedly(Return(USB_DEVICE_RESULT_OK));
+  EXPECT_TRUE(USBTransport_SendResponse(kToken, COMMAND_ECHO, RC_OK, NULL, 0));
+
+  EXPECT_CALL(m_stream_decoder_mock, ProcessMessage(_, _))
+      .With(Args<0, 1>(DataIs(packet, arraysize(packet))));
+  EXPECT_CALL(m_usb_mock, EndpointRead(m_usb_handle, _, 1, _, _))
+    .WillOnce(Return(USB_DEVICE_RESULT_OK));
+
+  CompleteRead(packet, arraysize(packet));
+  USBTransport_Tasks();
+  Mock::VerifyAndClearExpectations(&m_stream_decoder_mock);
+
+  // Once the queue is full, reads are held off until there is space.
+  for (unsigned int i = 1; i < USB_TRANSPORT_TX_QUEUE_SIZE; i++) {
+    EXPECT_TRUE(
+        USBTransport_SendResponse(kToken + i, COMMAND_ECHO, RC_OK, NULL, 0));
+  }
+  CompleteRead(packet, arraysize(packet));
+  USBTransport_Tasks();
+  Mock::VerifyAndClearExpectations(&m_stream_decoder_mock);
+
+  EXPECT_CALL(m_stream_decoder_mock, ProcessMessage(_, _))
+      .With(Args<0, 1>(DataIs(packet, arraysize(packet))));
+  EXPECT_CALL(m_usb_mock, EndpointRead(m_usb_handle, _, 1, _, _))
+    .WillOnce(Return(USB_DEVICE_RESULT_OK));
+  CompleteWrite();
+  USBTransport_Tasks();
+}
+
+/*
+ * Check a transfer with more messages than the TX queue can hold gets a
+ * response to every message.
+ */
+TEST_F(USBTransportTest, pipelinedRequests) {
+  const uint8_t packet[] = {1, 2, 3, 4, 5, 6, 7};
+
+  USBTransport_Initialize(StreamDecoder_ProcessMessage, nullptr);
+  ConfigureDevice();
+
+  EXPECT_CALL(m_stream_decoder_mock, ProcessMessage(_, _))
+      .Times(arraysize(packet))
+      .WillRepeatedly(Invoke(EchoEachByte));
+  EXPECT_CALL(
+      m_usb_mock,
+      EndpointWrite(m_usb_handle, _, 0x81, _, _,
+                    USB_DEVICE_TRANSFER_FLAGS_DATA_COMPLETE))
+      .WillRepeatedly(Invoke(RecordTokens));
+
+  CompleteRead(packet, arraysize(packet));
+  USBTransport_Tasks();
+  Mock::VerifyAndClearExpectations(&m_usb_mock);
+
+  // The buffer is only handed back once every message has been processed.
+  EXPECT_CALL(
+      m_usb_mock,
+      EndpointWrite(m_usb_handle, _, 0x81, _, _,
+                    USB_DEVICE_TRANSFER_FLAGS_DATA_COMPLETE))
+      .WillRepeatedly(Invoke(RecordTokens));
+  EXPECT_CALL(m_usb_mock, EndpointRead(m_usb_handle, _, 1, m_read_buffers[0],
+                                       USB_READ_BUFFER_SIZE))
+    .WillOnce(Return(USB_DEVICE_RESULT_OK));
+  while (USBTransport_WritePending()) {
+    CompleteWrite();
+    USBTransport_Tasks();
+  }
+
+  EXPECT_EQ(std::vector<uint8_t>(packet, packet + arraysize(packet)),
+            g_sent_tokens);
+
+  USBTransportStats stats;
+  USBTransport_GetStats(&stats);
+  EXPECT_EQ(0u, stats.dropped);
+  EXPECT_EQ(USB_TRANSPORT_TX_QUEUE_SIZE, stats.queue_high_water);
+}
+
+/*
+ * Check messages queued behind a write are coalesced into a single transfer.
+ */
+TEST_F(USBTransportTest, coalesceResponses) {
+  USBTransport_Initialize(StreamDecoder_ProcessMessage, nullptr);
+  ConfigureDevice();
+
+  const uint8_t expected_message[] = {
+    0x5a, kToken, 0xf0, 0x00, 0x00, 0x00, 0x00, 0x00, 0xa5
+  };
+  const uint8_t expected_transfer[] = {
+    0x5a, kToken + 1, 0xf0, 0x00, 0x00, 0x00, 0x00, 0x00, 0xa5,
+    0x5a, kToken + 2, 0xf0, 0x00, 0x01, 0x00, 0x00, 0x00, 0x07, 0xa5
+  };
+
+  InSequence seq;
+  EXPECT_CALL(
+      m_usb_mock,
+      EndpointWrite(m_usb_handle, _, 0x81, _, _,
+                    USB_DEVICE_TRANSFER_FLAGS_DATA_COMPLETE))
+      .With(Args<3, 4>(DataIs(expected_message, arraysize(expected_message))))
+      .WillOnce(Return(USB_DEVICE_RESULT_OK));
+  EXPECT_CALL(
+      m_usb_mock,
+      EndpointWrite(m_usb_handle, _, 0x81, _, _,
+                    USB_DEVICE_TRANSFER_FLAGS_DATA_COMPLETE))
+      .With(Args<3, 4>(DataIs(expected_transfer,
+                              arraysize(expected_transfer))))
+      .WillOnce(Return(USB_DEVICE_RESULT_OK));
+
+  const uint8_t payload = 7;
+  IOVec iovec { &payload, sizeof(payload) };
+
+  EXPECT_TRUE(USBTransport_SendResponse(kToken, COMMAND_ECHO, RC_OK, NULL, 0));
+  EXPECT_TRUE(
+      USBTransport_SendResponse(kToken + 1, COMMAND_ECHO, RC_OK, NULL, 0));
+  EXPECT_TRUE(
+      USBTransport_SendResponse(kToken + 2, COMMAND_ECHO, RC_OK, &iovec, 1));
+
+  CompleteWrite();
+  USBTransport_Tasks();
+  EXPECT_TRUE(USBTransport_WritePending());
   CompleteWrite();
   EXPECT_FALSE(USBTransport_WritePending());
+
+  USBTransportStats stats;
+  USBTransport_GetStats(&stats);
+  EXPECT_EQ(2u, stats.coalesced);
+}
+
+/*
+ * Check large messages are split across transfers.
+ */
+TEST_F(USBTransportTest, coalesceLimit) {
+  USBTransport_Initialize(StreamDecoder_ProcessMessage, nullptr);
+  ConfigureDevice();
+
+  uint8_t payload[PAYLOAD_SIZE];
+  memset(payload, 0, arraysize(payload));
+  IOVec iovec { payload, PAYLOAD_SIZE };
+
+  const unsigned int message_size = PAYLOAD_SIZE + 9;
+  ASSERT_GT(2 * message_size, USB_TRANSPORT_MAX_TRANSFER_SIZE);
+
+  // Each message ends up in its own transfer.
+  EXPECT_CALL(
+      m_usb_mock,
+      EndpointWrite(m_usb_handle, _, 0x81, _, message_size,
+                    USB_DEVICE_TRANSFER_FLAGS_DATA_COMPLETE))
+      .Times(3)
+      .WillRepeatedly(Return(USB_DEVICE_RESULT_OK));
+
+  for (unsigned int i = 0; i < 3; i++) {
+    EXPECT_TRUE(
+        USBTransport_SendResponse(kToken + i, COMMAND_ECHO, RC_OK, &iovec, 1));
+  }
+
+  for (unsigned int i = 0; i < 3; i++) {
+    CompleteWrite();
+    USBTransport_Tasks();
+  }
+  EXPECT_FALSE(USBTransport_WritePending());
+
+  USBTransportStats stats;
+  USBTransport_GetStats(&stats);
+  EXPECT_EQ(0u, stats.coalesced);
+}
+
+/*
+ * Check frames from the DMX endpoint are passed to the DMX callback.
+ */
+TEST_F(USBTransportTest, dmxEndpoint) {
+  const uint8_t frame[] = {0, 1, 2, 3, 4, 5};
+
+  USBTransport_Initialize(StreamDecoder_ProcessMessage, ReceiveDMXFrame);
+  ConfigureDevice();
+
+  // Nothing has been received yet.
+  USBTransport_Tasks();
+  EXPECT_TRUE(g_dmx_frames.empty());
+
+  EXPECT_CALL(m_usb_mock, EndpointRead(m_usb_handle, _, 4, m_dmx_buffer,
+                                       USB_READ_BUFFER_SIZE))
+    .WillOnce(DoAll(SetArgPointee<1>(kDMXTransfer),
+                    Return(USB_DEVICE_RESULT_OK)));
+
+  CompleteDMXRead(frame, arraysize(frame));
+  USBTransport_Tasks();
+
+  ASSERT_EQ(1u, g_dmx_frames.size());
+  EXPECT_THAT(g_dmx_frames[0], testing::ElementsAreArray(frame));
+}
+
+/*
+ * Check DMX frames are still received when the main endpoint is held off.
+ */
+TEST_F(USBTransportTest, dmxWhileTXQueueFull) {
+  const uint8_t frame[] = {0, 1, 2, 3, 4, 5};
+  const uint8_t packet[] = {1, 2, 3, 4};
+
+  USBTransport_Initialize(StreamDecoder_ProcessMessage, ReceiveDMXFrame);
+  ConfigureDevice();
+
+  EXPECT_CALL(
+      m_usb_mock,
+      EndpointWrite(m_usb_handle, _, 0x81, _, _,
+                    USB_DEVICE_TRANSFER_FLAGS_DATA_COMPLETE))
+      .WillOnce(Return(USB_DEVICE_RESULT_OK));
+  for (unsigned int i = 0; i < USB_TRANSPORT_TX_QUEUE_SIZE; i++) {
+    EXPECT_TRUE(
+        USBTransport_SendResponse(kToken + i, COMMAND_ECHO, RC_OK, NULL, 0));
+  }
+
+  EXPECT_CALL(m_usb_mock, EndpointRead(m_usb_handle, _, 4, m_dmx_buffer,
+                                       USB_READ_BUFFER_SIZE))
+    .WillOnce(DoAll(SetArgPointee<1>(kDMXTransfer),
+                    Return(USB_DEVICE_RESULT_OK)));
+
+  // The host message waits, the DMX frame doesn't.
+  CompleteRead(packet, arraysize(packet));
+  CompleteDMXRead(frame, arraysize(frame));
+  USBTransport_Tasks();
+
+  ASSERT_EQ(1u, g_dmx_frames.size());
+  EXPECT_THAT(g_dmx_frames[0], testing::ElementsAreArray(frame));
 }
 
 TEST_F(USBTransportTest, sendResponseWithData) {
-  USBTransport_Initialize(StreamDecoder_Process);
+  USBTransport_Initialize(StreamDecoder_ProcessMessage, nullptr);
   ConfigureDevice();
 
   const uint8_t chunk1[] = {1, 2, 3, 4, 5, 6, 7, 8};
@@ -423,8 +868,45 @@ TEST_F(USBTransportTest, sendResponseWithData) {
   EXPECT_FALSE(USBTransport_WritePending());
 }
 
+TEST_F(USBTransportTest, latencyTrace) {
+  StrictMock<MockCoarseTimer> timer_mock;
+  CoarseTimer_SetMock(&timer_mock);
+  EXPECT_CALL(timer_mock, GetTime())
+      .WillOnce(Return(0x20))
+      .WillOnce(Return(0x1234));
+
+  USBTransport_Initialize(StreamDecoder_ProcessMessage, nullptr);
+  ConfigureDevice();
+  LatencyTrace_SetEnabled(true);
+  LatencyTrace_Start(kToken);
+
+  const uint8_t payload[] = {1, 2};
+  IOVec iovec = { reinterpret_cast<const void*>(&payload), arraysize(payload) };
+
+  // The trailer follows the payload, and isn't included in the length.
+  const uint8_t expected_message[] = {
+    0x5a, kToken, 0xf0, 0x00, 0x02, 0x00, 0x00, 0x08,
+    1, 2,
+    0x11, 0x20, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0x34, 0x12, 0, 0,
+    0xa5
+  };
+
+  EXPECT_CALL(
+      m_usb_mock,
+      EndpointWrite(m_usb_handle, _, 0x81, _, _,
+                    USB_DEVICE_TRANSFER_FLAGS_DATA_COMPLETE))
+      .With(Args<3, 4>(DataIs(expected_message, arraysize(expected_message))))
+      .WillOnce(Return(USB_DEVICE_RESULT_OK));
+
+  EXPECT_TRUE(USBTransport_SendResponse(kToken, COMMAND_ECHO, RC_OK, &iovec,
+                                        1));
+  CompleteWrite();
+  CoarseTimer_SetMock(nullptr);
+}
+
 TEST_F(USBTransportTest, sendError) {
-  USBTransport_Initialize(StreamDecoder_Process);
+  USBTransport_Initialize(StreamDecoder_ProcessMessage, nullptr);
   ConfigureDevice();
 
   EXPECT_CALL(
@@ -435,10 +917,15 @@ TEST_F(USBTransportTest, sendError) {
 
   EXPECT_FALSE(USBTransport_SendResponse(kToken, COMMAND_ECHO, RC_OK, NULL, 0));
   EXPECT_FALSE(USBTransport_WritePending());
+
+  USBTransportStats stats;
+  USBTransport_GetStats(&stats);
+  EXPECT_EQ(1u, stats.tx_errors);
+  EXPECT_EQ(0u, stats.queue_depth);
 }
 
 TEST_F(USBTransportTest, truncateResponse) {
-  USBTransport_Initialize(StreamDecoder_Process);
+  USBTransport_Initialize(StreamDecoder_ProcessMessage, nullptr);
   ConfigureDevice();
 
   // Send a lot of data, and make sure we set the truncated bit.
@@ -476,7 +963,7 @@ TEST_F(USBTransportTest, truncateResponse) {
 }
 
 TEST_F(USBTransportTest, pendingFlags) {
-  USBTransport_Initialize(StreamDecoder_Process);
+  USBTransport_Initialize(StreamDecoder_ProcessMessage, nullptr);
   ConfigureDevice();
 
   Flags_SetTXDrop();
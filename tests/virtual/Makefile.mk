@@ -0,0 +1,52 @@
+# Virtual Ja Rule
+##################################################
+# The firmware built natively, with the transceiver running against the
+# simulated peripherals and the USB transport bridged to a Unix domain socket.
+
+noinst_PROGRAMS += tests/virtual/virtual_ja_rule
+
+# The virtual headers come first, so they override the board config.
+VIRTUAL_CFLAGS = -I tests/virtual $(BUILD_FLAGS) -Wno-unused-parameter
+
+tests_virtual_virtual_ja_rule_SOURCES = \
+    common/uid_store.c \
+    firmware/src/app.c \
+    firmware/src/coarse_timer.c \
+    firmware/src/dimmer_model.c \
+    firmware/src/dmx_stream.c \
+    firmware/src/flags.c \
+    firmware/src/latency_trace.c \
+    firmware/src/led_model.c \
+    firmware/src/message_handler.c \
+    firmware/src/moving_light.c \
+    firmware/src/network_model.c \
+    firmware/src/proxy_model.c \
+    firmware/src/random.c \
+    firmware/src/rdm_batch.c \
+    firmware/src/rdm_buffer.c \
+    firmware/src/rdm_discovery.c \
+    firmware/src/rdm_handler.c \
+    firmware/src/rdm_responder.c \
+    firmware/src/rdm_util.c \
+    firmware/src/receiver_counters.c \
+    firmware/src/responder.c \
+    firmware/src/sensor_model.c \
+    firmware/src/spi_rgb.c \
+    firmware/src/stream_decoder.c \
+    firmware/src/syslog.c \
+    firmware/src/transceiver.c \
+    firmware/src/usb_transport.c \
+    tests/virtual/VirtualJaRule.cpp \
+    tests/virtual/app_pipeline.h \
+    tests/virtual/common_settings.h \
+    tests/virtual/temperature.c \
+    tests/virtual/usb_console.c \
+    tests/virtual/usb_descriptors.c
+tests_virtual_virtual_ja_rule_CFLAGS = $(VIRTUAL_CFLAGS)
+tests_virtual_virtual_ja_rule_CXXFLAGS = $(TESTING_CXXFLAGS) $(OLA_CFLAGS)
+tests_virtual_virtual_ja_rule_LDADD = \
+    $(GMOCK_LIBS) $(GTEST_LIBS) $(OLA_LIBS) \
+    tests/sim/libsim.la \
+    tests/harmony/mocks/libharmonymock.la \
+    tests/mocks/libbootloaderoptionsmock.la \
+    tests/mocks/libresetmock.la
@@ -0,0 +1,259 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * VirtualJaRule.cpp
+ * Run the firmware natively, against the simulated peripherals.
+ * Copyright (C) 2015 Simon Newton
+ */
+
+#include <getopt.h>
+#include <gmock/gmock.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sysexits.h>
+
+#include <memory>
+
+#include "app.h"
+#include "app_settings.h"
+#include "system_config.h"
+#include "plib_eth_mock.h"
+#include "setting_macros.h"
+
+#include "tests/sim/InterruptController.h"
+#include "tests/sim/PeripheralDMA.h"
+#include "tests/sim/PeripheralInputCapture.h"
+#include "tests/sim/PeripheralTimer.h"
+#include "tests/sim/PeripheralUART.h"
+#include "tests/sim/Simulator.h"
+#include "tests/sim/SocketUSBDevice.h"
+
+using ::testing::NiceMock;
+using ::testing::Return;
+using ::testing::_;
+using ola::NewCallback;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Declare the ISR symbols.
+void TimerEvent();
+void InputCaptureEvent(void);
+void Transceiver_TimerEvent();
+void Transceiver_UARTEvent();
+void Transceiver_TXDMAEvent();
+void Transceiver_RXDMAEvent();
+
+#ifdef __cplusplus
+}
+#endif
+
+namespace {
+
+const uint32_t kClockSpeed = SYS_CLK_FREQ;
+
+// The default serial number, this gives a UID of 7a70:10000010.
+const uint32_t kDefaultSerialNumber = 1;
+
+const char kDefaultSocket[] = "/tmp/ja-rule.sock";
+
+// The USB endpoints, these match usb_transport.c.
+const USB_ENDPOINT_ADDRESS kOutEndpoint = 0x01;
+const USB_ENDPOINT_ADDRESS kInEndpoint = 0x81;
+
+// The Microchip OUI, see uid_store.c.
+const uint8_t kOUI[] = {0x00, 0x1e, 0xc0};
+
+Simulator *g_simulator = nullptr;
+
+typedef struct {
+  const char *socket;
+  uint32_t serial_number;
+  uint32_t duration;
+  bool help;
+} Options;
+
+void DisplayHelpAndExit(const char *arg0, int exit_code) {
+  printf("Usage: %s [options]\n", arg0);
+  printf("  -d, --duration <s>  Stop after s seconds of virtual time\n");
+  printf("  -h, --help   Show the help message\n");
+  printf("  -n, --serial <n>  The serial number, used to form the UID, "
+         "default %u\n", kDefaultSerialNumber);
+  printf("  -s, --socket <path>  The Unix domain socket to listen on, "
+         "default %s\n", kDefaultSocket);
+  exit(exit_code);
+}
+
+void InitOptions(Options *options, int argc, char *argv[]) {
+  options->socket = kDefaultSocket;
+  options->serial_number = kDefaultSerialNumber;
+  options->duration = 0u;
+  options->help = false;
+
+  static struct option long_options[] = {
+      {"duration", required_argument, 0, 'd'},
+      {"help", no_argument, 0, 'h'},
+      {"serial", required_argument, 0, 'n'},
+      {"socket", required_argument, 0, 's'},
+      {0, 0, 0, 0}
+    };
+
+  int c;
+  int option_index = 0;
+  char *end;
+
+  while (1) {
+    c = getopt_long(argc, argv, "d:hn:s:", long_options, &option_index);
+
+    if (c == -1)
+      break;
+
+    switch (c) {
+      case 0:
+        break;
+      case 'd':
+        options->duration = strtoul(optarg, &end, 10);
+        if (*end != 0) {
+          printf("Invalid duration\n");
+          exit(EX_USAGE);
+        }
+        break;
+      case 'h':
+        options->help = true;
+        break;
+      case 'n':
+        options->serial_number = strtoul(optarg, &end, 0);
+        if (*end != 0 || options->serial_number > 0xffffff) {
+          printf("Invalid serial number, must be 24 bits\n");
+          exit(EX_USAGE);
+        }
+        break;
+      case 's':
+        options->socket = optarg;
+        break;
+      default:
+        {}
+    }
+  }
+
+  if (options->help) {
+    DisplayHelpAndExit(argv[0], 0);
+  }
+}
+
+void StopSimulator(int) {
+  if (g_simulator) {
+    g_simulator->Stop();
+  }
+}
+
+// The transceiver output isn't connected to anything.
+void DiscardByte(USART_MODULE_ID, uint8_t) {}
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  Options options;
+  InitOptions(&options, argc, argv);
+
+  // The MAC address is read by the UID store.
+  NiceMock<MockPeripheralEth> eth;
+  uint8_t mac[] = {
+    kOUI[0], kOUI[1], kOUI[2],
+    static_cast<uint8_t>(options.serial_number >> 16),
+    static_cast<uint8_t>(options.serial_number >> 8),
+    static_cast<uint8_t>(options.serial_number),
+  };
+  for (unsigned int i = 0; i < sizeof(mac); i++) {
+    ON_CALL(eth, StationAddressGet(_, i + 1)).WillByDefault(Return(mac[i]));
+  }
+  PLIB_Eth_SetMock(&eth);
+
+  std::unique_ptr<PeripheralUART::TXCallback> tx_callback(
+      NewCallback(&DiscardByte));
+  std::unique_ptr<Simulator::TaskFn> app_tasks(NewCallback(&APP_Tasks));
+
+  Simulator simulator(kClockSpeed);
+  InterruptController interrupt_controller;
+  PeripheralTimer timer(&simulator, &interrupt_controller);
+  PeripheralInputCapture ic(&simulator, &interrupt_controller);
+  PeripheralUART uart(&simulator, &interrupt_controller, tx_callback.get());
+  PeripheralDMA dma(&simulator, &interrupt_controller, &uart);
+  SocketUSBDevice usb_device(&simulator, kClockSpeed, kOutEndpoint,
+                             kInEndpoint);
+
+  if (!usb_device.Listen(options.socket)) {
+    printf("Failed to listen on %s\n", options.socket);
+    return EX_UNAVAILABLE;
+  }
+
+  PLIB_TMR_SetMock(&timer);
+  PLIB_IC_SetMock(&ic);
+  PLIB_USART_SetMock(&uart);
+  PLIB_DMA_SetMock(&dma);
+  SYS_INT_SetMock(&interrupt_controller);
+  USBDevice_SetMock(&usb_device);
+
+  interrupt_controller.RegisterISR(
+      AS_TIMER_INTERRUPT_SOURCE(COARSE_TIMER_ID), NewCallback(&TimerEvent));
+  interrupt_controller.RegisterISR(
+      AS_TIMER_INTERRUPT_SOURCE(TRANSCEIVER_TIMER),
+      NewCallback(&Transceiver_TimerEvent));
+  interrupt_controller.RegisterISR(
+      AS_IC_INTERRUPT_SOURCE(TRANSCEIVER_IC), NewCallback(&InputCaptureEvent));
+  interrupt_controller.RegisterISR(
+      AS_USART_INTERRUPT_ERROR_SOURCE(TRANSCEIVER_UART),
+      NewCallback(&Transceiver_UARTEvent));
+  interrupt_controller.RegisterISR(
+      AS_USART_INTERRUPT_TX_SOURCE(TRANSCEIVER_UART),
+      NewCallback(&Transceiver_UARTEvent));
+  interrupt_controller.RegisterISR(
+      AS_USART_INTERRUPT_RX_SOURCE(TRANSCEIVER_UART),
+      NewCallback(&Transceiver_UARTEvent));
+  interrupt_controller.RegisterISR(
+      AS_DMA_INTERRUPT_SOURCE(TRANSCEIVER_TX_DMA_CHANNEL),
+      NewCallback(&Transceiver_TXDMAEvent));
+  interrupt_controller.RegisterISR(
+      AS_DMA_INTERRUPT_SOURCE(TRANSCEIVER_RX_DMA_CHANNEL),
+      NewCallback(&Transceiver_RXDMAEvent));
+
+  APP_Initialize();
+  simulator.AddTask(app_tasks.get());
+
+  g_simulator = &simulator;
+  signal(SIGINT, StopSimulator);
+  signal(SIGTERM, StopSimulator);
+
+  printf("Listening on %s, UID 7a70:1%06x0\n", options.socket,
+         options.serial_number);
+  fflush(stdout);
+  if (options.duration) {
+    simulator.SetClockLimit(options.duration * 1000000ull, false);
+  }
+  simulator.Run();
+
+  g_simulator = nullptr;
+  simulator.RemoveTask(app_tasks.get());
+  USBDevice_SetMock(nullptr);
+  SYS_INT_SetMock(nullptr);
+  PLIB_DMA_SetMock(nullptr);
+  PLIB_USART_SetMock(nullptr);
+  PLIB_IC_SetMock(nullptr);
+  PLIB_TMR_SetMock(nullptr);
+  PLIB_Eth_SetMock(nullptr);
+  return EX_OK;
+}
@@ -0,0 +1,37 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * app_pipeline.h
+ * Copyright (C) 2015 Simon Newton
+ *
+ * The pipeline for the virtual device. This is the default USB to DMX
+ * pipeline, along with the declarations of the pipeline functions, since the
+ * native build doesn't allow implicit declarations.
+ */
+
+#ifndef TESTS_VIRTUAL_APP_PIPELINE_H_
+#define TESTS_VIRTUAL_APP_PIPELINE_H_
+
+#include "dmx_stream.h"
+#include "message_handler.h"
+#include "responder.h"
+#include "stream_decoder.h"
+#include "transceiver.h"
+#include "usb_console.h"
+#include "usb_transport.h"
+
+#include "default/app_pipeline.h"
+
+#endif  // TESTS_VIRTUAL_APP_PIPELINE_H_
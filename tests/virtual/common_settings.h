@@ -0,0 +1,51 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * common_settings.h
+ * Copyright (C) 2015 Simon Newton
+ */
+
+#ifndef TESTS_VIRTUAL_COMMON_SETTINGS_H_
+#define TESTS_VIRTUAL_COMMON_SETTINGS_H_
+
+#include "config_options.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief The hardware model.
+ * @sa JaRuleModel
+ */
+#define HARDWARE_MODEL MODEL_UNDEFINED
+
+/**
+ * @brief The manufacturer ID to use for the UID.
+ */
+#define CFG_MANUFACTURER_ID 0x7a70
+
+/**
+ * @brief Derive the UID from the MAC address.
+ *
+ * The virtual device supplies the MAC address through the PLIB_ETH mock.
+ */
+#define CFG_UID_SOURCE UID_FROM_MAC
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // TESTS_VIRTUAL_COMMON_SETTINGS_H_
@@ -0,0 +1,32 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * temperature.c
+ * The virtual device has no ADC, so it reports a fixed temperature.
+ * Copyright (C) 2015 Simon Newton
+ */
+
+#include "temperature.h"
+
+// 25 degrees, in 10ths of a degree.
+static const uint16_t VIRTUAL_TEMPERATURE = 250u;
+
+void Temperature_Init() {}
+
+uint16_t Temperature_GetValue(TemperatureSensor sensor) {
+  return VIRTUAL_TEMPERATURE;
+}
+
+void Temperature_Tasks() {}
@@ -0,0 +1,31 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * usb_console.c
+ * The virtual device has no CDC interface, so log messages go to stderr.
+ * Copyright (C) 2015 Simon Newton
+ */
+
+#include "usb_console.h"
+
+#include <stdio.h>
+
+void USBConsole_Initialize() {}
+
+void USBConsole_Log(const char* message) {
+  fprintf(stderr, "%s\n", message);
+}
+
+void USBConsole_Tasks() {}
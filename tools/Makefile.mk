@@ -4,13 +4,24 @@ noinst_LTLIBRARIES += tools/libdfu.la
 tools_libdfu_la_SOURCES = tools/dfu.c \
                           tools/utils.c
 
+noinst_LTLIBRARIES += tools/libjaruleclient.la
+tools_libjaruleclient_la_SOURCES = tools/ja_rule_client.cpp \
+                                   tools/ja_rule_client.h
+tools_libjaruleclient_la_CXXFLAGS = $(WARNING_CFLAGS) $(WARNING_CXXFLAGS)
+
 # Programs
 ##################################################
 noinst_PROGRAMS += tools/hex2dfu \
+                   tools/ja_rule_cli \
                    tools/uid2dfu
 
 tools_hex2dfu_SOURCES = tools/hex2dfu.c
 tools_hex2dfu_LDADD = tools/libdfu.la
 
+tools_ja_rule_cli_SOURCES = tools/ja_rule_cli.cpp
+tools_ja_rule_cli_CXXFLAGS = $(WARNING_CFLAGS) $(WARNING_CXXFLAGS)
+tools_ja_rule_cli_LDADD = tools/libdfu.la \
+                          tools/libjaruleclient.la
+
 tools_uid2dfu_SOURCES = tools/uid2dfu.c
 tools_uid2dfu_LDADD = tools/libdfu.la
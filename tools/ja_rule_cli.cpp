@@ -0,0 +1,304 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * ja_rule_cli.cpp
+ * Copyright (C) 2015 Simon Newton.
+ */
+
+#include <getopt.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sysexits.h>
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "tools/ja_rule_client.h"
+#include "tools/utils.h"
+
+using ja_rule::Client;
+using ja_rule::RequestResult;
+using ja_rule::Response;
+using ja_rule::Transport;
+
+typedef struct {
+  const char *device;
+  const char *socket;
+  uint32_t count;
+  uint32_t timeout;
+  uint32_t window;
+  bool quiet;
+  bool help;
+} Options;
+
+void DisplayHelpAndExit(const char *arg0, int exit_code) {
+  printf("Usage: %s [options] <command> [args]\n", arg0);
+  printf("  -c, --count <n>    Send the request n times, default 1\n");
+  printf("  -d, --device <path>  The tty or pty to use\n");
+  printf("  -h, --help   Show the help message\n");
+  printf("  -q, --quiet  Only print the summary\n");
+  printf("  -s, --socket <path>  The Unix domain socket to connect to\n");
+  printf("  -t, --timeout <ms>  The response timeout, default %u\n",
+         Client::DEFAULT_TIMEOUT);
+  printf("  -w, --window <n>  The outstanding request limit, default %u\n",
+         Client::DEFAULT_WINDOW);
+  printf("\n");
+  printf("Commands:\n");
+  printf("  echo [bytes...]    Echo the bytes\n");
+  printf("  dmx [slots...]     Send a DMX frame with the slot values\n");
+  printf("  flags              Get the flags\n");
+  printf("  info               Get the hardware info\n");
+  printf("  stats              Get the USB transport stats\n");
+  printf("  raw <command> [bytes...]  Send a raw command\n");
+  exit(exit_code);
+}
+
+bool InitOptions(Options *options, int argc, char *argv[]) {
+  options->device = NULL;
+  options->socket = NULL;
+  options->count = 1u;
+  options->timeout = Client::DEFAULT_TIMEOUT;
+  options->window = Client::DEFAULT_WINDOW;
+  options->quiet = false;
+  options->help = false;
+
+  static struct option long_options[] = {
+      {"count", required_argument, 0, 'c'},
+      {"device", required_argument, 0, 'd'},
+      {"help", no_argument, 0, 'h'},
+      {"quiet", no_argument, 0, 'q'},
+      {"socket", required_argument, 0, 's'},
+      {"timeout", required_argument, 0, 't'},
+      {"window", required_argument, 0, 'w'},
+      {0, 0, 0, 0}
+    };
+
+  int c;
+  int option_index = 0;
+
+  while (1) {
+    c = getopt_long(argc, argv, "c:d:hqs:t:w:", long_options, &option_index);
+
+    if (c == -1)
+      break;
+
+    switch (c) {
+      case 0:
+        break;
+      case 'c':
+        if (!StringToUInt32(optarg, &options->count)) {
+          printf("Invalid count\n");
+          exit(EX_USAGE);
+        }
+        break;
+      case 'd':
+        options->device = optarg;
+        break;
+      case 'h':
+        options->help = true;
+        break;
+      case 'q':
+        options->quiet = true;
+        break;
+      case 's':
+        options->socket = optarg;
+        break;
+      case 't':
+        if (!StringToUInt32(optarg, &options->timeout)) {
+          printf("Invalid timeout\n");
+          exit(EX_USAGE);
+        }
+        break;
+      case 'w':
+        if (!StringToUInt32(optarg, &options->window) ||
+            options->window == 0u || options->window > 255u) {
+          printf("Invalid window, must be between 1 and 255\n");
+          exit(EX_USAGE);
+        }
+        break;
+      default:
+        {}
+    }
+  }
+
+  if (options->help) {
+    DisplayHelpAndExit(argv[0], 0);
+  }
+
+  if ((options->device == NULL) == (options->socket == NULL)) {
+    printf("Exactly one of --device or --socket is required\n");
+    exit(EX_USAGE);
+  }
+
+  if (optind >= argc) {
+    printf("Missing command\n");
+    exit(EX_USAGE);
+  }
+  return true;
+}
+
+/*
+ * @brief Convert the remaining arguments to bytes.
+ */
+bool ParseBytes(int argc, char *argv[], int start, std::vector<uint8_t> *data) {
+  for (int i = start; i < argc; i++) {
+    uint16_t value;
+    if (!StringToUInt16(argv[i], &value) || value > 0xff) {
+      printf("Invalid byte: %s\n", argv[i]);
+      return false;
+    }
+    data->push_back(value);
+  }
+  return true;
+}
+
+/*
+ * @brief Build the request from the command line.
+ */
+bool ParseCommand(int argc, char *argv[], Command *command,
+                  std::vector<uint8_t> *data) {
+  const char *name = argv[optind];
+  if (strcmp(name, "echo") == 0) {
+    *command = COMMAND_ECHO;
+    return ParseBytes(argc, argv, optind + 1, data);
+  } else if (strcmp(name, "dmx") == 0) {
+    // The payload excludes the null start code.
+    *command = TX_DMX;
+    return ParseBytes(argc, argv, optind + 1, data);
+  } else if (strcmp(name, "flags") == 0) {
+    *command = GET_FLAGS;
+    return true;
+  } else if (strcmp(name, "info") == 0) {
+    *command = COMMAND_GET_HARDWARE_INFO;
+    return true;
+  } else if (strcmp(name, "stats") == 0) {
+    *command = COMMAND_GET_TRANSPORT_STATS;
+    return true;
+  } else if (strcmp(name, "raw") == 0) {
+    uint16_t value;
+    if (optind + 1 >= argc || !StringToUInt16(argv[optind + 1], &value)) {
+      printf("Invalid command\n");
+      return false;
+    }
+    *command = static_cast<Command>(value);
+    return ParseBytes(argc, argv, optind + 2, data);
+  }
+  printf("Unknown command: %s\n", name);
+  return false;
+}
+
+void PrintResponse(const Response &response) {
+  printf("Token: %u, Command: 0x%04x, RC: %u", response.token,
+         response.command, response.return_code);
+  if (response.Truncated()) {
+    printf(", truncated");
+  }
+  if (response.FlagsChanged()) {
+    printf(", flags changed");
+  }
+  printf(", %zu bytes\n", response.payload.size());
+  for (unsigned int i = 0; i < response.payload.size(); i++) {
+    printf("%02x%c", response.payload[i],
+           (i % 16 == 15 || i + 1 == response.payload.size()) ? '\n' : ' ');
+  }
+}
+
+int main(int argc, char *argv[]) {
+  Options options;
+  if (!InitOptions(&options, argc, argv)) {
+    return EX_USAGE;
+  }
+
+  Command command;
+  std::vector<uint8_t> data;
+  if (!ParseCommand(argc, argv, &command, &data)) {
+    return EX_USAGE;
+  }
+
+  if (data.size() > PAYLOAD_SIZE) {
+    printf("Payload too large, max %u bytes\n", PAYLOAD_SIZE);
+    return EX_USAGE;
+  }
+
+  std::unique_ptr<Transport> transport(
+      options.socket ? ja_rule::OpenSocketTransport(options.socket) :
+                       ja_rule::OpenSerialTransport(options.device));
+  if (!transport.get()) {
+    printf("Failed to open %s\n",
+           options.socket ? options.socket : options.device);
+    return EX_UNAVAILABLE;
+  }
+
+  Client client(transport.get(), options.window, options.timeout);
+  client.SetFlagsCallback([&options](const std::vector<uint8_t> &flags) {
+    if (!options.quiet) {
+      printf("Flags:");
+      for (auto flag : flags) {
+        printf(" %02x", flag);
+      }
+      printf("\n");
+    }
+  });
+
+  unsigned int ok = 0u;
+  unsigned int failed = 0u;
+  auto on_complete = [&](RequestResult result, const Response &response) {
+    if (result != ja_rule::RESULT_OK) {
+      failed++;
+      if (!options.quiet) {
+        printf("Request failed: %s\n",
+               result == ja_rule::RESULT_TIMEOUT ? "timeout" : "error");
+      }
+      return;
+    }
+    if (response.return_code != RC_MORE_DATA) {
+      ok++;
+    }
+    if (!options.quiet) {
+      PrintResponse(response);
+    }
+  };
+
+  auto start = std::chrono::steady_clock::now();
+  for (unsigned int i = 0; i < options.count; i++) {
+    client.Send(command, data.data(), data.size(), on_complete);
+  }
+
+  bool open = true;
+  while (open && !client.Idle()) {
+    open = client.Poll(-1);
+  }
+  auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - start).count();
+
+  const ja_rule::ClientStats &stats = client.Stats();
+  printf("%u ok, %u failed in %lld us", ok, failed,
+         static_cast<long long>(elapsed));
+  if (elapsed) {
+    printf(", %.1f requests / s", (ok + failed) * 1000000.0 / elapsed);
+  }
+  printf("\n");
+  if (stats.truncated_responses || stats.unmatched_responses ||
+      stats.discarded_bytes) {
+    printf("%u truncated, %u unmatched, %u bytes discarded\n",
+           stats.truncated_responses, stats.unmatched_responses,
+           stats.discarded_bytes);
+  }
+  return (open && failed == 0u) ? EX_OK : EX_SOFTWARE;
+}
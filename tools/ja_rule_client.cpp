@@ -0,0 +1,422 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * ja_rule_client.cpp
+ * Copyright (C) 2015 Simon Newton.
+ */
+
+#include "tools/ja_rule_client.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <utility>
+
+#include "firmware/src/latency_trace_format.h"
+
+namespace ja_rule {
+
+namespace {
+
+/*
+ * SOM, token, command (2), length (2), return code & status.
+ */
+const unsigned int RESPONSE_HEADER_SIZE = 8u;
+
+/*
+ * SOM, token, command (2) & length (2).
+ */
+const unsigned int REQUEST_HEADER_SIZE = 6u;
+
+/*
+ * The latency trace trailer, see latency_trace_format.h in the firmware.
+ */
+const unsigned int TRACE_TRAILER_SIZE = LATENCY_TRACE_TRAILER_SIZE;
+
+const unsigned int MAX_WINDOW = 255u;
+
+/*
+ * Large enough for a complete transfer from the device, since packet based
+ * transports discard the remainder of a message that doesn't fit.
+ */
+const unsigned int READ_SIZE = 2048u;
+
+inline uint16_t JoinLittleEndian(uint8_t lsb, uint8_t msb) {
+  return (msb << 8) | lsb;
+}
+
+bool SetNonBlocking(int fd) {
+  int flags = fcntl(fd, F_GETFL, 0);
+  return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+}  // namespace
+
+// DescriptorTransport
+// ----------------------------------------------------------------------------
+DescriptorTransport::DescriptorTransport(int fd)
+    : m_fd(fd) {
+  SetNonBlocking(m_fd);
+}
+
+DescriptorTransport::~DescriptorTransport() {
+  close(m_fd);
+}
+
+bool DescriptorTransport::Send(const uint8_t *data, unsigned int size) {
+  while (size) {
+    ssize_t r = write(m_fd, data, size);
+    if (r < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      if (errno != EAGAIN && errno != EWOULDBLOCK) {
+        return false;
+      }
+      // The other end is slow to drain, wait until we can write again.
+      struct pollfd pfd = {m_fd, POLLOUT, 0};
+      if (poll(&pfd, 1, -1) < 0 && errno != EINTR) {
+        return false;
+      }
+      continue;
+    }
+    data += r;
+    size -= r;
+  }
+  return true;
+}
+
+int DescriptorTransport::Receive(uint8_t *data, unsigned int size) {
+  ssize_t r = read(m_fd, data, size);
+  if (r < 0) {
+    return (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) ?
+        0 : -1;
+  }
+  // A read of 0 bytes from a readable descriptor means it was closed.
+  return r == 0 ? -1 : r;
+}
+
+std::unique_ptr<Transport> OpenSocketTransport(const std::string &path) {
+  struct sockaddr_un address;
+  if (path.size() >= sizeof(address.sun_path)) {
+    return std::unique_ptr<Transport>();
+  }
+
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  memcpy(address.sun_path, path.c_str(), path.size());
+
+  // Prefer sequenced packets, they keep the request boundaries the same as a
+  // USB transfer does.
+  const int types[] = {SOCK_SEQPACKET, SOCK_STREAM};
+  for (unsigned int i = 0; i < sizeof(types) / sizeof(types[0]); i++) {
+    int fd = socket(AF_UNIX, types[i], 0);
+    if (fd < 0) {
+      continue;
+    }
+    if (connect(fd, reinterpret_cast<struct sockaddr*>(&address),
+                sizeof(address)) == 0) {
+      return std::unique_ptr<Transport>(new DescriptorTransport(fd));
+    }
+    int error = errno;
+    close(fd);
+    if (error != EPROTOTYPE) {
+      break;
+    }
+  }
+  return std::unique_ptr<Transport>();
+}
+
+std::unique_ptr<Transport> OpenSerialTransport(const std::string &path) {
+  int fd = open(path.c_str(), O_RDWR | O_NOCTTY);
+  if (fd < 0) {
+    return std::unique_ptr<Transport>();
+  }
+
+  struct termios options;
+  if (tcgetattr(fd, &options) == 0) {
+    cfmakeraw(&options);
+    tcsetattr(fd, TCSANOW, &options);
+  }
+  return std::unique_ptr<Transport>(new DescriptorTransport(fd));
+}
+
+// Client
+// ----------------------------------------------------------------------------
+const unsigned int Client::DEFAULT_WINDOW;
+const unsigned int Client::DEFAULT_TIMEOUT;
+
+Client::Client(Transport *transport, unsigned int window, unsigned int timeout)
+    : m_transport(transport),
+      m_window(std::max(1u, std::min(window, MAX_WINDOW))),
+      m_timeout(std::chrono::milliseconds(timeout)),
+      m_next_token(0u),
+      m_flags_pending(false) {
+  memset(&m_stats, 0, sizeof(m_stats));
+}
+
+Client::~Client() {
+  CancelAll(RESULT_CANCELLED);
+}
+
+bool Client::Send(Command command, const uint8_t *data, unsigned int size,
+                  Callback callback) {
+  if (size > PAYLOAD_SIZE) {
+    return false;
+  }
+
+  Request request;
+  request.command = command;
+  if (size) {
+    request.payload.assign(data, data + size);
+  }
+  request.callback = callback;
+  m_queue.push_back(std::move(request));
+  SendQueued();
+  return true;
+}
+
+bool Client::Poll(int timeout) {
+  struct pollfd pfd = {m_transport->Descriptor(), POLLIN, 0};
+  int r = poll(&pfd, 1, NextDeadline(timeout));
+  if (r < 0 && errno != EINTR) {
+    CancelAll(RESULT_CANCELLED);
+    return false;
+  }
+
+  if (r > 0) {
+    uint8_t data[READ_SIZE];
+    int size = m_transport->Receive(data, sizeof(data));
+    if (size < 0) {
+      CancelAll(RESULT_CANCELLED);
+      return false;
+    }
+    m_rx_buffer.insert(m_rx_buffer.end(), data, data + size);
+    Decode();
+  }
+
+  ExpireRequests();
+  SendQueued();
+  return true;
+}
+
+/*
+ * @brief Send queued requests until the window is full.
+ */
+void Client::SendQueued() {
+  while (!m_queue.empty() && m_in_flight.size() < m_window) {
+    // Skip over tokens that are still in use, the window is always smaller
+    // than the token space so this terminates.
+    while (m_in_flight.find(m_next_token) != m_in_flight.end()) {
+      m_next_token++;
+    }
+    uint8_t token = m_next_token++;
+
+    Request request = std::move(m_queue.front());
+    m_queue.pop_front();
+
+    if (!SendRequest(token, request)) {
+      Response response;
+      request.callback(RESULT_TRANSPORT_ERROR, response);
+      continue;
+    }
+    request.deadline = Clock::now() + m_timeout;
+    m_in_flight[token] = std::move(request);
+  }
+}
+
+bool Client::SendRequest(uint8_t token, const Request &request) {
+  uint16_t size = request.payload.size();
+  std::vector<uint8_t> frame;
+  frame.reserve(REQUEST_HEADER_SIZE + size + 1u);
+  frame.push_back(START_OF_MESSAGE_ID);
+  frame.push_back(token);
+  frame.push_back(request.command & 0xff);
+  frame.push_back(request.command >> 8);
+  frame.push_back(size & 0xff);
+  frame.push_back(size >> 8);
+  frame.insert(frame.end(), request.payload.begin(), request.payload.end());
+  frame.push_back(END_OF_MESSAGE_ID);
+
+  if (!m_transport->Send(frame.data(), frame.size())) {
+    return false;
+  }
+  m_stats.requests_sent++;
+  return true;
+}
+
+/*
+ * @brief Extract the complete responses from the receive buffer.
+ *
+ * If the framing is wrong, we skip to the next start of message and try again.
+ */
+void Client::Decode() {
+  unsigned int offset = 0u;
+  while (offset < m_rx_buffer.size()) {
+    const uint8_t *data = &m_rx_buffer[offset];
+    unsigned int remaining = m_rx_buffer.size() - offset;
+    if (data[0] != START_OF_MESSAGE_ID) {
+      offset++;
+      m_stats.discarded_bytes++;
+      continue;
+    }
+
+    if (remaining < RESPONSE_HEADER_SIZE) {
+      break;
+    }
+
+    uint16_t length = JoinLittleEndian(data[4], data[5]);
+    uint8_t status = data[7];
+    unsigned int trailer_size = (status & TRANSPORT_LATENCY_TRACE) ?
+        TRACE_TRAILER_SIZE : 0u;
+    unsigned int frame_size = RESPONSE_HEADER_SIZE + length + trailer_size + 1u;
+    if (length > PAYLOAD_SIZE) {
+      offset++;
+      m_stats.discarded_bytes++;
+      continue;
+    }
+
+    if (remaining < frame_size) {
+      break;
+    }
+
+    if (data[frame_size - 1u] != END_OF_MESSAGE_ID) {
+      offset++;
+      m_stats.discarded_bytes++;
+      continue;
+    }
+
+    Response response;
+    response.token = data[1];
+    response.command = JoinLittleEndian(data[2], data[3]);
+    response.return_code = data[6];
+    response.status = status;
+    const uint8_t *payload = data + RESPONSE_HEADER_SIZE;
+    response.payload.assign(payload, payload + length);
+    response.trace.assign(payload + length, payload + length + trailer_size);
+    offset += frame_size;
+
+    HandleResponse(response);
+  }
+  m_rx_buffer.erase(m_rx_buffer.begin(), m_rx_buffer.begin() + offset);
+}
+
+void Client::HandleResponse(const Response &response) {
+  m_stats.responses_received++;
+  if (response.Truncated()) {
+    m_stats.truncated_responses++;
+  }
+
+  if (response.FlagsChanged()) {
+    FetchFlags();
+  }
+
+  auto iter = m_in_flight.find(response.token);
+  if (iter == m_in_flight.end() ||
+      iter->second.command != response.command) {
+    m_stats.unmatched_responses++;
+    return;
+  }
+
+  Callback callback = iter->second.callback;
+  if (response.return_code == RC_MORE_DATA) {
+    iter->second.deadline = Clock::now() + m_timeout;
+  } else {
+    // Remove the request first, the callback may send more requests.
+    m_in_flight.erase(iter);
+  }
+  callback(RESULT_OK, response);
+}
+
+/*
+ * @brief Ask the device for the flags, unless we're already doing so.
+ */
+void Client::FetchFlags() {
+  if (m_flags_pending || !m_flags_callback) {
+    return;
+  }
+
+  m_flags_pending = true;
+  Send(GET_FLAGS, NULL, 0u,
+       [this](RequestResult result, const Response &response) {
+    m_flags_pending = false;
+    if (result == RESULT_OK && response.return_code == RC_OK &&
+        m_flags_callback) {
+      m_flags_callback(response.payload);
+    }
+  });
+}
+
+void Client::ExpireRequests() {
+  Clock::time_point now = Clock::now();
+  auto iter = m_in_flight.begin();
+  while (iter != m_in_flight.end()) {
+    if (iter->second.deadline > now) {
+      ++iter;
+      continue;
+    }
+    Callback callback = iter->second.callback;
+    iter = m_in_flight.erase(iter);
+    m_stats.timeouts++;
+    Response response;
+    callback(RESULT_TIMEOUT, response);
+  }
+}
+
+void Client::CancelAll(RequestResult result) {
+  std::vector<Callback> callbacks;
+  for (auto &entry : m_in_flight) {
+    callbacks.push_back(entry.second.callback);
+  }
+  for (auto &request : m_queue) {
+    callbacks.push_back(request.callback);
+  }
+  m_in_flight.clear();
+  m_queue.clear();
+
+  Response response;
+  for (auto &callback : callbacks) {
+    callback(result, response);
+  }
+}
+
+/*
+ * @brief Limit the poll timeout so we wake up for the next request expiry.
+ */
+int Client::NextDeadline(int timeout) const {
+  if (m_in_flight.empty()) {
+    return timeout;
+  }
+
+  Clock::time_point deadline = m_in_flight.begin()->second.deadline;
+  for (auto &entry : m_in_flight) {
+    deadline = std::min(deadline, entry.second.deadline);
+  }
+
+  auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+      deadline - Clock::now()).count();
+  remaining = std::max<decltype(remaining)>(remaining, 0);
+  if (timeout < 0 || remaining < timeout) {
+    return remaining;
+  }
+  return timeout;
+}
+}  // namespace ja_rule
@@ -0,0 +1,293 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * ja_rule_client.h
+ * Copyright (C) 2015 Simon Newton.
+ */
+
+/**
+ * @file ja_rule_client.h
+ * @brief An asynchronous host side client for the Ja Rule message protocol.
+ *
+ * The client frames requests, assigns each one a token and keeps up to a
+ * configurable number of them outstanding with the device. Responses are
+ * matched to requests using the token, so they may complete in any order.
+ *
+ * The client doesn't own an event loop, call Client::Poll() to read from the
+ * transport, run the completion callbacks and expire old requests.
+ */
+
+#ifndef TOOLS_JA_RULE_CLIENT_H_
+#define TOOLS_JA_RULE_CLIENT_H_
+
+#include <stdint.h>
+
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "firmware/src/transport.h"
+
+namespace ja_rule {
+
+/**
+ * @brief A byte stream to and from a Ja Rule device.
+ */
+class Transport {
+ public:
+  virtual ~Transport() {}
+
+  /**
+   * @brief Send data to the device.
+   * @returns true if all the data was written, false on error.
+   */
+  virtual bool Send(const uint8_t *data, unsigned int size) = 0;
+
+  /**
+   * @brief Read the data that is available from the device.
+   * @returns The number of bytes read, 0 if there was no data, or -1 if the
+   *   transport was closed or failed.
+   */
+  virtual int Receive(uint8_t *data, unsigned int size) = 0;
+
+  /**
+   * @brief The file descriptor to wait on for new data.
+   */
+  virtual int Descriptor() const = 0;
+};
+
+/**
+ * @brief A Transport that uses a file descriptor.
+ *
+ * This works with anything that behaves like a stream: a Unix domain socket,
+ * one end of a socketpair() or a pty. Each request is sent with a single
+ * write, so packet based sockets see one request per packet.
+ */
+class DescriptorTransport : public Transport {
+ public:
+  /**
+   * @brief Create a new DescriptorTransport.
+   * @param fd The file descriptor, it's switched to non-blocking mode and
+   *   closed when the transport is destroyed.
+   */
+  explicit DescriptorTransport(int fd);
+  ~DescriptorTransport();
+
+  bool Send(const uint8_t *data, unsigned int size);
+  int Receive(uint8_t *data, unsigned int size);
+  int Descriptor() const { return m_fd; }
+
+ private:
+  int m_fd;
+
+  DescriptorTransport(const DescriptorTransport&) = delete;
+  DescriptorTransport& operator=(const DescriptorTransport&) = delete;
+};
+
+/**
+ * @brief Connect to a Unix domain socket.
+ * @returns A new Transport or NULL if the connect failed.
+ *
+ * SOCK_SEQPACKET sockets, like the one used by the virtual device, are tried
+ * first, then SOCK_STREAM.
+ */
+std::unique_ptr<Transport> OpenSocketTransport(const std::string &path);
+
+/**
+ * @brief Open a tty or pty, and switch it to raw mode.
+ * @returns A new Transport or NULL if the open failed.
+ */
+std::unique_ptr<Transport> OpenSerialTransport(const std::string &path);
+
+/**
+ * @brief A response from the device.
+ */
+struct Response {
+  uint8_t token;
+  uint16_t command;
+  uint8_t return_code;
+  uint8_t status;  //!< The TransportFlags bits.
+  std::vector<uint8_t> payload;
+  std::vector<uint8_t> trace;  //!< The latency trace trailer, if present.
+
+  /**
+   * @brief True if the device truncated the payload to fit the message.
+   */
+  bool Truncated() const { return status & TRANSPORT_MSG_TRUNCATED; }
+
+  /**
+   * @brief True if the device flags have changed.
+   */
+  bool FlagsChanged() const { return status & TRANSPORT_FLAGS_CHANGED; }
+};
+
+/**
+ * @brief The outcome of a request.
+ */
+typedef enum {
+  RESULT_OK,  //!< A response was received.
+  RESULT_TIMEOUT,  //!< No response was received in time.
+  RESULT_TRANSPORT_ERROR,  //!< The request couldn't be sent.
+  RESULT_CANCELLED  //!< The client was destroyed or the transport closed.
+} RequestResult;
+
+/**
+ * @brief Called when a request completes.
+ * @param result The outcome of the request.
+ * @param response The response, only valid if result is RESULT_OK.
+ *
+ * If the return code is RC_MORE_DATA, more responses will follow and the
+ * callback will be run again.
+ */
+typedef std::function<void(RequestResult result, const Response &response)>
+    Callback;
+
+/**
+ * @brief Called with the payload of a GET_FLAGS response.
+ */
+typedef std::function<void(const std::vector<uint8_t> &flags)> FlagsCallback;
+
+/**
+ * @brief Counters for the client.
+ */
+struct ClientStats {
+  unsigned int requests_sent;
+  unsigned int responses_received;
+  unsigned int truncated_responses;
+  unsigned int unmatched_responses;  //!< Responses with an unknown token.
+  unsigned int timeouts;
+  unsigned int discarded_bytes;  //!< Bytes skipped while looking for a frame.
+};
+
+/**
+ * @brief The asynchronous client.
+ */
+class Client {
+ public:
+  /**
+   * @brief The default number of outstanding requests.
+   */
+  static const unsigned int DEFAULT_WINDOW = 4u;
+
+  /**
+   * @brief The default time to wait for a response, in milliseconds.
+   */
+  static const unsigned int DEFAULT_TIMEOUT = 1000u;
+
+  /**
+   * @brief Create a new client.
+   * @param transport The transport to use, ownership is not transferred.
+   * @param window The maximum number of outstanding requests, between 1 and
+   *   255.
+   * @param timeout The time to wait for a response, in milliseconds.
+   */
+  explicit Client(Transport *transport,
+                  unsigned int window = DEFAULT_WINDOW,
+                  unsigned int timeout = DEFAULT_TIMEOUT);
+
+  /**
+   * @brief Destroy the client.
+   *
+   * Any outstanding requests are completed with RESULT_CANCELLED.
+   */
+  ~Client();
+
+  /**
+   * @brief Set the callback to run when the device flags are fetched.
+   *
+   * When a response arrives with TRANSPORT_FLAGS_CHANGED set, the client sends
+   * a GET_FLAGS request and passes the result to this callback.
+   */
+  void SetFlagsCallback(FlagsCallback callback) {
+    m_flags_callback = callback;
+  }
+
+  /**
+   * @brief Queue a request.
+   * @param command The command to send.
+   * @param data The payload, may be NULL if size is 0.
+   * @param size The size of the payload.
+   * @param callback The callback to run when the request completes.
+   * @returns false if the payload was larger than PAYLOAD_SIZE.
+   *
+   * The request is sent immediately if the window has space, otherwise it's
+   * sent once an earlier request completes.
+   */
+  bool Send(Command command, const uint8_t *data, unsigned int size,
+            Callback callback);
+
+  /**
+   * @brief Wait for and process data from the device.
+   * @param timeout The maximum time to wait, in milliseconds.
+   * @returns false if the transport was closed.
+   */
+  bool Poll(int timeout);
+
+  /**
+   * @brief The number of requests that have been sent, but not completed.
+   */
+  unsigned int InFlight() const { return m_in_flight.size(); }
+
+  /**
+   * @brief The number of requests waiting for space in the window.
+   */
+  unsigned int Queued() const { return m_queue.size(); }
+
+  /**
+   * @brief True if there are no requests queued or in flight.
+   */
+  bool Idle() const { return m_in_flight.empty() && m_queue.empty(); }
+
+  const ClientStats& Stats() const { return m_stats; }
+
+ private:
+  typedef std::chrono::steady_clock Clock;
+
+  struct Request {
+    Command command;
+    std::vector<uint8_t> payload;
+    Callback callback;
+    Clock::time_point deadline;
+  };
+
+  Transport *m_transport;
+  const unsigned int m_window;
+  const Clock::duration m_timeout;
+  uint8_t m_next_token;
+  bool m_flags_pending;
+  FlagsCallback m_flags_callback;
+  ClientStats m_stats;
+  std::deque<Request> m_queue;
+  std::map<uint8_t, Request> m_in_flight;
+  std::vector<uint8_t> m_rx_buffer;
+
+  void SendQueued();
+  bool SendRequest(uint8_t token, const Request &request);
+  void Decode();
+  void HandleResponse(const Response &response);
+  void FetchFlags();
+  void ExpireRequests();
+  void CancelAll(RequestResult result);
+  int NextDeadline(int timeout) const;
+
+  Client(const Client&) = delete;
+  Client& operator=(const Client&) = delete;
+};
+}  // namespace ja_rule
+#endif  // TOOLS_JA_RULE_CLIENT_H_
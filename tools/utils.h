@@ -23,6 +23,10 @@
 #include <stdbool.h>
 #include <stdint.h>
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 /**
  * @brief Convert a string to a uint16_t.
  * @returns true if the input was within range, false otherwise.
@@ -39,4 +43,8 @@ bool StringToUInt16(const char *input, uint16_t *output);
  */
 bool StringToUInt32(const char *input, uint32_t *output);
 
+#ifdef __cplusplus
+}
+#endif
+
 #endif  // TOOLS_UTILS_H_
@@ -154,7 +154,24 @@ void OutputTable(const string &model, const vector<PidEntry> &rows) {
   cout << "Output " << file_name << endl;
 }
 
-void GenerateTable(PidStoreHelper *pid_helper, const ModelProperties &model) {
+/*
+ * RDMResponder_DispatchPID() uses a binary search, so the descriptor tables
+ * must be sorted by PID with no duplicates. SUPPORTED_PARAMETERS is built
+ * from the table, so check it's in order.
+ */
+bool CheckPIDOrder(const ModelProperties &model, const vector<PidEntry> &rows) {
+  for (unsigned int i = 1; i < rows.size(); i++) {
+    if (rows[i - 1].value >= rows[i].value) {
+      cerr << "PID table for " << model.name << " is not sorted: "
+           << ola::strings::ToHex(rows[i - 1].value) << " is followed by "
+           << ola::strings::ToHex(rows[i].value) << endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+bool GenerateTable(PidStoreHelper *pid_helper, const ModelProperties &model) {
   UID controller_uid(0x7a70, 0x00000000);
   UID device_uid(TEST_UID);
 
@@ -173,7 +190,7 @@ void GenerateTable(PidStoreHelper *pid_helper, const ModelProperties &model) {
   if (!ola::rdm::RDMCommandSerializer::Pack(request, &data)) {
     cerr << "Failed to pack PID_SUPPORTED_PARAMETERS for " << model.name
          << endl;
-    return;
+    return false;
   }
 
   int size = model.entry->request_fn(
@@ -186,7 +203,7 @@ void GenerateTable(PidStoreHelper *pid_helper, const ModelProperties &model) {
 
   if (response.get() == nullptr || response->ParamDataSize() % 2 != 0) {
     cerr << "Invalid response for " << model.name << endl;
-    return;
+    return false;
   }
 
   const uint8_t *param_data = response->ParamData();
@@ -215,8 +232,11 @@ void GenerateTable(PidStoreHelper *pid_helper, const ModelProperties &model) {
       rows.push_back(entry);
     }
   }
-  std::sort(rows.begin(), rows.end());
+  if (!CheckPIDOrder(model, rows)) {
+    return false;
+  }
   OutputTable(model.name, rows);
+  return true;
 }
 
 int main(int argc, char* argv[]) {
@@ -232,7 +252,9 @@ int main(int argc, char* argv[]) {
     return ola::EXIT_DATAERR;
   }
 
+  bool ok = true;
   for (unsigned int i = 0; i < arraysize(MODELS); i++) {
-    GenerateTable(&pid_helper, MODELS[i]);
+    ok &= GenerateTable(&pid_helper, MODELS[i]);
   }
+  return ok ? ola::EXIT_OK : ola::EXIT_DATAERR;
 }